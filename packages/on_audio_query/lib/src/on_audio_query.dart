@@ -340,6 +340,51 @@ class OnAudioQuery {
     );
   }
 
+  /// Used to search songs while the user is typing (search-as-you-type).
+  ///
+  /// Parameters:
+  ///
+  /// * [argsVal] the text typed so far.
+  /// * [sessionId] is used to define the search field, every field keeps its
+  /// own session.
+  ///
+  /// Important:
+  ///
+  /// * A call supersedes the previous one of the same session: that search is
+  /// stopped and completes with null, only the newest text gets songs.
+  /// * Text extending the previous one ("bea" => "beat") filters the previous
+  /// songs instead of searching the whole library again.
+  /// * Songs are ranked like [queryWithFilters] (word prefixes first).
+  /// * Call [closeSearchSession] once the field is gone.
+  ///
+  /// Platforms:
+  ///
+  /// |   Android   |   IOS   |   Web   |   Linux   |
+  /// |--------------|-----------------|-----------------|-----------------|
+  /// | `❌` | `❌` | `❌` | `✔️` | <br>
+  ///
+  /// See more about [platforms support](https://github.com/LucJosin/on_audio_query/blob/main/PLATFORMS.md)
+  Future<List<SongModel>?> searchAsYouType(
+    String argsVal, {
+    int sessionId = 0,
+  }) async {
+    return platform.searchAsYouType(argsVal, sessionId: sessionId);
+  }
+
+  /// Used to release a [searchAsYouType] session (its last songs are kept
+  /// for the next keystroke until then).
+  ///
+  /// Platforms:
+  ///
+  /// |   Android   |   IOS   |   Web   |   Linux   |
+  /// |--------------|-----------------|-----------------|-----------------|
+  /// | `❌` | `❌` | `❌` | `✔️` | <br>
+  ///
+  /// See more about [platforms support](https://github.com/LucJosin/on_audio_query/blob/main/PLATFORMS.md)
+  Future<bool> closeSearchSession({int sessionId = 0}) async {
+    return await platform.closeSearchSession(sessionId: sessionId);
+  }
+
   /// Used to return Songs Artwork.
   ///
   /// Parameters:
@@ -385,6 +430,44 @@ class OnAudioQuery {
     );
   }
 
+  /// Used to return the artwork of several songs/albums at once (e.g. a grid).
+  ///
+  /// Parameters:
+  ///
+  /// * [ids] songs or albums ids.
+  /// * [type] is used to define if artworks are from audios or albums.
+  /// * [format], [size] and [quality] work like in [queryArtwork].
+  ///
+  /// Important:
+  ///
+  /// * Every event is the id and its artwork (null when there's none).
+  /// * Cached artworks are sent together first, the others are extracted in
+  /// parallel and sent as soon as each one is ready (not in [ids] order).
+  /// * The stream is closed once every id was sent.
+  ///
+  /// Platforms:
+  ///
+  /// |   Android   |   IOS   |   Web   |   Linux   |
+  /// |--------------|-----------------|-----------------|-----------------|
+  /// | `❌` | `❌` | `❌` | `✔️` | <br>
+  ///
+  /// See more about [platforms support](https://github.com/LucJosin/on_audio_query/blob/main/PLATFORMS.md)
+  Stream<MapEntry<int, Uint8List?>> queryArtworks(
+    List<int> ids,
+    ArtworkType type, {
+    ArtworkFormat? format,
+    int? size,
+    int? quality,
+  }) {
+    return platform.queryArtworks(
+      ids,
+      type,
+      format: format,
+      size: size,
+      quality: quality,
+    );
+  }
+
   /// Used to return Songs Info from a specific [Folder] based in [SongModel].
   ///
   /// Parameters:
@@ -664,4 +747,150 @@ class OnAudioQuery {
   Future<bool> scanMedia(String path) async {
     return await platform.scanMedia(path);
   }
+
+  /// Used to return timings and counters of the current (or last) media scan.
+  ///
+  /// Parameters:
+  ///
+  /// * [asJson] is used to define if the stats will be returned as a JSON [String]
+  /// instead of a [Map].
+  ///
+  /// Will return:
+  ///
+  /// * Per phase timings (walk, diff, extract, db write, aggregate) in microseconds.
+  /// * File counters (new, updated, deleted, failed).
+  /// * A histogram of per-file extraction latency.
+  ///
+  /// Platforms:
+  ///
+  /// |   Android   |   IOS   |   Web   |   Linux   |
+  /// |--------------|-----------------|-----------------|-----------------|
+  /// | `❌` | `❌` | `❌` | `✔️` | <br>
+  ///
+  /// See more about [platforms support](https://github.com/LucJosin/on_audio_query/blob/main/PLATFORMS.md)
+  Future<dynamic> queryScanStats({bool asJson = false}) async {
+    return await platform.queryScanStats(asJson: asJson);
+  }
+
+  /// Used to configure how the media library is scanned.
+  ///
+  /// Parameters:
+  ///
+  /// * [fastFirstScan] is used to define if scans that find many new files will
+  /// first insert rows built from the file path (title = file name, unknown
+  /// artist/album) and fill in tags afterwards. Enabled by default.
+  /// * [extractorTimeoutMs] is used to define how long (milliseconds) an external
+  /// metadata extractor may run on a single file before it's killed and the file
+  /// is quarantined. `0` disables the limit. Default: 30000.
+  /// * [indexArtwork] is used to define if scans also locate and hash embedded
+  /// artworks while tags are read, so [queryArtwork] doesn't need to extract them
+  /// later. Disabled by default.
+  /// * [artworkThumbnailSize] is used to define the size of the JPEG thumbnails
+  /// (quality 50, like [queryArtwork] defaults) rendered during indexing. `0`
+  /// disables them. Default: 0.
+  ///
+  /// Platforms:
+  ///
+  /// |   Android   |   IOS   |   Web   |   Linux   |
+  /// |--------------|-----------------|-----------------|-----------------|
+  /// | `❌` | `❌` | `❌` | `✔️` | <br>
+  ///
+  /// See more about [platforms support](https://github.com/LucJosin/on_audio_query/blob/main/PLATFORMS.md)
+  Future<bool> setScanOptions({
+    bool? fastFirstScan,
+    int? extractorTimeoutMs,
+    bool? indexArtwork,
+    int? artworkThumbnailSize,
+  }) async {
+    return await platform.setScanOptions(
+      fastFirstScan: fastFirstScan,
+      extractorTimeoutMs: extractorTimeoutMs,
+      indexArtwork: indexArtwork,
+      artworkThumbnailSize: artworkThumbnailSize,
+    );
+  }
+
+  /// Used to configure how artworks are looked up.
+  ///
+  /// Parameters:
+  ///
+  /// * [coverFileNames] is used to define the folder cover images (e.g. `cover.jpg`,
+  /// `folder.png`) checked next to the audio file before the embedded artwork.
+  /// Names are compared case-insensitively and the first one in the list wins.
+  /// An empty list disables folder covers.
+  /// * [cacheMaxBytes] is used to define how much disk space cached artworks
+  /// may use. Least recently/frequently shown artworks are removed above it.
+  /// `0` disables the limit. Default: 256 MB.
+  /// * [systemThumbnails] is used to define if thumbnails shared by desktop apps
+  /// (`~/.cache/thumbnails`, freedesktop.org spec) are read and written, so the
+  /// file manager and this app don't extract the same covers twice. Enabled by default.
+  ///
+  /// Platforms:
+  ///
+  /// |   Android   |   IOS   |   Web   |   Linux   |
+  /// |--------------|-----------------|-----------------|-----------------|
+  /// | `❌` | `❌` | `❌` | `✔️` | <br>
+  ///
+  /// See more about [platforms support](https://github.com/LucJosin/on_audio_query/blob/main/PLATFORMS.md)
+  Future<bool> setArtworkOptions({
+    List<String>? coverFileNames,
+    int? cacheMaxBytes,
+    bool? systemThumbnails,
+  }) async {
+    return await platform.setArtworkOptions(
+      coverFileNames: coverFileNames,
+      cacheMaxBytes: cacheMaxBytes,
+      systemThumbnails: systemThumbnails,
+    );
+  }
+
+  /// Used to return files skipped by media scans because the metadata
+  /// extractor hung or crashed on them.
+  ///
+  /// Every item is a [Map] with `_data` (path), `reason` (`timeout` or `crash`),
+  /// `file_mtime` and `quarantined_at`. A quarantined file is retried once it's
+  /// modified.
+  ///
+  /// Platforms:
+  ///
+  /// |   Android   |   IOS   |   Web   |   Linux   |
+  /// |--------------|-----------------|-----------------|-----------------|
+  /// | `❌` | `❌` | `❌` | `✔️` | <br>
+  ///
+  /// See more about [platforms support](https://github.com/LucJosin/on_audio_query/blob/main/PLATFORMS.md)
+  Future<List<Map<dynamic, dynamic>>> queryQuarantinedFiles() async {
+    return await platform.queryQuarantinedFiles();
+  }
+
+  /// Used to remove files from the scan quarantine.
+  ///
+  /// Parameters:
+  ///
+  /// * [path] is used to define a single file to release. When null, every
+  /// quarantined file is released.
+  ///
+  /// Platforms:
+  ///
+  /// |   Android   |   IOS   |   Web   |   Linux   |
+  /// |--------------|-----------------|-----------------|-----------------|
+  /// | `❌` | `❌` | `❌` | `✔️` | <br>
+  ///
+  /// See more about [platforms support](https://github.com/LucJosin/on_audio_query/blob/main/PLATFORMS.md)
+  Future<bool> clearQuarantine({String? path}) async {
+    return await platform.clearQuarantine(path: path);
+  }
+
+  /// Used to listen for songs inserted or updated by a media scan.
+  ///
+  /// Every event is a list of song ids. During a fast-first scan the songs are
+  /// first sent with placeholder info, then again once their tags are read.
+  ///
+  /// Platforms:
+  ///
+  /// |   Android   |   IOS   |   Web   |   Linux   |
+  /// |--------------|-----------------|-----------------|-----------------|
+  /// | `❌` | `❌` | `❌` | `✔️` | <br>
+  ///
+  /// See more about [platforms support](https://github.com/LucJosin/on_audio_query/blob/main/PLATFORMS.md)
+  Stream<List<int>> get onSongsChanged => platform.onSongsChanged;
 }
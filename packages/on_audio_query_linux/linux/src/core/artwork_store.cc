@@ -0,0 +1,288 @@
+#include "artwork_store.h"
+#include "../utils/md5.h"
+#include <iostream>
+#include <filesystem>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace on_audio_query_linux {
+
+ArtworkStore::ArtworkStore(DatabaseManager* db_manager, const std::string& root_directory)
+    : db_manager_(db_manager),
+      root_directory_(root_directory),
+      mappings_(kMaxCachedMappings),
+      budget_bytes_(kDefaultBudgetBytes),
+      stored_bytes_(0),
+      maintenance_requested_(false),
+      compaction_pending_(true),
+      stop_requested_(false) {}
+
+ArtworkStore::~ArtworkStore() {
+  {
+    std::lock_guard<std::mutex> lock(maintenance_mutex_);
+    stop_requested_ = true;
+  }
+  maintenance_cv_.notify_all();
+  if (maintenance_thread_.joinable()) {
+    maintenance_thread_.join();
+  }
+  FlushAccesses();
+}
+
+bool ArtworkStore::Initialize() {
+  std::error_code error;
+  std::filesystem::create_directories(root_directory_, error);
+  if (error) {
+    std::cerr << "[ArtworkStore] Failed to create " << root_directory_ << ": "
+              << error.message() << std::endl;
+    return false;
+  }
+
+  stored_bytes_.store(db_manager_->GetArtworkStoreSize());
+  if (!maintenance_thread_.joinable()) {
+    maintenance_thread_ = std::thread(&ArtworkStore::MaintenanceLoop, this);
+  }
+  return true;
+}
+
+void ArtworkStore::SetBudget(int64_t max_bytes) {
+  budget_bytes_.store(max_bytes > 0 ? max_bytes : 0);
+  RequestMaintenance();
+}
+
+std::string ArtworkStore::MappingKey(const ArtworkCacheKey& key) {
+  //source + mtime are part of the key => a changed source never hits a stale entry
+  return std::to_string(key.id) + '|' + std::to_string(key.type) + '|' +
+         std::to_string(key.size) + '|' + key.format + '|' + std::to_string(key.quality) + '|' +
+         std::to_string(key.source_mtime) + '|' + key.source;
+}
+
+std::string ArtworkStore::PathForHash(const std::string& hash) const {
+  //two-character fan-out keeps directories small
+  return root_directory_ + "/" + hash.substr(0, 2) + "/" + hash;
+}
+
+std::optional<MappedRegion> ArtworkStore::MapHash(const std::string& hash) const {
+  if (hash.size() < 2) {
+    return std::nullopt;
+  }
+  return MappedRegion::MapFile(PathForHash(hash));
+}
+
+std::optional<MappedRegion> ArtworkStore::Lookup(const ArtworkCacheKey& key) {
+  std::string mapping_key = MappingKey(key);
+
+  auto hash = mappings_.Get(mapping_key);
+  if (!hash.has_value()) {
+    hash = db_manager_->GetArtworkHash(key);
+    if (!hash.has_value()) {
+      return std::nullopt;
+    }
+    mappings_.Put(mapping_key, *hash);
+  }
+
+  //the file may have been removed after its last mapping went away
+  auto region = MapHash(*hash);
+  if (region.has_value()) {
+    RecordAccess(*hash);
+  }
+  return region;
+}
+
+std::optional<MappedRegion> ArtworkStore::LookupRendition(const ArtworkCacheKey& key,
+                                                          const std::string& source_hash) {
+  auto hash = db_manager_->FindArtworkRendition(source_hash, key.size, key.format, key.quality);
+  if (!hash.has_value()) {
+    return std::nullopt;
+  }
+
+  auto region = MapHash(*hash);
+  if (!region.has_value()) {
+    return std::nullopt;
+  }
+
+  std::string orphaned_hash;
+  if (db_manager_->LinkArtwork(key, source_hash, *hash, &orphaned_hash)) {
+    mappings_.Put(MappingKey(key), *hash);
+  }
+  RemoveFile(orphaned_hash);
+  RecordAccess(*hash);
+  return region;
+}
+
+std::optional<MappedRegion> ArtworkStore::Store(const ArtworkCacheKey& key,
+                                                const std::string& source_hash,
+                                                const uint8_t* data, size_t size) {
+  std::string hash = Md5::HexDigest(data, size);
+  if (!WriteFile(hash, data, size)) {
+    return std::nullopt;
+  }
+
+  std::string orphaned_hash;
+  if (!db_manager_->CacheArtwork(key, source_hash, hash, size, &orphaned_hash)) {
+    return std::nullopt;
+  }
+  mappings_.Put(MappingKey(key), hash);
+  RemoveFile(orphaned_hash);
+
+  //counted even when deduplicated, the next eviction pass resyncs the total
+  int64_t budget = budget_bytes_.load();
+  if (stored_bytes_.fetch_add(static_cast<int64_t>(size)) + static_cast<int64_t>(size) > budget &&
+      budget > 0) {
+    RequestMaintenance();
+  }
+
+  return MapHash(hash);
+}
+
+bool ArtworkStore::WriteFile(const std::string& hash, const uint8_t* data, size_t size) {
+  std::string path = PathForHash(hash);
+  if (access(path.c_str(), F_OK) == 0) {
+    return true;  //same content already stored
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(root_directory_ + "/" + hash.substr(0, 2), error);
+
+  //write aside and rename => readers never map a partially written file
+  std::string temp_path = path + ".tmp" + std::to_string(getpid()) + "." +
+                          std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    std::cerr << "[ArtworkStore] Failed to create " << temp_path << std::endl;
+    return false;
+  }
+
+  size_t written = 0;
+  while (written < size) {
+    ssize_t n = write(fd, data + written, size - written);
+    if (n <= 0) {
+      break;
+    }
+    written += static_cast<size_t>(n);
+  }
+  close(fd);
+
+  if (written != size || rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::cerr << "[ArtworkStore] Failed to write " << path << std::endl;
+    unlink(temp_path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+void ArtworkStore::RecordAccess(const std::string& hash) {
+  bool flush_now = false;
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    ArtworkAccess& access = pending_accesses_[hash];
+    access.hash = hash;
+    access.last_access = time(nullptr);
+    access.count++;
+    flush_now = pending_accesses_.size() >= kMaxPendingAccesses;
+  }
+
+  if (flush_now) {
+    RequestMaintenance();
+  }
+}
+
+void ArtworkStore::FlushAccesses() {
+  std::vector<ArtworkAccess> batch;
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    batch.reserve(pending_accesses_.size());
+    for (auto& entry : pending_accesses_) {
+      batch.push_back(std::move(entry.second));
+    }
+    pending_accesses_.clear();
+  }
+
+  db_manager_->RecordArtworkAccess(batch);
+}
+
+void ArtworkStore::EvictOverBudget() {
+  int64_t budget = budget_bytes_.load();
+  int64_t total = db_manager_->GetArtworkStoreSize();
+  stored_bytes_.store(total);
+  if (budget <= 0 || total <= budget) {
+    return;
+  }
+
+  int64_t target = static_cast<int64_t>(budget * kEvictionTarget);
+  auto candidates = db_manager_->SelectArtworkEvictionCandidates(
+      total - target, kFrequencyBonusSeconds, kMaxHitsCounted);
+
+  std::vector<std::string> hashes;
+  int64_t freed = 0;
+  for (const auto& candidate : candidates) {
+    hashes.push_back(candidate.first);
+    freed += candidate.second;
+  }
+  if (!db_manager_->RemoveArtwork(hashes)) {
+    return;
+  }
+
+  //rows go first => a concurrent lookup misses instead of mapping a deleted file
+  mappings_.Clear();
+  for (const auto& hash : hashes) {
+    RemoveFile(hash);
+  }
+  stored_bytes_.fetch_sub(freed);
+
+  std::cout << "[ArtworkStore] Evicted " << hashes.size() << " artworks (" << freed
+            << " bytes), budget " << budget << " bytes" << std::endl;
+  compaction_pending_ = true;
+}
+
+void ArtworkStore::RequestMaintenance() {
+  {
+    std::lock_guard<std::mutex> lock(maintenance_mutex_);
+    maintenance_requested_ = true;
+  }
+  maintenance_cv_.notify_one();
+}
+
+void ArtworkStore::MaintenanceLoop() {
+  std::unique_lock<std::mutex> lock(maintenance_mutex_);
+  while (!stop_requested_) {
+    maintenance_cv_.wait_for(lock, std::chrono::seconds(kFlushIntervalSeconds),
+                             [this] { return maintenance_requested_ || stop_requested_; });
+    if (stop_requested_) {
+      break;
+    }
+    maintenance_requested_ = false;
+    lock.unlock();
+
+    //stats first => eviction ranks by up to date access times
+    FlushAccesses();
+    if (budget_bytes_.load() > 0 && stored_bytes_.load() > budget_bytes_.load()) {
+      EvictOverBudget();
+    }
+
+    //returns pages freed by evictions and old in-database artwork to the filesystem
+    if (compaction_pending_) {
+      bool deferred = false;
+      db_manager_->CompactDatabase(kCompactFreeRatio, &deferred);
+      compaction_pending_ = deferred;  //a scan's transaction is open => next pass
+    }
+
+    lock.lock();
+  }
+}
+
+void ArtworkStore::RemoveFile(const std::string& hash) {
+  if (hash.size() < 2) {
+    return;
+  }
+  //mappings still pointing at it simply miss (MapHash fails)
+  unlink(PathForHash(hash).c_str());
+}
+
+}  // namespace on_audio_query_linux
@@ -0,0 +1,101 @@
+#ifndef ARTWORK_STORE_H_
+#define ARTWORK_STORE_H_
+
+#include <string>
+#include <optional>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include "database_manager.h"
+#include "../utils/lru_cache.h"
+#include "../utils/mapped_region.h"
+
+namespace on_audio_query_linux {
+
+/// Artwork renditions on disk, one file per content hash (<root>/ab/abcdef...).
+///
+/// SQLite only keeps the metadata (artwork_store/artwork_map). Files are
+/// written once and never modified, so readers mmap them without any lock;
+/// recently used song/album => hash mappings are kept in memory, a hit
+/// doesn't touch the database at all.
+///
+/// The store is kept under a byte budget. Reads are counted in memory and
+/// flushed in batches by a background thread, which also evicts the least
+/// valuable renditions (recency, boosted by hit count) once the budget is
+/// exceeded and VACUUMs the database when it is mostly free pages.
+class ArtworkStore {
+ public:
+  ArtworkStore(DatabaseManager* db_manager, const std::string& root_directory);
+  ~ArtworkStore();
+
+  /// Create the store directory and start the maintenance thread
+  bool Initialize();
+
+  /// Byte budget for stored renditions (0 = unlimited)
+  void SetBudget(int64_t max_bytes);
+  int64_t GetBudget() const { return budget_bytes_.load(); }
+
+  /// Rendition cached for a song/album (nullopt on miss or stale source)
+  std::optional<MappedRegion> Lookup(const ArtworkCacheKey& key);
+
+  /// Rendition made from the same original image for another song/album,
+  /// the key is mapped to it when found
+  std::optional<MappedRegion> LookupRendition(const ArtworkCacheKey& key,
+                                              const std::string& source_hash);
+
+  /// Save a rendition (deduplicated by content) and map the key to it
+  std::optional<MappedRegion> Store(const ArtworkCacheKey& key, const std::string& source_hash,
+                                    const uint8_t* data, size_t size);
+
+  const std::string& GetRootDirectory() const { return root_directory_; }
+
+ private:
+  static constexpr size_t kMaxCachedMappings = 8192;
+  static constexpr int64_t kDefaultBudgetBytes = 256LL * 1024 * 1024;
+  static constexpr size_t kMaxPendingAccesses = 512;
+  static constexpr int kFlushIntervalSeconds = 30;
+  static constexpr int64_t kFrequencyBonusSeconds = 6 * 3600;  //per past hit
+  static constexpr int kMaxHitsCounted = 28;
+  static constexpr double kEvictionTarget = 0.9;    //evict down to 90% of the budget
+  static constexpr double kCompactFreeRatio = 0.25;
+
+  DatabaseManager* db_manager_;
+  std::string root_directory_;
+
+  /// Cache key string => content hash
+  LRUCache<std::string, std::string> mappings_;
+
+  std::atomic<int64_t> budget_bytes_;
+  std::atomic<int64_t> stored_bytes_;  //approximate, resynced on every eviction pass
+
+  /// Reads not yet written to artwork_store (hash => stats)
+  std::mutex pending_mutex_;
+  std::unordered_map<std::string, ArtworkAccess> pending_accesses_;
+
+  std::thread maintenance_thread_;
+  std::mutex maintenance_mutex_;
+  std::condition_variable maintenance_cv_;
+  bool maintenance_requested_;
+  bool compaction_pending_;
+  bool stop_requested_;
+
+  void RecordAccess(const std::string& hash);
+  void FlushAccesses();
+  void EvictOverBudget();
+  void RequestMaintenance();
+  void MaintenanceLoop();
+
+  std::string PathForHash(const std::string& hash) const;
+  std::optional<MappedRegion> MapHash(const std::string& hash) const;
+  bool WriteFile(const std::string& hash, const uint8_t* data, size_t size);
+  void RemoveFile(const std::string& hash);
+
+  static std::string MappingKey(const ArtworkCacheKey& key);
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // ARTWORK_STORE_H_
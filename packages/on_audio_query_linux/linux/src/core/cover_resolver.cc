@@ -0,0 +1,143 @@
+#include "cover_resolver.h"
+#include <iostream>
+#include <algorithm>
+#include <dirent.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+namespace on_audio_query_linux {
+
+namespace {
+
+std::string ParentDirectory(const std::string& path) {
+  size_t slash = path.find_last_of('/');
+  if (slash == std::string::npos) {
+    return ".";
+  }
+  if (slash == 0) {
+    return "/";
+  }
+  return path.substr(0, slash);
+}
+
+}  // namespace
+
+CoverResolver::CoverResolver()
+    : file_names_(DefaultFileNames()),
+      directories_(kMaxCachedDirectories) {}
+
+std::vector<std::string> CoverResolver::DefaultFileNames() {
+  return {
+    "cover.jpg", "cover.jpeg", "cover.png",
+    "folder.jpg", "folder.jpeg", "folder.png",
+    "front.jpg", "front.jpeg", "front.png",
+    "album.jpg", "album.png"
+  };
+}
+
+void CoverResolver::SetFileNames(const std::vector<std::string>& names) {
+  {
+    std::lock_guard<std::mutex> lock(names_mutex_);
+    file_names_.clear();
+    for (const auto& name : names) {
+      //plain file names only => a sidecar never points outside its folder
+      if (!name.empty() && name.find('/') == std::string::npos) {
+        file_names_.push_back(name);
+      }
+    }
+  }
+  directories_.Clear();
+}
+
+std::vector<std::string> CoverResolver::GetFileNames() const {
+  std::lock_guard<std::mutex> lock(names_mutex_);
+  return file_names_;
+}
+
+void CoverResolver::Clear() {
+  directories_.Clear();
+}
+
+std::optional<CoverFile> CoverResolver::Resolve(const std::string& audio_path) {
+  std::string directory = ParentDirectory(audio_path);
+
+  struct stat dir_stat;
+  if (stat(directory.c_str(), &dir_stat) != 0) {
+    return std::nullopt;
+  }
+  int64_t dir_mtime = static_cast<int64_t>(dir_stat.st_mtime);
+
+  //adding, removing or renaming a file bumps the folder mtime
+  auto cached = directories_.Get(directory);
+  if (cached.has_value() && cached->dir_mtime == dir_mtime) {
+    if (!cached->cover.has_value()) {
+      return std::nullopt;
+    }
+
+    //the image may have been rewritten in place => refresh its mtime/size
+    struct stat cover_stat;
+    if (stat(cached->cover->path.c_str(), &cover_stat) == 0 && S_ISREG(cover_stat.st_mode)) {
+      CoverFile cover = *cached->cover;
+      if (cover.mtime != static_cast<int64_t>(cover_stat.st_mtime) ||
+          cover.size != static_cast<int64_t>(cover_stat.st_size)) {
+        cover.mtime = static_cast<int64_t>(cover_stat.st_mtime);
+        cover.size = static_cast<int64_t>(cover_stat.st_size);
+        directories_.Put(directory, DirectoryEntry{dir_mtime, cover});
+      }
+      return cover;
+    }
+  }
+
+  auto cover = FindCover(directory, GetFileNames());
+  directories_.Put(directory, DirectoryEntry{dir_mtime, cover});
+  return cover;
+}
+
+std::optional<CoverFile> CoverResolver::FindCover(const std::string& directory,
+                                                  const std::vector<std::string>& names) const {
+  if (names.empty()) {
+    return std::nullopt;
+  }
+
+  DIR* dir = opendir(directory.c_str());
+  if (!dir) {
+    return std::nullopt;
+  }
+
+  //(rank, entry name) of every sidecar candidate in the folder
+  std::vector<std::pair<size_t, std::string>> candidates;
+  while (struct dirent* entry = readdir(dir)) {
+    if (entry->d_type != DT_REG && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN) {
+      continue;
+    }
+    for (size_t rank = 0; rank < names.size(); ++rank) {
+      if (strcasecmp(entry->d_name, names[rank].c_str()) == 0) {
+        candidates.emplace_back(rank, entry->d_name);
+        break;
+      }
+    }
+  }
+  closedir(dir);
+
+  std::sort(candidates.begin(), candidates.end());
+
+  for (const auto& candidate : candidates) {
+    std::string path = directory == "/" ? "/" + candidate.second
+                                        : directory + "/" + candidate.second;
+    struct stat cover_stat;
+    if (stat(path.c_str(), &cover_stat) != 0 || !S_ISREG(cover_stat.st_mode) ||
+        cover_stat.st_size == 0) {
+      continue;
+    }
+
+    CoverFile cover;
+    cover.path = path;
+    cover.mtime = static_cast<int64_t>(cover_stat.st_mtime);
+    cover.size = static_cast<int64_t>(cover_stat.st_size);
+    return cover;
+  }
+
+  return std::nullopt;
+}
+
+}  // namespace on_audio_query_linux
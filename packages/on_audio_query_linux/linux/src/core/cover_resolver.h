@@ -0,0 +1,61 @@
+#ifndef COVER_RESOLVER_H_
+#define COVER_RESOLVER_H_
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <mutex>
+#include <cstdint>
+#include "../utils/lru_cache.h"
+
+namespace on_audio_query_linux {
+
+/// Sidecar cover image found next to the audio files
+struct CoverFile {
+  std::string path;
+  int64_t mtime;  //unix seconds
+  int64_t size;
+};
+
+/// Finds folder cover images (cover.jpg, folder.png, front.jpg, ...).
+///
+/// A directory is listed at most once per change: the outcome (found file or
+/// nothing) is cached together with the directory mtime, so every track of an
+/// album after the first only costs a stat of the folder.
+class CoverResolver {
+ public:
+  CoverResolver();
+
+  /// Cover for the folder holding an audio file (nullopt when there's none)
+  std::optional<CoverFile> Resolve(const std::string& audio_path);
+
+  /// Ordered sidecar names, first match wins (compared case-insensitively).
+  /// Changing them drops every cached folder.
+  void SetFileNames(const std::vector<std::string>& names);
+  std::vector<std::string> GetFileNames() const;
+
+  /// Forget cached folders
+  void Clear();
+
+  static std::vector<std::string> DefaultFileNames();
+
+ private:
+  struct DirectoryEntry {
+    int64_t dir_mtime;
+    std::optional<CoverFile> cover;  //nullopt => folder has no cover (negative entry)
+  };
+
+  static constexpr size_t kMaxCachedDirectories = 4096;
+
+  mutable std::mutex names_mutex_;
+  std::vector<std::string> file_names_;
+  LRUCache<std::string, DirectoryEntry> directories_;
+
+  /// List a directory once and pick the best ranked sidecar
+  std::optional<CoverFile> FindCover(const std::string& directory,
+                                     const std::vector<std::string>& names) const;
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // COVER_RESOLVER_H_
@@ -5,33 +5,82 @@
 #include <sstream>
 #include <filesystem>
 #include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
 #include <sys/stat.h>
 
 namespace on_audio_query_linux {
 
+namespace {
+
+/// Escapes LIKE wildcards so a value only matches itself (used with ESCAPE '\')
+std::string EscapeLike(const std::string& value) {
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (char c : value) {
+    if (c == '\\' || c == '%' || c == '_') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+/// Word as an FTS5 string, so its punctuation isn't query syntax
+std::string Fts5String(const std::string& word) {
+  std::string quoted = "\"";
+  for (char c : word) {
+    quoted += c;
+    if (c == '"') {
+      quoted += '"';
+    }
+  }
+  return quoted + "\"";
+}
+
+}  // namespace
+
 /// QueryParams helper implementations
+std::vector<std::string> QueryParams::SearchWords(const std::string& term) {
+  std::vector<std::string> words;
+  std::istringstream stream(term);
+  std::string word;
+  while (stream >> word) {
+    words.push_back(word);
+  }
+  return words;
+}
+
+bool QueryParams::TrigramSearchable(const std::vector<std::string>& words) {
+  for (const auto& word : words) {
+    size_t characters = std::count_if(word.begin(), word.end(), [](char c) {
+      return (static_cast<unsigned char>(c) & 0xC0) != 0x80;  //UTF-8 lead bytes
+    });
+    if (characters < 3) {
+      return false;
+    }
+  }
+  return true;
+}
+
 std::string QueryParams::BuildWhereClause() const {
   std::vector<std::string> conditions;
 
   if (path_filter.has_value()) {
-    conditions.push_back("file_path LIKE '" + path_filter.value() + "%'");
+    conditions.push_back("file_path LIKE ? ESCAPE '\\'");
   }
 
   if (artist_filter.has_value()) {
-    conditions.push_back("artist_id = " + std::to_string(artist_filter.value()));
+    conditions.push_back("artist_id = ?");
   }
 
   if (album_filter.has_value()) {
-    conditions.push_back("album_id = " + std::to_string(album_filter.value()));
+    conditions.push_back("album_id = ?");
   }
 
   if (genre_filter.has_value()) {
-    conditions.push_back("genre_id = " + std::to_string(genre_filter.value()));
-  }
-
-  if (search_filter.has_value()) {
-    std::string search = search_filter.value();
-    conditions.push_back("(title LIKE '%" + search + "%' OR artist LIKE '%" + search + "%' OR album LIKE '%" + search + "%')");
+    conditions.push_back("genre_id = ?");
   }
 
   if (conditions.empty()) {
@@ -41,6 +90,76 @@ std::string QueryParams::BuildWhereClause() const {
   return StringUtils::Join(conditions, " AND ");
 }
 
+int QueryParams::BindWhereClause(sqlite3_stmt* stmt, int index) const {
+  if (path_filter.has_value()) {
+    std::string pattern = EscapeLike(path_filter.value()) + "%";
+    sqlite3_bind_text(stmt, index++, pattern.c_str(), -1, SQLITE_TRANSIENT);
+  }
+
+  if (artist_filter.has_value()) {
+    sqlite3_bind_int64(stmt, index++, artist_filter.value());
+  }
+
+  if (album_filter.has_value()) {
+    sqlite3_bind_int64(stmt, index++, album_filter.value());
+  }
+
+  if (genre_filter.has_value()) {
+    sqlite3_bind_int64(stmt, index++, genre_filter.value());
+  }
+
+  return index;
+}
+
+std::string QueryParams::BuildSearchJoin() const {
+  if (!search_filter.has_value()) {
+    return "";
+  }
+  auto words = SearchWords(search_filter.value());
+  if (words.empty()) {
+    return "";
+  }
+
+  //word prefixes rank first ("beat" => Beatles), ordered by bm25 (weights:
+  //title, artist, album, genre, path), then infixes only the trigram index
+  //finds ("eatl" => Beatles). Scoring is most of a search's cost and infix
+  //hits are many and weak => those keep the requested order instead
+  std::string matches =
+      "SELECT rowid AS id, 0 AS tier, bm25(songs_fts, 10.0, 5.0, 5.0, 2.0, 1.0) AS score "
+      "FROM songs_fts WHERE songs_fts MATCH ?";
+  if (TrigramSearchable(words)) {
+    //a bare column next to MIN() comes from the row holding the minimum
+    matches = "SELECT id, MIN(tier) AS tier, score FROM (" + matches +
+              " UNION ALL "
+              "SELECT rowid, 1, 0.0 FROM songs_trigram WHERE songs_trigram MATCH ?) GROUP BY id";
+  }
+  return " JOIN (" + matches + ") AS matches ON matches.id = songs.id";
+}
+
+int QueryParams::BindSearchJoin(sqlite3_stmt* stmt, int index) const {
+  if (!search_filter.has_value()) {
+    return index;
+  }
+  auto words = SearchWords(search_filter.value());
+  if (words.empty()) {
+    return index;
+  }
+
+  //implicit AND of the words, each one a word prefix (the last is still being typed)
+  std::string prefixes;
+  std::string infixes;
+  for (const auto& word : words) {
+    std::string quoted = Fts5String(word);
+    prefixes += (prefixes.empty() ? "" : " ") + quoted + "*";
+    infixes += (infixes.empty() ? "" : " ") + quoted;
+  }
+  sqlite3_bind_text(stmt, index++, prefixes.c_str(), -1, SQLITE_TRANSIENT);
+  if (TrigramSearchable(words)) {
+    sqlite3_bind_text(stmt, index++, infixes.c_str(), -1, SQLITE_TRANSIENT);
+  }
+  return index;
+}
+
 std::string QueryParams::BuildOrderByClause() const {
   std::string column;
 
@@ -79,6 +198,25 @@ std::string QueryParams::BuildOrderByClause() const {
   return column;
 }
 
+/// AggregateDelta implementation
+void AggregateDelta::AddSong(const SongMetadata& song) {
+  album_ids.insert(song.album_id);
+  genre_adjustments[song.genre_id] += 1;
+  genre_names[song.genre_id] = song.genre;
+  artists[song.artist_id] = song.artist;
+}
+
+void AggregateDelta::RemoveSong(const SongMetadata& song) {
+  album_ids.insert(song.album_id);
+  genre_adjustments[song.genre_id] -= 1;
+  genre_names[song.genre_id] = song.genre;
+  artists[song.artist_id] = song.artist;
+}
+
+bool AggregateDelta::IsEmpty() const {
+  return album_ids.empty() && genre_adjustments.empty() && artists.empty();
+}
+
 /// DatabaseManager implementation
 DatabaseManager::DatabaseManager(const std::string& db_path)
     : db_(nullptr), db_path_(db_path) {}
@@ -107,6 +245,7 @@ bool DatabaseManager::Initialize() {
   sqlite3_exec(db_, "PRAGMA synchronous=NORMAL", nullptr, nullptr, nullptr);
   sqlite3_exec(db_, "PRAGMA cache_size=10000", nullptr, nullptr, nullptr);
   sqlite3_exec(db_, "PRAGMA temp_store=MEMORY", nullptr, nullptr, nullptr);
+  sqlite3_busy_timeout(db_, kBusyTimeoutMs);
 
   if (is_first_run) {
     std::cout << "[DatabaseManager] First run - creating database schema" << std::endl;
@@ -114,6 +253,124 @@ bool DatabaseManager::Initialize() {
       std::cerr << "[DatabaseManager] Failed to create schema" << std::endl;
       return false;
     }
+    std::string version_sql = "PRAGMA user_version = " + std::to_string(kSchemaVersion);
+    sqlite3_exec(db_, version_sql.c_str(), nullptr, nullptr, nullptr);
+  } else {
+    int version = 0;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK) {
+      if (sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+      }
+      sqlite3_finalize(stmt);
+    }
+
+    if (version < kSchemaVersion && !MigrateSchema(version)) {
+      std::cerr << "[DatabaseManager] Failed to migrate schema from version " << version << std::endl;
+      return false;
+    }
+  }
+
+  //split artist index lives in memory => restore it from the persisted credits
+  LoadArtistIndex();
+
+  //a scan holds the write lock for seconds => queries are served by readers
+  if (!OpenReadConnections()) {
+    std::cerr << "[DatabaseManager] Cannot open read connections" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool DatabaseManager::MigrateSchema(int from_version) {
+  std::cout << "[DatabaseManager] Migrating schema from version " << from_version
+            << " to " << kSchemaVersion << std::endl;
+
+  //version 7: artwork bytes moved to files, version 8: access stats
+  //=> the artwork tables are only a cache, start over
+  if (from_version < 8 &&
+      sqlite3_exec(db_, "DROP TABLE IF EXISTS artwork_cache; DROP TABLE IF EXISTS artwork_store; "
+                        "DROP TABLE IF EXISTS artwork_map", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    return false;
+  }
+
+  //version 9: song_artwork, version 10: artwork_placeholder,
+  //version 11: artwork_sources, version 12: search index (created below)
+  //new tables and indexes are created with IF NOT EXISTS
+  if (!CreateTables()) {
+    return false;
+  }
+
+  //version 4: stream properties and extra tags (before indexes that use them)
+  if (from_version < 4 && !AddSongColumns()) {
+    return false;
+  }
+
+  if (!CreateIndexes()) {
+    return false;
+  }
+
+  //version 12: index the existing songs
+  if (from_version < 12 &&
+      sqlite3_exec(db_, "INSERT INTO songs_fts (songs_fts) VALUES ('rebuild'); "
+                        "INSERT INTO songs_trigram (songs_trigram) VALUES ('rebuild')",
+                   nullptr, nullptr, nullptr) != SQLITE_OK) {
+    std::cerr << "[DatabaseManager] Failed to build search index: " << sqlite3_errmsg(db_) << std::endl;
+    return false;
+  }
+
+  //version 2: artist_credits must be populated before incremental updates
+  if (from_version < 2) {
+    RebuildAggregatedTables();
+  } else if (from_version < 11) {
+    RebuildArtworkSources();
+  }
+
+  std::string version_sql = "PRAGMA user_version = " + std::to_string(kSchemaVersion);
+  return sqlite3_exec(db_, version_sql.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+bool DatabaseManager::AddSongColumns() {
+  //CREATE TABLE IF NOT EXISTS doesn't touch existing tables => add what's missing
+  const std::pair<const char*, const char*> columns[] = {
+    {"disc", "INTEGER DEFAULT 0"},
+    {"album_artist", "TEXT"},
+    {"composer", "TEXT"},
+    {"bitrate", "INTEGER DEFAULT 0"},
+    {"sample_rate", "INTEGER DEFAULT 0"},
+    {"bit_depth", "INTEGER DEFAULT 0"},
+    {"channels", "INTEGER DEFAULT 0"},
+    {"codec", "TEXT"},
+  };
+
+  std::set<std::string> existing;
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db_, "PRAGMA table_info(songs)", -1, &stmt, nullptr) != SQLITE_OK) {
+    return false;
+  }
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    existing.insert(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)));
+  }
+  sqlite3_finalize(stmt);
+
+  bool added = false;
+  for (const auto& column : columns) {
+    if (existing.count(column.first)) {
+      continue;
+    }
+    std::string sql = std::string("ALTER TABLE songs ADD COLUMN ") + column.first + " " + column.second;
+    if (sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) {
+      std::cerr << "[DatabaseManager] Failed to add column " << column.first << ": "
+                << sqlite3_errmsg(db_) << std::endl;
+      return false;
+    }
+    added = true;
+  }
+
+  //existing rows have no values yet => next scan sees them as modified and re-reads them
+  if (added) {
+    sqlite3_exec(db_, "UPDATE songs SET file_mtime = 0", nullptr, nullptr, nullptr);
   }
 
   return true;
@@ -142,7 +399,15 @@ bool DatabaseManager::CreateTables() {
       genre_id INTEGER,
       date_added INTEGER,
       date_modified INTEGER,
-      is_music INTEGER DEFAULT 1
+      is_music INTEGER DEFAULT 1,
+      disc INTEGER DEFAULT 0,
+      album_artist TEXT,
+      composer TEXT,
+      bitrate INTEGER DEFAULT 0,
+      sample_rate INTEGER DEFAULT 0,
+      bit_depth INTEGER DEFAULT 0,
+      channels INTEGER DEFAULT 0,
+      codec TEXT
     )
   )";
 
@@ -175,6 +440,18 @@ bool DatabaseManager::CreateTables() {
     )
   )";
 
+  //maps every raw artist string in songs to the split artists it credits
+  const char* artist_credits_table = R"(
+    CREATE TABLE IF NOT EXISTS artist_credits (
+      raw_artist_id INTEGER NOT NULL,
+      raw_artist TEXT NOT NULL,
+      artist_key TEXT NOT NULL,
+      artist_name TEXT NOT NULL,
+      is_single INTEGER NOT NULL DEFAULT 0,
+      PRIMARY KEY (raw_artist_id, artist_key)
+    )
+  )";
+
   const char* playlists_table = R"(
     CREATE TABLE IF NOT EXISTS playlists (
       id INTEGER PRIMARY KEY AUTOINCREMENT,
@@ -199,14 +476,74 @@ bool DatabaseManager::CreateTables() {
     )
   )";
 
-  const char* artwork_cache_table = R"(
-    CREATE TABLE IF NOT EXISTS artwork_cache (
+  //artwork renditions stored once per content hash (bytes live in files, see ArtworkStore)
+  const char* artwork_store_table = R"(
+    CREATE TABLE IF NOT EXISTS artwork_store (
+      hash TEXT PRIMARY KEY,
+      size INTEGER NOT NULL,
+      created_at INTEGER,
+      last_access INTEGER NOT NULL DEFAULT 0,
+      access_count INTEGER NOT NULL DEFAULT 0
+    )
+  )";
+
+  //song/album rendition => stored artwork (source_hash = hash of the original image)
+  const char* artwork_map_table = R"(
+    CREATE TABLE IF NOT EXISTS artwork_map (
       id INTEGER NOT NULL,
       type INTEGER NOT NULL,
       format TEXT NOT NULL,
-      data BLOB,
+      size INTEGER NOT NULL DEFAULT 0,
+      quality INTEGER NOT NULL DEFAULT 0,
+      source TEXT,
+      source_mtime INTEGER,
+      source_hash TEXT NOT NULL,
+      hash TEXT NOT NULL,
       cached_at INTEGER,
-      PRIMARY KEY (id, type, format)
+      PRIMARY KEY (id, type, size, format)
+    )
+  )";
+
+  //embedded pictures located during scans (offset/length of the image in the file)
+  const char* song_artwork_table = R"(
+    CREATE TABLE IF NOT EXISTS song_artwork (
+      file_path TEXT PRIMARY KEY,
+      file_mtime INTEGER NOT NULL,
+      has_picture INTEGER NOT NULL,
+      raw INTEGER NOT NULL DEFAULT 0,
+      offset INTEGER NOT NULL DEFAULT 0,
+      length INTEGER NOT NULL DEFAULT 0,
+      hash TEXT
+    )
+  )";
+
+  //placeholder painted before an artwork is decoded, per original image (source_hash)
+  const char* artwork_placeholder_table = R"(
+    CREATE TABLE IF NOT EXISTS artwork_placeholder (
+      hash TEXT PRIMARY KEY,
+      colors TEXT NOT NULL,
+      blurhash TEXT NOT NULL
+    )
+  )";
+
+  //song an album (1), artist (3) or genre (4) takes its artwork from (type = ArtworkType index)
+  const char* artwork_sources_table = R"(
+    CREATE TABLE IF NOT EXISTS artwork_sources (
+      type INTEGER NOT NULL,
+      id INTEGER NOT NULL,
+      file_path TEXT NOT NULL,
+      hash TEXT,
+      PRIMARY KEY (type, id)
+    )
+  )";
+
+  //files skipped by scans (extractor timed out or crashed on them)
+  const char* quarantine_table = R"(
+    CREATE TABLE IF NOT EXISTS quarantine (
+      file_path TEXT PRIMARY KEY,
+      file_mtime INTEGER NOT NULL,
+      reason TEXT NOT NULL,
+      quarantined_at INTEGER
     )
   )";
 
@@ -216,14 +553,48 @@ bool DatabaseManager::CreateTables() {
       sqlite3_exec(db_, albums_table, nullptr, nullptr, &err_msg) != SQLITE_OK ||
       sqlite3_exec(db_, artists_table, nullptr, nullptr, &err_msg) != SQLITE_OK ||
       sqlite3_exec(db_, genres_table, nullptr, nullptr, &err_msg) != SQLITE_OK ||
+      sqlite3_exec(db_, artist_credits_table, nullptr, nullptr, &err_msg) != SQLITE_OK ||
       sqlite3_exec(db_, playlists_table, nullptr, nullptr, &err_msg) != SQLITE_OK ||
       sqlite3_exec(db_, playlist_items_table, nullptr, nullptr, &err_msg) != SQLITE_OK ||
-      sqlite3_exec(db_, artwork_cache_table, nullptr, nullptr, &err_msg) != SQLITE_OK) {
+      sqlite3_exec(db_, artwork_store_table, nullptr, nullptr, &err_msg) != SQLITE_OK ||
+      sqlite3_exec(db_, artwork_map_table, nullptr, nullptr, &err_msg) != SQLITE_OK ||
+      sqlite3_exec(db_, song_artwork_table, nullptr, nullptr, &err_msg) != SQLITE_OK ||
+      sqlite3_exec(db_, artwork_placeholder_table, nullptr, nullptr, &err_msg) != SQLITE_OK ||
+      sqlite3_exec(db_, artwork_sources_table, nullptr, nullptr, &err_msg) != SQLITE_OK ||
+      sqlite3_exec(db_, quarantine_table, nullptr, nullptr, &err_msg) != SQLITE_OK) {
     std::cerr << "[DatabaseManager] Failed to create tables: " << err_msg << std::endl;
     sqlite3_free(err_msg);
     return false;
   }
 
+  return CreateSearchIndex();
+}
+
+bool DatabaseManager::CreateSearchIndex() {
+  //external content tables: the index only, text is read back from songs.
+  //songs_fts matches word prefixes, songs_trigram any substring of 3+ characters.
+  //Kept in sync by the song write methods, not triggers: FTS5 flushes its
+  //pending terms at every trigger statement, which made scans 3x slower
+  const char* search_tables = R"(
+    CREATE VIRTUAL TABLE IF NOT EXISTS songs_fts USING fts5(
+      title, artist, album, genre, file_path,
+      content='songs', content_rowid='id',
+      tokenize='unicode61 remove_diacritics 2', prefix='2 3'
+    );
+    CREATE VIRTUAL TABLE IF NOT EXISTS songs_trigram USING fts5(
+      title, artist, album, genre, file_path,
+      content='songs', content_rowid='id',
+      tokenize='trigram'
+    );
+  )";
+
+  char* err_msg = nullptr;
+  if (sqlite3_exec(db_, search_tables, nullptr, nullptr, &err_msg) != SQLITE_OK) {
+    std::cerr << "[DatabaseManager] Failed to create search index: " << err_msg << std::endl;
+    sqlite3_free(err_msg);
+    return false;
+  }
+
   return true;
 }
 
@@ -236,8 +607,12 @@ bool DatabaseManager::CreateIndexes() {
     "CREATE INDEX IF NOT EXISTS idx_songs_date_added ON songs(date_added)",
     "CREATE INDEX IF NOT EXISTS idx_songs_title ON songs(title COLLATE NOCASE)",
     "CREATE INDEX IF NOT EXISTS idx_songs_file_path ON songs(file_path)",
+    "CREATE INDEX IF NOT EXISTS idx_songs_album_artist ON songs(album_artist COLLATE NOCASE)",
     "CREATE INDEX IF NOT EXISTS idx_playlist_items_playlist ON playlist_items(playlist_id, position)",
-    "CREATE INDEX IF NOT EXISTS idx_playlist_items_song ON playlist_items(song_id)"
+    "CREATE INDEX IF NOT EXISTS idx_playlist_items_song ON playlist_items(song_id)",
+    "CREATE INDEX IF NOT EXISTS idx_artist_credits_key ON artist_credits(artist_key)",
+    "CREATE INDEX IF NOT EXISTS idx_artwork_map_source ON artwork_map(source_hash, size, format, quality)",
+    "CREATE INDEX IF NOT EXISTS idx_artwork_map_hash ON artwork_map(hash)"
   };
 
   char* err_msg = nullptr;
@@ -273,6 +648,8 @@ bool DatabaseManager::CheckIntegrity() {
 }
 
 void DatabaseManager::Close() {
+  CloseReadConnections();
+
   std::lock_guard<std::mutex> lock(db_mutex_);
 
   ClearPreparedStatements();
@@ -287,14 +664,39 @@ void DatabaseManager::Close() {
 bool DatabaseManager::InsertSong(const SongMetadata& song) {
   std::lock_guard<std::mutex> lock(db_mutex_);
 
+  //an upsert rather than INSERT OR REPLACE: a REPLACE (it may delete rows)
+  //opens a statement savepoint, at which FTS5 flushes its pending terms
+  //=> the search index would write a segment per song
   const char* sql = R"(
-    INSERT OR REPLACE INTO songs (
+    INSERT INTO songs (
       id, file_path, file_mtime, file_size, display_name, display_name_wo_ext,
       file_extension, uri, title, artist, album, genre, year, track, duration,
-      album_id, artist_id, genre_id, date_added, date_modified, is_music
-    ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+      album_id, artist_id, genre_id, date_added, date_modified, is_music,
+      disc, album_artist, composer, bitrate, sample_rate, bit_depth, channels, codec
+    ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?,
+              ?, ?, ?, ?, ?, ?, ?, ?)
+    ON CONFLICT(id) DO UPDATE SET
+      file_path = excluded.file_path, file_mtime = excluded.file_mtime,
+      file_size = excluded.file_size, display_name = excluded.display_name,
+      display_name_wo_ext = excluded.display_name_wo_ext, file_extension = excluded.file_extension,
+      uri = excluded.uri, title = excluded.title, artist = excluded.artist, album = excluded.album,
+      genre = excluded.genre, year = excluded.year, track = excluded.track,
+      duration = excluded.duration, album_id = excluded.album_id, artist_id = excluded.artist_id,
+      genre_id = excluded.genre_id, date_added = excluded.date_added,
+      date_modified = excluded.date_modified, is_music = excluded.is_music, disc = excluded.disc,
+      album_artist = excluded.album_artist, composer = excluded.composer,
+      bitrate = excluded.bitrate, sample_rate = excluded.sample_rate,
+      bit_depth = excluded.bit_depth, channels = excluded.channels, codec = excluded.codec
   )";
 
+  //the row this one updates leaves the search index => read it first
+  sqlite3_stmt* replaced_stmt = GetPreparedStatement(
+      "SELECT id, title, artist, album, genre, file_path FROM songs WHERE id = ?");
+  if (!replaced_stmt) return false;
+
+  sqlite3_bind_int64(replaced_stmt, 1, song.id);
+  auto replaced = ReadSearchEntries(replaced_stmt);
+
   sqlite3_stmt* stmt = GetPreparedStatement(sql);
   if (!stmt) return false;
 
@@ -319,20 +721,60 @@ bool DatabaseManager::InsertSong(const SongMetadata& song) {
   sqlite3_bind_int64(stmt, 19, song.date_added);
   sqlite3_bind_int64(stmt, 20, song.date_modified);
   sqlite3_bind_int(stmt, 21, song.is_music ? 1 : 0);
+  sqlite3_bind_int(stmt, 22, song.disc);
+  sqlite3_bind_text(stmt, 23, song.album_artist.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_text(stmt, 24, song.composer.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int(stmt, 25, song.bitrate);
+  sqlite3_bind_int(stmt, 26, song.sample_rate);
+  sqlite3_bind_int(stmt, 27, song.bit_depth);
+  sqlite3_bind_int(stmt, 28, song.channels);
+  sqlite3_bind_text(stmt, 29, song.codec.c_str(), -1, SQLITE_TRANSIENT);
 
   int rc = sqlite3_step(stmt);
   sqlite3_reset(stmt);
+  if (rc != SQLITE_DONE) {
+    return false;
+  }
 
-  return rc == SQLITE_DONE;
+  //a rescan mostly rewrites songs whose indexed text didn't change => left as is
+  SearchColumns columns = {song.title, song.artist, song.album, song.genre, song.data};
+  bool indexed = false;
+  for (const auto& entry : replaced) {
+    if (entry.second == columns) {
+      indexed = true;
+    } else {
+      WriteSearchEntry(entry.first, entry.second, true);
+    }
+  }
+  if (!indexed) {
+    WriteSearchEntry(song.id, columns, false);
+  }
+
+  return true;
 }
 
 bool DatabaseManager::UpdateSong(const SongMetadata& song) {
-  return InsertSong(song);  //INSERT OR REPLACE handles update
+  return InsertSong(song);  //upsert handles update
 }
 
 bool DatabaseManager::DeleteSong(int64_t song_id) {
   std::lock_guard<std::mutex> lock(db_mutex_);
 
+  sqlite3_stmt* artwork_stmt = GetPreparedStatement(
+      "DELETE FROM song_artwork WHERE file_path = (SELECT file_path FROM songs WHERE id = ?)");
+  if (artwork_stmt) {
+    sqlite3_bind_int64(artwork_stmt, 1, song_id);
+    sqlite3_step(artwork_stmt);
+    sqlite3_reset(artwork_stmt);
+  }
+
+  sqlite3_stmt* select_stmt = GetPreparedStatement(
+      "SELECT id, title, artist, album, genre, file_path FROM songs WHERE id = ?");
+  if (!select_stmt) return false;
+
+  sqlite3_bind_int64(select_stmt, 1, song_id);
+  auto removed = ReadSearchEntries(select_stmt);
+
   const char* sql = "DELETE FROM songs WHERE id = ?";
   sqlite3_stmt* stmt = GetPreparedStatement(sql);
   if (!stmt) return false;
@@ -341,13 +783,33 @@ bool DatabaseManager::DeleteSong(int64_t song_id) {
 
   int rc = sqlite3_step(stmt);
   sqlite3_reset(stmt);
+  if (rc != SQLITE_DONE) {
+    return false;
+  }
 
-  return rc == SQLITE_DONE;
+  for (const auto& entry : removed) {
+    WriteSearchEntry(entry.first, entry.second, true);
+  }
+  return true;
 }
 
 bool DatabaseManager::DeleteSongByPath(const std::string& path) {
   std::lock_guard<std::mutex> lock(db_mutex_);
 
+  sqlite3_stmt* artwork_stmt = GetPreparedStatement("DELETE FROM song_artwork WHERE file_path = ?");
+  if (artwork_stmt) {
+    sqlite3_bind_text(artwork_stmt, 1, path.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_step(artwork_stmt);
+    sqlite3_reset(artwork_stmt);
+  }
+
+  sqlite3_stmt* select_stmt = GetPreparedStatement(
+      "SELECT id, title, artist, album, genre, file_path FROM songs WHERE file_path = ?");
+  if (!select_stmt) return false;
+
+  sqlite3_bind_text(select_stmt, 1, path.c_str(), -1, SQLITE_TRANSIENT);
+  auto removed = ReadSearchEntries(select_stmt);
+
   const char* sql = "DELETE FROM songs WHERE file_path = ?";
   sqlite3_stmt* stmt = GetPreparedStatement(sql);
   if (!stmt) return false;
@@ -356,50 +818,81 @@ bool DatabaseManager::DeleteSongByPath(const std::string& path) {
 
   int rc = sqlite3_step(stmt);
   sqlite3_reset(stmt);
+  if (rc != SQLITE_DONE) {
+    return false;
+  }
 
-  return rc == SQLITE_DONE;
+  for (const auto& entry : removed) {
+    WriteSearchEntry(entry.first, entry.second, true);
+  }
+  return true;
 }
 
 std::vector<SongMetadata> DatabaseManager::QuerySongs(const QueryParams& params) {
-  std::lock_guard<std::mutex> lock(db_mutex_);
+  auto songs = QuerySongs(params, nullptr);
+  return songs ? std::move(*songs) : std::vector<SongMetadata>{};
+}
+
+std::optional<std::vector<SongMetadata>> DatabaseManager::QuerySongs(
+    const QueryParams& params, const std::function<bool()>& is_cancelled) {
+  auto reader = AcquireReader();
 
   std::ostringstream query;
-  query << "SELECT * FROM songs";
+  std::string search_join = params.BuildSearchJoin();
+  query << "SELECT songs.* FROM songs" << search_join;
 
   std::string where_clause = params.BuildWhereClause();
   if (!where_clause.empty()) {
     query << " WHERE " << where_clause;
   }
 
-  query << " ORDER BY " << params.BuildOrderByClause();
-
-  if (params.limit.has_value()) {
-    query << " LIMIT " << params.limit.value();
-    if (params.offset.has_value()) {
-      query << " OFFSET " << params.offset.value();
-    }
+  //searches are ranked, the requested order only breaks ties
+  query << " ORDER BY ";
+  if (!search_join.empty()) {
+    query << "matches.tier, matches.score, ";
   }
+  query << params.BuildOrderByClause();
 
-  sqlite3_stmt* stmt;
-  if (sqlite3_prepare_v2(db_, query.str().c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-    std::cerr << "[DatabaseManager] Failed to prepare query: " << sqlite3_errmsg(db_) << std::endl;
-    return {};
+  //always bound (-1 = no limit) => pagination doesn't add statement shapes
+  query << " LIMIT ? OFFSET ?";
+
+  sqlite3_stmt* stmt = reader.Prepare(query.str());
+  if (!stmt) return std::vector<SongMetadata>{};
+
+  int index = params.BindSearchJoin(stmt, 1);
+  index = params.BindWhereClause(stmt, index);
+  sqlite3_bind_int64(stmt, index++, params.limit.value_or(-1));
+  sqlite3_bind_int64(stmt, index, params.limit.has_value() ? params.offset.value_or(0) : 0);
+
+  //a progress handler rather than sqlite3_interrupt(): it only ever stops
+  //this statement, never whichever query the pooled connection runs next
+  if (is_cancelled) {
+    sqlite3_progress_handler(reader.db(), kCancelCheckSteps, [](void* arg) {
+      return (*static_cast<const std::function<bool()>*>(arg))() ? 1 : 0;
+    }, const_cast<std::function<bool()>*>(&is_cancelled));
   }
 
   std::vector<SongMetadata> results;
-  while (sqlite3_step(stmt) == SQLITE_ROW) {
+  int rc;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
     results.push_back(ExtractSongFromStatement(stmt));
   }
 
-  sqlite3_finalize(stmt);
+  sqlite3_reset(stmt);
+  if (is_cancelled) {
+    sqlite3_progress_handler(reader.db(), 0, nullptr, nullptr);
+    if (rc == SQLITE_INTERRUPT || is_cancelled()) {
+      return std::nullopt;
+    }
+  }
   return results;
 }
 
 std::optional<SongMetadata> DatabaseManager::GetSongById(int64_t id) {
-  std::lock_guard<std::mutex> lock(db_mutex_);
+  auto reader = AcquireReader();
 
   const char* sql = "SELECT * FROM songs WHERE id = ?";
-  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+  sqlite3_stmt* stmt = reader.Prepare(sql);
   if (!stmt) return std::nullopt;
 
   sqlite3_bind_int64(stmt, 1, id);
@@ -449,11 +942,11 @@ std::vector<std::string> DatabaseManager::GetAllSongPaths() {
 
 /// Album operations
 std::vector<AlbumData> DatabaseManager::QueryAlbums(const QueryParams& params) {
-  std::lock_guard<std::mutex> lock(db_mutex_);
+  auto reader = AcquireReader();
 
   //Check if this is a split artist filter (negative ID)
   if (params.artist_filter.has_value() && params.artist_filter.value() < 0) {
-    return QueryAlbumsForSplitArtist(params.artist_filter.value(), params);
+    return QueryAlbumsForSplitArtist(reader, params.artist_filter.value(), params);
   }
 
   std::ostringstream query;
@@ -461,15 +954,17 @@ std::vector<AlbumData> DatabaseManager::QueryAlbums(const QueryParams& params) {
 
   //Add WHERE clause for artist filter
   if (params.artist_filter.has_value()) {
-    query << " WHERE artist_id = " << params.artist_filter.value();
+    query << " WHERE artist_id = ?";
   }
 
   query << " ORDER BY album COLLATE NOCASE ";
   query << (params.order_type == QueryParams::OrderType::ASC ? "ASC" : "DESC");
 
-  sqlite3_stmt* stmt;
-  if (sqlite3_prepare_v2(db_, query.str().c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-    return {};
+  sqlite3_stmt* stmt = reader.Prepare(query.str());
+  if (!stmt) return {};
+
+  if (params.artist_filter.has_value()) {
+    sqlite3_bind_int64(stmt, 1, params.artist_filter.value());
   }
 
   std::vector<AlbumData> results;
@@ -477,15 +972,15 @@ std::vector<AlbumData> DatabaseManager::QueryAlbums(const QueryParams& params) {
     results.push_back(ExtractAlbumFromStatement(stmt));
   }
 
-  sqlite3_finalize(stmt);
+  sqlite3_reset(stmt);
   return results;
 }
 
 std::optional<AlbumData> DatabaseManager::GetAlbumById(int64_t id) {
-  std::lock_guard<std::mutex> lock(db_mutex_);
+  auto reader = AcquireReader();
 
   const char* sql = "SELECT id, album, artist, artist_id, num_of_songs, first_year, last_year FROM albums WHERE id = ?";
-  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+  sqlite3_stmt* stmt = reader.Prepare(sql);
   if (!stmt) return std::nullopt;
 
   sqlite3_bind_int64(stmt, 1, id);
@@ -501,32 +996,30 @@ std::optional<AlbumData> DatabaseManager::GetAlbumById(int64_t id) {
 
 /// Artist operations
 std::vector<ArtistData> DatabaseManager::QueryArtists(const QueryParams& params) {
-  std::lock_guard<std::mutex> lock(db_mutex_);
+  auto reader = AcquireReader();
 
   std::ostringstream query;
   query << "SELECT id, artist, number_of_albums, number_of_tracks FROM artists";
   query << " ORDER BY artist COLLATE NOCASE ";
   query << (params.order_type == QueryParams::OrderType::ASC ? "ASC" : "DESC");
 
-  sqlite3_stmt* stmt;
-  if (sqlite3_prepare_v2(db_, query.str().c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-    return {};
-  }
+  sqlite3_stmt* stmt = reader.Prepare(query.str());
+  if (!stmt) return {};
 
   std::vector<ArtistData> results;
   while (sqlite3_step(stmt) == SQLITE_ROW) {
     results.push_back(ExtractArtistFromStatement(stmt));
   }
 
-  sqlite3_finalize(stmt);
+  sqlite3_reset(stmt);
   return results;
 }
 
 std::optional<ArtistData> DatabaseManager::GetArtistById(int64_t id) {
-  std::lock_guard<std::mutex> lock(db_mutex_);
+  auto reader = AcquireReader();
 
   const char* sql = "SELECT id, artist, number_of_albums, number_of_tracks FROM artists WHERE id = ?";
-  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+  sqlite3_stmt* stmt = reader.Prepare(sql);
   if (!stmt) return std::nullopt;
 
   sqlite3_bind_int64(stmt, 1, id);
@@ -542,32 +1035,30 @@ std::optional<ArtistData> DatabaseManager::GetArtistById(int64_t id) {
 
 /// Genre operations
 std::vector<GenreData> DatabaseManager::QueryGenres(const QueryParams& params) {
-  std::lock_guard<std::mutex> lock(db_mutex_);
+  auto reader = AcquireReader();
 
   std::ostringstream query;
   query << "SELECT id, name, num_of_songs FROM genres";
   query << " ORDER BY name COLLATE NOCASE ";
   query << (params.order_type == QueryParams::OrderType::ASC ? "ASC" : "DESC");
 
-  sqlite3_stmt* stmt;
-  if (sqlite3_prepare_v2(db_, query.str().c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-    return {};
-  }
+  sqlite3_stmt* stmt = reader.Prepare(query.str());
+  if (!stmt) return {};
 
   std::vector<GenreData> results;
   while (sqlite3_step(stmt) == SQLITE_ROW) {
     results.push_back(ExtractGenreFromStatement(stmt));
   }
 
-  sqlite3_finalize(stmt);
+  sqlite3_reset(stmt);
   return results;
 }
 
 std::optional<GenreData> DatabaseManager::GetGenreById(int64_t id) {
-  std::lock_guard<std::mutex> lock(db_mutex_);
+  auto reader = AcquireReader();
 
   const char* sql = "SELECT id, name, num_of_songs FROM genres WHERE id = ?";
-  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+  sqlite3_stmt* stmt = reader.Prepare(sql);
   if (!stmt) return std::nullopt;
 
   sqlite3_bind_int64(stmt, 1, id);
@@ -809,10 +1300,10 @@ bool DatabaseManager::RenamePlaylist(int64_t playlist_id, const std::string& new
 }
 
 std::vector<PlaylistData> DatabaseManager::QueryPlaylists() {
-  std::lock_guard<std::mutex> lock(db_mutex_);
+  auto reader = AcquireReader();
 
   const char* sql = "SELECT id, name, data, date_added, date_modified, num_of_songs FROM playlists ORDER BY name";
-  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+  sqlite3_stmt* stmt = reader.Prepare(sql);
   if (!stmt) return {};
 
   std::vector<PlaylistData> results;
@@ -825,7 +1316,7 @@ std::vector<PlaylistData> DatabaseManager::QueryPlaylists() {
 }
 
 std::vector<SongMetadata> DatabaseManager::GetPlaylistSongs(int64_t playlist_id) {
-  std::lock_guard<std::mutex> lock(db_mutex_);
+  auto reader = AcquireReader();
 
   const char* sql = R"(
     SELECT s.* FROM songs s
@@ -834,7 +1325,7 @@ std::vector<SongMetadata> DatabaseManager::GetPlaylistSongs(int64_t playlist_id)
     ORDER BY pi.position
   )";
 
-  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+  sqlite3_stmt* stmt = reader.Prepare(sql);
   if (!stmt) return {};
 
   sqlite3_bind_int64(stmt, 1, playlist_id);
@@ -849,47 +1340,121 @@ std::vector<SongMetadata> DatabaseManager::GetPlaylistSongs(int64_t playlist_id)
 }
 
 /// Artwork cache
-bool DatabaseManager::CacheArtwork(int64_t id, int type, const std::string& format,
-                                   const std::vector<uint8_t>& data) {
+bool DatabaseManager::CacheArtwork(const ArtworkCacheKey& key, const std::string& source_hash,
+                                   const std::string& hash, size_t size,
+                                   std::string* orphaned_hash) {
   std::lock_guard<std::mutex> lock(db_mutex_);
 
-  const char* sql = "INSERT OR REPLACE INTO artwork_cache (id, type, format, data, cached_at) VALUES (?, ?, ?, ?, ?)";
+  //identical renditions (same cover in every track of an album) are stored once
+  const char* sql = "INSERT OR IGNORE INTO artwork_store (hash, size, created_at, last_access) "
+                    "VALUES (?, ?, ?, ?)";
   sqlite3_stmt* stmt = GetPreparedStatement(sql);
   if (!stmt) return false;
 
   int64_t now = time(nullptr);
-  sqlite3_bind_int64(stmt, 1, id);
-  sqlite3_bind_int(stmt, 2, type);
-  sqlite3_bind_text(stmt, 3, format.c_str(), -1, SQLITE_TRANSIENT);
-  sqlite3_bind_blob(stmt, 4, data.data(), data.size(), SQLITE_TRANSIENT);
-  sqlite3_bind_int64(stmt, 5, now);
+  sqlite3_bind_text(stmt, 1, hash.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 2, static_cast<int64_t>(size));
+  sqlite3_bind_int64(stmt, 3, now);
+  sqlite3_bind_int64(stmt, 4, now);
 
   int rc = sqlite3_step(stmt);
   sqlite3_reset(stmt);
+  if (rc != SQLITE_DONE) {
+    return false;
+  }
 
-  return rc == SQLITE_DONE;
+  return MapArtwork(key, source_hash, hash, orphaned_hash);
 }
 
-std::optional<std::vector<uint8_t>> DatabaseManager::GetCachedArtwork(int64_t id, int type,
-                                                                       const std::string& format) {
+bool DatabaseManager::LinkArtwork(const ArtworkCacheKey& key, const std::string& source_hash,
+                                  const std::string& hash, std::string* orphaned_hash) {
   std::lock_guard<std::mutex> lock(db_mutex_);
+  return MapArtwork(key, source_hash, hash, orphaned_hash);
+}
 
-  const char* sql = "SELECT data FROM artwork_cache WHERE id = ? AND type = ? AND format = ?";
-  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+bool DatabaseManager::MapArtwork(const ArtworkCacheKey& key, const std::string& source_hash,
+                                 const std::string& hash, std::string* orphaned_hash) {
+  //rendition currently mapped to this song/album (dropped below if nothing else uses it)
+  std::string previous_hash;
+  sqlite3_stmt* stmt = GetPreparedStatement(
+      "SELECT hash FROM artwork_map WHERE id = ? AND type = ? AND size = ? AND format = ?");
+  if (!stmt) return false;
+
+  sqlite3_bind_int64(stmt, 1, key.id);
+  sqlite3_bind_int(stmt, 2, key.type);
+  sqlite3_bind_int(stmt, 3, key.size);
+  sqlite3_bind_text(stmt, 4, key.format.c_str(), -1, SQLITE_TRANSIENT);
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    previous_hash = text ? text : "";
+  }
+  sqlite3_reset(stmt);
+
+  stmt = GetPreparedStatement(
+      "INSERT OR REPLACE INTO artwork_map "
+      "(id, type, format, size, quality, source, source_mtime, source_hash, hash, cached_at) "
+      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+  if (!stmt) return false;
+
+  int64_t now = time(nullptr);
+  sqlite3_bind_int64(stmt, 1, key.id);
+  sqlite3_bind_int(stmt, 2, key.type);
+  sqlite3_bind_text(stmt, 3, key.format.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int(stmt, 4, key.size);
+  sqlite3_bind_int(stmt, 5, key.quality);
+  sqlite3_bind_text(stmt, 6, key.source.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 7, key.source_mtime);
+  sqlite3_bind_text(stmt, 8, source_hash.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_text(stmt, 9, hash.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 10, now);
+
+  int rc = sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+  if (rc != SQLITE_DONE) {
+    return false;
+  }
+
+  if (!previous_hash.empty() && previous_hash != hash) {
+    stmt = GetPreparedStatement(
+        "DELETE FROM artwork_store WHERE hash = ? "
+        "AND NOT EXISTS (SELECT 1 FROM artwork_map WHERE hash = ?)");
+    if (stmt) {
+      sqlite3_bind_text(stmt, 1, previous_hash.c_str(), -1, SQLITE_TRANSIENT);
+      sqlite3_bind_text(stmt, 2, previous_hash.c_str(), -1, SQLITE_TRANSIENT);
+      //caller removes the file once the row is gone
+      if (sqlite3_step(stmt) == SQLITE_DONE && sqlite3_changes(db_) > 0 && orphaned_hash) {
+        *orphaned_hash = previous_hash;
+      }
+      sqlite3_reset(stmt);
+    }
+  }
+
+  return true;
+}
+
+std::optional<std::string> DatabaseManager::GetArtworkHash(const ArtworkCacheKey& key) {
+  auto reader = AcquireReader();
+
+  //a rendition of another quality or of a replaced image is a miss (overwritten on store)
+  const char* sql = "SELECT hash FROM artwork_map "
+                    "WHERE id = ? AND type = ? AND size = ? AND format = ? "
+                    "AND quality = ? AND source = ? AND source_mtime = ?";
+  sqlite3_stmt* stmt = reader.Prepare(sql);
   if (!stmt) return std::nullopt;
 
-  sqlite3_bind_int64(stmt, 1, id);
-  sqlite3_bind_int(stmt, 2, type);
-  sqlite3_bind_text(stmt, 3, format.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 1, key.id);
+  sqlite3_bind_int(stmt, 2, key.type);
+  sqlite3_bind_int(stmt, 3, key.size);
+  sqlite3_bind_text(stmt, 4, key.format.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int(stmt, 5, key.quality);
+  sqlite3_bind_text(stmt, 6, key.source.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 7, key.source_mtime);
 
-  std::optional<std::vector<uint8_t>> result;
+  std::optional<std::string> result;
   if (sqlite3_step(stmt) == SQLITE_ROW) {
-    const void* blob = sqlite3_column_blob(stmt, 0);
-    int blob_size = sqlite3_column_bytes(stmt, 0);
-
-    if (blob && blob_size > 0) {
-      const uint8_t* data = static_cast<const uint8_t*>(blob);
-      result = std::vector<uint8_t>(data, data + blob_size);
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    if (text) {
+      result = std::string(text);
     }
   }
 
@@ -897,15 +1462,458 @@ std::optional<std::vector<uint8_t>> DatabaseManager::GetCachedArtwork(int64_t id
   return result;
 }
 
-/// Transaction support
-void DatabaseManager::BeginTransaction() {
+bool DatabaseManager::SetSongArtwork(const SongArtwork& artwork) {
   std::lock_guard<std::mutex> lock(db_mutex_);
-  sqlite3_exec(db_, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
-}
+
+  const char* sql = "INSERT OR REPLACE INTO song_artwork "
+                    "(file_path, file_mtime, has_picture, raw, offset, length, hash) "
+                    "VALUES (?, ?, ?, ?, ?, ?, ?)";
+  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+  if (!stmt) return false;
+
+  sqlite3_bind_text(stmt, 1, artwork.file_path.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 2, artwork.file_mtime);
+  sqlite3_bind_int(stmt, 3, artwork.has_picture ? 1 : 0);
+  sqlite3_bind_int(stmt, 4, artwork.raw ? 1 : 0);
+  sqlite3_bind_int64(stmt, 5, artwork.offset);
+  sqlite3_bind_int64(stmt, 6, artwork.length);
+  sqlite3_bind_text(stmt, 7, artwork.hash.c_str(), -1, SQLITE_TRANSIENT);
+
+  int rc = sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+
+  return rc == SQLITE_DONE;
+}
+
+std::optional<SongArtwork> DatabaseManager::GetSongArtwork(const std::string& file_path,
+                                                           int64_t file_mtime) {
+  auto reader = AcquireReader();
+
+  //a rewritten file has another mtime => its old picture location is ignored
+  const char* sql = "SELECT has_picture, raw, offset, length, hash FROM song_artwork "
+                    "WHERE file_path = ? AND file_mtime = ?";
+  sqlite3_stmt* stmt = reader.Prepare(sql);
+  if (!stmt) return std::nullopt;
+
+  sqlite3_bind_text(stmt, 1, file_path.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 2, file_mtime);
+
+  std::optional<SongArtwork> result;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    const char* hash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+    result = SongArtwork{file_path, file_mtime,
+                         sqlite3_column_int(stmt, 0) != 0,
+                         sqlite3_column_int(stmt, 1) != 0,
+                         sqlite3_column_int64(stmt, 2),
+                         sqlite3_column_int64(stmt, 3),
+                         hash ? hash : ""};
+  }
+
+  sqlite3_reset(stmt);
+  return result;
+}
+
+std::unordered_map<int64_t, ArtworkSource> DatabaseManager::GetArtworkSources(
+    int type, const std::vector<int64_t>& ids) {
+  auto reader = AcquireReader();
+
+  std::unordered_map<int64_t, ArtworkSource> sources;
+  if (type != 0 && type != 1 && type != 3 && type != 4) {
+    return sources;
+  }
+
+  //chunks stay below SQLite's bound parameter limit
+  const size_t kChunkSize = 500;
+  for (size_t start = 0; start < ids.size(); start += kChunkSize) {
+    size_t count = std::min(kChunkSize, ids.size() - start);
+
+    std::string placeholders;
+    for (size_t i = 0; i < count; ++i) {
+      placeholders += i == 0 ? "?" : ",?";
+    }
+
+    //albums/artists/genres: representative song kept by the aggregate
+    //updates, its current mtime comes from songs
+    std::string sql = type == 0
+        ? "SELECT id, file_path, file_mtime FROM songs WHERE id IN (" + placeholders + ")"
+        : "SELECT r.id, s.file_path, s.file_mtime FROM artwork_sources r "
+          "JOIN songs s ON s.file_path = r.file_path "
+          "WHERE r.type = " + std::to_string(type) + " AND r.id IN (" + placeholders + ")";
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(reader.db(), sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+      std::cerr << "[DatabaseManager] Failed to prepare artwork sources query: "
+                << sqlite3_errmsg(reader.db()) << std::endl;
+      return sources;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      sqlite3_bind_int64(stmt, static_cast<int>(i + 1), ids[start + i]);
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      const char* path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+      if (!path) {
+        continue;
+      }
+      sources[sqlite3_column_int64(stmt, 0)] = ArtworkSource{path, sqlite3_column_int64(stmt, 2)};
+    }
+
+    sqlite3_finalize(stmt);
+  }
+
+  return sources;
+}
+
+bool DatabaseManager::SetArtworkPlaceholder(const std::string& hash,
+                                            const ArtworkPlaceholder& placeholder) {
+  std::lock_guard<std::mutex> lock(db_mutex_);
+
+  const char* sql = "INSERT OR REPLACE INTO artwork_placeholder (hash, colors, blurhash) "
+                    "VALUES (?, ?, ?)";
+  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+  if (!stmt) return false;
+
+  //colours as "rrggbb,rrggbb,..."
+  std::string colors;
+  for (uint32_t color : placeholder.colors) {
+    char hex[8];
+    snprintf(hex, sizeof(hex), "%06x", color & 0xFFFFFF);
+    if (!colors.empty()) {
+      colors += ',';
+    }
+    colors += hex;
+  }
+
+  sqlite3_bind_text(stmt, 1, hash.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_text(stmt, 2, colors.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_text(stmt, 3, placeholder.blurhash.c_str(), -1, SQLITE_TRANSIENT);
+
+  int rc = sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+
+  return rc == SQLITE_DONE;
+}
+
+bool DatabaseManager::HasArtworkPlaceholder(const std::string& hash) {
+  std::lock_guard<std::mutex> lock(db_mutex_);
+
+  sqlite3_stmt* stmt = GetPreparedStatement("SELECT 1 FROM artwork_placeholder WHERE hash = ?");
+  if (!stmt) return false;
+
+  sqlite3_bind_text(stmt, 1, hash.c_str(), -1, SQLITE_TRANSIENT);
+  bool found = sqlite3_step(stmt) == SQLITE_ROW;
+  sqlite3_reset(stmt);
+
+  return found;
+}
+
+std::unordered_map<int64_t, ArtworkPlaceholder> DatabaseManager::GetArtworkPlaceholders(
+    int type, const std::vector<int64_t>& ids) {
+  auto reader = AcquireReader();
+
+  std::unordered_map<int64_t, ArtworkPlaceholder> result;
+  if (type != 0 && type != 1) {
+    return result;
+  }
+
+  const size_t kChunkSize = 500;
+  for (size_t start = 0; start < ids.size(); start += kChunkSize) {
+    size_t count = std::min(kChunkSize, ids.size() - start);
+
+    std::string placeholders;
+    for (size_t i = 0; i < count; ++i) {
+      placeholders += i == 0 ? "?" : ",?";
+    }
+
+    //same source song as GetArtworkSources. The last rendition tells which
+    //image is shown (folder cover or embedded), a map entry made from an
+    //older version of the file doesn't count.
+    std::string sources = type == 0
+        ? "SELECT id, file_path, file_mtime FROM songs WHERE id IN (" + placeholders + ")"
+        : "SELECT r.id, s.file_path, s.file_mtime FROM artwork_sources r "
+          "JOIN songs s ON s.file_path = r.file_path "
+          "WHERE r.type = 1 AND r.id IN (" + placeholders + ")";
+    std::string sql =
+        "WITH sources(id, file_path, file_mtime) AS (" + sources + ") "
+        "SELECT sources.id, p.colors, p.blurhash FROM sources "
+        "JOIN artwork_placeholder p ON p.hash = COALESCE("
+        "(SELECT m.source_hash FROM artwork_map m "
+        "JOIN artwork_placeholder q ON q.hash = m.source_hash "
+        "WHERE m.id = sources.id AND m.type = ? "
+        "AND (m.source != sources.file_path OR m.source_mtime = sources.file_mtime) "
+        "ORDER BY m.cached_at DESC LIMIT 1), "
+        "(SELECT a.hash FROM song_artwork a WHERE a.file_path = sources.file_path "
+        "AND a.file_mtime = sources.file_mtime AND a.has_picture = 1))";
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(reader.db(), sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+      std::cerr << "[DatabaseManager] Failed to prepare artwork placeholders query: "
+                << sqlite3_errmsg(reader.db()) << std::endl;
+      return result;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      sqlite3_bind_int64(stmt, static_cast<int>(i + 1), ids[start + i]);
+    }
+    sqlite3_bind_int(stmt, static_cast<int>(count + 1), type);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      const char* colors = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+      const char* blurhash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+
+      ArtworkPlaceholder placeholder;
+      placeholder.blurhash = blurhash ? blurhash : "";
+      std::stringstream stream(colors ? colors : "");
+      std::string color;
+      while (std::getline(stream, color, ',')) {
+        placeholder.colors.push_back(static_cast<uint32_t>(strtoul(color.c_str(), nullptr, 16)));
+      }
+      result[sqlite3_column_int64(stmt, 0)] = std::move(placeholder);
+    }
+
+    sqlite3_finalize(stmt);
+  }
+
+  return result;
+}
+
+std::optional<std::string> DatabaseManager::FindArtworkRendition(const std::string& source_hash,
+                                                                 int size,
+                                                                 const std::string& format,
+                                                                 int quality) {
+  std::lock_guard<std::mutex> lock(db_mutex_);
+
+  const char* sql = "SELECT hash FROM artwork_map "
+                    "WHERE source_hash = ? AND size = ? AND format = ? AND quality = ? LIMIT 1";
+  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+  if (!stmt) return std::nullopt;
+
+  sqlite3_bind_text(stmt, 1, source_hash.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int(stmt, 2, size);
+  sqlite3_bind_text(stmt, 3, format.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int(stmt, 4, quality);
+
+  std::optional<std::string> result;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    if (text) {
+      result = std::string(text);
+    }
+  }
+
+  sqlite3_reset(stmt);
+  return result;
+}
+
+bool DatabaseManager::RecordArtworkAccess(const std::vector<ArtworkAccess>& accesses) {
+  if (accesses.empty()) {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(db_mutex_);
+
+  sqlite3_stmt* stmt = GetPreparedStatement(
+      "UPDATE artwork_store SET last_access = MAX(last_access, ?), "
+      "access_count = access_count + ? WHERE hash = ?");
+  if (!stmt) return false;
+
+  //one savepoint per batch => a single WAL commit for all reads since the last
+  //flush, or part of a scan's open transaction instead of committing it halfway
+  sqlite3_exec(db_, "SAVEPOINT artwork_access", nullptr, nullptr, nullptr);
+  for (const auto& access : accesses) {
+    sqlite3_bind_int64(stmt, 1, access.last_access);
+    sqlite3_bind_int64(stmt, 2, access.count);
+    sqlite3_bind_text(stmt, 3, access.hash.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+  }
+  return sqlite3_exec(db_, "RELEASE artwork_access", nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+int64_t DatabaseManager::GetArtworkStoreSize() {
+  std::lock_guard<std::mutex> lock(db_mutex_);
+
+  sqlite3_stmt* stmt = GetPreparedStatement("SELECT COALESCE(SUM(size), 0) FROM artwork_store");
+  if (!stmt) return 0;
+
+  int64_t total = 0;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    total = sqlite3_column_int64(stmt, 0);
+  }
+  sqlite3_reset(stmt);
+  return total;
+}
+
+std::vector<std::pair<std::string, int64_t>> DatabaseManager::SelectArtworkEvictionCandidates(
+    int64_t bytes_to_free, int64_t frequency_bonus_seconds, int max_hits_counted) {
+  std::lock_guard<std::mutex> lock(db_mutex_);
+
+  std::vector<std::pair<std::string, int64_t>> candidates;
+
+  //oldest access first, every past hit (up to a cap) counts as a more recent access
+  //=> often shown covers outlive a burst of one-off lookups
+  sqlite3_stmt* stmt = GetPreparedStatement(
+      "SELECT hash, size FROM artwork_store "
+      "ORDER BY last_access + MIN(access_count, ?) * ? ASC");
+  if (!stmt) return candidates;
+
+  sqlite3_bind_int(stmt, 1, max_hits_counted);
+  sqlite3_bind_int64(stmt, 2, frequency_bonus_seconds);
+
+  int64_t freed = 0;
+  while (freed < bytes_to_free && sqlite3_step(stmt) == SQLITE_ROW) {
+    const char* hash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    int64_t size = sqlite3_column_int64(stmt, 1);
+    if (hash) {
+      candidates.emplace_back(hash, size);
+      freed += size;
+    }
+  }
+
+  sqlite3_reset(stmt);
+  return candidates;
+}
+
+bool DatabaseManager::RemoveArtwork(const std::vector<std::string>& hashes) {
+  if (hashes.empty()) {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(db_mutex_);
+
+  //the caller deletes the files next => the rows must be gone for good, not
+  //pending in a scan's transaction (retried on the next maintenance pass)
+  if (sqlite3_get_autocommit(db_) == 0) {
+    return false;
+  }
+
+  sqlite3_stmt* map_stmt = GetPreparedStatement("DELETE FROM artwork_map WHERE hash = ?");
+  sqlite3_stmt* store_stmt = GetPreparedStatement("DELETE FROM artwork_store WHERE hash = ?");
+  if (!map_stmt || !store_stmt) return false;
+
+  sqlite3_exec(db_, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
+  for (const auto& hash : hashes) {
+    sqlite3_bind_text(map_stmt, 1, hash.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_step(map_stmt);
+    sqlite3_reset(map_stmt);
+
+    sqlite3_bind_text(store_stmt, 1, hash.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_step(store_stmt);
+    sqlite3_reset(store_stmt);
+  }
+  return sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+bool DatabaseManager::CompactDatabase(double min_free_ratio, bool* deferred) {
+  std::lock_guard<std::mutex> lock(db_mutex_);
+
+  //VACUUM fails inside a transaction, and a scan's one uses the cached statements
+  if (sqlite3_get_autocommit(db_) == 0) {
+    if (deferred) {
+      *deferred = true;
+    }
+    return false;
+  }
+
+  auto pragma_int = [this](const char* sql) -> int64_t {
+    sqlite3_stmt* stmt = nullptr;
+    int64_t value = 0;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+      value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return value;
+  };
+
+  int64_t page_count = pragma_int("PRAGMA page_count");
+  int64_t free_count = pragma_int("PRAGMA freelist_count");
+  if (page_count == 0 || static_cast<double>(free_count) / page_count < min_free_ratio) {
+    return false;
+  }
+
+  std::cout << "[DatabaseManager] Compacting database (" << free_count << "/" << page_count
+            << " pages free)" << std::endl;
+
+  //VACUUM needs no open statements => drop the cached ones (re-prepared on demand)
+  ClearPreparedStatements();
+  bool ok = sqlite3_exec(db_, "VACUUM", nullptr, nullptr, nullptr) == SQLITE_OK;
+  sqlite3_wal_checkpoint_v2(db_, nullptr, SQLITE_CHECKPOINT_TRUNCATE, nullptr, nullptr);
+  return ok;
+}
+
+/// Quarantine
+bool DatabaseManager::QuarantineFile(const std::string& path, int64_t file_mtime,
+                                     const std::string& reason) {
+  std::lock_guard<std::mutex> lock(db_mutex_);
+
+  const char* sql = "INSERT OR REPLACE INTO quarantine (file_path, file_mtime, reason, quarantined_at) VALUES (?, ?, ?, ?)";
+  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+  if (!stmt) return false;
+
+  sqlite3_bind_text(stmt, 1, path.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 2, file_mtime);
+  sqlite3_bind_text(stmt, 3, reason.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 4, time(nullptr));
+
+  int rc = sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+
+  return rc == SQLITE_DONE;
+}
+
+bool DatabaseManager::RemoveFromQuarantine(const std::string& path) {
+  std::lock_guard<std::mutex> lock(db_mutex_);
+
+  const char* sql = "DELETE FROM quarantine WHERE file_path = ?";
+  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+  if (!stmt) return false;
+
+  sqlite3_bind_text(stmt, 1, path.c_str(), -1, SQLITE_TRANSIENT);
+
+  int rc = sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+
+  return rc == SQLITE_DONE && sqlite3_changes(db_) > 0;
+}
+
+bool DatabaseManager::ClearQuarantine() {
+  std::lock_guard<std::mutex> lock(db_mutex_);
+  return sqlite3_exec(db_, "DELETE FROM quarantine", nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+std::vector<QuarantineEntry> DatabaseManager::GetQuarantinedFiles() {
+  auto reader = AcquireReader();
+
+  const char* sql = "SELECT file_path, file_mtime, reason, quarantined_at FROM quarantine ORDER BY quarantined_at DESC";
+  sqlite3_stmt* stmt = reader.Prepare(sql);
+  if (!stmt) return {};
+
+  std::vector<QuarantineEntry> results;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    QuarantineEntry entry;
+    entry.file_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    entry.file_mtime = sqlite3_column_int64(stmt, 1);
+    entry.reason = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+    entry.quarantined_at = sqlite3_column_int64(stmt, 3);
+    results.push_back(entry);
+  }
+
+  sqlite3_reset(stmt);
+  return results;
+}
+
+/// Transaction support
+void DatabaseManager::BeginTransaction() {
+  std::lock_guard<std::mutex> lock(db_mutex_);
+  sqlite3_exec(db_, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
+}
 
 void DatabaseManager::CommitTransaction() {
   std::lock_guard<std::mutex> lock(db_mutex_);
   sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr);
+  songs_revision_++;
 }
 
 void DatabaseManager::RollbackTransaction() {
@@ -916,7 +1924,36 @@ void DatabaseManager::RollbackTransaction() {
 /// Aggregation updates
 void DatabaseManager::UpdateAggregatedTables() {
   std::lock_guard<std::mutex> lock(db_mutex_);
+  RebuildAggregatedTables();
+}
 
+void DatabaseManager::UpdateAggregatedTables(const AggregateDelta& delta) {
+  std::lock_guard<std::mutex> lock(db_mutex_);
+
+  if (delta.IsEmpty()) {
+    return;
+  }
+
+  std::cout << "[DatabaseManager] Updating aggregates for " << delta.album_ids.size() << " albums, "
+            << delta.genre_adjustments.size() << " genres, "
+            << delta.artists.size() << " artists" << std::endl;
+
+  sqlite3_exec(db_, "SAVEPOINT aggregates", nullptr, nullptr, nullptr);
+  RefreshAlbums(delta.album_ids);
+  AdjustGenres(delta);
+  UpdateArtistsIncremental(delta.artists);
+
+  //an updated song keeps its genre count (-1 +1) but may change the genre artwork
+  std::set<int64_t> genre_ids;
+  for (const auto& [genre_id, adjustment] : delta.genre_adjustments) {
+    genre_ids.insert(genre_id);
+  }
+  RefreshArtworkSources(1, delta.album_ids);
+  RefreshArtworkSources(4, genre_ids);
+  sqlite3_exec(db_, "RELEASE aggregates", nullptr, nullptr, nullptr);
+}
+
+void DatabaseManager::RebuildAggregatedTables() {
   //update albums
   const char* albums_sql = R"(
     INSERT OR REPLACE INTO albums (id, album, artist, artist_id, num_of_songs, first_year, last_year)
@@ -943,19 +1980,212 @@ void DatabaseManager::UpdateAggregatedTables() {
     GROUP BY genre_id
   )";
 
+  sqlite3_exec(db_, "SAVEPOINT aggregates", nullptr, nullptr, nullptr);
+
+  //drop albums/genres that no longer have songs
+  sqlite3_exec(db_, "DELETE FROM albums", nullptr, nullptr, nullptr);
+  sqlite3_exec(db_, "DELETE FROM genres", nullptr, nullptr, nullptr);
   sqlite3_exec(db_, albums_sql, nullptr, nullptr, nullptr);
   sqlite3_exec(db_, genres_sql, nullptr, nullptr, nullptr);
 
   //update artists with splitting
   UpdateArtistsWithSplitting();
+
+  RebuildArtworkSources();
+
+  sqlite3_exec(db_, "RELEASE aggregates", nullptr, nullptr, nullptr);
+}
+
+void DatabaseManager::RefreshAlbums(const std::set<int64_t>& album_ids) {
+  //recompute only the touched albums (idx_songs_album keeps this per-album)
+  const char* delete_sql = "DELETE FROM albums WHERE id = ?";
+  const char* insert_sql = R"(
+    INSERT OR REPLACE INTO albums (id, album, artist, artist_id, num_of_songs, first_year, last_year)
+    SELECT
+      album_id,
+      album,
+      artist,
+      artist_id,
+      COUNT(*) as num_of_songs,
+      MIN(CASE WHEN year > 0 THEN year ELSE NULL END) as first_year,
+      MAX(year) as last_year
+    FROM songs
+    WHERE album_id = ?
+    GROUP BY album_id
+  )";
+
+  for (int64_t album_id : album_ids) {
+    sqlite3_stmt* delete_stmt = GetPreparedStatement(delete_sql);
+    if (delete_stmt) {
+      sqlite3_bind_int64(delete_stmt, 1, album_id);
+      sqlite3_step(delete_stmt);
+      sqlite3_reset(delete_stmt);
+    }
+
+    sqlite3_stmt* insert_stmt = GetPreparedStatement(insert_sql);
+    if (insert_stmt) {
+      sqlite3_bind_int64(insert_stmt, 1, album_id);
+      sqlite3_step(insert_stmt);
+      sqlite3_reset(insert_stmt);
+    }
+  }
+}
+
+void DatabaseManager::AdjustGenres(const AggregateDelta& delta) {
+  //genres only carry a song count => apply counter adjustments
+  const char* upsert_sql = R"(
+    INSERT INTO genres (id, name, num_of_songs) VALUES (?, ?, ?)
+    ON CONFLICT(id) DO UPDATE SET num_of_songs = num_of_songs + excluded.num_of_songs
+  )";
+  const char* prune_sql = "DELETE FROM genres WHERE id = ? AND num_of_songs <= 0";
+
+  for (const auto& [genre_id, adjustment] : delta.genre_adjustments) {
+    if (adjustment == 0) {
+      continue;
+    }
+
+    auto name_it = delta.genre_names.find(genre_id);
+    const std::string& name = name_it != delta.genre_names.end() ? name_it->second : "";
+
+    sqlite3_stmt* upsert_stmt = GetPreparedStatement(upsert_sql);
+    if (upsert_stmt) {
+      sqlite3_bind_int64(upsert_stmt, 1, genre_id);
+      sqlite3_bind_text(upsert_stmt, 2, name.c_str(), -1, SQLITE_TRANSIENT);
+      sqlite3_bind_int(upsert_stmt, 3, adjustment);
+      sqlite3_step(upsert_stmt);
+      sqlite3_reset(upsert_stmt);
+    }
+
+    if (adjustment < 0) {
+      sqlite3_stmt* prune_stmt = GetPreparedStatement(prune_sql);
+      if (prune_stmt) {
+        sqlite3_bind_int64(prune_stmt, 1, genre_id);
+        sqlite3_step(prune_stmt);
+        sqlite3_reset(prune_stmt);
+      }
+    }
+  }
+}
+
+namespace {
+
+/// Representative song of the songs matched by `where`: the picture most of
+/// them embed (ties: the largest image), else the first song by title
+std::string RepresentativeSongSql(const char* from, const char* where) {
+  return std::string("SELECT s.file_path, a.hash FROM ") + from +
+         " LEFT JOIN song_artwork a ON a.file_path = s.file_path"
+         " AND a.file_mtime = s.file_mtime AND a.has_picture = 1"
+         " WHERE " + where +
+         " ORDER BY a.hash IS NULL, COUNT(*) OVER (PARTITION BY a.hash) DESC, a.length DESC,"
+         " s.title COLLATE NOCASE LIMIT 1";
+}
+
+}  // namespace
+
+void DatabaseManager::RefreshArtworkSources(int type, const std::set<int64_t>& ids) {
+  static const std::string album_sql = RepresentativeSongSql("songs s", "s.album_id = ?");
+  static const std::string genre_sql = RepresentativeSongSql("songs s", "s.genre_id = ?");
+  if (type != 1 && type != 4) {
+    return;
+  }
+
+  for (int64_t id : ids) {
+    sqlite3_stmt* stmt = GetPreparedStatement(type == 1 ? album_sql : genre_sql);
+    if (!stmt) continue;
+
+    sqlite3_bind_int64(stmt, 1, id);
+    WriteArtworkSource(type, id, stmt);
+  }
+}
+
+void DatabaseManager::RefreshArtistArtworkSources(const std::set<std::string>& artist_keys) {
+  //split artists => every raw artist crediting them
+  static const std::string sql = RepresentativeSongSql(
+      "artist_credits c JOIN songs s ON s.artist_id = c.raw_artist_id", "c.artist_key = ?");
+
+  for (const auto& artist_key : artist_keys) {
+    sqlite3_stmt* stmt = GetPreparedStatement(sql);
+    if (!stmt) continue;
+
+    sqlite3_bind_text(stmt, 1, artist_key.c_str(), -1, SQLITE_TRANSIENT);
+    WriteArtworkSource(3, ResolveArtistId(artist_key), stmt);
+  }
+}
+
+void DatabaseManager::WriteArtworkSource(int type, int64_t id, sqlite3_stmt* select_stmt) {
+  bool found = sqlite3_step(select_stmt) == SQLITE_ROW;
+  std::string file_path;
+  std::optional<std::string> hash;
+  if (found) {
+    file_path = reinterpret_cast<const char*>(sqlite3_column_text(select_stmt, 0));
+    const char* hash_text = reinterpret_cast<const char*>(sqlite3_column_text(select_stmt, 1));
+    if (hash_text) {
+      hash = hash_text;
+    }
+  }
+  sqlite3_reset(select_stmt);
+
+  //no songs left => the entity is gone
+  sqlite3_stmt* stmt = GetPreparedStatement(
+      found ? "INSERT OR REPLACE INTO artwork_sources (type, id, file_path, hash) VALUES (?, ?, ?, ?)"
+            : "DELETE FROM artwork_sources WHERE type = ? AND id = ?");
+  if (!stmt) return;
+
+  sqlite3_bind_int(stmt, 1, type);
+  sqlite3_bind_int64(stmt, 2, id);
+  if (found) {
+    sqlite3_bind_text(stmt, 3, file_path.c_str(), -1, SQLITE_TRANSIENT);
+    if (hash.has_value()) {
+      sqlite3_bind_text(stmt, 4, hash->c_str(), -1, SQLITE_TRANSIENT);
+    } else {
+      sqlite3_bind_null(stmt, 4);
+    }
+  }
+  sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+}
+
+void DatabaseManager::RebuildArtworkSources() {
+  //same choice as RepresentativeSongSql, for every album/genre in one pass
+  auto rebuild_sql = [](int type, const char* column) {
+    return "INSERT INTO artwork_sources (type, id, file_path, hash) "
+           "SELECT " + std::to_string(type) + ", entity, file_path, hash FROM ("
+           "SELECT entity, file_path, hash, ROW_NUMBER() OVER (PARTITION BY entity "
+           "ORDER BY hash IS NULL, votes DESC, length DESC, title COLLATE NOCASE) AS position FROM ("
+           "SELECT s." + std::string(column) + " AS entity, s.file_path, s.title, a.hash, a.length, "
+           "COUNT(*) OVER (PARTITION BY s." + column + ", a.hash) AS votes FROM songs s "
+           "LEFT JOIN song_artwork a ON a.file_path = s.file_path "
+           "AND a.file_mtime = s.file_mtime AND a.has_picture = 1)) "
+           "WHERE position = 1";
+  };
+
+  sqlite3_exec(db_, "DELETE FROM artwork_sources", nullptr, nullptr, nullptr);
+  for (const auto& sql : {rebuild_sql(1, "album_id"), rebuild_sql(4, "genre_id")}) {
+    char* err_msg = nullptr;
+    if (sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK) {
+      std::cerr << "[DatabaseManager] Failed to rebuild artwork sources: " << err_msg << std::endl;
+      sqlite3_free(err_msg);
+    }
+  }
+
+  std::set<std::string> artist_keys;
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db_, "SELECT DISTINCT artist_key FROM artist_credits", -1, &stmt,
+                         nullptr) == SQLITE_OK) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      artist_keys.insert(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+    }
+    sqlite3_finalize(stmt);
+  }
+  RefreshArtistArtworkSources(artist_keys);
 }
 
 /// Utility
 bool DatabaseManager::IsDatabaseEmpty() {
-  std::lock_guard<std::mutex> lock(db_mutex_);
+  auto reader = AcquireReader();
 
   const char* sql = "SELECT COUNT(*) FROM songs";
-  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+  sqlite3_stmt* stmt = reader.Prepare(sql);
   if (!stmt) return true;
 
   int count = 0;
@@ -968,10 +2198,10 @@ bool DatabaseManager::IsDatabaseEmpty() {
 }
 
 int64_t DatabaseManager::GetSongCount() {
-  std::lock_guard<std::mutex> lock(db_mutex_);
+  auto reader = AcquireReader();
 
   const char* sql = "SELECT COUNT(*) FROM songs";
-  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+  sqlite3_stmt* stmt = reader.Prepare(sql);
   if (!stmt) return 0;
 
   int64_t count = 0;
@@ -1010,6 +2240,138 @@ void DatabaseManager::ClearPreparedStatements() {
   prepared_stmts_.clear();
 }
 
+/// Read connection pool
+DatabaseManager::ReadLease::~ReadLease() {
+  if (!connection_) return;
+
+  {
+    std::lock_guard<std::mutex> lock(owner_->readers_mutex_);
+    owner_->idle_readers_.push_back(connection_);
+  }
+  owner_->readers_cv_.notify_one();
+}
+
+sqlite3_stmt* DatabaseManager::ReadLease::Prepare(const std::string& query) {
+  if (!connection_) return nullptr;
+
+  auto it = connection_->statements.find(query);
+  if (it != connection_->statements.end()) {
+    sqlite3_reset(it->second);
+    sqlite3_clear_bindings(it->second);
+    return it->second;
+  }
+
+  sqlite3_stmt* stmt;
+  int rc = sqlite3_prepare_v2(connection_->db, query.c_str(), -1, &stmt, nullptr);
+  if (rc != SQLITE_OK) {
+    std::cerr << "[DatabaseManager] Failed to prepare statement: " << sqlite3_errmsg(connection_->db) << std::endl;
+    return nullptr;
+  }
+
+  connection_->statements[query] = stmt;
+  return stmt;
+}
+
+DatabaseManager::ReadLease DatabaseManager::AcquireReader() {
+  std::unique_lock<std::mutex> lock(readers_mutex_);
+  if (read_connections_.empty()) {
+    return ReadLease(this, nullptr);
+  }
+
+  readers_cv_.wait(lock, [this] { return !idle_readers_.empty(); });
+  ReadConnection* connection = idle_readers_.back();
+  idle_readers_.pop_back();
+  return ReadLease(this, connection);
+}
+
+bool DatabaseManager::OpenReadConnections() {
+  std::lock_guard<std::mutex> lock(readers_mutex_);
+
+  for (size_t i = 0; i < kReadConnections; ++i) {
+    auto connection = std::make_unique<ReadConnection>();
+    //the lease serialises access to a connection => sqlite's own mutex isn't needed
+    int rc = sqlite3_open_v2(db_path_.c_str(), &connection->db,
+                             SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+    if (rc != SQLITE_OK) {
+      std::cerr << "[DatabaseManager] Cannot open read connection: " << sqlite3_errmsg(connection->db) << std::endl;
+      sqlite3_close(connection->db);
+      break;
+    }
+
+    //page cache is per connection => smaller than the writer's
+    sqlite3_busy_timeout(connection->db, kBusyTimeoutMs);
+    sqlite3_exec(connection->db, "PRAGMA cache_size=2000", nullptr, nullptr, nullptr);
+    sqlite3_exec(connection->db, "PRAGMA temp_store=MEMORY", nullptr, nullptr, nullptr);
+    sqlite3_exec(connection->db, "PRAGMA query_only=1", nullptr, nullptr, nullptr);
+
+    idle_readers_.push_back(connection.get());
+    read_connections_.push_back(std::move(connection));
+  }
+
+  std::cout << "[DatabaseManager] Opened " << read_connections_.size() << " read connections" << std::endl;
+  return !read_connections_.empty();
+}
+
+void DatabaseManager::CloseReadConnections() {
+  std::unique_lock<std::mutex> lock(readers_mutex_);
+
+  //queries still running keep their connection until they return it
+  readers_cv_.wait(lock, [this] { return idle_readers_.size() == read_connections_.size(); });
+
+  for (auto& connection : read_connections_) {
+    for (auto& pair : connection->statements) {
+      sqlite3_finalize(pair.second);
+    }
+    sqlite3_close(connection->db);
+  }
+  idle_readers_.clear();
+  read_connections_.clear();
+}
+
+std::vector<std::pair<int64_t, DatabaseManager::SearchColumns>> DatabaseManager::ReadSearchEntries(
+    sqlite3_stmt* select_stmt) {
+  std::vector<std::pair<int64_t, SearchColumns>> entries;
+  while (sqlite3_step(select_stmt) == SQLITE_ROW) {
+    SearchColumns columns;
+    for (size_t i = 0; i < columns.size(); ++i) {
+      const char* text = reinterpret_cast<const char*>(sqlite3_column_text(select_stmt, i + 1));
+      columns[i] = text ? text : "";  //NULL and "" index the same (no tokens)
+    }
+    entries.emplace_back(sqlite3_column_int64(select_stmt, 0), std::move(columns));
+  }
+  sqlite3_reset(select_stmt);
+  return entries;
+}
+
+void DatabaseManager::WriteSearchEntry(int64_t id, const SearchColumns& columns, bool remove) {
+  //external content => a delete must repeat the text that was indexed
+  static const char* const kInsertSql[] = {
+    "INSERT INTO songs_fts (rowid, title, artist, album, genre, file_path) VALUES (?, ?, ?, ?, ?, ?)",
+    "INSERT INTO songs_trigram (rowid, title, artist, album, genre, file_path) VALUES (?, ?, ?, ?, ?, ?)",
+  };
+  static const char* const kDeleteSql[] = {
+    "INSERT INTO songs_fts (songs_fts, rowid, title, artist, album, genre, file_path) "
+    "VALUES ('delete', ?, ?, ?, ?, ?, ?)",
+    "INSERT INTO songs_trigram (songs_trigram, rowid, title, artist, album, genre, file_path) "
+    "VALUES ('delete', ?, ?, ?, ?, ?, ?)",
+  };
+
+  for (const char* sql : remove ? kDeleteSql : kInsertSql) {
+    sqlite3_stmt* stmt = GetPreparedStatement(sql);
+    if (!stmt) continue;
+
+    sqlite3_bind_int64(stmt, 1, id);
+    for (size_t i = 0; i < columns.size(); ++i) {
+      sqlite3_bind_text(stmt, i + 2, columns[i].c_str(), -1, SQLITE_TRANSIENT);
+    }
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+      std::cerr << "[DatabaseManager] Failed to update search index: " << sqlite3_errmsg(db_) << std::endl;
+    }
+    sqlite3_reset(stmt);
+  }
+  songs_revision_++;
+}
+
 SongMetadata DatabaseManager::ExtractSongFromStatement(sqlite3_stmt* stmt) {
   SongMetadata song;
 
@@ -1034,6 +2396,19 @@ SongMetadata DatabaseManager::ExtractSongFromStatement(sqlite3_stmt* stmt) {
   song.date_added = sqlite3_column_int64(stmt, 18);
   song.date_modified = sqlite3_column_int64(stmt, 19);
   song.is_music = sqlite3_column_int(stmt, 20) != 0;
+  song.disc = sqlite3_column_int(stmt, 21);
+
+  //columns added in schema version 4 are NULL until the file is re-read
+  const char* album_artist = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 22));
+  const char* composer = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 23));
+  const char* codec = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 28));
+  song.album_artist = album_artist ? album_artist : "";
+  song.composer = composer ? composer : "";
+  song.bitrate = sqlite3_column_int(stmt, 24);
+  song.sample_rate = sqlite3_column_int(stmt, 25);
+  song.bit_depth = sqlite3_column_int(stmt, 26);
+  song.channels = sqlite3_column_int(stmt, 27);
+  song.codec = codec ? codec : "";
 
   return song;
 }
@@ -1092,7 +2467,9 @@ PlaylistData DatabaseManager::ExtractPlaylistFromStatement(sqlite3_stmt* stmt) {
   return playlist;
 }
 
-std::vector<AlbumData> DatabaseManager::QueryAlbumsForSplitArtist(int64_t split_artist_id, const QueryParams& params) {
+std::vector<AlbumData> DatabaseManager::QueryAlbumsForSplitArtist(ReadLease& reader,
+                                                                  int64_t split_artist_id,
+                                                                  const QueryParams& params) {
   //This method queries albums for a split artist (negative ID)
   //Strategy: Find all songs by this split artist, extract unique album_ids, then query those albums
 
@@ -1117,7 +2494,7 @@ std::vector<AlbumData> DatabaseManager::QueryAlbumsForSplitArtist(int64_t split_
   if (combined_artists.empty()) {
     //Query songs where artist matches exactly
     const char* sql = "SELECT DISTINCT album_id FROM songs WHERE artist = ?";
-    sqlite3_stmt* stmt = GetPreparedStatement(sql);
+    sqlite3_stmt* stmt = reader.Prepare(sql);
     if (stmt) {
       sqlite3_bind_text(stmt, 1, artist_name.c_str(), -1, SQLITE_TRANSIENT);
       while (sqlite3_step(stmt) == SQLITE_ROW) {
@@ -1128,7 +2505,7 @@ std::vector<AlbumData> DatabaseManager::QueryAlbumsForSplitArtist(int64_t split_
   } else {
     //Query songs for each combined artist string
     const char* sql = "SELECT DISTINCT album_id FROM songs WHERE artist = ?";
-    sqlite3_stmt* stmt = GetPreparedStatement(sql);
+    sqlite3_stmt* stmt = reader.Prepare(sql);
     if (stmt) {
       for (const auto& combined_artist : combined_artists) {
         sqlite3_bind_text(stmt, 1, combined_artist.c_str(), -1, SQLITE_TRANSIENT);
@@ -1144,13 +2521,18 @@ std::vector<AlbumData> DatabaseManager::QueryAlbumsForSplitArtist(int64_t split_
     return {};
   }
 
-  //Query albums by collected album_ids
+  //Query albums by collected album_ids (on the caller's reader, GetAlbumById would take another)
+  const char* album_sql = "SELECT id, album, artist, artist_id, num_of_songs, first_year, last_year FROM albums WHERE id = ?";
   std::vector<AlbumData> results;
   for (int64_t album_id : album_ids) {
-    auto album = GetAlbumById(album_id);
-    if (album.has_value()) {
-      results.push_back(album.value());
+    sqlite3_stmt* album_stmt = reader.Prepare(album_sql);
+    if (!album_stmt) break;
+
+    sqlite3_bind_int64(album_stmt, 1, album_id);
+    if (sqlite3_step(album_stmt) == SQLITE_ROW) {
+      results.push_back(ExtractAlbumFromStatement(album_stmt));
     }
+    sqlite3_reset(album_stmt);
   }
 
   //Sort results
@@ -1172,19 +2554,12 @@ void DatabaseManager::UpdateArtistsWithSplitting() {
   auto& separator = ArtistSeparator::Instance();
   separator.ClearIndex();
 
-  //Clear artists table
+  //Clear artists and credits tables
   sqlite3_exec(db_, "DELETE FROM artists", nullptr, nullptr, nullptr);
+  sqlite3_exec(db_, "DELETE FROM artist_credits", nullptr, nullptr, nullptr);
 
-  //Get all unique artists from songs with their metadata
-  const char* query_sql = R"(
-    SELECT
-      artist_id,
-      artist,
-      COUNT(DISTINCT album_id) as number_of_albums,
-      COUNT(*) as number_of_tracks
-    FROM songs
-    GROUP BY artist_id
-  )";
+  //Get all unique raw artist strings from songs
+  const char* query_sql = "SELECT artist_id, artist FROM songs GROUP BY artist_id";
 
   sqlite3_stmt* stmt;
   if (sqlite3_prepare_v2(db_, query_sql, -1, &stmt, nullptr) != SQLITE_OK) {
@@ -1192,111 +2567,241 @@ void DatabaseManager::UpdateArtistsWithSplitting() {
     return;
   }
 
-  //Build MediaStore ID lookup for single (non-combined) artists
-  std::map<std::string, int64_t> mediastore_id_lookup;
-  std::vector<ArtistData> raw_artists;
-
+  std::vector<std::pair<int64_t, std::string>> raw_artists;
   while (sqlite3_step(stmt) == SQLITE_ROW) {
-    ArtistData artist;
-    artist.id = sqlite3_column_int64(stmt, 0);
-    artist.artist = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-    artist.number_of_albums = sqlite3_column_int(stmt, 2);
-    artist.number_of_tracks = sqlite3_column_int(stmt, 3);
-
-    raw_artists.push_back(artist);
-
-    //Check if this is a single artist (not combined)
-    auto split_check = separator.SplitArtistString(artist.artist);
-    if (split_check.size() == 1) {
-      std::string artist_lower = artist.artist;
-      std::transform(artist_lower.begin(), artist_lower.end(), artist_lower.begin(), ::tolower);
-      mediastore_id_lookup[artist_lower] = artist.id;
-    }
+    const char* artist_text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+    raw_artists.emplace_back(sqlite3_column_int64(stmt, 0), artist_text ? artist_text : "");
   }
 
   sqlite3_finalize(stmt);
 
-  //Map to track seen artists (key = lowercase artist name)
-  std::map<std::string, ArtistData> seen_artists;
+  //Credit every raw artist to its split artists, then aggregate per split artist
+  std::set<std::string> artist_keys;
+  for (const auto& [raw_artist_id, raw_artist] : raw_artists) {
+    WriteArtistCredits(raw_artist_id, raw_artist, artist_keys);
+  }
+
+  RefreshArtists(artist_keys);
+
+  std::cout << "[DatabaseManager] Artists table updated with " << artist_keys.size()
+            << " artists (from " << raw_artists.size() << " raw entries)" << std::endl;
+}
+
+void DatabaseManager::UpdateArtistsIncremental(const std::map<int64_t, std::string>& raw_artists) {
+  //Split artists credited by the touched raw artists, before and after the change
+  std::set<std::string> artist_keys;
+
+  const char* old_keys_sql = "SELECT artist_key FROM artist_credits WHERE raw_artist_id = ?";
+  for (const auto& [raw_artist_id, raw_artist] : raw_artists) {
+    sqlite3_stmt* stmt = GetPreparedStatement(old_keys_sql);
+    if (!stmt) continue;
+
+    sqlite3_bind_int64(stmt, 1, raw_artist_id);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      artist_keys.insert(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+    }
+    sqlite3_reset(stmt);
+  }
 
-  //Process each raw artist
-  for (const auto& artist_data : raw_artists) {
-    auto split_artists = separator.SplitArtistString(artist_data.artist);
-    int64_t original_id = artist_data.id;
-    int num_albums = artist_data.number_of_albums;
-    int num_tracks = artist_data.number_of_tracks;
+  //Remove current rows (their ID depends on the credits we are about to rewrite)
+  const char* delete_sql = "DELETE FROM artists WHERE id = ?";
+  const char* delete_source_sql = "DELETE FROM artwork_sources WHERE type = 3 AND id = ?";
+  for (const auto& artist_key : artist_keys) {
+    int64_t artist_id = ResolveArtistId(artist_key);
+    for (const char* sql : {delete_sql, delete_source_sql}) {
+      sqlite3_stmt* stmt = GetPreparedStatement(sql);
+      if (!stmt) continue;
+
+      sqlite3_bind_int64(stmt, 1, artist_id);
+      sqlite3_step(stmt);
+      sqlite3_reset(stmt);
+    }
+  }
+
+  //Rewrite credits for raw artists that still have songs
+  const char* exists_sql = "SELECT 1 FROM songs WHERE artist_id = ? LIMIT 1";
+  for (const auto& [raw_artist_id, raw_artist] : raw_artists) {
+    DeleteArtistCredits(raw_artist_id);
+
+    sqlite3_stmt* stmt = GetPreparedStatement(exists_sql);
+    if (!stmt) continue;
+
+    sqlite3_bind_int64(stmt, 1, raw_artist_id);
+    bool has_songs = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_reset(stmt);
+
+    if (has_songs) {
+      WriteArtistCredits(raw_artist_id, raw_artist, artist_keys);
+    }
+  }
+
+  RefreshArtists(artist_keys);
+  RefreshArtistArtworkSources(artist_keys);
+}
+
+void DatabaseManager::WriteArtistCredits(int64_t raw_artist_id, const std::string& raw_artist,
+                                         std::set<std::string>& artist_keys) {
+  auto& separator = ArtistSeparator::Instance();
+  auto split_artists = separator.SplitArtistString(raw_artist);
+  bool is_single = split_artists.size() == 1;
+
+  const char* insert_sql = R"(
+    INSERT OR IGNORE INTO artist_credits (raw_artist_id, raw_artist, artist_key, artist_name, is_single)
+    VALUES (?, ?, ?, ?, ?)
+  )";
+
+  for (const auto& artist_name : split_artists) {
+    std::string artist_key = StringUtils::ToLower(artist_name);
+    artist_keys.insert(artist_key);
 
     //Build split artist index if this is a combined artist
-    if (split_artists.size() > 1) {
-      for (const auto& artist_name : split_artists) {
-        separator.AddToIndex(artist_name, artist_data.artist);
-      }
+    if (!is_single) {
+      separator.AddToIndex(artist_name, raw_artist);
     }
 
-    //Process each split artist
-    for (const auto& artist_name : split_artists) {
-      std::string artist_key = artist_name;
-      std::transform(artist_key.begin(), artist_key.end(), artist_key.begin(), ::tolower);
-
-      if (seen_artists.find(artist_key) != seen_artists.end()) {
-        //Artist already exists => merge counts
-        auto& existing_artist = seen_artists[artist_key];
-        existing_artist.number_of_albums += num_albums;
-        existing_artist.number_of_tracks += num_tracks;
-      } else {
-        //New artist => create entry
-        ArtistData split_data;
-        split_data.artist = artist_name;
-
-        //Determine ID: use MediaStore ID if available, otherwise generate
-        int64_t artist_id;
-        if (mediastore_id_lookup.find(artist_key) != mediastore_id_lookup.end()) {
-          artist_id = mediastore_id_lookup[artist_key];
-        } else if (split_artists.size() == 1) {
-          artist_id = original_id;
-        } else {
-          artist_id = separator.GenerateSplitArtistId(artist_name);
-        }
+    sqlite3_stmt* stmt = GetPreparedStatement(insert_sql);
+    if (!stmt) continue;
 
-        split_data.id = artist_id;
+    sqlite3_bind_int64(stmt, 1, raw_artist_id);
+    sqlite3_bind_text(stmt, 2, raw_artist.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, artist_key.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 4, artist_name.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 5, is_single ? 1 : 0);
+    sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+  }
+}
 
-        //Add ID-to-name mapping for split artists
-        if (artist_id < 0) {
-          separator.AddIdMapping(artist_id, artist_name);
-          std::cout << "[DatabaseManager] Added ID mapping: " << artist_id << " -> " << artist_name << std::endl;
-        }
+void DatabaseManager::DeleteArtistCredits(int64_t raw_artist_id) {
+  auto& separator = ArtistSeparator::Instance();
 
-        split_data.number_of_albums = num_albums;
-        split_data.number_of_tracks = num_tracks;
+  const char* select_sql = "SELECT artist_name, raw_artist FROM artist_credits WHERE raw_artist_id = ? AND is_single = 0";
+  sqlite3_stmt* select_stmt = GetPreparedStatement(select_sql);
+  if (select_stmt) {
+    sqlite3_bind_int64(select_stmt, 1, raw_artist_id);
+    while (sqlite3_step(select_stmt) == SQLITE_ROW) {
+      separator.RemoveFromIndex(reinterpret_cast<const char*>(sqlite3_column_text(select_stmt, 0)),
+                                reinterpret_cast<const char*>(sqlite3_column_text(select_stmt, 1)));
+    }
+    sqlite3_reset(select_stmt);
+  }
 
-        seen_artists[artist_key] = split_data;
-      }
+  const char* delete_sql = "DELETE FROM artist_credits WHERE raw_artist_id = ?";
+  sqlite3_stmt* delete_stmt = GetPreparedStatement(delete_sql);
+  if (delete_stmt) {
+    sqlite3_bind_int64(delete_stmt, 1, raw_artist_id);
+    sqlite3_step(delete_stmt);
+    sqlite3_reset(delete_stmt);
+  }
+}
+
+int64_t DatabaseManager::ResolveArtistId(const std::string& artist_key) {
+  //Use MediaStore ID of the matching single (non-combined) artist if available, otherwise generate
+  const char* sql = "SELECT MAX(raw_artist_id) FROM artist_credits WHERE artist_key = ? AND is_single = 1";
+  sqlite3_stmt* stmt = GetPreparedStatement(sql);
+
+  if (stmt) {
+    sqlite3_bind_text(stmt, 1, artist_key.c_str(), -1, SQLITE_TRANSIENT);
+    bool found = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL;
+    int64_t artist_id = found ? sqlite3_column_int64(stmt, 0) : 0;
+    sqlite3_reset(stmt);
+
+    if (found) {
+      return artist_id;
     }
   }
 
-  std::cout << "[DatabaseManager] Split artist count: " << seen_artists.size()
-            << " (from " << raw_artists.size() << " raw entries)" << std::endl;
+  return ArtistSeparator::Instance().GenerateSplitArtistId(artist_key);
+}
 
-  //Insert split artists into database
-  const char* insert_sql = "INSERT INTO artists (id, artist, number_of_albums, number_of_tracks) VALUES (?, ?, ?, ?)";
-  sqlite3_stmt* insert_stmt = GetPreparedStatement(insert_sql);
+void DatabaseManager::RefreshArtists(const std::set<std::string>& artist_keys) {
+  auto& separator = ArtistSeparator::Instance();
 
-  if (insert_stmt) {
-    for (const auto& [key, artist] : seen_artists) {
-      sqlite3_bind_int64(insert_stmt, 1, artist.id);
-      sqlite3_bind_text(insert_stmt, 2, artist.artist.c_str(), -1, SQLITE_TRANSIENT);
-      sqlite3_bind_int(insert_stmt, 3, artist.number_of_albums);
-      sqlite3_bind_int(insert_stmt, 4, artist.number_of_tracks);
+  //Per raw artist counts, merged into the split artist they credit
+  const char* stats_sql = R"(
+    SELECT
+      c.artist_name,
+      COUNT(DISTINCT s.album_id) as number_of_albums,
+      COUNT(*) as number_of_tracks
+    FROM artist_credits c
+    JOIN songs s ON s.artist_id = c.raw_artist_id
+    WHERE c.artist_key = ?
+    GROUP BY c.raw_artist_id
+    ORDER BY c.raw_artist_id
+  )";
+  const char* insert_sql = "INSERT OR REPLACE INTO artists (id, artist, number_of_albums, number_of_tracks) VALUES (?, ?, ?, ?)";
+
+  for (const auto& artist_key : artist_keys) {
+    sqlite3_stmt* stats_stmt = GetPreparedStatement(stats_sql);
+    if (!stats_stmt) continue;
+
+    sqlite3_bind_text(stats_stmt, 1, artist_key.c_str(), -1, SQLITE_TRANSIENT);
 
-      if (sqlite3_step(insert_stmt) != SQLITE_DONE) {
-        std::cerr << "[DatabaseManager] Failed to insert artist: " << sqlite3_errmsg(db_) << std::endl;
+    bool found = false;
+    ArtistData artist;
+    artist.number_of_albums = 0;
+    artist.number_of_tracks = 0;
+
+    while (sqlite3_step(stats_stmt) == SQLITE_ROW) {
+      if (!found) {
+        //first credited spelling wins as display name
+        artist.artist = reinterpret_cast<const char*>(sqlite3_column_text(stats_stmt, 0));
+        found = true;
       }
+      artist.number_of_albums += sqlite3_column_int(stats_stmt, 1);
+      artist.number_of_tracks += sqlite3_column_int(stats_stmt, 2);
+    }
+    sqlite3_reset(stats_stmt);
 
-      sqlite3_reset(insert_stmt);
+    if (!found) {
+      continue;  //no songs left for this artist
     }
+
+    artist.id = ResolveArtistId(artist_key);
+
+    //Add ID-to-name mapping for split artists
+    if (artist.id < 0) {
+      separator.AddIdMapping(artist.id, artist.artist);
+    }
+
+    sqlite3_stmt* insert_stmt = GetPreparedStatement(insert_sql);
+    if (!insert_stmt) continue;
+
+    sqlite3_bind_int64(insert_stmt, 1, artist.id);
+    sqlite3_bind_text(insert_stmt, 2, artist.artist.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(insert_stmt, 3, artist.number_of_albums);
+    sqlite3_bind_int(insert_stmt, 4, artist.number_of_tracks);
+
+    if (sqlite3_step(insert_stmt) != SQLITE_DONE) {
+      std::cerr << "[DatabaseManager] Failed to insert artist: " << sqlite3_errmsg(db_) << std::endl;
+    }
+
+    sqlite3_reset(insert_stmt);
+  }
+}
+
+void DatabaseManager::LoadArtistIndex() {
+  auto& separator = ArtistSeparator::Instance();
+  separator.ClearIndex();
+
+  const char* credits_sql = "SELECT artist_name, raw_artist FROM artist_credits WHERE is_single = 0";
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db_, credits_sql, -1, &stmt, nullptr) == SQLITE_OK) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      separator.AddToIndex(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)),
+                           reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)));
+    }
+    sqlite3_finalize(stmt);
   }
 
-  std::cout << "[DatabaseManager] Artists table updated with " << seen_artists.size() << " artists" << std::endl;
+  const char* ids_sql = "SELECT id, artist FROM artists WHERE id < 0";
+  if (sqlite3_prepare_v2(db_, ids_sql, -1, &stmt, nullptr) == SQLITE_OK) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      separator.AddIdMapping(sqlite3_column_int64(stmt, 0),
+                             reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)));
+    }
+    sqlite3_finalize(stmt);
+  }
 }
 
 }  // namespace on_audio_query_linux
@@ -4,8 +4,15 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <optional>
 #include <mutex>
+#include <memory>
+#include <condition_variable>
+#include <array>
+#include <atomic>
+#include <functional>
 #include <sqlite3.h>
 #include "../models/song_metadata.h"
 
@@ -37,6 +44,63 @@ struct GenreData {
   int num_of_songs;
 };
 
+/// Aggregate keys touched by song writes (used to refresh albums, genres
+/// and artists without rebuilding them from the whole songs table)
+struct AggregateDelta {
+  std::set<int64_t> album_ids;
+  std::map<int64_t, int> genre_adjustments;  //genre_id -> song count change
+  std::map<int64_t, std::string> genre_names;
+  std::map<int64_t, std::string> artists;  //raw artist_id -> artist string
+
+  void AddSong(const SongMetadata& song);
+  void RemoveSong(const SongMetadata& song);
+  bool IsEmpty() const;
+};
+
+/// Cached artwork rendition (one per id, type, size and format) and the
+/// image it was made from, an entry is only valid while the source is unchanged.
+/// The bytes themselves are files named by their MD5 (see ArtworkStore).
+struct ArtworkCacheKey {
+  int64_t id;
+  int type;
+  std::string format;
+  int size;          //max width/height, 0 = original size
+  int quality;
+  std::string source;   //audio file (embedded art) or folder cover image
+  int64_t source_mtime;
+};
+
+/// Audio file an artwork is read from (the song itself, or the representative
+/// song of an album/artist/genre)
+struct ArtworkSource {
+  std::string file_path;
+  int64_t file_mtime;
+};
+
+/// Embedded picture recorded by a scan (valid while the file mtime matches)
+struct SongArtwork {
+  std::string file_path;
+  int64_t file_mtime;
+  bool has_picture;   //false => the file has no embedded picture
+  bool raw;           //image stored as is at [offset, offset + length) => can be mapped
+  int64_t offset;
+  int64_t length;     //image size
+  std::string hash;   //MD5 of the image (source_hash of its renditions)
+};
+
+/// Tiny stand-in for an artwork, painted before the image itself is decoded
+struct ArtworkPlaceholder {
+  std::vector<uint32_t> colors;  //dominant colours (0xRRGGBB), most common first
+  std::string blurhash;
+};
+
+/// Artwork reads collected in memory and written in batches
+struct ArtworkAccess {
+  std::string hash;
+  int64_t last_access;  //unix seconds
+  int64_t count;
+};
+
 /// Playlist data
 struct PlaylistData {
   int64_t id;
@@ -47,6 +111,14 @@ struct PlaylistData {
   int num_of_songs;
 };
 
+/// File skipped by scans because the extractor hung or crashed on it
+struct QuarantineEntry {
+  std::string file_path;
+  int64_t file_mtime;  //mtime when quarantined (a changed file is retried)
+  std::string reason;
+  int64_t quarantined_at;
+};
+
 /// Query parameters for sorting and filtering
 struct QueryParams {
   enum class SortType {
@@ -72,10 +144,36 @@ struct QueryParams {
   std::optional<int> limit;
   std::optional<int> offset;
 
+  /// WHERE condition with `?` placeholders, the SQL only depends on which
+  /// filters are set => one cached statement per filter/sort combination
   std::string BuildWhereClause() const;
+  /// Binds the values of BuildWhereClause from parameter `index`, returns the next index
+  int BindWhereClause(sqlite3_stmt* stmt, int index) const;
+  /// Full-text matches of search_filter joined to songs as `matches(id, tier, score)`,
+  /// empty without a search
+  std::string BuildSearchJoin() const;
+  int BindSearchJoin(sqlite3_stmt* stmt, int index) const;
   std::string BuildOrderByClause() const;
+
+  /// Whitespace separated words of a search term
+  static std::vector<std::string> SearchWords(const std::string& term);
+  /// The trigram tokenizer can't match a word under 3 characters
+  static bool TrigramSearchable(const std::vector<std::string>& words);
 };
 
+/// Read-only connection of DatabaseManager's pool with its own statement cache
+struct ReadConnection {
+  sqlite3* db = nullptr;
+  std::map<std::string, sqlite3_stmt*> statements;
+};
+
+/// Data access on one writer connection plus a pool of read-only ones.
+///
+/// The database is in WAL mode, so readers see the last committed state and
+/// never wait for the writer, not even for a scan's long transaction. Query
+/// methods run on a pooled reader; writes, and the reads write paths
+/// depend on (they must see their own uncommitted rows), use the writer
+/// under db_mutex_.
 class DatabaseManager {
  public:
   explicit DatabaseManager(const std::string& db_path);
@@ -92,6 +190,10 @@ class DatabaseManager {
   bool DeleteSong(int64_t song_id);
   bool DeleteSongByPath(const std::string& path);
   std::vector<SongMetadata> QuerySongs(const QueryParams& params = QueryParams{});
+  /// QuerySongs giving up as soon as `is_cancelled` returns true (polled while
+  /// the statement runs), nullopt then
+  std::optional<std::vector<SongMetadata>> QuerySongs(const QueryParams& params,
+                                                      const std::function<bool()>& is_cancelled);
   std::optional<SongMetadata> GetSongById(int64_t id);
   std::optional<SongMetadata> GetSongByPath(const std::string& path);
   std::vector<std::string> GetAllSongPaths();
@@ -118,11 +220,58 @@ class DatabaseManager {
   std::vector<PlaylistData> QueryPlaylists();
   std::vector<SongMetadata> GetPlaylistSongs(int64_t playlist_id);
 
-  /// Artwork cache
-  bool CacheArtwork(int64_t id, int type, const std::string& format,
-                    const std::vector<uint8_t>& data);
-  std::optional<std::vector<uint8_t>> GetCachedArtwork(int64_t id, int type,
-                                                        const std::string& format);
+  /// Artwork cache metadata (content-addressed renditions + song/album mapping).
+  /// `orphaned_hash` receives a rendition no longer referenced by anything,
+  /// its file can be deleted.
+  bool CacheArtwork(const ArtworkCacheKey& key, const std::string& source_hash,
+                    const std::string& hash, size_t size, std::string* orphaned_hash = nullptr);
+  std::optional<std::string> GetArtworkHash(const ArtworkCacheKey& key);
+
+  /// Embedded picture located by a scan (nullopt when unknown or the file changed)
+  bool SetSongArtwork(const SongArtwork& artwork);
+  std::optional<SongArtwork> GetSongArtwork(const std::string& file_path, int64_t file_mtime);
+
+  /// Source file of many songs (type 0), albums (1), artists (3) or genres (4)
+  /// in one indexed query, ids without songs are left out
+  std::unordered_map<int64_t, ArtworkSource> GetArtworkSources(int type,
+                                                               const std::vector<int64_t>& ids);
+
+  /// Placeholder of an original image (keyed like source_hash)
+  bool SetArtworkPlaceholder(const std::string& hash, const ArtworkPlaceholder& placeholder);
+  bool HasArtworkPlaceholder(const std::string& hash);
+
+  /// Placeholders of many songs (type 0) or albums (type 1): the image their
+  /// artwork was last rendered from, else the picture a scan indexed.
+  /// Ids without one are left out.
+  std::unordered_map<int64_t, ArtworkPlaceholder> GetArtworkPlaceholders(
+      int type, const std::vector<int64_t>& ids);
+
+  /// Stored rendition of the same original image (made for another song/album)
+  std::optional<std::string> FindArtworkRendition(const std::string& source_hash, int size,
+                                                  const std::string& format, int quality);
+
+  /// Point a song/album at an already stored rendition
+  bool LinkArtwork(const ArtworkCacheKey& key, const std::string& source_hash,
+                   const std::string& hash, std::string* orphaned_hash = nullptr);
+
+  /// Artwork cache budget
+  bool RecordArtworkAccess(const std::vector<ArtworkAccess>& accesses);
+  int64_t GetArtworkStoreSize();
+  /// Least valuable renditions (hash, size) until `bytes_to_free` is reached
+  std::vector<std::pair<std::string, int64_t>> SelectArtworkEvictionCandidates(
+      int64_t bytes_to_free, int64_t frequency_bonus_seconds, int max_hits_counted);
+  /// Refused (false) while a write transaction is open: files are deleted right after
+  bool RemoveArtwork(const std::vector<std::string>& hashes);
+
+  /// VACUUM when at least `min_free_ratio` of the pages are unused (returns true if it ran).
+  /// `deferred` is set when a write transaction is open, the caller retries later.
+  bool CompactDatabase(double min_free_ratio, bool* deferred = nullptr);
+
+  /// Quarantine (files the extractor hung or crashed on)
+  bool QuarantineFile(const std::string& path, int64_t file_mtime, const std::string& reason);
+  bool RemoveFromQuarantine(const std::string& path);
+  bool ClearQuarantine();
+  std::vector<QuarantineEntry> GetQuarantinedFiles();
 
   /// Transaction support
   void BeginTransaction();
@@ -131,24 +280,81 @@ class DatabaseManager {
 
   /// Aggregation updates
   void UpdateAggregatedTables();
+  void UpdateAggregatedTables(const AggregateDelta& delta);
 
   /// Utility
   bool IsDatabaseEmpty();
   int64_t GetSongCount();
+  /// Bumped by song writes and commits: results read under an older value
+  /// may be stale
+  uint64_t GetSongsRevision() const { return songs_revision_.load(); }
 
  private:
   sqlite3* db_;
   std::string db_path_;
   mutable std::mutex db_mutex_;
+  std::atomic<uint64_t> songs_revision_{0};
 
   /// Prepared statements cache
   std::map<std::string, sqlite3_stmt*> prepared_stmts_;
 
+  /// Reader borrowed from the pool for one query method, returned on destruction
+  class ReadLease {
+   public:
+    ReadLease(DatabaseManager* owner, ReadConnection* connection)
+        : owner_(owner), connection_(connection) {}
+    ~ReadLease();
+    ReadLease(const ReadLease&) = delete;
+    ReadLease& operator=(const ReadLease&) = delete;
+
+    sqlite3* db() const { return connection_ ? connection_->db : nullptr; }
+
+    /// Cached statement of this connection, reset and unbound (nullptr on error)
+    sqlite3_stmt* Prepare(const std::string& query);
+
+   private:
+    DatabaseManager* owner_;
+    ReadConnection* connection_;
+  };
+
+  static constexpr size_t kReadConnections = 4;
+  static constexpr int kBusyTimeoutMs = 5000;
+  /// VM steps between two polls of a cancellable query's callback
+  static constexpr int kCancelCheckSteps = 1000;
+  std::vector<std::unique_ptr<ReadConnection>> read_connections_;
+  std::vector<ReadConnection*> idle_readers_;
+  std::mutex readers_mutex_;
+  std::condition_variable readers_cv_;
+
+  /// Waits for an idle reader (no connection when the pool isn't open)
+  ReadLease AcquireReader();
+  bool OpenReadConnections();
+  void CloseReadConnections();
+
+  /// Schema version stored in PRAGMA user_version
+  static constexpr int kSchemaVersion = 12;
+
   bool CreateTables();
+  bool CreateSearchIndex();
   bool CreateIndexes();
+  bool MigrateSchema(int from_version);
+  bool AddSongColumns();
   sqlite3_stmt* GetPreparedStatement(const std::string& query);
+
+  /// Upsert an artwork_map row, dropping the rendition it replaced when
+  /// nothing else uses it (caller must hold db_mutex_)
+  bool MapArtwork(const ArtworkCacheKey& key, const std::string& source_hash,
+                  const std::string& hash, std::string* orphaned_hash);
   void ClearPreparedStatements();
 
+  /// Search index upkeep (caller must hold db_mutex_). Indexed text of a song
+  /// in songs_fts/songs_trigram column order: title, artist, album, genre, path
+  using SearchColumns = std::array<std::string, 5>;
+  /// Rows of a prepared `SELECT id, title, artist, album, genre, file_path`
+  std::vector<std::pair<int64_t, SearchColumns>> ReadSearchEntries(sqlite3_stmt* select_stmt);
+  /// Adds a song to both search indexes, or with `remove` takes it out
+  void WriteSearchEntry(int64_t id, const SearchColumns& columns, bool remove);
+
   /// Helper functions
   SongMetadata ExtractSongFromStatement(sqlite3_stmt* stmt);
   AlbumData ExtractAlbumFromStatement(sqlite3_stmt* stmt);
@@ -156,9 +362,29 @@ class DatabaseManager {
   GenreData ExtractGenreFromStatement(sqlite3_stmt* stmt);
   PlaylistData ExtractPlaylistFromStatement(sqlite3_stmt* stmt);
 
+  /// Aggregation helpers (callers must hold db_mutex_)
+  void RebuildAggregatedTables();
+  void RefreshAlbums(const std::set<int64_t>& album_ids);
+  void AdjustGenres(const AggregateDelta& delta);
+
+  /// Representative song of albums (type 1) and genres (type 4) and of
+  /// split artists (type 3): the picture most of their songs embed
+  void RefreshArtworkSources(int type, const std::set<int64_t>& ids);
+  void RefreshArtistArtworkSources(const std::set<std::string>& artist_keys);
+  void WriteArtworkSource(int type, int64_t id, sqlite3_stmt* select_stmt);
+  void RebuildArtworkSources();
+
   /// Split artist query helpers
-  std::vector<AlbumData> QueryAlbumsForSplitArtist(int64_t split_artist_id, const QueryParams& params);
+  std::vector<AlbumData> QueryAlbumsForSplitArtist(ReadLease& reader, int64_t split_artist_id,
+                                                   const QueryParams& params);
   void UpdateArtistsWithSplitting();
+  void UpdateArtistsIncremental(const std::map<int64_t, std::string>& raw_artists);
+  void WriteArtistCredits(int64_t raw_artist_id, const std::string& raw_artist,
+                          std::set<std::string>& artist_keys);
+  void DeleteArtistCredits(int64_t raw_artist_id);
+  int64_t ResolveArtistId(const std::string& artist_key);
+  void RefreshArtists(const std::set<std::string>& artist_keys);
+  void LoadArtistIndex();
 };
 
 }  // namespace on_audio_query_linux
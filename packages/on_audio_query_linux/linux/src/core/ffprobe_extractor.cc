@@ -1,102 +1,169 @@
 #include "ffprobe_extractor.h"
+#include "ffprobe_json_parser.h"
 #include "../utils/string_utils.h"
+#include "../utils/process_runner.h"
 
-#include <nlohmann/json.hpp>
 #include <iostream>
-#include <sstream>
-#include <cstdlib>
-#include <array>
-#include <memory>
 #include <sys/stat.h>
 #include <functional>
 
-using json = nlohmann::json;
-
 namespace on_audio_query_linux {
 
-FFprobeExtractor::FFprobeExtractor() : cache_(kCacheSize) {}
+FFprobeExtractor::FFprobeExtractor()
+    : cache_(kCacheSize), stats_(nullptr), process_timeout_ms_(kDefaultProcessTimeoutMs) {}
 
 FFprobeExtractor::~FFprobeExtractor() {}
 
 bool FFprobeExtractor::IsAvailable() {
-  int exit_code = system("which ffprobe > /dev/null 2>&1");
-  return exit_code == 0;
+  return ProcessRunner::IsExecutableAvailable("ffprobe");
 }
 
-std::optional<SongMetadata> FFprobeExtractor::Extract(const std::string& file_path) {
-  //check cache first
-  auto cached = cache_.Get(file_path);
+std::optional<SongMetadata> FFprobeExtractor::Extract(const std::string& file_path,
+                                                      ExtractFailure* failure,
+                                                      ScannedArtwork* artwork) {
+  if (failure) *failure = ExtractFailure::NONE;
+
+  //check cache first (entries for files modified since extraction are stale)
+  auto cached = artwork ? std::nullopt : cache_.Get(file_path);
   if (cached.has_value()) {
-    return cached.value();
+    struct stat st;
+    if (stat(file_path.c_str(), &st) == 0 && st.st_mtime == cached->file_mtime) {
+      if (ScanStats* stats = stats_.load()) stats->Increment(ScanStats::Counter::CACHE_HITS);
+      return cached.value();
+    }
+  }
+
+  ScanStats* stats = stats_.load();
+
+  //native reader first (only when it also knows the duration)
+  std::optional<TagInfo> tag_info;
+  {
+    ScanStats::ScopedTimer native_timer(stats, ScanStats::Phase::EXTRACT_NATIVE);
+    TagReadIo io;
+    tag_info = tag_reader_.Read(file_path, &io, artwork ? &artwork->bytes : nullptr);
+    if (artwork && tag_info.has_value()) {
+      artwork->located = true;
+      artwork->found = !artwork->bytes.empty();
+      if (artwork->found && tag_info->picture->encoding == PictureInfo::Encoding::RAW) {
+        artwork->raw = true;
+        artwork->offset = tag_info->picture->spans[0].offset;
+      }
+    }
+    if (stats) {
+      stats->Increment(ScanStats::Counter::TAG_FILES);
+      stats->Increment(ScanStats::Counter::TAG_BYTES_READ, io.bytes_read);
+      stats->Increment(ScanStats::Counter::TAG_FILE_BYTES, io.file_size);
+    }
+  }
+
+  //estimates that can't be trusted (TLEN, mixed bitrate MP3) go through ffprobe
+  if (tag_info.has_value() && tag_info->HasTrustedDuration()) {
+    if (stats) {
+      stats->Increment(ScanStats::Counter::NATIVE_READS);
+      if (tag_info->duration_accuracy != DurationAccuracy::EXACT) {
+        stats->Increment(ScanStats::Counter::DURATION_ESTIMATES);
+      }
+    }
+    SongMetadata metadata = BuildMetadata(tag_info.value(), file_path);
+    cache_.Put(file_path, metadata);
+    return metadata;
   }
 
   //run ffprobe
   auto output = RunFFprobe(file_path);
 
+  //hung or crashed => no fallback row, the caller quarantines the file
+  if (output.failure != ExtractFailure::NONE) {
+    std::cerr << "[FFprobeExtractor] ffprobe "
+              << (output.failure == ExtractFailure::TIMEOUT ? "timed out" : "crashed")
+              << " on: " << file_path << std::endl;
+    if (failure) *failure = output.failure;
+    return std::nullopt;
+  }
+
   if (output.exit_code != 0 || output.json_output.empty()) {
     std::cerr << "[FFprobeExtractor] Failed to extract metadata from: " << file_path << std::endl;
+    if (stats) stats->Increment(ScanStats::Counter::FALLBACKS);
+
+    //tags read natively are still better than the file name (duration is best effort)
+    if (tag_info.has_value()) {
+      SongMetadata metadata = BuildMetadata(tag_info.value(), file_path);
+      cache_.Put(file_path, metadata);
+      return metadata;
+    }
+
     //return fallback metadata
     SongMetadata fallback = CreateFallbackMetadata(file_path);
     cache_.Put(file_path, fallback);
     return fallback;
   }
 
-  try {
-    SongMetadata metadata = ParseFFprobeOutput(output.json_output, file_path);
-    cache_.Put(file_path, metadata);
-    return metadata;
-  } catch (const std::exception& e) {
-    std::cerr << "[FFprobeExtractor] Parse error: " << e.what() << std::endl;
+  std::optional<SongMetadata> metadata;
+  {
+    ScanStats::ScopedTimer parse_timer(stats, ScanStats::Phase::EXTRACT_PARSE);
+    metadata = ParseFFprobeOutput(output.json_output, file_path);
+  }
+
+  if (!metadata.has_value()) {
+    std::cerr << "[FFprobeExtractor] Parse error: malformed ffprobe output for " << file_path << std::endl;
+    if (stats) stats->Increment(ScanStats::Counter::FALLBACKS);
     SongMetadata fallback = CreateFallbackMetadata(file_path);
     cache_.Put(file_path, fallback);
     return fallback;
   }
+
+  cache_.Put(file_path, metadata.value());
+  return metadata;
+}
+
+SongMetadata FFprobeExtractor::CreatePlaceholder(const std::string& file_path) {
+  SongMetadata metadata = CreateFallbackMetadata(file_path);
+  metadata.file_mtime = 0;
+  return metadata;
 }
 
-std::optional<std::vector<uint8_t>> FFprobeExtractor::ExtractArtwork(
+std::optional<ArtworkBytes> FFprobeExtractor::ExtractArtwork(
     const std::string& file_path,
     const std::string& format) {
 
-  //extract embedded artwork (ffmpeg)
-  std::string temp_file = "/tmp/artwork_" + std::to_string(time(nullptr)) + "_" +
-                         std::to_string(rand()) + "." + format;
+  //the attached picture is returned as stored, whatever `format` asks for
+  (void)format;
 
-  std::ostringstream cmd;
-  cmd << "ffmpeg -i " << StringUtils::EscapeShellArg(file_path) << " "
-      << "-an -vcodec copy " << StringUtils::EscapeShellArg(temp_file)
-      << " 2>/dev/null";
-
-  int exit_code = system(cmd.str().c_str());
+  //picture located while reading the tags => no process, no temp file
+  auto tag_info = tag_reader_.Read(file_path);
+  if (tag_info.has_value()) {
+    if (!tag_info->picture.has_value()) {
+      return std::nullopt;
+    }
 
-  if (exit_code != 0) {
-    return std::nullopt;
-  }
+    const PictureInfo& picture = tag_info->picture.value();
+    if (picture.encoding == PictureInfo::Encoding::RAW) {
+      auto region = MappedRegion::Map(file_path, picture.spans[0].offset,
+                                      static_cast<size_t>(picture.spans[0].length));
+      if (region.has_value()) {
+        return ArtworkBytes(std::move(region.value()));
+      }
+    }
 
-  //read extracted artwork
-  FILE* file = fopen(temp_file.c_str(), "rb");
-  if (!file) {
-    std::remove(temp_file.c_str());
-    return std::nullopt;
+    //unsynchronised ID3 frames and base64 blocks are decoded into memory
+    auto bytes = tag_reader_.ReadPicture(file_path, picture);
+    if (!bytes.has_value() || bytes->empty()) {
+      return std::nullopt;
+    }
+    return ArtworkBytes(std::move(bytes.value()));
   }
 
-  //get file size
-  fseek(file, 0, SEEK_END);
-  long size = ftell(file);
-  fseek(file, 0, SEEK_SET);
-
-  //read into buffer
-  std::vector<uint8_t> buffer(size);
-  size_t bytes_read = fread(buffer.data(), 1, size, file);
-  fclose(file);
+  //other containers: ffmpeg, streamed to stdout
+  ProcessResult result = RunProcess({
+    "ffmpeg", "-v", "quiet", "-i", file_path,
+    "-an", "-vcodec", "copy", "-frames:v", "1", "-f", "image2pipe", "pipe:1"
+  }, kArtworkOutputReserve);
 
-  //clean up temp file
-  std::remove(temp_file.c_str());
-
-  if (bytes_read != static_cast<size_t>(size)) {
+  if (result.exit_code != 0 || result.output.empty()) {
     return std::nullopt;
   }
 
-  return buffer;
+  return ArtworkBytes(std::vector<uint8_t>(result.output.begin(), result.output.end()));
 }
 
 std::vector<std::optional<SongMetadata>> FFprobeExtractor::ExtractBatch(
@@ -129,103 +196,99 @@ FFprobeExtractor::FFprobeOutput FFprobeExtractor::RunFFprobe(
     const std::string& file_path,
     const std::vector<std::string>& extra_args) {
 
-  //build ffprobe command
-  std::ostringstream cmd;
-  cmd << "ffprobe -v quiet -print_format json "
-      << "-show_format -show_streams "
-      << "-show_entries format=duration,size "
-      << "-show_entries format_tags=artist,album,title,genre,date,track,disc,composer ";
-
-  for (const auto& arg : extra_args) {
-    cmd << arg << " ";
+  //build ffprobe argv (no shell => no escaping)
+  std::vector<std::string> argv = {
+    "ffprobe", "-v", "quiet", "-print_format", "json",
+    //first audio stream only (no attached pictures), just the fields we store
+    "-select_streams", "a:0",
+    "-show_entries",
+    "stream=codec_type,codec_name,sample_rate,channels,bits_per_sample,bits_per_raw_sample,bit_rate"
+    ":format=duration,size,bit_rate"
+    ":format_tags=artist,album,title,genre,date,track,disc,composer,album_artist,albumartist"
+  };
+  argv.insert(argv.end(), extra_args.begin(), extra_args.end());
+  argv.push_back(file_path);
+
+  ProcessResult result = RunProcess(argv, kFFprobeOutputReserve);
+  if (!result.started) {
+    return {"", -1, ExtractFailure::NONE};
   }
 
-  cmd << StringUtils::EscapeShellArg(file_path) << " 2>&1";
+  ExtractFailure failure = ExtractFailure::NONE;
+  if (result.timed_out) {
+    failure = ExtractFailure::TIMEOUT;
+  } else if (result.term_signal != 0) {
+    failure = ExtractFailure::CRASH;
+  }
 
-  //execute command and capture output
-  std::array<char, 128> buffer;
-  std::string result;
-  std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.str().c_str(), "r"), pclose);
+  return {std::move(result.output), result.exit_code, failure};
+}
 
-  if (!pipe) {
-    return {"", -1};
+ProcessResult FFprobeExtractor::RunProcess(const std::vector<std::string>& argv,
+                                           size_t expected_output) {
+  ScanStats* stats = stats_.load();
+
+  ProcessLimits limits;
+  limits.timeout_ms = process_timeout_ms_.load();
+  limits.cpu_seconds = kProcessCpuSeconds;
+  limits.memory_bytes = kProcessMemoryBytes;
+
+  ScanStats::ScopedTimer run_timer(nullptr, ScanStats::Phase::EXTRACT_IO);
+  ProcessResult result = ProcessRunner::Run(argv, expected_output, limits);
+
+  if (stats) {
+    //time waiting on the child output includes its own file I/O
+    stats->AddPhaseTime(ScanStats::Phase::EXTRACT_SPAWN, result.spawn_us);
+    stats->AddPhaseTime(ScanStats::Phase::EXTRACT_IO, run_timer.Elapsed() - result.spawn_us);
+    stats->RecordSpawn(result.spawn_us);
+    if (result.started) stats->Increment(ScanStats::Counter::PROCESS_SPAWNS);
+    if (result.timed_out) stats->Increment(ScanStats::Counter::PROCESS_TIMEOUTS);
   }
 
-  while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
-    result += buffer.data();
-  }
+  return result;
+}
 
-  int exit_code = pclose(pipe.release()) >> 8;
+std::optional<SongMetadata> FFprobeExtractor::ParseFFprobeOutput(const std::string& json_output,
+                                                                  const std::string& file_path) {
+  //single pass, only the stream properties, format.duration and the mapped format.tags are decoded
+  TagInfo info;
+  if (!FFprobeJsonParser::Parse(json_output, info)) {
+    return std::nullopt;
+  }
 
-  return {result, exit_code};
+  return BuildMetadata(info, file_path);
 }
 
-SongMetadata FFprobeExtractor::ParseFFprobeOutput(const std::string& json_output,
-                                                   const std::string& file_path) {
+SongMetadata FFprobeExtractor::BuildMetadata(const TagInfo& info,
+                                              const std::string& file_path) {
   SongMetadata metadata = {};
 
-  auto j = json::parse(json_output);
-
-  /// Extract format data
-  if (j.contains("format")) {
-    auto& format = j["format"];
+  metadata.duration = info.duration_ms;
 
-    /// Duration (millisecs)
-    if (format.contains("duration")) {
-      std::string duration_str = format["duration"].get<std::string>();
-      double duration_secs = std::stod(duration_str);
-      metadata.duration = static_cast<int64_t>(duration_secs * 1000);
-    }
+  /// Tags
+  metadata.title = info.GetTag("title", StringUtils::GetFilenameWithoutExtension(file_path));
+  metadata.artist = info.GetTag("artist", "Unknown Artist");
+  metadata.album = info.GetTag("album", "Unknown Album");
+  metadata.genre = info.GetTag("genre", "Unknown");
 
-    /// File size
-    if (format.contains("size")) {
-      std::string size_str = format["size"].get<std::string>();
-      metadata.size = std::stoll(size_str);
-    }
+  //year (date tag)
+  std::string date_str = info.GetTag("date", "");
+  if (!date_str.empty()) {
+    metadata.year = StringUtils::ExtractYear(date_str);
+  }
 
-    /// Tags
-    if (format.contains("tags")) {
-      auto& tags = format["tags"];
-
-      //helper lambda to get tag value
-      auto getTag = [&tags](const std::string& key, const std::string& default_val) -> std::string {
-        if (tags.contains(key)) {
-          return tags[key].get<std::string>();
-        }
-        //try uppercase key
-        std::string upper_key = StringUtils::ToLower(key);
-        for (auto it = tags.begin(); it != tags.end(); ++it) {
-          if (StringUtils::EqualsIgnoreCase(it.key(), key)) {
-            return it.value().get<std::string>();
-          }
-        }
-        return default_val;
-      };
-
-      metadata.title = getTag("title", StringUtils::GetFilenameWithoutExtension(file_path));
-      metadata.artist = getTag("artist", "Unknown Artist");
-      metadata.album = getTag("album", "Unknown Album");
-      metadata.genre = getTag("genre", "Unknown");
-
-      //year (date tag9
-      std::string date_str = getTag("date", "");
-      if (!date_str.empty()) {
-        metadata.year = StringUtils::ExtractYear(date_str);
-      }
+  //Track number
+  metadata.track = StringUtils::ParseTrackNumber(info.GetTag("track", "0"));
+  metadata.disc = StringUtils::ParseDiscNumber(info.GetTag("disc", "0"));
+  metadata.album_artist = info.GetTag("album_artist", "");
+  metadata.composer = info.GetTag("composer", "");
 
-      //Track number
-      std::string track_str = getTag("track", "0");
-      metadata.track = StringUtils::ParseTrackNumber(track_str);
-    } else {
-      //no tags => use fallback values
-      metadata.title = StringUtils::GetFilenameWithoutExtension(file_path);
-      metadata.artist = "Unknown Artist";
-      metadata.album = "Unknown Album";
-      metadata.genre = "Unknown";
-      metadata.year = 0;
-      metadata.track = 0;
-    }
-  }
+  /// Stream properties
+  metadata.bitrate = info.bitrate;
+  metadata.sample_rate = info.sample_rate;
+  metadata.bit_depth = info.bit_depth;
+  metadata.channels = info.channels;
+  metadata.codec = info.codec;
 
   /// Generate IDs
   metadata.id = GenerateId(file_path);
@@ -240,9 +303,11 @@ SongMetadata FFprobeExtractor::ParseFFprobeOutput(const std::string& json_output
   metadata.display_name_wo_ext = StringUtils::GetFilenameWithoutExtension(file_path);
   metadata.file_extension = StringUtils::GetFileExtension(file_path);
 
-  /// File timestamps
+  /// File size and timestamps
   struct stat st;
   if (stat(file_path.c_str(), &st) == 0) {
+    metadata.size = st.st_size;
+    metadata.file_mtime = st.st_mtime;
     metadata.date_added = st.st_ctime * 1000;
     metadata.date_modified = st.st_mtime * 1000;
   }
@@ -276,12 +341,14 @@ SongMetadata FFprobeExtractor::CreateFallbackMetadata(const std::string& file_pa
   struct stat st;
   if (stat(file_path.c_str(), &st) == 0) {
     metadata.size = st.st_size;
+    metadata.file_mtime = st.st_mtime;
     metadata.date_added = st.st_ctime * 1000;
     metadata.date_modified = st.st_mtime * 1000;
   }
 
   metadata.year = 0;
   metadata.track = 0;
+  metadata.disc = 0;
   metadata.duration = 0;
   metadata.is_music = true;
 
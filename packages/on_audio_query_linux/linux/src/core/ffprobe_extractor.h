@@ -7,20 +7,68 @@
 #include <functional>
 #include "../models/song_metadata.h"
 #include "../utils/lru_cache.h"
+#include "scan_stats.h"
+#include "tag_reader.h"
+#include "../utils/process_runner.h"
+#include "../utils/mapped_region.h"
 
 namespace on_audio_query_linux {
 
+/// Image bytes from ExtractArtwork: a slice of the mapped file when the
+/// picture is stored as is, a decoded copy otherwise
+class ArtworkBytes {
+ public:
+  explicit ArtworkBytes(MappedRegion region) : region_(std::move(region)) {}
+  explicit ArtworkBytes(std::vector<uint8_t> bytes) : bytes_(std::move(bytes)) {}
+
+  const uint8_t* data() const { return region_.IsMapped() ? region_.data() : bytes_.data(); }
+  size_t size() const { return region_.IsMapped() ? region_.size() : bytes_.size(); }
+  bool empty() const { return size() == 0; }
+  bool IsMapped() const { return region_.IsMapped(); }
+
+ private:
+  MappedRegion region_;
+  std::vector<uint8_t> bytes_;
+};
+
+/// Embedded picture read by Extract through the file it already has open
+struct ScannedArtwork {
+  bool located = false;  //the tag reader understood the file => `found` is reliable
+  bool found = false;
+  bool raw = false;      //image stored as is at [offset, offset + length)
+  uint64_t offset = 0;
+  std::vector<uint8_t> bytes;
+};
+
 class FFprobeExtractor {
  public:
   FFprobeExtractor();
   ~FFprobeExtractor();
 
-  /// Extract metadata (ffprobe)
-  std::optional<SongMetadata> Extract(const std::string& file_path);
+  /// Why an extraction was abandoned (such files get quarantined)
+  enum class ExtractFailure {
+    NONE,
+    TIMEOUT,  //ffprobe killed by the watchdog
+    CRASH     //ffprobe killed by a signal (crash, CPU limit)
+  };
+
+  /// Extract metadata (native tag reader, ffprobe as fallback).
+  /// Returns nullopt when ffprobe hung or crashed, `failure` tells which.
+  /// With `artwork` the embedded picture is read along with the tags
+  /// (the metadata cache is bypassed).
+  std::optional<SongMetadata> Extract(const std::string& file_path,
+                                      ExtractFailure* failure = nullptr,
+                                      ScannedArtwork* artwork = nullptr);
 
-  /// Extract artwork (returns raw image bytes)
-  std::optional<std::vector<uint8_t>> ExtractArtwork(const std::string& file_path,
-                                                       const std::string& format = "jpeg");
+  /// Path/stat-only metadata for fast-first scans. file_mtime is left at 0,
+  /// so the row keeps being picked up by incremental scans until enriched.
+  SongMetadata CreatePlaceholder(const std::string& file_path);
+
+  /// Extract embedded artwork (raw image bytes). Pictures are located by the
+  /// tag reader and mapped from the file; ffmpeg only handles containers the
+  /// tag reader doesn't know.
+  std::optional<ArtworkBytes> ExtractArtwork(const std::string& file_path,
+                                             const std::string& format = "jpeg");
 
   /// Batch extraction for parallel processing
   std::vector<std::optional<SongMetadata>> ExtractBatch(
@@ -31,19 +79,42 @@ class FFprobeExtractor {
   /// Check if ffprobe is available on the system
   static bool IsAvailable();
 
+  /// Report spawn/io/parse timings to the given stats (nullptr disables)
+  void SetStats(ScanStats* stats) { stats_ = stats; }
+
+  /// Wall-clock limit per ffprobe/ffmpeg run in milliseconds (0 disables)
+  void SetProcessTimeout(int timeout_ms) { process_timeout_ms_ = timeout_ms; }
+  int GetProcessTimeout() const { return process_timeout_ms_.load(); }
+
  private:
   struct FFprobeOutput {
     std::string json_output;
     int exit_code;
+    ExtractFailure failure;
   };
 
   /// Run ffprobe command and capture output
   FFprobeOutput RunFFprobe(const std::string& file_path,
                            const std::vector<std::string>& extra_args = {});
 
-  /// Parse FFprobe JSON output into SongMetadata
-  SongMetadata ParseFFprobeOutput(const std::string& json_output,
-                                   const std::string& file_path);
+  /// Spawn a process and report spawn latency/io time to the stats
+  ProcessResult RunProcess(const std::vector<std::string>& argv, size_t expected_output);
+
+  /// Read buffer sizes (ffprobe JSON is a few KB, artwork up to a few hundred)
+  static constexpr size_t kFFprobeOutputReserve = 16 * 1024;
+  static constexpr size_t kArtworkOutputReserve = 256 * 1024;
+
+  /// Child process limits (a probe reads headers => these are generous)
+  static constexpr int kDefaultProcessTimeoutMs = 30000;
+  static constexpr uint64_t kProcessCpuSeconds = 20;
+  static constexpr uint64_t kProcessMemoryBytes = 1024ULL * 1024 * 1024;
+
+  /// Parse FFprobe JSON output into SongMetadata (nullopt when malformed)
+  std::optional<SongMetadata> ParseFFprobeOutput(const std::string& json_output,
+                                                 const std::string& file_path);
+
+  /// Build metadata from normalized tags (shared by both extraction paths)
+  SongMetadata BuildMetadata(const TagInfo& info, const std::string& file_path);
 
   /// Create fallback metadata when FFprobe fails
   SongMetadata CreateFallbackMetadata(const std::string& file_path);
@@ -51,9 +122,17 @@ class FFprobeExtractor {
   /// Generate ID from string (hash function)
   int64_t GenerateId(const std::string& input);
 
+  /// In-process reader for common tag formats
+  TagReader tag_reader_;
+
   /// LRU cache for recently extracted files (avoid re-extraction)
   LRUCache<std::string, SongMetadata> cache_;
   static constexpr size_t kCacheSize = 100;
+
+  /// Scan instrumentation (owned by ScanCoordinator)
+  std::atomic<ScanStats*> stats_;
+
+  std::atomic<int> process_timeout_ms_;
 };
 
 }  // namespace on_audio_query_linux
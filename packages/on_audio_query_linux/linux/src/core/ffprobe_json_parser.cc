@@ -0,0 +1,479 @@
+#include "ffprobe_json_parser.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+namespace on_audio_query_linux {
+
+namespace {
+
+/// ffprobe keys (lowercased) => normalized tag keys
+struct TagKeyMapping {
+  const char* ffprobe_key;
+  const char* tag_key;
+};
+
+const TagKeyMapping kTagKeys[] = {
+  {"title", "title"},
+  {"artist", "artist"},
+  {"album", "album"},
+  {"genre", "genre"},
+  {"date", "date"},
+  {"year", "date"},
+  {"track", "track"},
+  {"tracknumber", "track"},
+  {"disc", "disc"},
+  {"discnumber", "disc"},
+  {"composer", "composer"},
+  {"album_artist", "album_artist"},
+  {"albumartist", "album_artist"},
+  {"album artist", "album_artist"},
+};
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+void AppendUtf8(std::string& out, uint32_t code_point) {
+  if (code_point < 0x80) {
+    out += static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    out += static_cast<char>(0xC0 | (code_point >> 6));
+    out += static_cast<char>(0x80 | (code_point & 0x3F));
+  } else if (code_point < 0x10000) {
+    out += static_cast<char>(0xE0 | (code_point >> 12));
+    out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (code_point & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (code_point >> 18));
+    out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (code_point & 0x3F));
+  }
+}
+
+}  // namespace
+
+FFprobeJsonParser::FFprobeJsonParser(const char* data, size_t size)
+    : pos_(data), end_(data + size) {}
+
+bool FFprobeJsonParser::Parse(const std::string& json_output, TagInfo& info) {
+  FFprobeJsonParser parser(json_output.data(), json_output.size());
+  return parser.ParseRoot(info);
+}
+
+bool FFprobeJsonParser::ParseRoot(TagInfo& info) {
+  if (!Consume('{')) return false;
+
+  char key[kMaxKeySize];
+  size_t key_length = 0;
+
+  if (Consume('}')) return true;
+  do {
+    if (!ReadKey(key, key_length) || !Consume(':')) return false;
+
+    bool ok;
+    if (key_length == 6 && memcmp(key, "format", 6) == 0) {
+      ok = ParseFormat(info);
+    } else if (key_length == 7 && memcmp(key, "streams", 7) == 0) {
+      ok = ParseStreams(info);
+    } else {
+      ok = SkipValue(1);
+    }
+    if (!ok) return false;
+  } while (Consume(','));
+
+  return Consume('}');
+}
+
+bool FFprobeJsonParser::ParseFormat(TagInfo& info) {
+  SkipWhitespace();
+  if (pos_ < end_ && *pos_ != '{') {
+    return SkipValue(1);
+  }
+  if (!Consume('{')) return false;
+
+  char key[kMaxKeySize];
+  size_t key_length = 0;
+
+  if (Consume('}')) return true;
+  do {
+    if (!ReadKey(key, key_length) || !Consume(':')) return false;
+
+    bool ok;
+    if (key_length == 8 && memcmp(key, "duration", 8) == 0) {
+      ok = ParseDuration(info.duration_ms);
+    } else if (key_length == 4 && memcmp(key, "tags", 4) == 0) {
+      ok = ParseTags(info);
+    } else if (key_length == 8 && memcmp(key, "bit_rate", 8) == 0) {
+      //container average, the stream bitrate wins when present
+      int64_t bitrate = 0;
+      ok = ParseInteger(bitrate);
+      if (info.bitrate == 0 && bitrate > 0 && bitrate <= INT32_MAX) {
+        info.bitrate = static_cast<int>(bitrate);
+      }
+    } else {
+      ok = SkipValue(2);
+    }
+    if (!ok) return false;
+  } while (Consume(','));
+
+  return Consume('}');
+}
+
+bool FFprobeJsonParser::ParseTags(TagInfo& info) {
+  SkipWhitespace();
+  if (pos_ < end_ && *pos_ != '{') {
+    return SkipValue(2);
+  }
+  if (!Consume('{')) return false;
+
+  char key[kMaxKeySize];
+  size_t key_length = 0;
+
+  if (Consume('}')) return true;
+  do {
+    if (!ReadKey(key, key_length) || !Consume(':')) return false;
+
+    //only string values of mapped keys are decoded (first one wins)
+    const char* tag_key = MapTagKey(key, key_length);
+    SkipWhitespace();
+    if (tag_key && pos_ < end_ && *pos_ == '"' && info.tags.find(tag_key) == info.tags.end()) {
+      std::string value;
+      if (!ReadString(value)) return false;
+      if (!value.empty()) {
+        info.tags.emplace(tag_key, std::move(value));
+      }
+    } else if (!SkipValue(3)) {
+      return false;
+    }
+  } while (Consume(','));
+
+  return Consume('}');
+}
+
+bool FFprobeJsonParser::ParseStreams(TagInfo& info) {
+  SkipWhitespace();
+  if (pos_ < end_ && *pos_ != '[') {
+    return SkipValue(1);
+  }
+  if (!Consume('[')) return false;
+
+  if (Consume(']')) return true;
+  do {
+    if (!ParseStream(info)) return false;
+  } while (Consume(','));
+
+  return Consume(']');
+}
+
+bool FFprobeJsonParser::ParseStream(TagInfo& info) {
+  SkipWhitespace();
+  if (pos_ < end_ && *pos_ != '{') {
+    return SkipValue(2);
+  }
+  if (!Consume('{')) return false;
+
+  //codec_type may come after the other keys => collect, then keep the first audio stream
+  std::string codec_type;
+  std::string codec_name;
+  int64_t sample_rate = 0;
+  int64_t channels = 0;
+  int64_t bits_per_sample = 0;
+  int64_t bits_per_raw_sample = 0;
+  int64_t bitrate = 0;
+
+  char key[kMaxKeySize];
+  size_t key_length = 0;
+
+  if (!Consume('}')) {
+    do {
+      if (!ReadKey(key, key_length) || !Consume(':')) return false;
+
+      bool ok;
+      SkipWhitespace();
+      bool is_string = pos_ < end_ && *pos_ == '"';
+      if (key_length == 10 && memcmp(key, "codec_type", 10) == 0 && is_string) {
+        ok = ReadString(codec_type);
+      } else if (key_length == 10 && memcmp(key, "codec_name", 10) == 0 && is_string) {
+        ok = ReadString(codec_name);
+      } else if (key_length == 11 && memcmp(key, "sample_rate", 11) == 0) {
+        ok = ParseInteger(sample_rate);
+      } else if (key_length == 8 && memcmp(key, "channels", 8) == 0) {
+        ok = ParseInteger(channels);
+      } else if (key_length == 15 && memcmp(key, "bits_per_sample", 15) == 0) {
+        ok = ParseInteger(bits_per_sample);
+      } else if (key_length == 19 && memcmp(key, "bits_per_raw_sample", 19) == 0) {
+        ok = ParseInteger(bits_per_raw_sample);
+      } else if (key_length == 8 && memcmp(key, "bit_rate", 8) == 0) {
+        ok = ParseInteger(bitrate);
+      } else {
+        ok = SkipValue(3);
+      }
+      if (!ok) return false;
+    } while (Consume(','));
+
+    if (!Consume('}')) return false;
+  }
+
+  if ((codec_type.empty() || codec_type == "audio") && info.codec.empty()) {
+    info.codec = codec_name;
+    info.sample_rate = static_cast<int>(sample_rate);
+    info.channels = static_cast<int>(channels);
+    //lossy decoders report 0 bits per sample
+    info.bit_depth = static_cast<int>(std::max(bits_per_raw_sample, bits_per_sample));
+    if (bitrate > 0 && bitrate <= INT32_MAX) {
+      info.bitrate = static_cast<int>(bitrate);
+    }
+  }
+  return true;
+}
+
+bool FFprobeJsonParser::ParseInteger(int64_t& value) {
+  SkipWhitespace();
+  if (pos_ >= end_) return false;
+
+  bool quoted = *pos_ == '"';
+  const char* start = quoted ? pos_ + 1 : pos_;
+  const char* stop = start;
+  int64_t parsed = 0;
+  while (stop < end_ && *stop >= '0' && *stop <= '9' && stop - start < 18) {
+    parsed = parsed * 10 + (*stop - '0');
+    stop++;
+  }
+
+  bool terminated = quoted
+      ? stop < end_ && *stop == '"'
+      : stop >= end_ || *stop == ',' || *stop == '}' || *stop == ']' ||
+        *stop == ' ' || *stop == '\n' || *stop == '\r' || *stop == '\t';
+  if (stop == start || !terminated) {
+    //"N/A", null, negative or fractional values
+    return SkipValue(2);
+  }
+
+  value = parsed;
+  pos_ = quoted ? stop + 1 : stop;
+  return true;
+}
+
+bool FFprobeJsonParser::ParseDuration(int64_t& duration_ms) {
+  SkipWhitespace();
+  if (pos_ >= end_) return false;
+
+  //ffprobe prints "123.456000" (quoted), accept plain numbers as well
+  bool quoted = *pos_ == '"';
+  const char* start = quoted ? pos_ + 1 : pos_;
+  const char* stop = start;
+  while (stop < end_ && (*stop == '.' || *stop == '-' || *stop == '+' ||
+                         *stop == 'e' || *stop == 'E' || (*stop >= '0' && *stop <= '9'))) {
+    stop++;
+  }
+
+  if (quoted ? (stop >= end_ || *stop != '"') : stop == start) {
+    //"N/A", null or anything else that isn't a number
+    return SkipValue(2);
+  }
+
+  char buffer[32];
+  size_t length = static_cast<size_t>(stop - start);
+  if (length > 0 && length < sizeof(buffer)) {
+    memcpy(buffer, start, length);
+    buffer[length] = '\0';
+    double seconds = strtod(buffer, nullptr);
+    if (seconds > 0) {
+      duration_ms = static_cast<int64_t>(seconds * 1000);
+    }
+  }
+
+  pos_ = quoted ? stop + 1 : stop;
+  return true;
+}
+
+bool FFprobeJsonParser::ReadKey(char* buffer, size_t& length) {
+  SkipWhitespace();
+  if (pos_ >= end_ || *pos_ != '"') return false;
+  pos_++;
+
+  //keys are plain ASCII in practice => lowercase in place, give up on escapes
+  length = 0;
+  bool usable = true;
+  while (pos_ < end_ && *pos_ != '"') {
+    char c = *pos_;
+    if (c == '\\') {
+      usable = false;
+      if (++pos_ >= end_) return false;
+    } else if (usable) {
+      if (length == kMaxKeySize) {
+        usable = false;
+      } else {
+        buffer[length++] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+      }
+    }
+    pos_++;
+  }
+  if (pos_ >= end_) return false;
+  pos_++;
+
+  if (!usable) length = 0;
+  return true;
+}
+
+bool FFprobeJsonParser::ReadString(std::string& out) {
+  SkipWhitespace();
+  if (pos_ >= end_ || *pos_ != '"') return false;
+  pos_++;
+
+  //copy unescaped runs in one go
+  const char* run = pos_;
+  while (pos_ < end_) {
+    char c = *pos_;
+    if (c == '"') {
+      out.append(run, pos_ - run);
+      pos_++;
+      return true;
+    }
+    if (c != '\\') {
+      pos_++;
+      continue;
+    }
+
+    out.append(run, pos_ - run);
+    if (++pos_ >= end_) return false;
+    switch (*pos_++) {
+      case '"': out += '"'; break;
+      case '\\': out += '\\'; break;
+      case '/': out += '/'; break;
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'u': {
+        uint32_t code_point = 0;
+        for (int i = 0; i < 4; ++i) {
+          int digit = pos_ < end_ ? HexValue(*pos_++) : -1;
+          if (digit < 0) return false;
+          code_point = (code_point << 4) | digit;
+        }
+
+        //surrogate pair => one code point
+        if (code_point >= 0xD800 && code_point <= 0xDBFF &&
+            end_ - pos_ >= 6 && pos_[0] == '\\' && pos_[1] == 'u') {
+          uint32_t low = 0;
+          bool valid = true;
+          for (int i = 2; i < 6; ++i) {
+            int digit = HexValue(pos_[i]);
+            if (digit < 0) {
+              valid = false;
+              break;
+            }
+            low = (low << 4) | digit;
+          }
+          if (valid && low >= 0xDC00 && low <= 0xDFFF) {
+            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+            pos_ += 6;
+          }
+        }
+
+        AppendUtf8(out, code_point);
+        break;
+      }
+      default:
+        return false;
+    }
+    run = pos_;
+  }
+
+  return false;
+}
+
+bool FFprobeJsonParser::SkipString() {
+  if (pos_ >= end_ || *pos_ != '"') return false;
+  pos_++;
+
+  while (pos_ < end_) {
+    const char* next = static_cast<const char*>(memchr(pos_, '"', end_ - pos_));
+    if (!next) return false;
+
+    //a quote preceded by an odd number of backslashes is escaped
+    size_t backslashes = 0;
+    for (const char* p = next; p > pos_ && p[-1] == '\\'; --p) {
+      backslashes++;
+    }
+
+    pos_ = next + 1;
+    if (backslashes % 2 == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool FFprobeJsonParser::SkipValue(int depth) {
+  if (depth > kMaxDepth) return false;
+
+  SkipWhitespace();
+  if (pos_ >= end_) return false;
+
+  switch (*pos_) {
+    case '"':
+      return SkipString();
+    case '{': {
+      pos_++;
+      if (Consume('}')) return true;
+      do {
+        SkipWhitespace();
+        if (!SkipString() || !Consume(':') || !SkipValue(depth + 1)) return false;
+      } while (Consume(','));
+      return Consume('}');
+    }
+    case '[': {
+      pos_++;
+      if (Consume(']')) return true;
+      do {
+        if (!SkipValue(depth + 1)) return false;
+      } while (Consume(','));
+      return Consume(']');
+    }
+    default: {
+      //number, true, false, null
+      const char* start = pos_;
+      while (pos_ < end_ && *pos_ != ',' && *pos_ != '}' && *pos_ != ']' &&
+             *pos_ != ' ' && *pos_ != '\n' && *pos_ != '\r' && *pos_ != '\t') {
+        pos_++;
+      }
+      return pos_ > start;
+    }
+  }
+}
+
+void FFprobeJsonParser::SkipWhitespace() {
+  while (pos_ < end_ && (*pos_ == ' ' || *pos_ == '\n' || *pos_ == '\r' || *pos_ == '\t')) {
+    pos_++;
+  }
+}
+
+bool FFprobeJsonParser::Consume(char c) {
+  SkipWhitespace();
+  if (pos_ < end_ && *pos_ == c) {
+    pos_++;
+    return true;
+  }
+  return false;
+}
+
+const char* FFprobeJsonParser::MapTagKey(const char* key, size_t length) {
+  for (const auto& mapping : kTagKeys) {
+    if (strlen(mapping.ffprobe_key) == length && memcmp(mapping.ffprobe_key, key, length) == 0) {
+      return mapping.tag_key;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace on_audio_query_linux
@@ -0,0 +1,60 @@
+#ifndef FFPROBE_JSON_PARSER_H_
+#define FFPROBE_JSON_PARSER_H_
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include "tag_reader.h"
+
+namespace on_audio_query_linux {
+
+/// Single-pass parser for `ffprobe -print_format json` output.
+///
+/// Only format.duration/bit_rate, the format.tags we map and the properties
+/// of the first audio stream are decoded (keys are matched case-insensitively
+/// in place). Everything else is skipped without allocating.
+class FFprobeJsonParser {
+ public:
+  /// Fill `info` from ffprobe output (false when the JSON is malformed)
+  static bool Parse(const std::string& json_output, TagInfo& info);
+
+ private:
+  FFprobeJsonParser(const char* data, size_t size);
+
+  const char* pos_;
+  const char* end_;
+
+  /// Nesting limit for skipped values (keeps recursion bounded)
+  static constexpr int kMaxDepth = 64;
+
+  /// Tag keys we map are short, longer ones never match
+  static constexpr size_t kMaxKeySize = 32;
+
+  bool ParseRoot(TagInfo& info);
+  bool ParseFormat(TagInfo& info);
+  bool ParseTags(TagInfo& info);
+  bool ParseStreams(TagInfo& info);
+  bool ParseStream(TagInfo& info);
+  bool ParseDuration(int64_t& duration_ms);
+
+  /// Integer printed quoted ("44100") or plain (2), "N/A" leaves `value` alone
+  bool ParseInteger(int64_t& value);
+
+  /// Read an object key lowercased into `buffer` (length = 0 when too long)
+  bool ReadKey(char* buffer, size_t& length);
+
+  /// Read a string value, decoding escapes
+  bool ReadString(std::string& out);
+
+  bool SkipString();
+  bool SkipValue(int depth);
+  void SkipWhitespace();
+  bool Consume(char c);
+
+  /// Tag key for a lowercased ffprobe key (nullptr = not interesting)
+  static const char* MapTagKey(const char* key, size_t length);
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // FFPROBE_JSON_PARSER_H_
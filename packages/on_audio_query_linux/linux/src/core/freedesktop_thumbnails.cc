@@ -0,0 +1,278 @@
+#include "freedesktop_thumbnails.h"
+#include "thumbnail_generator.h"
+#include "../utils/md5.h"
+#include <iostream>
+#include <filesystem>
+#include <thread>
+#include <array>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace on_audio_query_linux {
+
+namespace {
+
+constexpr uint8_t kPngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+uint32_t ReadBigEndian32(const uint8_t* data) {
+  return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+         (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+}
+
+void AppendBigEndian32(std::vector<uint8_t>& out, uint32_t value) {
+  out.push_back(static_cast<uint8_t>(value >> 24));
+  out.push_back(static_cast<uint8_t>(value >> 16));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+/// Characters GLib leaves unescaped in file URIs (UNSAFE_PATH)
+bool IsUriPathChar(unsigned char c) {
+  if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+    return true;
+  }
+  return c != '\0' && strchr("!$&'()*+,-./:=@_~", c) != nullptr;
+}
+
+}  // namespace
+
+FreedesktopThumbnails::FreedesktopThumbnails(const std::string& cache_directory)
+    : cache_directory_(cache_directory), enabled_(true) {}
+
+std::string FreedesktopThumbnails::DefaultDirectory() {
+  const char* cache_home = getenv("XDG_CACHE_HOME");
+  if (cache_home && cache_home[0] == '/') {
+    return std::string(cache_home) + "/thumbnails";
+  }
+  const char* home = getenv("HOME");
+  return std::string(home ? home : "/tmp") + "/.cache/thumbnails";
+}
+
+std::string FreedesktopThumbnails::FileUri(const std::string& file_path) {
+  static const char kHex[] = "0123456789ABCDEF";
+
+  std::string uri = "file://";
+  uri.reserve(uri.size() + file_path.size());
+  for (unsigned char c : file_path) {
+    if (IsUriPathChar(c)) {
+      uri += static_cast<char>(c);
+    } else {
+      uri += '%';
+      uri += kHex[c >> 4];
+      uri += kHex[c & 0x0F];
+    }
+  }
+  return uri;
+}
+
+std::string FreedesktopThumbnails::ThumbnailPath(const Flavor& flavor, const std::string& uri) const {
+  return cache_directory_ + "/" + flavor.name + "/" + Md5::HexDigest(uri) + ".png";
+}
+
+std::optional<MappedRegion> FreedesktopThumbnails::Lookup(const std::string& file_path,
+                                                          int64_t file_mtime, int size) {
+  if (!enabled_ || size <= 0) {
+    return std::nullopt;
+  }
+
+  std::string uri = FileUri(file_path);
+  for (const Flavor& flavor : kFlavors) {
+    if (flavor.size < size) {
+      continue;  //upscaled covers look worse than a fresh extraction
+    }
+
+    auto png = MappedRegion::MapFile(ThumbnailPath(flavor, uri));
+    if (png.has_value() && IsValid(png.value(), uri, file_mtime)) {
+      return png;
+    }
+  }
+
+  return std::nullopt;
+}
+
+bool FreedesktopThumbnails::IsValid(const MappedRegion& png, const std::string& uri,
+                                    int64_t file_mtime) const {
+  auto texts = ReadTextChunks(png.data(), png.size());
+
+  //URI and MTime are mandatory, a missing one makes the thumbnail invalid
+  auto uri_text = texts.find("Thumb::URI");
+  auto mtime_text = texts.find("Thumb::MTime");
+  if (uri_text == texts.end() || mtime_text == texts.end() || uri_text->second != uri) {
+    return false;
+  }
+
+  char* end = nullptr;
+  long long mtime = strtoll(mtime_text->second.c_str(), &end, 10);
+  return end != mtime_text->second.c_str() && mtime == file_mtime;
+}
+
+bool FreedesktopThumbnails::Save(const std::string& file_path, int64_t file_mtime, int size,
+                                 const uint8_t* image, size_t image_size) {
+  if (!enabled_ || size <= 0 || !image || image_size == 0) {
+    return false;
+  }
+
+  //the spec forbids thumbnailing thumbnails
+  if (file_path.compare(0, cache_directory_.size() + 1, cache_directory_ + "/") == 0) {
+    return false;
+  }
+
+  const Flavor* flavor = nullptr;
+  for (const Flavor& candidate : kFlavors) {
+    if (candidate.size >= size) {
+      flavor = &candidate;
+      break;
+    }
+  }
+  if (!flavor) {
+    return false;
+  }
+
+  std::string uri = FileUri(file_path);
+  std::string path = ThumbnailPath(*flavor, uri);
+  auto existing = MappedRegion::MapFile(path);
+  if (existing.has_value() && IsValid(existing.value(), uri, file_mtime)) {
+    return true;
+  }
+
+  //PNG fitting the flavor (a small PNG original is used as is)
+  std::vector<uint8_t> png;
+  auto generated = ThumbnailGenerator::Generate(image, image_size, flavor->size, "png", 0);
+  if (generated.has_value()) {
+    png = std::move(generated.value());
+  } else if (ThumbnailGenerator::IsPng(image, image_size)) {
+    png.assign(image, image + image_size);
+  } else {
+    return false;
+  }
+
+  std::vector<std::pair<std::string, std::string>> texts = {
+    {"Thumb::URI", uri},
+    {"Thumb::MTime", std::to_string(file_mtime)},
+    {"Software", "on_audio_query"},
+  };
+  struct stat st;
+  if (stat(file_path.c_str(), &st) == 0) {
+    texts.push_back({"Thumb::Size", std::to_string(static_cast<int64_t>(st.st_size))});
+  }
+
+  png = AddTextChunks(png, texts);
+  if (png.empty()) {
+    return false;
+  }
+
+  //thumbnail directories are private to the user (0700)
+  std::string directory = cache_directory_ + "/" + flavor->name;
+  std::error_code error;
+  std::filesystem::create_directories(std::filesystem::path(cache_directory_).parent_path(), error);
+  mkdir(cache_directory_.c_str(), 0700);
+  mkdir(directory.c_str(), 0700);
+
+  //written aside and renamed => other apps never read a partial file
+  std::string temp_path = path + ".on_audio_query." + std::to_string(getpid()) + "." +
+                          std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return false;
+  }
+
+  size_t written = 0;
+  while (written < png.size()) {
+    ssize_t n = write(fd, png.data() + written, png.size() - written);
+    if (n <= 0) {
+      break;
+    }
+    written += static_cast<size_t>(n);
+  }
+  close(fd);
+
+  if (written != png.size() || rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::cerr << "[FreedesktopThumbnails] Failed to write " << path << std::endl;
+    unlink(temp_path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+std::map<std::string, std::string> FreedesktopThumbnails::ReadTextChunks(const uint8_t* data,
+                                                                        size_t size) {
+  std::map<std::string, std::string> texts;
+  if (size < 8 || memcmp(data, kPngSignature, 8) != 0) {
+    return texts;
+  }
+
+  size_t offset = 8;
+  while (offset + 12 <= size) {
+    uint32_t length = ReadBigEndian32(data + offset);
+    const uint8_t* type = data + offset + 4;
+    if (length > size - offset - 12) {
+      break;
+    }
+
+    if (memcmp(type, "tEXt", 4) == 0) {
+      const char* text = reinterpret_cast<const char*>(data + offset + 8);
+      const char* separator = static_cast<const char*>(memchr(text, '\0', length));
+      if (separator) {
+        texts[std::string(text, separator)] = std::string(separator + 1, text + length);
+      }
+    } else if (memcmp(type, "IEND", 4) == 0) {
+      break;
+    }
+
+    offset += 12 + static_cast<size_t>(length);
+  }
+
+  return texts;
+}
+
+std::vector<uint8_t> FreedesktopThumbnails::AddTextChunks(
+    const std::vector<uint8_t>& png,
+    const std::vector<std::pair<std::string, std::string>>& texts) {
+  //signature + IHDR (always the first chunk, 13 bytes of data)
+  const size_t kHeaderEnd = 8 + 12 + 13;
+  if (png.size() < kHeaderEnd || memcmp(png.data(), kPngSignature, 8) != 0 ||
+      memcmp(png.data() + 12, "IHDR", 4) != 0) {
+    return {};
+  }
+
+  std::vector<uint8_t> out(png.begin(), png.begin() + kHeaderEnd);
+  for (const auto& text : texts) {
+    std::vector<uint8_t> chunk = {'t', 'E', 'X', 't'};
+    chunk.insert(chunk.end(), text.first.begin(), text.first.end());
+    chunk.push_back(0);
+    chunk.insert(chunk.end(), text.second.begin(), text.second.end());
+
+    AppendBigEndian32(out, static_cast<uint32_t>(chunk.size() - 4));
+    out.insert(out.end(), chunk.begin(), chunk.end());
+    AppendBigEndian32(out, Crc32(chunk.data(), chunk.size()));
+  }
+  out.insert(out.end(), png.begin() + kHeaderEnd, png.end());
+  return out;
+}
+
+uint32_t FreedesktopThumbnails::Crc32(const uint8_t* data, size_t size, uint32_t crc) {
+  static const auto kTable = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      table[n] = c;
+    }
+    return table;
+  }();
+
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i) {
+    crc = kTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+}  // namespace on_audio_query_linux
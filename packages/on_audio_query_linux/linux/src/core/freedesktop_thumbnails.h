@@ -0,0 +1,71 @@
+#ifndef FREEDESKTOP_THUMBNAILS_H_
+#define FREEDESKTOP_THUMBNAILS_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <optional>
+#include <atomic>
+#include <cstdint>
+#include "../utils/mapped_region.h"
+
+namespace on_audio_query_linux {
+
+/// Thumbnails shared with the desktop (freedesktop.org thumbnail spec):
+/// $XDG_CACHE_HOME/thumbnails/{normal,large,x-large,xx-large}/<md5 of the file URI>.png
+///
+/// File managers and other apps keep covers there already, a valid one
+/// (Thumb::URI and Thumb::MTime match the file) is used instead of extracting
+/// the artwork again, and thumbnails we make are written back in that format.
+class FreedesktopThumbnails {
+ public:
+  explicit FreedesktopThumbnails(const std::string& cache_directory = DefaultDirectory());
+
+  /// $XDG_CACHE_HOME/thumbnails (~/.cache/thumbnails)
+  static std::string DefaultDirectory();
+
+  void SetEnabled(bool enabled) { enabled_ = enabled; }
+  bool IsEnabled() const { return enabled_.load(); }
+
+  /// Valid PNG thumbnail of a file that is at least `size` pixels (the
+  /// smallest such flavor), nullopt when there's none or it's stale
+  std::optional<MappedRegion> Lookup(const std::string& file_path, int64_t file_mtime, int size);
+
+  /// Write the thumbnail of the flavor covering `size` from the original image
+  /// (JPEG/PNG bytes). Existing valid thumbnails are kept.
+  bool Save(const std::string& file_path, int64_t file_mtime, int size,
+            const uint8_t* image, size_t image_size);
+
+  /// file:// URI escaped like GLib's g_filename_to_uri (thumbnail names are its MD5)
+  static std::string FileUri(const std::string& file_path);
+
+ private:
+  struct Flavor {
+    const char* name;
+    int size;
+  };
+
+  static constexpr Flavor kFlavors[] = {
+    {"normal", 128}, {"large", 256}, {"x-large", 512}, {"xx-large", 1024}
+  };
+
+  std::string cache_directory_;
+  std::atomic<bool> enabled_;
+
+  std::string ThumbnailPath(const Flavor& flavor, const std::string& uri) const;
+  bool IsValid(const MappedRegion& png, const std::string& uri, int64_t file_mtime) const;
+
+  /// tEXt chunks of a PNG (keyword => text)
+  static std::map<std::string, std::string> ReadTextChunks(const uint8_t* data, size_t size);
+
+  /// Copy of a PNG with tEXt chunks inserted after IHDR (empty when not a PNG)
+  static std::vector<uint8_t> AddTextChunks(
+      const std::vector<uint8_t>& png,
+      const std::vector<std::pair<std::string, std::string>>& texts);
+
+  static uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // FREEDESKTOP_THUMBNAILS_H_
@@ -0,0 +1,214 @@
+#include "placeholder_generator.h"
+#include "thumbnail_generator.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace on_audio_query_linux {
+
+namespace {
+
+constexpr char kBase83[] =
+    "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz#$%*+,-.:;=?@[]^_{|}~";
+
+void AppendBase83(std::string& out, int value, int length) {
+  int divisor = 1;
+  for (int i = 1; i < length; ++i) {
+    divisor *= 83;
+  }
+  for (int i = 0; i < length; ++i) {
+    out += kBase83[(value / divisor) % 83];
+    divisor /= 83;
+  }
+}
+
+float SrgbToLinear(uint8_t value) {
+  static const auto kTable = [] {
+    std::array<float, 256> table{};
+    for (int i = 0; i < 256; ++i) {
+      float v = i / 255.0f;
+      table[i] = v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+    }
+    return table;
+  }();
+  return kTable[value];
+}
+
+int LinearToSrgb(float value) {
+  float v = std::clamp(value, 0.0f, 1.0f);
+  return v <= 0.0031308f ? static_cast<int>(v * 12.92f * 255 + 0.5f)
+                         : static_cast<int>((1.055f * std::pow(v, 1 / 2.4f) - 0.055f) * 255 + 0.5f);
+}
+
+float SignedSqrt(float value) {
+  return std::copysign(std::sqrt(std::fabs(value)), value);
+}
+
+/// RGB of a pixel, false for (mostly) transparent ones
+bool ReadPixel(const ImageBuffer& image, size_t index, uint8_t rgb[3]) {
+  const uint8_t* pixel = image.pixels.data() + index * image.channels;
+  if (image.channels < 3) {
+    rgb[0] = rgb[1] = rgb[2] = pixel[0];
+    return true;
+  }
+  rgb[0] = pixel[0];
+  rgb[1] = pixel[1];
+  rgb[2] = pixel[2];
+  return image.channels != 4 || pixel[3] >= 128;
+}
+
+}  // namespace
+
+std::optional<ArtworkPlaceholder> PlaceholderGenerator::Generate(const uint8_t* data, size_t size) {
+  ImageBuffer image;
+  if (!ThumbnailGenerator::Decode(data, size, kSampleSize, &image)) {
+    return std::nullopt;
+  }
+
+  ArtworkPlaceholder placeholder;
+  placeholder.colors = DominantColors(image);
+  placeholder.blurhash = EncodeBlurhash(image);
+  if (placeholder.colors.empty()) {
+    return std::nullopt;  //fully transparent
+  }
+  return placeholder;
+}
+
+std::vector<uint32_t> PlaceholderGenerator::DominantColors(const ImageBuffer& image) {
+  struct Bucket {
+    uint32_t count = 0;
+    uint32_t sum[3] = {0, 0, 0};
+  };
+  std::array<Bucket, 512> buckets;
+
+  size_t pixel_count = static_cast<size_t>(image.width) * image.height;
+  uint32_t counted = 0;
+  for (size_t i = 0; i < pixel_count; ++i) {
+    uint8_t rgb[3];
+    if (!ReadPixel(image, i, rgb)) {
+      continue;
+    }
+    Bucket& bucket = buckets[((rgb[0] >> 5) << 6) | ((rgb[1] >> 5) << 3) | (rgb[2] >> 5)];
+    bucket.count++;
+    bucket.sum[0] += rgb[0];
+    bucket.sum[1] += rgb[1];
+    bucket.sum[2] += rgb[2];
+    counted++;
+  }
+
+  std::vector<const Bucket*> ranked;
+  for (const Bucket& bucket : buckets) {
+    if (bucket.count > 0) {
+      ranked.push_back(&bucket);
+    }
+  }
+  std::sort(ranked.begin(), ranked.end(),
+            [](const Bucket* a, const Bucket* b) { return a->count > b->count; });
+
+  //a colour covering under 2% of the cover is noise, one close to a more
+  //common colour is the same colour split across buckets
+  const uint32_t kMinCount = std::max<uint32_t>(1, counted / 50);
+  const int kMinDistanceSquared = 48 * 48;
+
+  std::vector<uint32_t> colors;
+  for (const Bucket* bucket : ranked) {
+    if (colors.size() >= kMaxColors || (!colors.empty() && bucket->count < kMinCount)) {
+      break;
+    }
+
+    int rgb[3];
+    for (int c = 0; c < 3; ++c) {
+      rgb[c] = static_cast<int>((bucket->sum[c] + bucket->count / 2) / bucket->count);
+    }
+
+    bool distinct = std::all_of(colors.begin(), colors.end(), [&](uint32_t color) {
+      int dr = rgb[0] - static_cast<int>((color >> 16) & 0xFF);
+      int dg = rgb[1] - static_cast<int>((color >> 8) & 0xFF);
+      int db = rgb[2] - static_cast<int>(color & 0xFF);
+      return dr * dr + dg * dg + db * db >= kMinDistanceSquared;
+    });
+    if (distinct) {
+      colors.push_back((static_cast<uint32_t>(rgb[0]) << 16) | (rgb[1] << 8) | rgb[2]);
+    }
+  }
+
+  return colors;
+}
+
+std::string PlaceholderGenerator::EncodeBlurhash(const ImageBuffer& image) {
+  const int width = image.width;
+  const int height = image.height;
+
+  //cosine bases are the same for every row/column => computed once
+  std::vector<float> cos_x(static_cast<size_t>(kComponentsX) * width);
+  std::vector<float> cos_y(static_cast<size_t>(kComponentsY) * height);
+  for (int i = 0; i < kComponentsX; ++i) {
+    for (int x = 0; x < width; ++x) {
+      cos_x[i * width + x] = std::cos(static_cast<float>(M_PI) * i * x / width);
+    }
+  }
+  for (int j = 0; j < kComponentsY; ++j) {
+    for (int y = 0; y < height; ++y) {
+      cos_y[j * height + y] = std::cos(static_cast<float>(M_PI) * j * y / height);
+    }
+  }
+
+  float factors[kComponentsY][kComponentsX][3] = {};
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint8_t rgb[3];
+      ReadPixel(image, static_cast<size_t>(y) * width + x, rgb);
+      float linear[3] = {SrgbToLinear(rgb[0]), SrgbToLinear(rgb[1]), SrgbToLinear(rgb[2])};
+
+      for (int j = 0; j < kComponentsY; ++j) {
+        for (int i = 0; i < kComponentsX; ++i) {
+          float basis = cos_x[i * width + x] * cos_y[j * height + y];
+          factors[j][i][0] += basis * linear[0];
+          factors[j][i][1] += basis * linear[1];
+          factors[j][i][2] += basis * linear[2];
+        }
+      }
+    }
+  }
+
+  float max_ac = 0.0f;
+  for (int j = 0; j < kComponentsY; ++j) {
+    for (int i = 0; i < kComponentsX; ++i) {
+      float scale = (i == 0 && j == 0 ? 1.0f : 2.0f) / (width * height);
+      for (int c = 0; c < 3; ++c) {
+        factors[j][i][c] *= scale;
+        if (i != 0 || j != 0) {
+          max_ac = std::max(max_ac, std::fabs(factors[j][i][c]));
+        }
+      }
+    }
+  }
+
+  std::string hash;
+  AppendBase83(hash, (kComponentsX - 1) + (kComponentsY - 1) * 9, 1);
+
+  int quantised_max = std::clamp(static_cast<int>(std::floor(max_ac * 166 - 0.5f)), 0, 82);
+  float max_value = (quantised_max + 1) / 166.0f;
+  AppendBase83(hash, quantised_max, 1);
+
+  AppendBase83(hash, (LinearToSrgb(factors[0][0][0]) << 16) +
+                     (LinearToSrgb(factors[0][0][1]) << 8) + LinearToSrgb(factors[0][0][2]), 4);
+
+  for (int j = 0; j < kComponentsY; ++j) {
+    for (int i = 0; i < kComponentsX; ++i) {
+      if (i == 0 && j == 0) {
+        continue;
+      }
+      int quantised[3];
+      for (int c = 0; c < 3; ++c) {
+        quantised[c] = std::clamp(
+            static_cast<int>(std::floor(SignedSqrt(factors[j][i][c] / max_value) * 9 + 9.5f)), 0, 18);
+      }
+      AppendBase83(hash, quantised[0] * 19 * 19 + quantised[1] * 19 + quantised[2], 2);
+    }
+  }
+
+  return hash;
+}
+
+}  // namespace on_audio_query_linux
@@ -0,0 +1,38 @@
+#ifndef PLACEHOLDER_GENERATOR_H_
+#define PLACEHOLDER_GENERATOR_H_
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include "database_manager.h"
+#include "../utils/image_resampler.h"
+
+namespace on_audio_query_linux {
+
+/// Computes the placeholder of an artwork: its dominant colours and a
+/// BlurHash (https://blurha.sh), so a list can paint something before the
+/// image itself is loaded and decoded.
+///
+/// The image is decoded straight to a tiny sample (JPEG DCT scaling, then the
+/// SIMD area-averaging resampler), both reductions then only walk that sample.
+class PlaceholderGenerator {
+ public:
+  /// Placeholder of a JPEG/PNG image (nullopt when it can't be decoded)
+  static std::optional<ArtworkPlaceholder> Generate(const uint8_t* data, size_t size);
+
+ private:
+  static constexpr int kSampleSize = 32;
+  static constexpr int kComponentsX = 4;
+  static constexpr int kComponentsY = 4;
+  static constexpr size_t kMaxColors = 4;
+
+  /// Most common colours of 3-bit-per-channel buckets, near duplicates merged
+  static std::vector<uint32_t> DominantColors(const ImageBuffer& image);
+
+  static std::string EncodeBlurhash(const ImageBuffer& image);
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // PLACEHOLDER_GENERATOR_H_
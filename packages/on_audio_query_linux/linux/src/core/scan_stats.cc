@@ -0,0 +1,261 @@
+#include "scan_stats.h"
+
+using json = nlohmann::json;
+
+namespace on_audio_query_linux {
+
+/// LatencyHistogram implementation
+LatencyHistogram::LatencyHistogram() {
+  Reset();
+}
+
+void LatencyHistogram::Record(int64_t micros) {
+  uint64_t value = micros > 0 ? static_cast<uint64_t>(micros) : 0;
+
+  //bucket index = number of significant bits (0us and 1us land in buckets 0/1)
+  size_t bucket = 0;
+  while (bucket < kBucketCount - 1 && (value >> bucket) != 0) {
+    bucket++;
+  }
+
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_us_.fetch_add(value, std::memory_order_relaxed);
+
+  uint64_t current_max = max_us_.load(std::memory_order_relaxed);
+  while (value > current_max &&
+         !max_us_.compare_exchange_weak(current_max, value, std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::Reset() {
+  for (auto& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  sum_us_.store(0, std::memory_order_relaxed);
+  max_us_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Percentile(double p) const {
+  uint64_t total = count_.load(std::memory_order_relaxed);
+  if (total == 0) {
+    return 0;
+  }
+
+  uint64_t target = static_cast<uint64_t>(p * total);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen > target) {
+      return i == kBucketCount - 1 ? max_us_.load(std::memory_order_relaxed)
+                                   : (uint64_t{1} << i);
+    }
+  }
+
+  return max_us_.load(std::memory_order_relaxed);
+}
+
+json LatencyHistogram::ToJson() const {
+  uint64_t count = count_.load(std::memory_order_relaxed);
+  uint64_t sum = sum_us_.load(std::memory_order_relaxed);
+
+  //only non-empty buckets, keyed by their upper bound
+  json buckets = json::array();
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    uint64_t bucket_count = buckets_[i].load(std::memory_order_relaxed);
+    if (bucket_count == 0) {
+      continue;
+    }
+    json bucket;
+    bucket["le_us"] = i == kBucketCount - 1 ? json(nullptr) : json(uint64_t{1} << i);
+    bucket["count"] = bucket_count;
+    buckets.push_back(bucket);
+  }
+
+  json result;
+  result["count"] = count;
+  result["sum_us"] = sum;
+  result["mean_us"] = count > 0 ? sum / count : 0;
+  result["max_us"] = max_us_.load(std::memory_order_relaxed);
+  result["p50_us"] = Percentile(0.50);
+  result["p90_us"] = Percentile(0.90);
+  result["p99_us"] = Percentile(0.99);
+  result["buckets"] = buckets;
+  return result;
+}
+
+/// ScanStats implementation
+ScanStats::ScanStats()
+    : started_at_(0),
+      finished_at_(0),
+      wall_us_(0),
+      in_progress_(false) {
+  for (auto& phase : phase_us_) {
+    phase.store(0);
+  }
+  for (auto& counter : counters_) {
+    counter.store(0);
+  }
+}
+
+void ScanStats::Begin(const std::string& scan_type, const std::string& directory) {
+  {
+    std::lock_guard<std::mutex> lock(info_mutex_);
+    scan_type_ = scan_type;
+    directory_ = directory;
+    started_at_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    finished_at_ = 0;
+    start_time_ = std::chrono::steady_clock::now();
+  }
+
+  for (auto& phase : phase_us_) {
+    phase.store(0, std::memory_order_relaxed);
+  }
+  for (auto& counter : counters_) {
+    counter.store(0, std::memory_order_relaxed);
+  }
+  extraction_latency_.Reset();
+  spawn_latency_.Reset();
+  wall_us_.store(0);
+  in_progress_.store(true);
+}
+
+void ScanStats::End() {
+  std::lock_guard<std::mutex> lock(info_mutex_);
+  finished_at_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  wall_us_.store(std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_time_).count());
+  in_progress_.store(false);
+}
+
+void ScanStats::AddPhaseTime(Phase phase, int64_t micros) {
+  phase_us_[static_cast<size_t>(phase)].fetch_add(micros, std::memory_order_relaxed);
+}
+
+void ScanStats::Increment(Counter counter, int64_t amount) {
+  counters_[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void ScanStats::RecordExtraction(int64_t micros) {
+  extraction_latency_.Record(micros);
+}
+
+void ScanStats::RecordSpawn(int64_t micros) {
+  spawn_latency_.Record(micros);
+}
+
+json ScanStats::ToJson() const {
+  json result;
+
+  {
+    std::lock_guard<std::mutex> lock(info_mutex_);
+    result["scan_type"] = scan_type_;
+    result["directory"] = directory_;
+    result["started_at"] = started_at_;
+    result["finished_at"] = finished_at_;
+
+    //report elapsed time so far while the scan is running
+    int64_t wall_us = in_progress_.load()
+        ? std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - start_time_).count()
+        : wall_us_.load();
+    result["wall_us"] = started_at_ > 0 ? wall_us : 0;
+  }
+
+  result["in_progress"] = in_progress_.load();
+
+  //extract phases are summed across worker threads (CPU-side time, not wall time)
+  json phases;
+  for (size_t i = 0; i < kPhaseCount; ++i) {
+    phases[PhaseName(static_cast<Phase>(i))] = phase_us_[i].load(std::memory_order_relaxed);
+  }
+  result["phases_us"] = phases;
+
+  json counters;
+  for (size_t i = 0; i < kCounterCount; ++i) {
+    counters[CounterName(static_cast<Counter>(i))] = counters_[i].load(std::memory_order_relaxed);
+  }
+  result["counters"] = counters;
+
+  //native tag reader I/O volume (read_ratio should stay well below 1%)
+  int64_t tag_files = counters_[static_cast<size_t>(Counter::TAG_FILES)].load(std::memory_order_relaxed);
+  int64_t tag_bytes = counters_[static_cast<size_t>(Counter::TAG_BYTES_READ)].load(std::memory_order_relaxed);
+  int64_t file_bytes = counters_[static_cast<size_t>(Counter::TAG_FILE_BYTES)].load(std::memory_order_relaxed);
+  json tag_io;
+  tag_io["files"] = tag_files;
+  tag_io["bytes_read"] = tag_bytes;
+  tag_io["file_bytes"] = file_bytes;
+  tag_io["bytes_per_file"] = tag_files > 0 ? tag_bytes / tag_files : 0;
+  tag_io["read_ratio"] = file_bytes > 0 ? static_cast<double>(tag_bytes) / file_bytes : 0.0;
+  result["tag_io"] = tag_io;
+
+  result["extraction_latency"] = extraction_latency_.ToJson();
+  result["spawn_latency"] = spawn_latency_.ToJson();
+
+  return result;
+}
+
+const char* ScanStats::PhaseName(Phase phase) {
+  switch (phase) {
+    case Phase::WALK: return "walk";
+    case Phase::DIFF: return "diff";
+    case Phase::EXTRACT: return "extract";
+    case Phase::EXTRACT_NATIVE: return "extract_native";
+    case Phase::EXTRACT_SPAWN: return "extract_spawn";
+    case Phase::EXTRACT_IO: return "extract_io";
+    case Phase::EXTRACT_PARSE: return "extract_parse";
+    case Phase::DB_WRITE: return "db_write";
+    case Phase::PLACEHOLDER: return "placeholder";
+    case Phase::AGGREGATE: return "aggregate";
+    case Phase::ARTWORK: return "artwork";
+    case Phase::COUNT: break;
+  }
+  return "unknown";
+}
+
+const char* ScanStats::CounterName(Counter counter) {
+  switch (counter) {
+    case Counter::FILES_WALKED: return "files_walked";
+    case Counter::FILES_NEW: return "files_new";
+    case Counter::FILES_UPDATED: return "files_updated";
+    case Counter::FILES_DELETED: return "files_deleted";
+    case Counter::FILES_FAILED: return "files_failed";
+    case Counter::FILES_ENRICHED: return "files_enriched";
+    case Counter::CACHE_HITS: return "cache_hits";
+    case Counter::FALLBACKS: return "fallbacks";
+    case Counter::NATIVE_READS: return "native_reads";
+    case Counter::DURATION_ESTIMATES: return "duration_estimates";
+    case Counter::TAG_FILES: return "tag_files";
+    case Counter::TAG_BYTES_READ: return "tag_bytes_read";
+    case Counter::TAG_FILE_BYTES: return "tag_file_bytes";
+    case Counter::PROCESS_SPAWNS: return "process_spawns";
+    case Counter::PROCESS_TIMEOUTS: return "process_timeouts";
+    case Counter::FILES_QUARANTINED: return "files_quarantined";
+    case Counter::QUARANTINE_SKIPPED: return "quarantine_skipped";
+    case Counter::ARTWORKS_INDEXED: return "artworks_indexed";
+    case Counter::ARTWORK_THUMBNAILS: return "artwork_thumbnails";
+    case Counter::ARTWORK_PLACEHOLDERS: return "artwork_placeholders";
+    case Counter::COUNT: break;
+  }
+  return "unknown";
+}
+
+/// ScopedTimer implementation
+ScanStats::ScopedTimer::ScopedTimer(ScanStats* stats, Phase phase)
+    : stats_(stats), phase_(phase), start_(std::chrono::steady_clock::now()) {}
+
+ScanStats::ScopedTimer::~ScopedTimer() {
+  if (stats_) {
+    stats_->AddPhaseTime(phase_, Elapsed());
+  }
+}
+
+int64_t ScanStats::ScopedTimer::Elapsed() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_).count();
+}
+
+}  // namespace on_audio_query_linux
@@ -0,0 +1,140 @@
+#ifndef SCAN_STATS_H_
+#define SCAN_STATS_H_
+
+#include <string>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <nlohmann/json.hpp>
+
+namespace on_audio_query_linux {
+
+/// Thread-safe latency histogram (power-of-two microsecond buckets)
+class LatencyHistogram {
+ public:
+  /// Bucket i holds samples < 2^i us, the last bucket is open ended (~8s+)
+  static constexpr size_t kBucketCount = 24;
+
+  LatencyHistogram();
+
+  void Record(int64_t micros);
+  void Reset();
+
+  nlohmann::json ToJson() const;
+
+ private:
+  std::array<std::atomic<uint64_t>, kBucketCount> buckets_;
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_us_;
+  std::atomic<uint64_t> max_us_;
+
+  /// Approximate percentile (upper bound of the bucket holding it)
+  uint64_t Percentile(double p) const;
+};
+
+/// Timings and counters for the phases of a single scan
+class ScanStats {
+ public:
+  enum class Phase {
+    WALK,
+    DIFF,
+    EXTRACT,
+    EXTRACT_NATIVE,
+    EXTRACT_SPAWN,
+    EXTRACT_IO,
+    EXTRACT_PARSE,
+    DB_WRITE,
+    PLACEHOLDER,
+    AGGREGATE,
+    ARTWORK,
+    COUNT
+  };
+
+  enum class Counter {
+    FILES_WALKED,
+    FILES_NEW,
+    FILES_UPDATED,
+    FILES_DELETED,
+    FILES_FAILED,
+    FILES_ENRICHED,
+    CACHE_HITS,
+    FALLBACKS,
+    NATIVE_READS,
+    DURATION_ESTIMATES,
+    TAG_FILES,
+    TAG_BYTES_READ,
+    TAG_FILE_BYTES,
+    PROCESS_SPAWNS,
+    PROCESS_TIMEOUTS,
+    FILES_QUARANTINED,
+    QUARANTINE_SKIPPED,
+    ARTWORKS_INDEXED,
+    ARTWORK_THUMBNAILS,
+    ARTWORK_PLACEHOLDERS,
+    COUNT
+  };
+
+  ScanStats();
+
+  /// Start a new scan (clears previous values)
+  void Begin(const std::string& scan_type, const std::string& directory);
+
+  /// Mark the scan as finished
+  void End();
+
+  /// Accumulate time (microseconds) spent in a phase
+  void AddPhaseTime(Phase phase, int64_t micros);
+
+  /// Increment a counter
+  void Increment(Counter counter, int64_t amount = 1);
+
+  /// Record the latency of a single file extraction
+  void RecordExtraction(int64_t micros);
+
+  /// Record the time spent starting an external process
+  void RecordSpawn(int64_t micros);
+
+  /// Snapshot as JSON (safe to call while a scan is running)
+  nlohmann::json ToJson() const;
+
+  /// Measures the lifetime of the timer and adds it to a phase
+  class ScopedTimer {
+   public:
+    ScopedTimer(ScanStats* stats, Phase phase);
+    ~ScopedTimer();
+
+    /// Elapsed microseconds so far
+    int64_t Elapsed() const;
+
+   private:
+    ScanStats* stats_;
+    Phase phase_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+ private:
+  static constexpr size_t kPhaseCount = static_cast<size_t>(Phase::COUNT);
+  static constexpr size_t kCounterCount = static_cast<size_t>(Counter::COUNT);
+
+  static const char* PhaseName(Phase phase);
+  static const char* CounterName(Counter counter);
+
+  mutable std::mutex info_mutex_;
+  std::string scan_type_;
+  std::string directory_;
+  int64_t started_at_;   //unix millis
+  int64_t finished_at_;  //unix millis, 0 while running
+  std::chrono::steady_clock::time_point start_time_;
+  std::atomic<int64_t> wall_us_;
+  std::atomic<bool> in_progress_;
+
+  std::array<std::atomic<int64_t>, kPhaseCount> phase_us_;
+  std::array<std::atomic<int64_t>, kCounterCount> counters_;
+  LatencyHistogram extraction_latency_;
+  LatencyHistogram spawn_latency_;
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // SCAN_STATS_H_
@@ -0,0 +1,249 @@
+#include "search_session.h"
+#include "../utils/string_utils.h"
+#include <algorithm>
+#include <iterator>
+
+namespace on_audio_query_linux {
+
+namespace {
+
+/// Stands for a letter outside ASCII and Latin, no query character equals it
+constexpr char kOtherLetter = '\x01';
+
+/// Base letter of U+00C0..U+017F once unicode61 dropped the diacritic
+/// ('.' => no ASCII base: Æ, Ø, ß, Ł, Œ...)
+constexpr char kLatinFold[] =
+    "aaaaaa.ceeeeiiii.nooooo..uuuuy.."  // U+00C0
+    "aaaaaa.ceeeeiiii.nooooo..uuuuy.y"  // U+00E0
+    "aaaaaaccccccccdd..eeeeeeeeeegggg"  // U+0100
+    "gggghh..iiiiiiiii...jjkk.llllll."  // U+0120
+    "...nnnnnn...oooooo..rrrrrrssssss"  // U+0140
+    "sstttt..uuuuuuuuuuuuwwyyyzzzzzz.";  // U+0160
+
+/// Code point at `i` of UTF-8 text, `i` moves past it (malformed bytes => U+FFFD)
+uint32_t NextCodePoint(const std::string& text, size_t& i) {
+  unsigned char lead = static_cast<unsigned char>(text[i++]);
+  if (lead < 0x80) {
+    return lead;
+  }
+
+  int length = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+  uint32_t code_point = lead & (0x3F >> length);
+  for (int k = 0; k < length; ++k) {
+    if (i >= text.size() || (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80) {
+      return 0xFFFD;
+    }
+    code_point = (code_point << 6) | (static_cast<unsigned char>(text[i++]) & 0x3F);
+  }
+  return length > 0 ? code_point : 0xFFFD;
+}
+
+/// Symbols, punctuation and spaces unicode61 splits words on (outside ASCII
+/// only Latin-1 and General Punctuation are told apart, the rest are letters)
+bool IsSeparator(uint32_t code_point) {
+  if (code_point >= 0x80 && code_point <= 0xBF) {
+    switch (code_point) {
+      case 0xAA: case 0xB2: case 0xB3: case 0xB5: case 0xB9: case 0xBA:
+      case 0xBC: case 0xBD: case 0xBE:
+        return false;  //ª ² ³ µ ¹ º ¼ ½ ¾
+      default:
+        return true;
+    }
+  }
+  return code_point == 0xD7 || code_point == 0xF7 ||
+         (code_point >= 0x2000 && code_point <= 0x206F);
+}
+
+/// Appends the tokens of `text` as songs_fts (unicode61, remove_diacritics 2)
+/// splits them and an ASCII query compares them: case folded, Latin letters
+/// without their diacritics, each token preceded by a space
+void AppendTokens(const std::string& text, std::string& out) {
+  bool in_token = false;
+  size_t i = 0;
+  while (i < text.size()) {
+    uint32_t code_point = NextCodePoint(text, i);
+    char folded;
+    if (code_point < 0x80) {
+      folded = static_cast<char>(code_point | 0x20);  //lower case of letters
+      if (code_point >= '0' && code_point <= '9') {
+        folded = static_cast<char>(code_point);
+      } else if (folded < 'a' || folded > 'z') {
+        in_token = false;
+        continue;
+      }
+    } else if (code_point >= 0x300 && code_point <= 0x36F) {
+      continue;  //combining diacritic, removed
+    } else if (IsSeparator(code_point)) {
+      in_token = false;
+      continue;
+    } else {
+      folded = code_point >= 0xC0 && code_point <= 0x17F ? kLatinFold[code_point - 0xC0] : '.';
+      if (folded == '.') {
+        folded = kOtherLetter;
+      }
+    }
+
+    if (!in_token) {
+      out += ' ';
+      in_token = true;
+    }
+    out += folded;
+  }
+}
+
+/// Matching of one term against songs already in memory, same rules as the
+/// queries QueryParams builds for an ASCII term
+class TermMatcher {
+ public:
+  explicit TermMatcher(const std::vector<std::string>& words)
+      : infix_(QueryParams::TrigramSearchable(words)) {
+    for (const auto& word : words) {
+      std::string phrase;
+      AppendTokens(word, phrase);
+      phrases_.push_back(std::move(phrase));
+      infixes_.push_back(StringUtils::ToLower(word));
+    }
+  }
+
+  /// 0 = every word is a word prefix, 1 = every word is an infix, -1 = no match
+  int Tier(const SongMetadata& song) {
+    const std::string* columns[] = {&song.title, &song.artist, &song.album, &song.genre,
+                                    &song.data};
+
+    //`"a-b c"*` is the phrase of consecutive tokens a, then b, then one
+    //starting with c => " a b c" in " token token...", columns end with a
+    //newline so a phrase never spans two
+    tokens_.clear();
+    for (const std::string* column : columns) {
+      AppendTokens(*column, tokens_);
+      tokens_ += '\n';
+    }
+    bool prefixes = std::all_of(phrases_.begin(), phrases_.end(), [&](const std::string& phrase) {
+      return tokens_.find(phrase) != std::string::npos;
+    });
+    if (prefixes) {
+      return 0;
+    }
+    if (!infix_) {
+      return -1;
+    }
+
+    text_.clear();
+    for (const std::string* column : columns) {
+      for (char c : *column) {
+        text_ += c >= 'A' && c <= 'Z' ? static_cast<char>(c | 0x20) : c;
+      }
+      text_ += '\n';
+    }
+    bool infixes = std::all_of(infixes_.begin(), infixes_.end(), [&](const std::string& infix) {
+      return text_.find(infix) != std::string::npos;
+    });
+    return infixes ? 1 : -1;
+  }
+
+ private:
+  bool infix_;
+  std::vector<std::string> phrases_;
+  std::vector<std::string> infixes_;
+
+  /// Buffers reused from song to song
+  std::string tokens_;
+  std::string text_;
+};
+
+/// Words the in-memory matcher handles exactly: ASCII with at least one token each
+bool Refinable(const std::vector<std::string>& words) {
+  return !words.empty() && std::all_of(words.begin(), words.end(), [](const std::string& word) {
+    bool ascii = std::all_of(word.begin(), word.end(),
+                             [](char c) { return static_cast<unsigned char>(c) < 0x80; });
+    std::string phrase;
+    AppendTokens(word, phrase);
+    return ascii && !phrase.empty();
+  });
+}
+
+}  // namespace
+
+SearchSession::SearchSession(DatabaseManager* db_manager) : db_manager_(db_manager) {}
+
+uint64_t SearchSession::Supersede() {
+  return ++generation_;
+}
+
+SearchSession::Results SearchSession::Search(const std::string& term, uint64_t generation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!IsCurrent(generation)) {
+    return nullptr;
+  }
+
+  //read before searching: a write landing meanwhile makes the next search query again
+  uint64_t revision = db_manager_->GetSongsRevision();
+
+  Results results;
+  if (CanRefine(term, revision)) {
+    results = Refine(term, generation);
+  } else {
+    QueryParams params;
+    params.search_filter = term;
+    auto songs = db_manager_->QuerySongs(params, [this, generation] {
+      return !IsCurrent(generation);
+    });
+    if (songs) {
+      results = std::make_shared<const std::vector<SongMetadata>>(std::move(*songs));
+    }
+  }
+  if (!results) {
+    return nullptr;
+  }
+
+  //kept even when superseded by now, the next term probably extends this one
+  previous_term_ = term;
+  previous_results_ = results;
+  previous_revision_ = revision;
+
+  return IsCurrent(generation) ? results : nullptr;
+}
+
+bool SearchSession::CanRefine(const std::string& term, uint64_t revision) const {
+  if (!previous_results_ || revision != previous_revision_ ||
+      term.compare(0, previous_term_.size(), previous_term_) != 0) {
+    return false;
+  }
+
+  //"be" => "bee" only ever narrows the matches, except when the new term is
+  //the first one the infix (trigram) search applies to
+  auto previous_words = QueryParams::SearchWords(previous_term_);
+  auto words = QueryParams::SearchWords(term);
+  if (!Refinable(previous_words) || !Refinable(words)) {
+    return false;
+  }
+  return QueryParams::TrigramSearchable(previous_words) || !QueryParams::TrigramSearchable(words);
+}
+
+SearchSession::Results SearchSession::Refine(const std::string& term, uint64_t generation) const {
+  TermMatcher matcher(QueryParams::SearchWords(term));
+
+  //songs keep their previous rank, those only matching as infixes now move
+  //behind the word prefix matches
+  std::vector<SongMetadata> prefix_matches;
+  std::vector<SongMetadata> infix_matches;
+  for (size_t i = 0; i < previous_results_->size(); ++i) {
+    if (i % kCancelCheckInterval == 0 && !IsCurrent(generation)) {
+      return nullptr;
+    }
+
+    const SongMetadata& song = (*previous_results_)[i];
+    int tier = matcher.Tier(song);
+    if (tier == 0) {
+      prefix_matches.push_back(song);
+    } else if (tier == 1) {
+      infix_matches.push_back(song);
+    }
+  }
+
+  prefix_matches.insert(prefix_matches.end(), std::make_move_iterator(infix_matches.begin()),
+                        std::make_move_iterator(infix_matches.end()));
+  return std::make_shared<const std::vector<SongMetadata>>(std::move(prefix_matches));
+}
+
+}  // namespace on_audio_query_linux
@@ -0,0 +1,56 @@
+#ifndef SEARCH_SESSION_H_
+#define SEARCH_SESSION_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "database_manager.h"
+
+namespace on_audio_query_linux {
+
+/// Search-as-you-type state of one search field.
+///
+/// Every keystroke calls Supersede() first (on the caller's thread), which
+/// stops the search still running for the previous one and makes it return
+/// nothing, so only the newest term is ever answered. A term extending the
+/// previous one ("bea" => "beat") can only match fewer songs: it is answered
+/// by filtering the previous results in memory instead of querying again.
+class SearchSession {
+ public:
+  using Results = std::shared_ptr<const std::vector<SongMetadata>>;
+
+  explicit SearchSession(DatabaseManager* db_manager);
+
+  /// Invalidates the running and queued searches, returns the generation
+  /// of the next one
+  uint64_t Supersede();
+  bool IsCurrent(uint64_t generation) const { return generation_.load() == generation; }
+
+  /// Songs matching `term`, ranked like QueryParams::search_filter
+  /// (nullptr when a newer search superseded this one)
+  Results Search(const std::string& term, uint64_t generation);
+
+ private:
+  /// Previous results checked every this many songs while refining
+  static constexpr size_t kCancelCheckInterval = 1024;
+
+  DatabaseManager* db_manager_;
+  std::atomic<uint64_t> generation_{0};
+
+  /// Last completed search (guarded by mutex_, one search at a time)
+  std::mutex mutex_;
+  std::string previous_term_;
+  Results previous_results_;
+  uint64_t previous_revision_ = 0;
+
+  bool CanRefine(const std::string& term, uint64_t revision) const;
+  /// previous_results_ still matching `term`, nullptr once superseded
+  Results Refine(const std::string& term, uint64_t generation) const;
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // SEARCH_SESSION_H_
@@ -0,0 +1,2078 @@
+#include "tag_reader.h"
+#include "../utils/string_utils.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <algorithm>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace on_audio_query_linux {
+
+namespace {
+
+/// Text frames/items larger than this are not tags we care about (artwork etc.)
+constexpr size_t kMaxTextSize = 64 * 1024;
+
+/// Vorbis comment keys we map are short, longer ones are skipped unread
+constexpr size_t kMaxVorbisKeySize = 32;
+
+/// Ogg pages walked while looking for the header packets
+constexpr int kMaxOggHeaderPages = 512;
+
+/// Tail windows searched for the last Ogg page (pages are at most ~64 KB)
+constexpr uint64_t kOggTailWindows[] = {8 * 1024, 68 * 1024};
+
+/// MPEG audio normally starts right after the ID3v2 tag, allow some junk
+constexpr uint64_t kMaxMpegSyncSearch = 16 * 1024;
+
+/// MP4 container nesting we follow (moov => udta => meta => ilst => item is 4 deep)
+constexpr int kMaxMp4Depth = 16;
+
+/// Picture headers (mime, description) are parsed from this much, the image is not read
+constexpr size_t kPicturePrefixSize = 512;
+
+/// Upper bound for picture headers with huge descriptions and for embedded images
+constexpr size_t kMaxPictureHeaderSize = 64 * 1024;
+constexpr uint64_t kMaxPictureSize = 64 * 1024 * 1024;
+
+/// ID3v1 genre list (same names as ffmpeg)
+const char* const kId3Genres[] = {
+  "Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge",
+  "Hip-Hop", "Jazz", "Metal", "New Age", "Oldies", "Other", "Pop", "R&B",
+  "Rap", "Reggae", "Rock", "Techno", "Industrial", "Alternative", "Ska",
+  "Death Metal", "Pranks", "Soundtrack", "Euro-Techno", "Ambient", "Trip-Hop",
+  "Vocal", "Jazz+Funk", "Fusion", "Trance", "Classical", "Instrumental",
+  "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise", "AlternRock",
+  "Bass", "Soul", "Punk", "Space", "Meditative", "Instrumental Pop",
+  "Instrumental Rock", "Ethnic", "Gothic", "Darkwave", "Techno-Industrial",
+  "Electronic", "Pop-Folk", "Eurodance", "Dream", "Southern Rock", "Comedy",
+  "Cult", "Gangsta", "Top 40", "Christian Rap", "Pop/Funk", "Jungle",
+  "Native American", "Cabaret", "New Wave", "Psychadelic", "Rave",
+  "Showtunes", "Trailer", "Lo-Fi", "Tribal", "Acid Punk", "Acid Jazz",
+  "Polka", "Retro", "Musical", "Rock & Roll", "Hard Rock", "Folk",
+  "Folk-Rock", "National Folk", "Swing", "Fast Fusion", "Bebob", "Latin",
+  "Revival", "Celtic", "Bluegrass", "Avantgarde", "Gothic Rock",
+  "Progressive Rock", "Psychedelic Rock", "Symphonic Rock", "Slow Rock",
+  "Big Band", "Chorus", "Easy Listening", "Acoustic", "Humour", "Speech",
+  "Chanson", "Opera", "Chamber Music", "Sonata", "Symphony", "Booty Bass",
+  "Primus", "Porn Groove", "Satire", "Slow Jam", "Club", "Tango", "Samba",
+  "Folklore", "Ballad", "Power Ballad", "Rhythmic Soul", "Freestyle", "Duet",
+  "Punk Rock", "Drum Solo", "A capella", "Euro-House", "Dance Hall", "Goa",
+  "Drum & Bass", "Club-House", "Hardcore", "Terror", "Indie", "BritPop",
+  "Negerpunk", "Polsk Punk", "Beat", "Christian Gangsta", "Heavy Metal",
+  "Black Metal", "Crossover", "Contemporary Christian", "Christian Rock",
+  "Merengue", "Salsa", "Thrash Metal", "Anime", "JPop", "SynthPop",
+  "Abstract", "Art Rock", "Baroque", "Bhangra", "Big Beat", "Breakbeat",
+  "Chillout", "Downtempo", "Dub", "EBM", "Eclectic", "Electro",
+  "Electroclash", "Emo", "Experimental", "Garage", "Global", "IDM",
+  "Illbient", "Industro-Goth", "Jam Band", "Krautrock", "Leftfield", "Lounge",
+  "Math Rock", "New Romantic", "Nu-Breakz", "Post-Punk", "Post-Rock",
+  "Psytrance", "Shoegaze", "Space Rock", "Trop Rock", "World Music",
+  "Neoclassical", "Audiobook", "Audio Theatre", "Neue Deutsche Welle",
+  "Podcast", "Indie Rock", "G-Funk", "Dubstep", "Garage Rock", "Psybient",
+};
+constexpr size_t kId3GenreCount = sizeof(kId3Genres) / sizeof(kId3Genres[0]);
+
+uint16_t ReadBE16(const uint8_t* p) {
+  return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t ReadBE24(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 16) | (p[1] << 8) | p[2];
+}
+
+uint32_t ReadBE32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+uint64_t ReadBE64(const uint8_t* p) {
+  return (static_cast<uint64_t>(ReadBE32(p)) << 32) | ReadBE32(p + 4);
+}
+
+uint16_t ReadLE16(const uint8_t* p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t ReadLE32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t ReadLE64(const uint8_t* p) {
+  return ReadLE32(p) | (static_cast<uint64_t>(ReadLE32(p + 4)) << 32);
+}
+
+uint32_t ReadSyncsafe(const uint8_t* p) {
+  return ((p[0] & 0x7F) << 21) | ((p[1] & 0x7F) << 14) | ((p[2] & 0x7F) << 7) | (p[3] & 0x7F);
+}
+
+/// Undo ID3 unsynchronisation (0xFF 0x00 => 0xFF)
+std::vector<uint8_t> RemoveUnsync(const uint8_t* data, size_t size) {
+  std::vector<uint8_t> result;
+  result.reserve(size);
+  for (size_t i = 0; i < size; ++i) {
+    result.push_back(data[i]);
+    if (data[i] == 0xFF && i + 1 < size && data[i + 1] == 0x00) {
+      i++;
+    }
+  }
+  return result;
+}
+
+/// Append a code point as UTF-8
+void AppendUtf8(std::string& out, uint32_t cp) {
+  if (cp < 0x80) {
+    out += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    out += static_cast<char>(0xC0 | (cp >> 6));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    out += static_cast<char>(0xE0 | (cp >> 12));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (cp >> 18));
+    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+}
+
+bool IsValidUtf8(const uint8_t* data, size_t size) {
+  for (size_t i = 0; i < size;) {
+    uint8_t c = data[i];
+    size_t extra = c < 0x80 ? 0
+                 : (c & 0xE0) == 0xC0 ? 1
+                 : (c & 0xF0) == 0xE0 ? 2
+                 : (c & 0xF8) == 0xF0 ? 3
+                 : 4;
+    if (extra > 3 || (extra > 0 && i + extra >= size)) {
+      return false;
+    }
+    for (size_t k = 1; k <= extra; ++k) {
+      if ((data[i + k] & 0xC0) != 0x80) {
+        return false;
+      }
+    }
+    i += extra + 1;
+  }
+  return true;
+}
+
+/// Decoded MPEG audio frame header
+struct MpegHeader {
+  int version;           //0 = MPEG 1, 1 = MPEG 2, 2 = MPEG 2.5
+  int layer;             //1..3
+  uint32_t bitrate_kbps;
+  uint32_t sample_rate;
+  uint32_t frame_size;   //bytes including the header
+  uint32_t samples;      //samples per frame
+  bool mono;
+};
+
+bool ParseMpegHeader(const uint8_t* h, MpegHeader& header) {
+  if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) {
+    return false;
+  }
+
+  static const uint16_t kBitrates[2][3][15] = {
+    {  //MPEG 1: layer I, II, III
+      {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+      {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+      {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+    },
+    {  //MPEG 2/2.5: layer I, II, III
+      {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+      {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+      {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+    },
+  };
+  static const uint32_t kSampleRates[3][3] = {
+    {44100, 48000, 32000}, {22050, 24000, 16000}, {11025, 12000, 8000},
+  };
+
+  int version_bits = (h[1] >> 3) & 0x03;
+  int layer_bits = (h[1] >> 1) & 0x03;
+  int bitrate_index = h[2] >> 4;
+  int rate_index = (h[2] >> 2) & 0x03;
+  int padding = (h[2] >> 1) & 0x01;
+
+  //reserved values, free format bitrate (size unknown)
+  if (version_bits == 1 || layer_bits == 0 || bitrate_index == 0 ||
+      bitrate_index == 15 || rate_index == 3) {
+    return false;
+  }
+
+  header.version = version_bits == 3 ? 0 : version_bits == 2 ? 1 : 2;
+  header.layer = 4 - layer_bits;
+  header.bitrate_kbps = kBitrates[header.version == 0 ? 0 : 1][header.layer - 1][bitrate_index];
+  header.sample_rate = kSampleRates[header.version][rate_index];
+  header.mono = (h[3] >> 6) == 3;
+
+  uint32_t bitrate = header.bitrate_kbps * 1000;
+  if (header.layer == 1) {
+    header.samples = 384;
+    header.frame_size = (12 * bitrate / header.sample_rate + padding) * 4;
+  } else if (header.layer == 2 || header.version == 0) {
+    header.samples = 1152;
+    header.frame_size = 144 * bitrate / header.sample_rate + padding;
+  } else {
+    header.samples = 576;
+    header.frame_size = 72 * bitrate / header.sample_rate + padding;
+  }
+
+  return header.frame_size > 4;
+}
+
+/// ffprobe codec name of an MPEG audio layer
+const char* MpegCodecName(int layer) {
+  return layer == 1 ? "mp1" : layer == 2 ? "mp2" : "mp3";
+}
+
+/// ffprobe codec name of a WAVE format tag ("" = not one we know)
+std::string WaveCodecName(uint16_t format_tag, uint16_t bits) {
+  switch (format_tag) {
+    case 0x0001: return bits == 8 ? "pcm_u8" : "pcm_s" + std::to_string(bits) + "le";
+    case 0x0003: return "pcm_f" + std::to_string(bits) + "le";
+    case 0x0002: return "adpcm_ms";
+    case 0x0006: return "pcm_alaw";
+    case 0x0007: return "pcm_mulaw";
+    case 0x0011: return "adpcm_ima_wav";
+    case 0x0050: return "mp2";
+    case 0x0055: return "mp3";
+    case 0x2000: return "ac3";
+  }
+  return "";
+}
+
+/// ffprobe codec name of an MP4 audio sample entry ("" = not one we know)
+std::string Mp4CodecName(const uint8_t* format) {
+  if (memcmp(format, "mp4a", 4) == 0) return "aac";  //refined by the esds object type
+  if (memcmp(format, "alac", 4) == 0) return "alac";
+  if (memcmp(format, "fLaC", 4) == 0) return "flac";
+  if (memcmp(format, "Opus", 4) == 0) return "opus";
+  if (memcmp(format, "ac-3", 4) == 0) return "ac3";
+  if (memcmp(format, "ec-3", 4) == 0) return "eac3";
+  return "";
+}
+
+/// Decode base64 (whitespace ignored, stops at padding)
+bool DecodeBase64(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+  out.clear();
+  out.reserve(size / 4 * 3);
+  uint32_t buffer = 0;
+  int bits = 0;
+  for (size_t i = 0; i < size; ++i) {
+    uint8_t c = data[i];
+    int value;
+    if (c >= 'A' && c <= 'Z') value = c - 'A';
+    else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+    else if (c >= '0' && c <= '9') value = c - '0' + 52;
+    else if (c == '+') value = 62;
+    else if (c == '/') value = 63;
+    else if (c == '=') break;
+    else if (c == ' ' || c == '\n' || c == '\r' || c == '\t') continue;
+    else return false;
+
+    buffer = (buffer << 6) | static_cast<uint32_t>(value);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out.push_back(static_cast<uint8_t>(buffer >> bits));
+    }
+  }
+  return true;
+}
+
+/// Average bitrate over the audio payload (containers without a nominal rate)
+void SetAverageBitrate(TagInfo& info, uint64_t audio_bytes) {
+  if (info.bitrate == 0 && info.duration_ms > 0 && audio_bytes > 0) {
+    info.bitrate = static_cast<int>(audio_bytes * 8000 / info.duration_ms);
+  }
+}
+
+/// Strip trailing NULs and spaces (fixed size fields)
+std::string TrimField(std::string value) {
+  while (!value.empty() && (value.back() == '\0' || value.back() == ' ')) {
+    value.pop_back();
+  }
+  return value;
+}
+
+}  // namespace
+
+/// TagInfo implementation
+std::string TagInfo::GetTag(const std::string& key, const std::string& default_val) const {
+  auto it = tags.find(key);
+  if (it != tags.end() && !it->second.empty()) {
+    return it->second;
+  }
+  return default_val;
+}
+
+void TagInfo::SetDuration(int64_t ms, DurationAccuracy accuracy) {
+  if (ms > 0 && accuracy > duration_accuracy) {
+    duration_ms = ms;
+    duration_accuracy = accuracy;
+  }
+}
+
+uint64_t PictureInfo::StoredSize() const {
+  uint64_t size = 0;
+  for (const auto& span : spans) size += span.length;
+  return size;
+}
+
+/// Source implementation
+TagReader::Source::Source(const std::string& file_path)
+    : fd_(-1), is_memory_(false), size_(0), window_offset_(0), bytes_read_(0) {
+  fd_ = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    return;
+  }
+
+  struct stat st;
+  if (fstat(fd_, &st) == 0) {
+    size_ = static_cast<uint64_t>(st.st_size);
+  }
+
+  //reads jump between the head and tail of the file => no kernel readahead
+  posix_fadvise(fd_, 0, 0, POSIX_FADV_RANDOM);
+}
+
+TagReader::Source::Source(std::vector<uint8_t> data)
+    : fd_(-1), memory_(std::move(data)), is_memory_(true), size_(memory_.size()),
+      window_offset_(0), bytes_read_(0) {}
+
+TagReader::Source::~Source() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool TagReader::Source::ReadAt(uint64_t offset, void* buffer, size_t length) {
+  if (offset > size_ || length > size_ - offset) {
+    return false;
+  }
+
+  if (is_memory_) {
+    memcpy(buffer, memory_.data() + offset, length);
+    return true;
+  }
+
+  //serve whatever the read-ahead window already holds, fetch the rest
+  uint8_t* out = static_cast<uint8_t*>(buffer);
+  uint64_t window_end = window_offset_ + window_.size();
+  if (offset >= window_offset_ && offset < window_end) {
+    size_t cached = static_cast<size_t>(std::min<uint64_t>(length, window_end - offset));
+    memcpy(out, window_.data() + (offset - window_offset_), cached);
+    out += cached;
+    offset += cached;
+    length -= cached;
+    if (length == 0) {
+      return true;
+    }
+  }
+
+  //large bodies go straight into the caller's buffer
+  if (length >= kWindowSize) {
+    return PRead(offset, out, length);
+  }
+
+  size_t window_size = static_cast<size_t>(std::min<uint64_t>(kWindowSize, size_ - offset));
+  window_.resize(window_size);
+  if (!PRead(offset, window_.data(), window_size)) {
+    window_.clear();
+    return false;
+  }
+  window_offset_ = offset;
+
+  memcpy(out, window_.data(), length);
+  return true;
+}
+
+bool TagReader::Source::ReadAtDirect(uint64_t offset, void* buffer, size_t length) {
+  if (offset > size_ || length > size_ - offset) {
+    return false;
+  }
+
+  if (is_memory_) {
+    memcpy(buffer, memory_.data() + offset, length);
+    return true;
+  }
+
+  return PRead(offset, buffer, length);
+}
+
+bool TagReader::Source::PRead(uint64_t offset, void* buffer, size_t length) {
+  uint8_t* out = static_cast<uint8_t*>(buffer);
+  size_t done = 0;
+  while (done < length) {
+    ssize_t n = pread(fd_, out + done, length - done, static_cast<off_t>(offset + done));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    done += static_cast<size_t>(n);
+    bytes_read_ += static_cast<uint64_t>(n);
+  }
+  return true;
+}
+
+bool TagReader::Source::ReadAt(uint64_t offset, size_t length, std::vector<uint8_t>& out) {
+  out.resize(length);
+  return length == 0 || ReadAt(offset, out.data(), length);
+}
+
+/// TagReader implementation
+TagReader::TagReader() {}
+
+TagReader::~TagReader() {}
+
+std::optional<TagInfo> TagReader::Read(const std::string& file_path, TagReadIo* io,
+                                       std::vector<uint8_t>* picture_bytes) {
+  Source source(file_path);
+  if (!source.IsOpen()) {
+    return std::nullopt;
+  }
+
+  auto info = ReadTags(source);
+
+  //picture read while the file is still open (scan-time artwork indexing)
+  if (picture_bytes && info.has_value() && info->picture.has_value()) {
+    auto bytes = ReadPicture(source, info->picture.value());
+    if (bytes.has_value()) {
+      *picture_bytes = std::move(bytes.value());
+    }
+  }
+
+  if (io) {
+    io->bytes_read = source.BytesRead();
+    io->file_size = source.Size();
+  }
+
+  return info;
+}
+
+std::optional<std::vector<uint8_t>> TagReader::ReadPicture(const std::string& file_path,
+                                                           const PictureInfo& picture,
+                                                           TagReadIo* io) {
+  Source source(file_path);
+  if (!source.IsOpen()) {
+    return std::nullopt;
+  }
+
+  auto bytes = ReadPicture(source, picture);
+
+  if (io) {
+    io->bytes_read = source.BytesRead();
+    io->file_size = source.Size();
+  }
+
+  return bytes;
+}
+
+std::optional<std::vector<uint8_t>> TagReader::ReadPicture(Source& source,
+                                                           const PictureInfo& picture) {
+  if (picture.spans.empty() || picture.StoredSize() > kMaxPictureSize) {
+    return std::nullopt;
+  }
+
+  //stored form (spans concatenated), read in one go per span
+  std::vector<uint8_t> stored(static_cast<size_t>(picture.StoredSize()));
+  size_t filled = 0;
+  for (const auto& span : picture.spans) {
+    if (span.offset > source.Size() || span.length > source.Size() - span.offset ||
+        !source.ReadAtDirect(span.offset, stored.data() + filled, static_cast<size_t>(span.length))) {
+      return std::nullopt;
+    }
+    filled += static_cast<size_t>(span.length);
+  }
+
+  switch (picture.encoding) {
+    case PictureInfo::Encoding::RAW:
+      return stored;
+
+    case PictureInfo::Encoding::ID3_FRAME: {
+      std::vector<uint8_t> clean = RemoveUnsync(stored.data(), stored.size());
+      if (picture.inner_offset >= clean.size()) {
+        return std::nullopt;
+      }
+      const uint8_t* frame = clean.data() + picture.inner_offset;
+      size_t frame_size = static_cast<size_t>(
+          std::min<uint64_t>(picture.inner_length, clean.size() - picture.inner_offset));
+      size_t data_offset = ParseApicHeader(frame, frame_size, picture.id3v22, nullptr, nullptr);
+      if (data_offset == 0) {
+        return std::nullopt;
+      }
+      return std::vector<uint8_t>(frame + data_offset, frame + frame_size);
+    }
+
+    case PictureInfo::Encoding::BASE64_BLOCK: {
+      std::vector<uint8_t> block;
+      uint32_t data_length = 0;
+      if (!DecodeBase64(stored.data(), stored.size(), block)) {
+        return std::nullopt;
+      }
+      size_t data_offset = ParseFlacPictureHeader(block.data(), block.size(), nullptr, nullptr,
+                                                  &data_length);
+      if (data_offset == 0 || data_length > block.size() - data_offset) {
+        return std::nullopt;
+      }
+      return std::vector<uint8_t>(block.begin() + data_offset,
+                                  block.begin() + data_offset + data_length);
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::optional<TagInfo> TagReader::ReadTags(Source& source) {
+  if (source.Size() < 12) {
+    return std::nullopt;
+  }
+
+  uint8_t header[12];
+  if (!source.ReadAt(0, header, sizeof(header))) {
+    return std::nullopt;
+  }
+
+  TagInfo info;
+
+  if (memcmp(header, "fLaC", 4) == 0) {
+    if (!ReadFlac(source, 0, info)) return std::nullopt;
+  } else if (memcmp(header, "OggS", 4) == 0) {
+    if (!ReadOgg(source, info)) return std::nullopt;
+  } else if (memcmp(header + 4, "ftyp", 4) == 0) {
+    if (!ReadMp4(source, info)) return std::nullopt;
+  } else if (memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "WAVE", 4) == 0) {
+    if (!ReadRiff(source, info)) return std::nullopt;
+  } else {
+    //ID3v2 in front (MPEG audio, sometimes FLAC), APEv2/ID3v1 at the end
+    uint64_t audio_start = 0;
+    TagInfo id3_info;
+    bool has_id3v2 = ReadId3v2(source, 0, id3_info, &audio_start);
+
+    uint8_t magic[4];
+    if (has_id3v2 && source.ReadAt(audio_start, magic, sizeof(magic)) &&
+        memcmp(magic, "fLaC", 4) == 0) {
+      //vorbis comments win over the (non standard) ID3 tag
+      if (!ReadFlac(source, audio_start, info)) return std::nullopt;
+      for (const auto& tag : id3_info.tags) {
+        SetTag(info, tag.first, tag.second);
+      }
+      if (id3_info.picture.has_value()) {
+        OfferPicture(info, std::move(id3_info.picture.value()));
+      }
+      return info;
+    }
+
+    info = std::move(id3_info);
+    bool has_mpeg = ReadMpeg(source, audio_start, info);  //first => reuses the head window
+    bool has_ape = ReadApe(source, info);
+    bool has_id3v1 = ReadId3v1(source, info);
+
+    if (!has_id3v2 && !has_ape && !has_id3v1 && !has_mpeg) {
+      return std::nullopt;
+    }
+  }
+
+  //whole file as payload when the format reader found no better figure
+  SetAverageBitrate(info, source.Size());
+  return info;
+}
+
+bool TagReader::ReadId3v2(Source& source, uint64_t offset, TagInfo& info, uint64_t* tag_end) {
+  uint8_t header[10];
+  if (!source.ReadAt(offset, header, sizeof(header)) || memcmp(header, "ID3", 3) != 0) {
+    return false;
+  }
+
+  int version = header[3];
+  if (version < 2 || version > 4) {
+    return false;
+  }
+
+  uint8_t flags = header[5];
+  uint64_t start = offset + 10;
+  uint64_t end = start + ReadSyncsafe(header + 6);
+
+  if (tag_end) {
+    *tag_end = end + ((flags & 0x10) ? 10 : 0);  //footer
+  }
+  end = std::min(end, source.Size());
+
+  //v2.2/v2.3 tag level unsynchronisation => parse a cleaned copy
+  if ((flags & 0x80) && version < 4) {
+    std::vector<uint8_t> raw;
+    if (!source.ReadAt(start, static_cast<size_t>(end - start), raw)) {
+      return true;
+    }
+
+    Source memory(RemoveUnsync(raw.data(), raw.size()));
+    uint64_t frames_start = 0;
+    uint8_t ext[4];
+    if (version == 3 && (flags & 0x40) && memory.ReadAt(0, ext, sizeof(ext))) {
+      frames_start = ReadBE32(ext) + 4;
+    }
+    FileSpan tag_region = {start, end - start};
+    ReadId3v2Frames(memory, frames_start, memory.Size(), version, false, info, &tag_region);
+    return true;
+  }
+
+  //skip extended header
+  if ((flags & 0x40) && version > 2) {
+    uint8_t ext[4];
+    if (!source.ReadAt(start, ext, sizeof(ext))) {
+      return true;
+    }
+    start += version == 4 ? ReadSyncsafe(ext) : ReadBE32(ext) + 4;
+  }
+
+  ReadId3v2Frames(source, start, end, version, version == 4 && (flags & 0x80), info);
+  return true;
+}
+
+void TagReader::ReadId3v2Frames(Source& source, uint64_t offset, uint64_t end,
+                                int version, bool frame_unsync, TagInfo& info,
+                                const FileSpan* unsync_region) {
+  const size_t header_size = version == 2 ? 6 : 10;
+  const size_t id_size = version == 2 ? 3 : 4;
+
+  uint64_t pos = offset;
+  while (pos + header_size <= end) {
+    uint8_t header[10];
+    if (!source.ReadAt(pos, header, header_size) || header[0] == 0) {
+      break;  //padding
+    }
+
+    std::string frame_id(reinterpret_cast<const char*>(header), id_size);
+    uint32_t frame_size = version == 2 ? ReadBE24(header + 3)
+                        : version == 3 ? ReadBE32(header + 4)
+                        : ReadSyncsafe(header + 4);
+
+    uint64_t body = pos + header_size;
+    if (frame_size == 0 || body + frame_size > end) {
+      break;
+    }
+    pos = body + frame_size;
+
+    //text frames we map and pictures (other binary frames are skipped)
+    bool is_picture = frame_id == "APIC" || frame_id == "PIC";
+    bool is_length = frame_id == "TLEN" || frame_id == "TLE";
+    std::string key = NormalizeId3Key(frame_id);
+    if (!is_picture && ((key.empty() && !is_length) || frame_size > kMaxTextSize)) {
+      continue;
+    }
+
+    uint8_t format_flags = version == 2 ? 0 : header[9];
+    if ((version == 3 && (format_flags & 0xC0)) || (version == 4 && (format_flags & 0x0C))) {
+      continue;  //compressed or encrypted
+    }
+
+    size_t skip = 0;
+    if (version == 3 && (format_flags & 0x20)) skip += 1;  //group id
+    if (version == 4 && (format_flags & 0x40)) skip += 1;  //group id
+    if (version == 4 && (format_flags & 0x01)) skip += 4;  //data length indicator
+    if (skip >= frame_size) {
+      continue;
+    }
+
+    //only the picture header is read, the image stays where it is
+    if (is_picture) {
+      bool unsync = version == 4 && (frame_unsync || (format_flags & 0x02));
+      ReadId3Picture(source, body + skip, frame_size - skip, version == 2, unsync,
+                     unsync_region, info);
+      continue;
+    }
+
+    std::vector<uint8_t> data;
+    if (!source.ReadAt(body, frame_size, data)) {
+      break;
+    }
+
+    if (version == 4 && (frame_unsync || (format_flags & 0x02))) {
+      data = RemoveUnsync(data.data() + skip, data.size() - skip);
+      skip = 0;
+    }
+
+    std::string value = DecodeId3Text(data.data() + skip, data.size() - skip);
+    if (is_length) {
+      //written by taggers, often stale => only a hint
+      info.SetDuration(std::atoll(value.c_str()), DurationAccuracy::UNRELIABLE);
+    } else if (key == "genre") {
+      SetTag(info, key, ResolveId3Genre(value));
+    } else {
+      SetTag(info, key, value);
+    }
+  }
+}
+
+void TagReader::ReadId3Picture(Source& source, uint64_t offset, uint64_t length, bool id3v22,
+                               bool unsync, const FileSpan* unsync_region, TagInfo& info) {
+  //header from a prefix, the whole frame only when the description is longer
+  std::vector<uint8_t> header;
+  PictureInfo picture;
+  picture.id3v22 = id3v22;
+  size_t data_offset = 0;
+  for (size_t window : {kPicturePrefixSize, kMaxPictureHeaderSize}) {
+    size_t header_size = static_cast<size_t>(std::min<uint64_t>(length, window));
+    if (!source.ReadAt(offset, header_size, header)) {
+      return;
+    }
+    if (unsync) {
+      header = RemoveUnsync(header.data(), header.size());
+    }
+    data_offset = ParseApicHeader(header.data(), header.size(), id3v22,
+                                  &picture.mime_type, &picture.picture_type);
+    if (data_offset > 0 || header_size == length) {
+      break;
+    }
+  }
+  if (data_offset == 0) {
+    return;
+  }
+
+  if (unsync_region) {
+    //frames come from a cleaned copy of the tag => offsets are only valid after unsync
+    picture.encoding = PictureInfo::Encoding::ID3_FRAME;
+    picture.spans.push_back(*unsync_region);
+    picture.inner_offset = offset;
+    picture.inner_length = length;
+  } else if (unsync) {
+    picture.encoding = PictureInfo::Encoding::ID3_FRAME;
+    picture.spans.push_back({offset, length});
+    picture.inner_length = length;
+  } else {
+    picture.spans.push_back({offset + data_offset, length - data_offset});
+  }
+
+  OfferPicture(info, std::move(picture));
+}
+
+bool TagReader::ReadId3v1(Source& source, TagInfo& info) {
+  if (source.Size() < 128) {
+    return false;
+  }
+
+  uint8_t tag[128];
+  if (!source.ReadAt(source.Size() - 128, tag, sizeof(tag)) || memcmp(tag, "TAG", 3) != 0) {
+    return false;
+  }
+
+  SetTag(info, "title", TrimField(Latin1ToUtf8(tag + 3, 30)));
+  SetTag(info, "artist", TrimField(Latin1ToUtf8(tag + 33, 30)));
+  SetTag(info, "album", TrimField(Latin1ToUtf8(tag + 63, 30)));
+  SetTag(info, "date", TrimField(Latin1ToUtf8(tag + 93, 4)));
+
+  //ID3v1.1 => track number in the last comment byte
+  if (tag[125] == 0 && tag[126] != 0) {
+    SetTag(info, "track", std::to_string(tag[126]));
+  }
+
+  if (tag[127] < kId3GenreCount) {
+    SetTag(info, "genre", kId3Genres[tag[127]]);
+  }
+
+  return true;
+}
+
+bool TagReader::ReadApe(Source& source, TagInfo& info) {
+  //footer is the last thing in the file, or right before ID3v1
+  uint64_t footer_pos = 0;
+  uint8_t footer[32];
+  bool found = false;
+
+  for (uint64_t trailer : {uint64_t{0}, uint64_t{128}}) {
+    if (source.Size() < 32 + trailer) {
+      continue;
+    }
+    footer_pos = source.Size() - trailer - 32;
+    if (source.ReadAt(footer_pos, footer, sizeof(footer)) &&
+        memcmp(footer, "APETAGEX", 8) == 0) {
+      found = true;
+      break;
+    }
+  }
+
+  if (!found) {
+    return false;
+  }
+
+  uint32_t tag_size = ReadLE32(footer + 12);  //items + footer
+  uint32_t item_count = ReadLE32(footer + 16);
+  if (tag_size < 32 || tag_size - 32 > footer_pos) {
+    return false;
+  }
+
+  uint64_t pos = footer_pos + 32 - tag_size;
+  for (uint32_t i = 0; i < item_count && pos + 8 < footer_pos; ++i) {
+    uint8_t item_header[8];
+    if (!source.ReadAt(pos, item_header, sizeof(item_header))) {
+      break;
+    }
+    uint32_t value_size = ReadLE32(item_header);
+    uint32_t item_flags = ReadLE32(item_header + 4);
+
+    //key is NUL terminated (ASCII, at most 255 chars)
+    uint8_t key_buffer[256];
+    size_t key_window = static_cast<size_t>(std::min<uint64_t>(sizeof(key_buffer), footer_pos - pos - 8));
+    if (!source.ReadAt(pos + 8, key_buffer, key_window)) {
+      break;
+    }
+    const uint8_t* key_end = static_cast<const uint8_t*>(memchr(key_buffer, 0, key_window));
+    if (!key_end) {
+      break;
+    }
+    std::string key(reinterpret_cast<const char*>(key_buffer), key_end - key_buffer);
+
+    uint64_t value_pos = pos + 8 + key.size() + 1;
+    pos = value_pos + value_size;
+    if (pos > footer_pos) {
+      break;
+    }
+
+    //text items only (binary items hold artwork)
+    std::string lower_key = StringUtils::ToLower(key);
+    std::string normalized = lower_key == "title" ? "title"
+                           : lower_key == "artist" ? "artist"
+                           : lower_key == "album" ? "album"
+                           : lower_key == "genre" ? "genre"
+                           : lower_key == "year" ? "date"
+                           : lower_key == "track" ? "track"
+                           : lower_key == "disc" ? "disc"
+                           : lower_key == "composer" ? "composer"
+                           : (lower_key == "album artist" || lower_key == "albumartist") ? "album_artist"
+                           : "";
+    if (normalized.empty() || ((item_flags >> 1) & 0x3) != 0 || value_size > kMaxTextSize) {
+      continue;
+    }
+
+    std::vector<uint8_t> value;
+    if (!source.ReadAt(value_pos, value_size, value)) {
+      break;
+    }
+
+    //multiple values are NUL separated
+    std::string joined;
+    for (const auto& part : StringUtils::Split(std::string(value.begin(), value.end()), '\0')) {
+      if (part.empty()) continue;
+      if (!joined.empty()) joined += "/";
+      joined += part;
+    }
+    SetTag(info, normalized, joined);
+  }
+
+  return true;
+}
+
+bool TagReader::ReadFlac(Source& source, uint64_t offset, TagInfo& info) {
+  uint8_t magic[4];
+  if (!source.ReadAt(offset, magic, sizeof(magic)) || memcmp(magic, "fLaC", 4) != 0) {
+    return false;
+  }
+
+  uint64_t pos = offset + 4;
+  for (int blocks = 0; blocks < 128 && pos + 4 <= source.Size(); ++blocks) {
+    uint8_t header[4];
+    if (!source.ReadAt(pos, header, sizeof(header))) {
+      break;
+    }
+
+    bool is_last = (header[0] & 0x80) != 0;
+    int type = header[0] & 0x7F;
+    uint32_t length = ReadBE24(header + 1);
+    uint64_t body = pos + 4;
+
+    if (type == 0 && length >= 34) {
+      //STREAMINFO: 20 bit sample rate, 36 bit total samples
+      uint8_t info_block[34];
+      if (source.ReadAt(body, info_block, sizeof(info_block))) {
+        uint32_t sample_rate = (info_block[10] << 12) | (info_block[11] << 4) | (info_block[12] >> 4);
+        uint64_t total_samples = (static_cast<uint64_t>(info_block[13] & 0x0F) << 32) |
+                                 ReadBE32(info_block + 14);
+        //3 bit channels - 1, 5 bit bits per sample - 1
+        info.codec = "flac";
+        info.sample_rate = static_cast<int>(sample_rate);
+        info.channels = ((info_block[12] >> 1) & 0x07) + 1;
+        info.bit_depth = (((info_block[12] & 0x01) << 4) | (info_block[13] >> 4)) + 1;
+        //total samples 0 = unknown (streamed encodes)
+        if (sample_rate > 0 && total_samples > 0) {
+          info.SetDuration(static_cast<int64_t>(total_samples * 1000 / sample_rate),
+                           DurationAccuracy::EXACT);
+        }
+      }
+    } else if (type == 4) {
+      auto block_reader = [&source, body](uint64_t offset, void* buffer, size_t size) {
+        return source.ReadAt(body + offset, buffer, size);
+      };
+      auto block_mapper = [body](uint64_t offset, uint64_t size) {
+        return std::vector<FileSpan>{{body + offset, size}};
+      };
+      ParseVorbisComment(block_reader, block_mapper, length, info);
+    } else if (type == 6) {
+      ReadFlacPicture(source, body, length, info);
+    }
+
+    pos = body + length;
+    if (is_last) {
+      break;
+    }
+  }
+
+  //frames follow the last metadata block
+  if (pos < source.Size()) {
+    SetAverageBitrate(info, source.Size() - pos);
+  }
+
+  return true;
+}
+
+bool TagReader::ReadFlacPicture(Source& source, uint64_t offset, uint64_t length, TagInfo& info) {
+  PictureInfo picture;
+  uint32_t data_length = 0;
+  size_t data_offset = 0;
+  std::vector<uint8_t> header;
+  for (size_t window : {kPicturePrefixSize, kMaxPictureHeaderSize}) {
+    size_t header_size = static_cast<size_t>(std::min<uint64_t>(length, window));
+    if (!source.ReadAt(offset, header_size, header)) {
+      return false;
+    }
+    data_offset = ParseFlacPictureHeader(header.data(), header.size(), &picture.mime_type,
+                                         &picture.picture_type, &data_length);
+    if (data_offset > 0 || header_size == length) {
+      break;
+    }
+  }
+  if (data_offset == 0 || data_length == 0 || data_length > length - data_offset) {
+    return false;
+  }
+
+  picture.spans.push_back({offset + data_offset, data_length});
+  OfferPicture(info, std::move(picture));
+  return true;
+}
+
+bool TagReader::ReadOgg(Source& source, TagInfo& info) {
+  //locate the identification and comment packets of the first stream by
+  //their page spans => only the bytes that get parsed are read
+  struct Span {
+    uint64_t offset;
+    uint64_t length;
+  };
+  std::vector<std::vector<Span>> packets;
+  std::vector<Span> packet;
+  uint32_t serial = 0;
+  bool have_serial = false;
+  uint64_t pos = 0;
+
+  for (int pages = 0; pages < kMaxOggHeaderPages && packets.size() < 2; ++pages) {
+    //page header + lacing table in one read, page data is skipped
+    uint8_t header[27 + 255];
+    size_t header_size = static_cast<size_t>(std::min<uint64_t>(sizeof(header), source.Size() - pos));
+    if (header_size < 27 || !source.ReadAtDirect(pos, header, header_size) ||
+        memcmp(header, "OggS", 4) != 0) {
+      break;
+    }
+
+    uint32_t page_serial = ReadLE32(header + 14);
+    uint8_t segment_count = header[26];
+    const uint8_t* lacing = header + 27;
+    if (27u + segment_count > header_size) {
+      break;
+    }
+
+    uint64_t data_pos = pos + 27 + segment_count;
+    uint64_t segment_pos = data_pos;
+
+    if (!have_serial) {
+      serial = page_serial;
+      have_serial = true;
+    }
+
+    for (int i = 0; i < segment_count; ++i) {
+      if (page_serial == serial && packets.size() < 2) {
+        if (!packet.empty() && packet.back().offset + packet.back().length == segment_pos) {
+          packet.back().length += lacing[i];
+        } else if (lacing[i] > 0) {
+          packet.push_back({segment_pos, lacing[i]});
+        }
+        if (lacing[i] < 255) {
+          packets.push_back(std::move(packet));
+          packet.clear();
+        }
+      }
+      segment_pos += lacing[i];
+    }
+
+    pos = segment_pos;
+  }
+
+  if (packets.size() < 2) {
+    return false;
+  }
+
+  auto packet_size = [](const std::vector<Span>& spans) {
+    uint64_t size = 0;
+    for (const auto& span : spans) size += span.length;
+    return size;
+  };
+
+  auto packet_reader = [&source](const std::vector<Span>& spans) {
+    return [&source, &spans](uint64_t offset, void* buffer, size_t length) {
+      uint8_t* out = static_cast<uint8_t*>(buffer);
+      uint64_t span_start = 0;
+      for (const auto& span : spans) {
+        if (length == 0) {
+          break;
+        }
+        if (offset < span_start + span.length) {
+          uint64_t in_span = offset - span_start;
+          size_t chunk = static_cast<size_t>(std::min<uint64_t>(length, span.length - in_span));
+          if (!source.ReadAt(span.offset + in_span, out, chunk)) {
+            return false;
+          }
+          out += chunk;
+          offset += chunk;
+          length -= chunk;
+        }
+        span_start += span.length;
+      }
+      return length == 0;
+    };
+  };
+
+  auto packet_mapper = [](const std::vector<Span>& spans, uint64_t skip) {
+    return [&spans, skip](uint64_t offset, uint64_t length) {
+      //packet range => the page segments holding it
+      std::vector<FileSpan> result;
+      offset += skip;
+      uint64_t span_start = 0;
+      for (const auto& span : spans) {
+        if (length == 0) {
+          break;
+        }
+        if (offset < span_start + span.length) {
+          uint64_t in_span = offset - span_start;
+          uint64_t chunk = std::min<uint64_t>(length, span.length - in_span);
+          result.push_back({span.offset + in_span, chunk});
+          offset += chunk;
+          length -= chunk;
+        }
+        span_start += span.length;
+      }
+      return result;
+    };
+  };
+
+  RegionReader read_id = packet_reader(packets[0]);
+  RegionReader read_comment = packet_reader(packets[1]);
+  uint64_t id_size = packet_size(packets[0]);
+  uint64_t comment_size = packet_size(packets[1]);
+
+  //vorbis id header is 30 bytes (nominal bitrate at 20), OpusHead 19
+  uint8_t id_packet[28] = {};
+  uint8_t comment_magic[8];
+  size_t id_read = static_cast<size_t>(std::min<uint64_t>(id_size, sizeof(id_packet)));
+  if (id_size < 19 || comment_size < sizeof(comment_magic) ||
+      !read_id(0, id_packet, id_read) ||
+      !read_comment(0, comment_magic, sizeof(comment_magic))) {
+    return false;
+  }
+
+  if (memcmp(id_packet, "\x01vorbis", 7) == 0) {
+    if (memcmp(comment_magic, "\x03vorbis", 7) != 0) {
+      return false;
+    }
+    auto read_tags = [&read_comment](uint64_t offset, void* buffer, size_t length) {
+      return read_comment(offset + 7, buffer, length);
+    };
+    ParseVorbisComment(read_tags, packet_mapper(packets[1], 7), comment_size - 7, info);
+
+    uint32_t sample_rate = ReadLE32(id_packet + 12);
+    int32_t nominal_bitrate = static_cast<int32_t>(ReadLE32(id_packet + 20));
+    info.codec = "vorbis";
+    info.channels = id_packet[11];
+    info.sample_rate = static_cast<int>(sample_rate);
+    if (nominal_bitrate > 0) {
+      info.bitrate = nominal_bitrate;
+    }
+
+    int64_t granule = ReadOggLastGranule(source, serial);
+    if (sample_rate > 0 && granule > 0) {
+      info.SetDuration(granule * 1000 / sample_rate, DurationAccuracy::EXACT);
+    }
+    return true;
+  }
+
+  if (memcmp(id_packet, "OpusHead", 8) == 0) {
+    if (memcmp(comment_magic, "OpusTags", 8) != 0) {
+      return false;
+    }
+    auto read_tags = [&read_comment](uint64_t offset, void* buffer, size_t length) {
+      return read_comment(offset + 8, buffer, length);
+    };
+    ParseVorbisComment(read_tags, packet_mapper(packets[1], 8), comment_size - 8, info);
+
+    //opus always decodes (and counts granule positions) at 48 kHz
+    info.codec = "opus";
+    info.channels = id_packet[9];
+    info.sample_rate = 48000;
+
+    uint16_t pre_skip = ReadLE16(id_packet + 10);
+    int64_t granule = ReadOggLastGranule(source, serial);
+    if (granule > pre_skip) {
+      info.SetDuration((granule - pre_skip) * 1000 / 48000, DurationAccuracy::EXACT);
+    }
+    return true;
+  }
+
+  //other codecs (speex, ogg flac, ...) are left to ffprobe
+  return false;
+}
+
+int64_t TagReader::ReadOggLastGranule(Source& source, uint32_t serial) {
+  //small window first, the last page is usually only a few KB
+  for (uint64_t tail_window : kOggTailWindows) {
+    uint64_t window = std::min(source.Size(), tail_window);
+    std::vector<uint8_t> tail;
+    if (!source.ReadAt(source.Size() - window, static_cast<size_t>(window), tail)) {
+      return 0;
+    }
+
+    //walk backwards to the last page of our stream with a valid granule
+    for (size_t i = tail.size() >= 27 ? tail.size() - 27 : 0; i + 27 <= tail.size(); --i) {
+      if (memcmp(tail.data() + i, "OggS", 4) == 0 && ReadLE32(tail.data() + i + 14) == serial) {
+        int64_t granule = static_cast<int64_t>(ReadLE64(tail.data() + i + 6));
+        if (granule > 0) {
+          return granule;
+        }
+      }
+      if (i == 0) {
+        break;
+      }
+    }
+
+    if (window == source.Size()) {
+      break;
+    }
+  }
+
+  return 0;
+}
+
+void TagReader::ParseVorbisComment(const RegionReader& read, const RegionMapper& map,
+                                   uint64_t size, TagInfo& info) {
+  uint8_t word[4];
+  if (size < 8 || !read(0, word, sizeof(word))) {
+    return;
+  }
+
+  uint64_t pos = 4 + static_cast<uint64_t>(ReadLE32(word));  //vendor string
+  if (pos + 4 > size || !read(pos, word, sizeof(word))) {
+    return;
+  }
+  uint32_t count = ReadLE32(word);
+  pos += 4;
+
+  //repeated keys (e.g. several ARTIST entries) are joined
+  std::map<std::string, std::string> values;
+  for (uint32_t i = 0; i < count && pos + 4 <= size; ++i) {
+    if (!read(pos, word, sizeof(word))) {
+      break;
+    }
+    uint64_t length = ReadLE32(word);
+    pos += 4;
+    if (length > size - pos) {
+      break;
+    }
+    uint64_t entry_pos = pos;
+    pos += length;
+
+    //key first => values we don't map (e.g. METADATA_BLOCK_PICTURE) stay unread
+    char key_buffer[kMaxVorbisKeySize];
+    size_t key_window = static_cast<size_t>(std::min<uint64_t>(length, sizeof(key_buffer)));
+    if (!read(entry_pos, key_buffer, key_window)) {
+      break;
+    }
+    const char* separator = static_cast<const char*>(memchr(key_buffer, '=', key_window));
+    if (!separator) {
+      continue;
+    }
+
+    size_t key_length = separator - key_buffer;
+    uint64_t value_offset = key_length + 1;
+    uint64_t value_size = length - value_offset;
+
+    //base64 FLAC picture block: header from the first characters, the rest stays unread
+    if (key_length == 22 && strncasecmp(key_buffer, "METADATA_BLOCK_PICTURE", 22) == 0) {
+      uint8_t encoded[kPicturePrefixSize];
+      size_t encoded_size = static_cast<size_t>(std::min<uint64_t>(value_size, sizeof(encoded))) & ~size_t{3};
+      std::vector<uint8_t> header;
+      PictureInfo picture;
+      uint32_t data_length = 0;
+      if (encoded_size >= 8 && read(entry_pos + value_offset, encoded, encoded_size) &&
+          DecodeBase64(encoded, encoded_size, header) && header.size() >= 4) {
+        picture.picture_type = static_cast<int>(ReadBE32(header.data()));
+        ParseFlacPictureHeader(header.data(), header.size(), &picture.mime_type,
+                               &picture.picture_type, &data_length);
+        picture.encoding = PictureInfo::Encoding::BASE64_BLOCK;
+        picture.spans = map(entry_pos + value_offset, value_size);
+        OfferPicture(info, std::move(picture));
+      }
+      continue;
+    }
+
+    std::string key = NormalizeVorbisKey(std::string(key_buffer, key_length));
+    if (key.empty() || value_size == 0 || value_size > kMaxTextSize) {
+      continue;
+    }
+
+    std::string value(static_cast<size_t>(value_size), '\0');
+    if (!read(entry_pos + value_offset, &value[0], value.size())) {
+      break;
+    }
+
+    std::string& joined = values[key];
+    if (!joined.empty()) joined += "/";
+    joined += value;
+  }
+
+  for (const auto& value : values) {
+    SetTag(info, value.first, value.second);
+  }
+}
+
+bool TagReader::ReadMp4(Source& source, TagInfo& info) {
+  uint64_t pos = 0;
+  while (pos + 8 <= source.Size()) {
+    uint8_t header[16];
+    if (!source.ReadAt(pos, header, 8)) {
+      break;
+    }
+
+    uint64_t size = ReadBE32(header);
+    uint64_t header_size = 8;
+    if (size == 1) {
+      if (!source.ReadAt(pos + 8, header + 8, 8)) break;
+      size = ReadBE64(header + 8);
+      header_size = 16;
+    } else if (size == 0) {
+      size = source.Size() - pos;
+    }
+    //compare against the remaining bytes: pos + size can wrap for 64 bit sizes
+    if (size < header_size || size > source.Size() - pos) {
+      break;
+    }
+
+    if (memcmp(header + 4, "moov", 4) == 0) {
+      ReadMp4Atoms(source, pos + header_size, pos + size, "moov", 0, info);
+      return true;
+    }
+
+    pos += size;
+  }
+
+  return false;
+}
+
+void TagReader::ReadMp4Atoms(Source& source, uint64_t offset, uint64_t end,
+                             const std::string& parent, int depth, TagInfo& info) {
+  //callers pass a child range inside their own atom, anything else is corrupt
+  if (depth > kMaxMp4Depth || offset > end || end > source.Size()) {
+    return;
+  }
+  uint64_t pos = offset;
+  while (pos + 8 <= end) {
+    uint8_t header[16];
+    if (!source.ReadAt(pos, header, 8)) {
+      break;
+    }
+
+    uint64_t size = ReadBE32(header);
+    uint64_t header_size = 8;
+    if (size == 1) {
+      if (!source.ReadAt(pos + 8, header + 8, 8)) break;
+      size = ReadBE64(header + 8);
+      header_size = 16;
+    } else if (size == 0) {
+      size = end - pos;
+    }
+    if (size < header_size || size > end - pos) {
+      break;
+    }
+
+    std::string type(reinterpret_cast<const char*>(header + 4), 4);
+    uint64_t body = pos + header_size;
+    uint64_t body_size = size - header_size;
+    pos += size;
+
+    if (type == "mvhd") {
+      //version 0: 32 bit times, version 1: 64 bit times
+      uint8_t mvhd[32];
+      size_t needed = 20;
+      if (body_size >= 1 && source.ReadAt(body, mvhd, 1) && mvhd[0] == 1) needed = 32;
+      if (body_size >= needed && source.ReadAt(body, mvhd, needed)) {
+        uint32_t timescale = mvhd[0] == 1 ? ReadBE32(mvhd + 20) : ReadBE32(mvhd + 12);
+        uint64_t duration = mvhd[0] == 1 ? ReadBE64(mvhd + 24) : ReadBE32(mvhd + 16);
+        //movie timescale is often coarse and may cover other tracks => refined by mdhd
+        if (timescale > 0) {
+          info.SetDuration(static_cast<int64_t>(duration * 1000 / timescale),
+                           DurationAccuracy::ESTIMATED);
+        }
+      }
+    } else if (type == "udta" || type == "ilst" || type == "trak") {
+      ReadMp4Atoms(source, body, body + body_size, type, depth + 1, info);
+    } else if (type == "mdia") {
+      ReadMp4Media(source, body, body + body_size, info);
+    } else if (type == "meta") {
+      //ISO meta is a full box (4 bytes version/flags), QuickTime meta is not
+      uint8_t probe[8];
+      uint64_t children = body;
+      if (body_size >= 8 && source.ReadAt(body, probe, sizeof(probe)) &&
+          memcmp(probe + 4, "hdlr", 4) != 0) {
+        children += 4;
+      }
+      ReadMp4Atoms(source, children, body + body_size, type, depth + 1, info);
+    } else if (parent == "ilst" && type == "covr") {
+      //first "data" child: 8 byte header, 4 byte type (13 JPEG, 14 PNG, 27 BMP), 4 byte locale
+      uint8_t data_header[16];
+      if (body_size < sizeof(data_header) || !source.ReadAt(body, data_header, sizeof(data_header)) ||
+          memcmp(data_header + 4, "data", 4) != 0) {
+        continue;
+      }
+      uint32_t data_size = ReadBE32(data_header);
+      if (data_size <= sizeof(data_header) || data_size > body_size) {
+        continue;
+      }
+
+      PictureInfo picture;
+      uint32_t data_type = ReadBE32(data_header + 8) & 0x00FFFFFF;
+      picture.mime_type = data_type == 13 ? "image/jpeg" : data_type == 14 ? "image/png"
+                        : data_type == 27 ? "image/bmp" : "";
+      picture.spans.push_back({body + sizeof(data_header), data_size - sizeof(data_header)});
+      OfferPicture(info, std::move(picture));
+    } else if (parent == "ilst") {
+      std::string key = NormalizeMp4Key(type);
+      if (key.empty() || body_size > kMaxTextSize) {
+        continue;
+      }
+
+      std::vector<uint8_t> item;
+      if (!source.ReadAt(body, static_cast<size_t>(body_size), item)) {
+        continue;
+      }
+
+      //first "data" child: 8 byte header, 4 byte type, 4 byte locale
+      size_t item_pos = 0;
+      while (item_pos + 16 <= item.size()) {
+        uint32_t data_size = ReadBE32(item.data() + item_pos);
+        if (data_size < 16 || item_pos + data_size > item.size()) {
+          break;
+        }
+        if (memcmp(item.data() + item_pos + 4, "data", 4) != 0) {
+          item_pos += data_size;
+          continue;
+        }
+
+        const uint8_t* payload = item.data() + item_pos + 16;
+        size_t payload_size = data_size - 16;
+
+        if (type == "trkn" || type == "disk") {
+          if (payload_size >= 6) {
+            uint16_t number = ReadBE16(payload + 2);
+            uint16_t total = ReadBE16(payload + 4);
+            if (number > 0) {
+              SetTag(info, key, total > 0 ? std::to_string(number) + "/" + std::to_string(total)
+                                          : std::to_string(number));
+            }
+          }
+        } else if (type == "gnre") {
+          //ID3v1 genre index + 1
+          if (payload_size >= 2) {
+            uint16_t genre = ReadBE16(payload);
+            if (genre > 0 && genre <= kId3GenreCount) {
+              SetTag(info, key, kId3Genres[genre - 1]);
+            }
+          }
+        } else {
+          SetTag(info, key, std::string(reinterpret_cast<const char*>(payload), payload_size));
+        }
+        break;
+      }
+    }
+  }
+}
+
+bool TagReader::ReadRiff(Source& source, TagInfo& info) {
+  uint16_t format_tag = 0;
+  uint16_t sub_format = 0;
+  uint16_t bits_per_sample = 0;
+  uint32_t byte_rate = 0;
+  uint64_t data_size = 0;
+  bool data_size_known = false;
+
+  uint64_t pos = 12;
+  while (pos + 8 <= source.Size()) {
+    uint8_t header[8];
+    if (!source.ReadAt(pos, header, sizeof(header))) {
+      break;
+    }
+
+    std::string chunk_id(reinterpret_cast<const char*>(header), 4);
+    uint64_t chunk_size = ReadLE32(header + 4);
+    uint64_t body = pos + 8;
+
+    if (chunk_id == "fmt ") {
+      //WAVE_FORMAT_EXTENSIBLE keeps the real format in the first bytes of the sub format GUID
+      uint8_t fmt[26];
+      size_t fmt_size = static_cast<size_t>(std::min<uint64_t>(chunk_size, sizeof(fmt)));
+      if (fmt_size >= 16 && source.ReadAt(body, fmt, fmt_size)) {
+        format_tag = ReadLE16(fmt);
+        info.channels = ReadLE16(fmt + 2);
+        info.sample_rate = static_cast<int>(ReadLE32(fmt + 4));
+        byte_rate = ReadLE32(fmt + 8);
+        bits_per_sample = ReadLE16(fmt + 14);
+        sub_format = format_tag == 0xFFFE && fmt_size >= 26 ? ReadLE16(fmt + 24) : format_tag;
+      }
+    } else if (chunk_id == "data") {
+      //streamed wav files may leave the size unset
+      data_size_known = chunk_size <= source.Size() - body;
+      data_size = std::min<uint64_t>(chunk_size, source.Size() - body);
+    } else if (chunk_id == "LIST") {
+      uint8_t list_type[4];
+      if (chunk_size >= 4 && source.ReadAt(body, list_type, sizeof(list_type)) &&
+          memcmp(list_type, "INFO", 4) == 0) {
+        uint64_t sub_pos = body + 4;
+        uint64_t list_end = std::min(body + chunk_size, source.Size());
+        while (sub_pos + 8 <= list_end) {
+          uint8_t sub_header[8];
+          if (!source.ReadAt(sub_pos, sub_header, sizeof(sub_header))) {
+            break;
+          }
+          std::string sub_id(reinterpret_cast<const char*>(sub_header), 4);
+          uint32_t sub_size = ReadLE32(sub_header + 4);
+          std::string key = NormalizeRiffKey(sub_id);
+
+          std::vector<uint8_t> value;
+          if (!key.empty() && sub_size <= kMaxTextSize &&
+              source.ReadAt(sub_pos + 8, sub_size, value)) {
+            //INFO strings have no declared charset: UTF-8 when valid, Latin-1 otherwise
+            std::string text = IsValidUtf8(value.data(), value.size())
+                ? std::string(value.begin(), value.end())
+                : Latin1ToUtf8(value.data(), value.size());
+            SetTag(info, key, TrimField(text));
+          }
+
+          sub_pos += 8 + sub_size + (sub_size & 1);
+        }
+      }
+    } else if (chunk_id == "id3 " || chunk_id == "ID3 ") {
+      ReadId3v2(source, body, info, nullptr);
+    }
+
+    //chunks are word aligned
+    pos = body + chunk_size + (chunk_size & 1);
+  }
+
+  info.codec = WaveCodecName(sub_format, bits_per_sample);
+  if (sub_format == 0x0001 || sub_format == 0x0003) {
+    info.bit_depth = bits_per_sample;
+  }
+  info.bitrate = static_cast<int>(std::min<uint64_t>(uint64_t{byte_rate} * 8, INT32_MAX));
+
+  //PCM/float/extensible have a constant byte rate, compressed formats store an average
+  if (byte_rate > 0 && data_size > 0) {
+    bool constant_rate = format_tag == 0x0001 || format_tag == 0x0003 || format_tag == 0xFFFE;
+    info.SetDuration(static_cast<int64_t>(data_size * 1000 / byte_rate),
+                     constant_rate && data_size_known ? DurationAccuracy::EXACT
+                                                      : DurationAccuracy::ESTIMATED);
+  }
+
+  return true;
+}
+
+void TagReader::ReadMp4Media(Source& source, uint64_t offset, uint64_t end, TagInfo& info) {
+  uint32_t timescale = 0;
+  uint64_t duration = 0;
+  bool is_sound = false;
+
+  uint64_t pos = offset;
+  while (pos + 8 <= end) {
+    uint8_t header[8];
+    if (!source.ReadAt(pos, header, sizeof(header))) {
+      break;
+    }
+    uint64_t size = ReadBE32(header);
+    if (size < 8 || size > end - pos) {
+      break;
+    }
+
+    uint64_t body = pos + 8;
+    if (memcmp(header + 4, "mdhd", 4) == 0) {
+      //same layout as mvhd: version 0 => 32 bit times, version 1 => 64 bit
+      uint8_t mdhd[32];
+      size_t needed = 20;
+      if (size >= 9 && source.ReadAt(body, mdhd, 1) && mdhd[0] == 1) needed = 32;
+      if (size - 8 >= needed && source.ReadAt(body, mdhd, needed)) {
+        timescale = mdhd[0] == 1 ? ReadBE32(mdhd + 20) : ReadBE32(mdhd + 12);
+        duration = mdhd[0] == 1 ? ReadBE64(mdhd + 24) : ReadBE32(mdhd + 16);
+        //all ones = unknown
+        if ((mdhd[0] == 1 && duration == UINT64_MAX) || (mdhd[0] == 0 && duration == UINT32_MAX)) {
+          duration = 0;
+        }
+      }
+    } else if (memcmp(header + 4, "hdlr", 4) == 0) {
+      uint8_t hdlr[12];
+      if (size - 8 >= sizeof(hdlr) && source.ReadAt(body, hdlr, sizeof(hdlr))) {
+        is_sound = memcmp(hdlr + 8, "soun", 4) == 0;
+      }
+    } else if (memcmp(header + 4, "minf", 4) == 0 && is_sound && info.codec.empty()) {
+      //hdlr precedes minf => only the first sound track is described
+      ReadMp4SampleTable(source, body, pos + size, info);
+    }
+
+    pos += size;
+  }
+
+  //media timescale is usually the sample rate => sample accurate
+  if (is_sound && timescale > 0 && duration > 0) {
+    info.SetDuration(static_cast<int64_t>(duration * 1000 / timescale), DurationAccuracy::EXACT);
+  }
+}
+
+void TagReader::ReadMp4SampleTable(Source& source, uint64_t offset, uint64_t end, TagInfo& info) {
+  //minf => stbl => stsd (full box + entry count, then the first sample entry)
+  uint64_t pos = offset;
+  while (pos + 8 <= end) {
+    uint8_t header[8];
+    if (!source.ReadAt(pos, header, sizeof(header))) {
+      break;
+    }
+    uint64_t size = ReadBE32(header);
+    if (size < 8 || size > end - pos) {
+      break;
+    }
+
+    if (memcmp(header + 4, "stbl", 4) == 0) {
+      //descend in place: a chain of nested stbl atoms must not grow the stack
+      end = pos + size;
+      pos += 8;
+      continue;
+    }
+    if (memcmp(header + 4, "stsd", 4) == 0) {
+      if (size >= 16) {
+        ReadMp4SampleEntry(source, pos + 16, pos + size, info);
+      }
+      return;
+    }
+
+    pos += size;
+  }
+}
+
+void TagReader::ReadMp4SampleEntry(Source& source, uint64_t offset, uint64_t end, TagInfo& info) {
+  //sample entry (8 header + 8) + audio fields: version, revision, vendor,
+  //channels, sample size, compression id, packet size, 16.16 sample rate
+  uint8_t entry[36];
+  if (offset + sizeof(entry) > end || !source.ReadAt(offset, entry, sizeof(entry))) {
+    return;
+  }
+  uint64_t entry_end = std::min<uint64_t>(offset + ReadBE32(entry), end);
+  uint16_t version = ReadBE16(entry + 16);
+  uint16_t sample_size = ReadBE16(entry + 26);
+
+  info.codec = Mp4CodecName(entry + 4);
+  if (version < 2) {
+    //version 2 moves the real values into extension fields
+    info.channels = ReadBE16(entry + 24);
+    info.sample_rate = static_cast<int>(ReadBE32(entry + 32) >> 16);
+  }
+  if (info.codec == "alac" || info.codec == "flac") {
+    info.bit_depth = sample_size;
+  }
+
+  //QuickTime sound description v1 adds 16 bytes, v2 adds 36
+  uint64_t pos = offset + sizeof(entry) + (version == 1 ? 16 : version == 2 ? 36 : 0);
+  while (pos + 8 <= entry_end) {
+    uint8_t header[8];
+    if (!source.ReadAt(pos, header, sizeof(header))) {
+      break;
+    }
+    uint64_t size = ReadBE32(header);
+    if (size < 8 || size > entry_end - pos) {
+      break;
+    }
+    uint64_t body = pos + 8;
+    size_t body_size = static_cast<size_t>(std::min<uint64_t>(size - 8, 64));
+
+    if (memcmp(header + 4, "esds", 4) == 0) {
+      uint8_t esds[64];
+      if (!source.ReadAt(body, esds, body_size)) {
+        break;
+      }
+
+      //full box, ES_Descriptor (0x03) => DecoderConfigDescriptor (0x04)
+      size_t p = 4;
+      auto read_descriptor = [&esds, &p, body_size](uint8_t expected) {
+        if (p >= body_size || esds[p++] != expected) return false;
+        //size: up to 4 bytes, 7 bits each
+        for (int i = 0; i < 4 && p < body_size; ++i) {
+          if ((esds[p++] & 0x80) == 0) break;
+        }
+        return true;
+      };
+
+      if (read_descriptor(0x03) && p + 3 <= body_size) {
+        uint8_t es_flags = esds[p + 2];
+        p += 3;
+        if (es_flags & 0x80) p += 2;                                       //depends on ES_ID
+        if ((es_flags & 0x40) && p < body_size) p += 1 + esds[p];          //URL
+        if (es_flags & 0x20) p += 2;                                       //OCR ES_ID
+        //object type, stream type, 24 bit buffer size, max bitrate, avg bitrate
+        if (read_descriptor(0x04) && p + 13 <= body_size) {
+          uint8_t object_type = esds[p];
+          if (object_type == 0x69 || object_type == 0x6B) info.codec = "mp3";
+          uint32_t avg_bitrate = ReadBE32(esds + p + 9);
+          if (avg_bitrate > 0 && avg_bitrate <= INT32_MAX) {
+            info.bitrate = static_cast<int>(avg_bitrate);
+          }
+        }
+      }
+    } else if (memcmp(header + 4, "alac", 4) == 0 && body_size >= 28) {
+      //ALAC magic cookie: full box, frame length, version, bit depth, ..., channels,
+      //max run, max frame bytes, avg bitrate, sample rate
+      uint8_t cookie[28];
+      if (source.ReadAt(body, cookie, sizeof(cookie))) {
+        info.bit_depth = cookie[9];
+        info.channels = cookie[13];
+        uint32_t avg_bitrate = ReadBE32(cookie + 20);
+        if (avg_bitrate > 0 && avg_bitrate <= INT32_MAX) {
+          info.bitrate = static_cast<int>(avg_bitrate);
+        }
+        info.sample_rate = static_cast<int>(ReadBE32(cookie + 24));
+      }
+    }
+
+    pos += size;
+  }
+}
+
+bool TagReader::ReadMpeg(Source& source, uint64_t offset, TagInfo& info) {
+  uint64_t frame_pos = 0;
+  if (!FindMpegFrame(source, offset, std::min(offset + kMaxMpegSyncSearch, source.Size()), &frame_pos)) {
+    return false;
+  }
+
+  //first frame + room for the Xing (side info + 16) / VBRI (32 + 18) headers
+  uint8_t frame[4 + 32 + 18];
+  size_t available = static_cast<size_t>(std::min<uint64_t>(sizeof(frame), source.Size() - frame_pos));
+  MpegHeader header;
+  if (!source.ReadAt(frame_pos, frame, available) || !ParseMpegHeader(frame, header)) {
+    return false;
+  }
+
+  info.codec = MpegCodecName(header.layer);
+  info.sample_rate = static_cast<int>(header.sample_rate);
+  info.channels = header.mono ? 1 : 2;
+
+  //Xing ("Info" for CBR) right after the side info: frame count => exact
+  size_t side_info = header.version == 0 ? (header.mono ? 17 : 32) : (header.mono ? 9 : 17);
+  const uint8_t* xing = frame + 4 + side_info;
+  if (header.layer == 3 && 4 + side_info + 12 <= available &&
+      (memcmp(xing, "Xing", 4) == 0 || memcmp(xing, "Info", 4) == 0)) {
+    uint32_t flags = ReadBE32(xing + 4);
+    uint32_t frames = (flags & 0x01) ? ReadBE32(xing + 8) : 0;
+    if (frames > 0) {
+      info.SetDuration(static_cast<int64_t>(uint64_t{frames} * header.samples * 1000 / header.sample_rate),
+                       DurationAccuracy::EXACT);
+      //stream byte count follows the frame count
+      if ((flags & 0x02) && 4 + side_info + 16 <= available) {
+        SetAverageBitrate(info, ReadBE32(xing + 12));
+      }
+      return true;
+    }
+  }
+
+  //VBRI (Fraunhofer) always 32 bytes after the header
+  const uint8_t* vbri = frame + 4 + 32;
+  if (4 + 32 + 18 <= available && memcmp(vbri, "VBRI", 4) == 0) {
+    uint32_t frames = ReadBE32(vbri + 14);
+    if (frames > 0) {
+      info.SetDuration(static_cast<int64_t>(uint64_t{frames} * header.samples * 1000 / header.sample_rate),
+                       DurationAccuracy::EXACT);
+      SetAverageBitrate(info, ReadBE32(vbri + 10));
+      return true;
+    }
+  }
+
+  //no VBR header => assume CBR: audio bytes / bitrate, trusted only if
+  //the frames after the start and in the middle use the same bitrate
+  info.bitrate = static_cast<int>(header.bitrate_kbps * 1000);
+  bool constant = true;
+  uint64_t next_pos = frame_pos + header.frame_size;
+  for (int i = 0; i < 2 && constant && next_pos + 4 <= source.Size(); ++i) {
+    uint8_t next[4];
+    MpegHeader next_header;
+    constant = source.ReadAt(next_pos, next, sizeof(next)) && ParseMpegHeader(next, next_header) &&
+               next_header.bitrate_kbps == header.bitrate_kbps;
+    if (constant) {
+      next_pos += next_header.frame_size;
+    }
+  }
+
+  uint64_t audio_end = source.Size() - std::min(source.Size(), TrailingTagsSize(source));
+  if (audio_end <= frame_pos) {
+    return true;
+  }
+  int64_t estimate = static_cast<int64_t>((audio_end - frame_pos) * 8 / header.bitrate_kbps);
+
+  uint64_t middle = frame_pos + (audio_end - frame_pos) / 2;
+  uint64_t middle_frame = 0;
+  if (constant && FindMpegFrame(source, middle, std::min(middle + 4096, audio_end), &middle_frame)) {
+    uint8_t middle_bytes[4];
+    MpegHeader middle_header;
+    constant = source.ReadAt(middle_frame, middle_bytes, sizeof(middle_bytes)) &&
+               ParseMpegHeader(middle_bytes, middle_header) &&
+               middle_header.bitrate_kbps == header.bitrate_kbps;
+  }
+
+  info.SetDuration(estimate, constant ? DurationAccuracy::ESTIMATED : DurationAccuracy::UNRELIABLE);
+  return true;
+}
+
+bool TagReader::FindMpegFrame(Source& source, uint64_t offset, uint64_t limit, uint64_t* frame_pos) {
+  //smaller than the read-ahead window => consecutive chunks share one pread
+  constexpr size_t kChunkSize = 2048;
+
+  uint8_t chunk[kChunkSize];
+  for (uint64_t base = offset; base + 4 <= limit; base += kChunkSize - 3) {
+    size_t length = static_cast<size_t>(std::min<uint64_t>(kChunkSize, source.Size() - base));
+    if (length < 4 || !source.ReadAt(base, chunk, length)) {
+      return false;
+    }
+
+    size_t scan_end = static_cast<size_t>(std::min<uint64_t>(length, limit - base + 3));
+    for (size_t i = 0; i + 4 <= scan_end; ++i) {
+      MpegHeader header;
+      if (chunk[i] != 0xFF || !ParseMpegHeader(chunk + i, header)) {
+        continue;
+      }
+
+      //a real frame is followed by another one with the same format
+      uint64_t candidate = base + i;
+      uint64_t next_pos = candidate + header.frame_size;
+      uint8_t next[4];
+      if (next_pos + 4 <= base + length) {
+        memcpy(next, chunk + (next_pos - base), sizeof(next));
+      } else if (!source.ReadAt(next_pos, next, sizeof(next))) {
+        continue;
+      }
+
+      MpegHeader next_header;
+      if (ParseMpegHeader(next, next_header) &&
+          next_header.version == header.version && next_header.layer == header.layer &&
+          next_header.sample_rate == header.sample_rate) {
+        *frame_pos = candidate;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+uint64_t TagReader::TrailingTagsSize(Source& source) {
+  uint64_t trailer = 0;
+
+  uint8_t id3v1[3];
+  if (source.Size() >= 128 && source.ReadAt(source.Size() - 128, id3v1, sizeof(id3v1)) &&
+      memcmp(id3v1, "TAG", 3) == 0) {
+    trailer = 128;
+  }
+
+  //APEv2 footer (+ optional header, flag bit 31)
+  uint8_t footer[32];
+  if (source.Size() >= trailer + 32 &&
+      source.ReadAt(source.Size() - trailer - 32, footer, sizeof(footer)) &&
+      memcmp(footer, "APETAGEX", 8) == 0) {
+    uint32_t flags = ReadLE32(footer + 20);
+    trailer += ReadLE32(footer + 12) + ((flags & 0x80000000u) ? 32 : 0);
+  }
+
+  return trailer;
+}
+
+void TagReader::OfferPicture(TagInfo& info, PictureInfo picture) {
+  if (picture.spans.empty() || picture.StoredSize() == 0) {
+    return;
+  }
+  if (!info.picture.has_value() || (picture.picture_type == 3 && info.picture->picture_type != 3)) {
+    info.picture = std::move(picture);
+  }
+}
+
+size_t TagReader::ParseApicHeader(const uint8_t* data, size_t size, bool id3v22,
+                                  std::string* mime_type, int* picture_type) {
+  if (size < (id3v22 ? 5u : 4u)) {
+    return 0;
+  }
+
+  uint8_t encoding = data[0];
+  std::string mime;
+  size_t pos;
+  if (id3v22) {
+    //3 character image format
+    mime = strncasecmp(reinterpret_cast<const char*>(data + 1), "PNG", 3) == 0 ? "image/png"
+         : strncasecmp(reinterpret_cast<const char*>(data + 1), "JPG", 3) == 0 ? "image/jpeg"
+         : "";
+    pos = 4;
+  } else {
+    const uint8_t* mime_end = static_cast<const uint8_t*>(memchr(data + 1, 0, size - 1));
+    if (!mime_end) {
+      return 0;
+    }
+    mime.assign(reinterpret_cast<const char*>(data + 1), mime_end - data - 1);
+    pos = mime_end - data + 1;
+  }
+
+  //"-->" = the frame only holds a URL
+  if (pos >= size || mime == "-->") {
+    return 0;
+  }
+  int type = data[pos++];
+
+  //description, terminated by one NUL (Latin-1/UTF-8) or two (UTF-16)
+  if (encoding == 1 || encoding == 2) {
+    while (pos + 1 < size && (data[pos] != 0 || data[pos + 1] != 0)) {
+      pos += 2;
+    }
+    if (pos + 1 >= size) {
+      return 0;
+    }
+    pos += 2;
+  } else {
+    const uint8_t* description_end = static_cast<const uint8_t*>(memchr(data + pos, 0, size - pos));
+    if (!description_end) {
+      return 0;
+    }
+    pos = description_end - data + 1;
+  }
+  if (pos >= size) {
+    return 0;
+  }
+
+  if (mime_type) *mime_type = mime;
+  if (picture_type) *picture_type = type;
+  return pos;
+}
+
+size_t TagReader::ParseFlacPictureHeader(const uint8_t* data, size_t size,
+                                         std::string* mime_type, int* picture_type,
+                                         uint32_t* data_length) {
+  if (size < 8) {
+    return 0;
+  }
+  uint32_t type = ReadBE32(data);
+  uint32_t mime_length = ReadBE32(data + 4);
+  if (mime_length > size - 8) {
+    return 0;
+  }
+  size_t pos = 8 + mime_length;
+  if (pos + 4 > size) {
+    return 0;
+  }
+  uint32_t description_length = ReadBE32(data + pos);
+  pos += 4;
+  //description, width, height, depth, colors, data length
+  if (description_length > size - pos || size - pos - description_length < 20) {
+    return 0;
+  }
+  pos += description_length + 16;
+
+  if (mime_type) mime_type->assign(reinterpret_cast<const char*>(data + 8), mime_length);
+  if (picture_type) *picture_type = static_cast<int>(type);
+  if (data_length) *data_length = ReadBE32(data + pos);
+  return pos + 4;
+}
+
+void TagReader::SetTag(TagInfo& info, const std::string& key, const std::string& value) {
+  if (key.empty() || value.empty()) {
+    return;
+  }
+  info.tags.emplace(key, value);  //first source wins
+}
+
+std::string TagReader::NormalizeId3Key(const std::string& frame_id) {
+  static const std::map<std::string, std::string> kKeys = {
+    {"TIT2", "title"}, {"TT2", "title"},
+    {"TPE1", "artist"}, {"TP1", "artist"},
+    {"TALB", "album"}, {"TAL", "album"},
+    {"TCON", "genre"}, {"TCO", "genre"},
+    {"TDRC", "date"}, {"TYER", "date"}, {"TYE", "date"},
+    {"TRCK", "track"}, {"TRK", "track"},
+    {"TPOS", "disc"}, {"TPA", "disc"},
+    {"TCOM", "composer"}, {"TCM", "composer"},
+    {"TPE2", "album_artist"}, {"TP2", "album_artist"},
+  };
+  auto it = kKeys.find(frame_id);
+  return it != kKeys.end() ? it->second : "";
+}
+
+std::string TagReader::NormalizeVorbisKey(const std::string& key) {
+  std::string lower_key = StringUtils::ToLower(key);
+  if (lower_key == "title" || lower_key == "artist" || lower_key == "album" ||
+      lower_key == "genre" || lower_key == "date" || lower_key == "composer") {
+    return lower_key;
+  }
+  if (lower_key == "year") return "date";
+  if (lower_key == "tracknumber") return "track";
+  if (lower_key == "discnumber") return "disc";
+  if (lower_key == "albumartist" || lower_key == "album artist") return "album_artist";
+  return "";
+}
+
+std::string TagReader::NormalizeMp4Key(const std::string& atom) {
+  static const std::map<std::string, std::string> kKeys = {
+    {"\xA9nam", "title"},
+    {"\xA9" "ART", "artist"},
+    {"\xA9" "alb", "album"},
+    {"\xA9gen", "genre"}, {"gnre", "genre"},
+    {"\xA9" "day", "date"},
+    {"trkn", "track"},
+    {"disk", "disc"},
+    {"\xA9wrt", "composer"},
+    {"aART", "album_artist"},
+  };
+  auto it = kKeys.find(atom);
+  return it != kKeys.end() ? it->second : "";
+}
+
+std::string TagReader::NormalizeRiffKey(const std::string& chunk_id) {
+  static const std::map<std::string, std::string> kKeys = {
+    {"INAM", "title"},
+    {"IART", "artist"},
+    {"IPRD", "album"},
+    {"IGNR", "genre"},
+    {"ICRD", "date"},
+    {"ITRK", "track"}, {"IPRT", "track"},
+  };
+  auto it = kKeys.find(chunk_id);
+  return it != kKeys.end() ? it->second : "";
+}
+
+std::string TagReader::DecodeId3Text(const uint8_t* data, size_t size) {
+  if (size < 2) {
+    return "";
+  }
+
+  uint8_t encoding = data[0];
+  const uint8_t* text = data + 1;
+  size_t text_size = size - 1;
+  bool wide = encoding == 1 || encoding == 2;
+
+  //v2.4 allows several NUL separated values => join them
+  std::string result;
+  size_t start = 0;
+  while (start < text_size) {
+    size_t end = start;
+    if (wide) {
+      while (end + 1 < text_size && (text[end] != 0 || text[end + 1] != 0)) end += 2;
+      if (end + 1 >= text_size) end = text_size;
+    } else {
+      while (end < text_size && text[end] != 0) end++;
+    }
+
+    size_t length = end - start;
+    std::string value = encoding == 0 ? Latin1ToUtf8(text + start, length)
+                      : encoding == 3 ? std::string(reinterpret_cast<const char*>(text + start), length)
+                      : Utf16ToUtf8(text + start, length, encoding == 2);
+    if (!value.empty()) {
+      if (!result.empty()) result += "/";
+      result += value;
+    }
+
+    start = end + (wide ? 2 : 1);
+  }
+
+  return result;
+}
+
+std::string TagReader::Latin1ToUtf8(const uint8_t* data, size_t size) {
+  std::string result;
+  result.reserve(size);
+  for (size_t i = 0; i < size && data[i] != 0; ++i) {
+    AppendUtf8(result, data[i]);
+  }
+  return result;
+}
+
+std::string TagReader::Utf16ToUtf8(const uint8_t* data, size_t size, bool big_endian) {
+  size_t pos = 0;
+
+  //BOM overrides the default byte order
+  if (size >= 2 && data[0] == 0xFF && data[1] == 0xFE) {
+    big_endian = false;
+    pos = 2;
+  } else if (size >= 2 && data[0] == 0xFE && data[1] == 0xFF) {
+    big_endian = true;
+    pos = 2;
+  }
+
+  std::string result;
+  result.reserve(size);
+  while (pos + 2 <= size) {
+    uint32_t unit = big_endian ? ReadBE16(data + pos) : ReadLE16(data + pos);
+    pos += 2;
+    if (unit == 0) {
+      break;
+    }
+
+    if (unit >= 0xD800 && unit <= 0xDBFF && pos + 2 <= size) {
+      uint32_t low = big_endian ? ReadBE16(data + pos) : ReadLE16(data + pos);
+      if (low >= 0xDC00 && low <= 0xDFFF) {
+        pos += 2;
+        unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+      }
+    }
+    AppendUtf8(result, unit);
+  }
+
+  return result;
+}
+
+std::string TagReader::ResolveId3Genre(const std::string& value) {
+  //"(17)", "(17)Rock", "17", "RX" and "CR" forms
+  std::string index;
+  std::string rest = value;
+  if (!value.empty() && value[0] == '(') {
+    size_t close = value.find(')');
+    if (close != std::string::npos) {
+      index = value.substr(1, close - 1);
+      rest = value.substr(close + 1);
+    }
+  } else if (!value.empty() && std::all_of(value.begin(), value.end(), ::isdigit)) {
+    index = value;
+    rest.clear();
+  }
+
+  if (!rest.empty()) {
+    return rest;
+  }
+  if (index == "RX") return "Remix";
+  if (index == "CR") return "Cover";
+  if (!index.empty() && index.size() < 4 && std::all_of(index.begin(), index.end(), ::isdigit)) {
+    size_t genre = std::stoul(index);
+    if (genre < kId3GenreCount) {
+      return kId3Genres[genre];
+    }
+  }
+  return value;
+}
+
+}  // namespace on_audio_query_linux
@@ -0,0 +1,227 @@
+#ifndef TAG_READER_H_
+#define TAG_READER_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <optional>
+#include <functional>
+#include <cstdint>
+
+namespace on_audio_query_linux {
+
+/// How far a duration computed from headers can be trusted
+enum class DurationAccuracy {
+  NONE,        //no duration found
+  UNRELIABLE,  //ID3 TLEN, CBR estimate of a stream with mixed bitrates
+  ESTIMATED,   //derived from sizes and rates (CBR MP3, compressed WAV, mvhd)
+  EXACT        //sample counts (Xing/VBRI, STREAMINFO, Ogg granule, mdhd, PCM WAV)
+};
+
+/// Byte range of a file
+struct FileSpan {
+  uint64_t offset;
+  uint64_t length;
+};
+
+/// Where an embedded picture is stored (found while reading tags, the
+/// image itself is only read on request)
+struct PictureInfo {
+  enum class Encoding {
+    RAW,          //image bytes as stored in spans[0] => can be mapped directly
+    ID3_FRAME,    //unsynchronised APIC/PIC frame: unsync spans, then the frame body at inner_offset
+    BASE64_BLOCK  //Vorbis METADATA_BLOCK_PICTURE: base64 FLAC picture block split over spans
+  };
+
+  Encoding encoding = Encoding::RAW;
+  std::vector<FileSpan> spans;
+  uint64_t inner_offset = 0;  //ID3_FRAME only
+  uint64_t inner_length = 0;
+  bool id3v22 = false;        //PIC frame layout
+
+  std::string mime_type;      //"" when the container doesn't say
+  int picture_type = 3;       //ID3/FLAC picture type, 3 = front cover
+
+  /// Encoded size (sum of the spans)
+  uint64_t StoredSize() const;
+};
+
+/// Tags and stream info read directly from an audio file
+struct TagInfo {
+  /// Normalized keys: title, artist, album, genre, date, track, disc,
+  /// composer, album_artist (multiple values are joined with "/")
+  std::map<std::string, std::string> tags;
+
+  /// 0 when the container doesn't store it (caller falls back to ffprobe)
+  int64_t duration_ms = 0;
+  DurationAccuracy duration_accuracy = DurationAccuracy::NONE;
+
+  /// Audio stream properties (0/"" = unknown), codec names as ffprobe reports them
+  int bitrate = 0;      //bits per second (average for VBR)
+  int sample_rate = 0;  //Hz
+  int bit_depth = 0;    //lossless/PCM only
+  int channels = 0;
+  std::string codec;
+
+  /// Front cover if there is one, the first picture otherwise
+  std::optional<PictureInfo> picture;
+
+  std::string GetTag(const std::string& key, const std::string& default_val) const;
+
+  /// Keep the most accurate duration seen so far
+  void SetDuration(int64_t ms, DurationAccuracy accuracy);
+
+  /// Duration good enough to skip ffprobe
+  bool HasTrustedDuration() const {
+    return duration_ms > 0 && duration_accuracy >= DurationAccuracy::ESTIMATED;
+  }
+};
+
+/// I/O done by a single TagReader::Read call
+struct TagReadIo {
+  uint64_t bytes_read = 0;
+  uint64_t file_size = 0;
+};
+
+/// In-process tag reader for ID3v1/ID3v2.2-2.4, FLAC/Ogg Vorbis comments,
+/// Opus tags, MP4 ilst atoms, APEv2 and RIFF INFO. Embedded pictures (APIC,
+/// FLAC PICTURE, METADATA_BLOCK_PICTURE, covr) are located, not read.
+///
+/// Only the tag regions are read, through pread and a small read-ahead
+/// window (no decoding, no external process, no whole-file streaming).
+class TagReader {
+ public:
+  TagReader();
+  ~TagReader();
+
+  /// Read tags (nullopt when the format is unsupported or malformed).
+  /// With `picture_bytes` the located picture is also read through the same
+  /// open file (left untouched when there is none).
+  std::optional<TagInfo> Read(const std::string& file_path, TagReadIo* io = nullptr,
+                              std::vector<uint8_t>* picture_bytes = nullptr);
+
+  /// Image bytes of a picture found by Read (decodes unsync/base64 forms)
+  std::optional<std::vector<uint8_t>> ReadPicture(const std::string& file_path,
+                                                  const PictureInfo& picture,
+                                                  TagReadIo* io = nullptr);
+
+ private:
+  /// Positioned reads over an open file (or an in-memory copy of a region)
+  class Source {
+   public:
+    explicit Source(const std::string& file_path);
+    explicit Source(std::vector<uint8_t> data);
+    ~Source();
+
+    Source(const Source&) = delete;
+    Source& operator=(const Source&) = delete;
+
+    bool IsOpen() const { return is_memory_ || fd_ >= 0; }
+    uint64_t Size() const { return size_; }
+
+    /// Bytes actually read from the file so far
+    uint64_t BytesRead() const { return bytes_read_; }
+
+    /// Read exactly `length` bytes at `offset`
+    bool ReadAt(uint64_t offset, void* buffer, size_t length);
+    bool ReadAt(uint64_t offset, size_t length, std::vector<uint8_t>& out);
+
+    /// Read without filling the read-ahead window (sparse header walks)
+    bool ReadAtDirect(uint64_t offset, void* buffer, size_t length);
+
+   private:
+    /// Headers are read a few bytes at a time => serve them from one window
+    static constexpr size_t kWindowSize = 4096;
+
+    int fd_;
+    std::vector<uint8_t> memory_;
+    bool is_memory_;
+    uint64_t size_;
+
+    std::vector<uint8_t> window_;
+    uint64_t window_offset_;
+    uint64_t bytes_read_;
+
+    /// pread until `length` bytes arrived (or EOF/error)
+    bool PRead(uint64_t offset, void* buffer, size_t length);
+  };
+
+  /// Image bytes of a located picture from an open source
+  std::optional<std::vector<uint8_t>> ReadPicture(Source& source, const PictureInfo& picture);
+
+  /// Detect the format and dispatch to the readers below
+  std::optional<TagInfo> ReadTags(Source& source);
+
+  /// Format readers (return false when the data is not in that format)
+  bool ReadId3v2(Source& source, uint64_t offset, TagInfo& info, uint64_t* tag_end);
+  bool ReadId3v1(Source& source, TagInfo& info);
+  bool ReadApe(Source& source, TagInfo& info);
+  bool ReadFlac(Source& source, uint64_t offset, TagInfo& info);
+  bool ReadOgg(Source& source, TagInfo& info);
+  bool ReadMp4(Source& source, TagInfo& info);
+  bool ReadRiff(Source& source, TagInfo& info);
+
+  /// MPEG audio duration from the first frame (Xing/Info/VBRI or CBR size)
+  bool ReadMpeg(Source& source, uint64_t offset, TagInfo& info);
+
+  /// Shared helpers
+  /// `unsync_region`: frames come from a cleaned copy of that tag region
+  void ReadId3v2Frames(Source& source, uint64_t offset, uint64_t end,
+                       int version, bool frame_unsync, TagInfo& info,
+                       const FileSpan* unsync_region = nullptr);
+  /// Positioned reads inside a logical region (metadata block, Ogg packet)
+  using RegionReader = std::function<bool(uint64_t offset, void* buffer, size_t length)>;
+  /// File ranges backing a range of a logical region
+  using RegionMapper = std::function<std::vector<FileSpan>(uint64_t offset, uint64_t length)>;
+  void ParseVorbisComment(const RegionReader& read, const RegionMapper& map,
+                          uint64_t size, TagInfo& info);
+  bool ReadFlacPicture(Source& source, uint64_t offset, uint64_t length, TagInfo& info);
+  void ReadId3Picture(Source& source, uint64_t offset, uint64_t length, bool id3v22,
+                      bool unsync, const FileSpan* unsync_region, TagInfo& info);
+  /// `depth`: container nesting below moov (bounded against crafted files)
+  void ReadMp4Atoms(Source& source, uint64_t offset, uint64_t end,
+                    const std::string& parent, int depth, TagInfo& info);
+  void ReadMp4Media(Source& source, uint64_t offset, uint64_t end, TagInfo& info);
+  void ReadMp4SampleTable(Source& source, uint64_t offset, uint64_t end, TagInfo& info);
+  void ReadMp4SampleEntry(Source& source, uint64_t offset, uint64_t end, TagInfo& info);
+  int64_t ReadOggLastGranule(Source& source, uint32_t serial);
+
+  /// Find the first MPEG frame in [offset, limit) followed by a valid frame
+  bool FindMpegFrame(Source& source, uint64_t offset, uint64_t limit, uint64_t* frame_pos);
+
+  /// Size of APEv2/ID3v1 tags at the end of the file
+  uint64_t TrailingTagsSize(Source& source);
+
+  /// Add a value under a normalized key (keeps existing values)
+  static void SetTag(TagInfo& info, const std::string& key, const std::string& value);
+
+  /// Keep `picture` unless a front cover was already found
+  static void OfferPicture(TagInfo& info, PictureInfo picture);
+
+  /// APIC/PIC body: text encoding, mime (or 3 char format), type, description.
+  /// Returns the offset of the image data (0 when the header is incomplete).
+  static size_t ParseApicHeader(const uint8_t* data, size_t size, bool id3v22,
+                                std::string* mime_type, int* picture_type);
+
+  /// FLAC picture block: type, mime, description, dimensions, data length.
+  /// Returns the offset of the image data (0 when incomplete).
+  static size_t ParseFlacPictureHeader(const uint8_t* data, size_t size,
+                                       std::string* mime_type, int* picture_type,
+                                       uint32_t* data_length);
+
+  /// Map format specific keys to normalized keys ("" = not interesting)
+  static std::string NormalizeId3Key(const std::string& frame_id);
+  static std::string NormalizeVorbisKey(const std::string& key);
+  static std::string NormalizeMp4Key(const std::string& atom);
+  static std::string NormalizeRiffKey(const std::string& chunk_id);
+
+  /// Text helpers
+  static std::string DecodeId3Text(const uint8_t* data, size_t size);
+  static std::string Latin1ToUtf8(const uint8_t* data, size_t size);
+  static std::string Utf16ToUtf8(const uint8_t* data, size_t size, bool big_endian);
+  static std::string ResolveId3Genre(const std::string& value);
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // TAG_READER_H_
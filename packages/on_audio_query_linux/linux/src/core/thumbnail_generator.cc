@@ -0,0 +1,298 @@
+#include "thumbnail_generator.h"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csetjmp>
+#include <algorithm>
+#include <jpeglib.h>
+#include <png.h>
+
+namespace on_audio_query_linux {
+
+namespace {
+
+/// libjpeg reports fatal errors through error_exit (default: exit()) => jump back instead
+struct JpegErrorManager {
+  jpeg_error_mgr base;
+  jmp_buf jump;
+};
+
+void JpegErrorExit(j_common_ptr cinfo) {
+  JpegErrorManager* manager = reinterpret_cast<JpegErrorManager*>(cinfo->err);
+  longjmp(manager->jump, 1);
+}
+
+void JpegSilentMessage(j_common_ptr) {
+  //corrupt-data warnings are expected from some taggers => don't spam stderr
+}
+
+}  // namespace
+
+bool ThumbnailGenerator::IsJpeg(const uint8_t* data, size_t size) {
+  return size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+bool ThumbnailGenerator::IsPng(const uint8_t* data, size_t size) {
+  static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  return size >= 8 && memcmp(data, kSignature, 8) == 0;
+}
+
+std::optional<std::vector<uint8_t>> ThumbnailGenerator::Generate(const uint8_t* data, size_t size,
+                                                                 int max_size,
+                                                                 const std::string& format,
+                                                                 int quality) {
+  if (!data || size == 0 || max_size <= 0) {
+    return std::nullopt;
+  }
+
+  bool is_jpeg = IsJpeg(data, size);
+  bool is_png = IsPng(data, size);
+  if (!is_jpeg && !is_png) {
+    return std::nullopt;  //other formats are forwarded untouched
+  }
+
+  bool want_png = format == "png";
+  bool same_format = want_png ? is_png : is_jpeg;
+
+  ImageBuffer image;
+  bool fits = false;
+  bool decoded = is_jpeg ? DecodeJpeg(data, size, max_size, same_format, &image, &fits)
+                         : DecodePng(data, size, max_size, same_format, &image, &fits);
+  if (!decoded) {
+    std::cerr << "[ThumbnailGenerator] Failed to decode " << (is_jpeg ? "JPEG" : "PNG")
+              << " artwork (" << size << " bytes)" << std::endl;
+    return std::nullopt;
+  }
+  if (fits && same_format) {
+    return std::nullopt;
+  }
+
+  int width = image.width;
+  int height = image.height;
+  ImageResampler::FitInside(image.width, image.height, max_size, &width, &height);
+  if (width != image.width || height != image.height) {
+    image = ImageResampler::Downscale(image, width, height);
+    if (image.pixels.empty()) {
+      return std::nullopt;
+    }
+  }
+
+  return want_png ? EncodePng(image) : EncodeJpeg(image, quality);
+}
+
+bool ThumbnailGenerator::Decode(const uint8_t* data, size_t size, int max_size,
+                                ImageBuffer* image) {
+  if (!data || size == 0 || max_size <= 0) {
+    return false;
+  }
+
+  bool fits = false;
+  bool decoded = IsJpeg(data, size) ? DecodeJpeg(data, size, max_size, false, image, &fits)
+               : IsPng(data, size) ? DecodePng(data, size, max_size, false, image, &fits)
+               : false;
+  if (!decoded) {
+    return false;
+  }
+
+  int width = image->width;
+  int height = image->height;
+  ImageResampler::FitInside(image->width, image->height, max_size, &width, &height);
+  if (width != image->width || height != image->height) {
+    *image = ImageResampler::Downscale(*image, width, height);
+  }
+  return !image->pixels.empty();
+}
+
+bool ThumbnailGenerator::DecodeJpeg(const uint8_t* data, size_t size, int max_size,
+                                    bool stop_if_fits, ImageBuffer* image, bool* fits) {
+  jpeg_decompress_struct cinfo;
+  JpegErrorManager error;
+  JSAMPROW row = nullptr;
+
+  cinfo.err = jpeg_std_error(&error.base);
+  error.base.error_exit = JpegErrorExit;
+  error.base.output_message = JpegSilentMessage;
+
+  if (setjmp(error.jump)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, const_cast<unsigned char*>(data), static_cast<unsigned long>(size));
+
+  if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+
+  int source_width = static_cast<int>(cinfo.image_width);
+  int source_height = static_cast<int>(cinfo.image_height);
+  *fits = source_width <= max_size && source_height <= max_size;
+  if (*fits && stop_if_fits) {
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+  }
+
+  //CMYK/YCCK can't be converted to RGB by libjpeg
+  if (cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  cinfo.out_color_space = cinfo.jpeg_color_space == JCS_GRAYSCALE ? JCS_GRAYSCALE : JCS_RGB;
+
+  //smallest DCT scaling that still covers the target size
+  int target_width = source_width;
+  int target_height = source_height;
+  ImageResampler::FitInside(source_width, source_height, max_size, &target_width, &target_height);
+  unsigned int denom = 8;
+  while (denom > 1 &&
+         (static_cast<int>((source_width + denom - 1) / denom) < target_width ||
+          static_cast<int>((source_height + denom - 1) / denom) < target_height)) {
+    denom /= 2;
+  }
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = denom;
+
+  jpeg_calc_output_dimensions(&cinfo);
+  if (static_cast<uint64_t>(cinfo.output_width) * cinfo.output_height > kMaxDecodedPixels) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+
+  jpeg_start_decompress(&cinfo);
+
+  image->width = static_cast<int>(cinfo.output_width);
+  image->height = static_cast<int>(cinfo.output_height);
+  image->channels = cinfo.output_components;
+  image->pixels.resize(static_cast<size_t>(image->width) * image->height * image->channels);
+
+  size_t stride = static_cast<size_t>(image->width) * image->channels;
+  while (cinfo.output_scanline < cinfo.output_height) {
+    row = image->pixels.data() + cinfo.output_scanline * stride;
+    jpeg_read_scanlines(&cinfo, &row, 1);
+  }
+
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return true;
+}
+
+bool ThumbnailGenerator::DecodePng(const uint8_t* data, size_t size, int max_size,
+                                   bool stop_if_fits, ImageBuffer* image, bool* fits) {
+  png_image png;
+  memset(&png, 0, sizeof(png));
+  png.version = PNG_IMAGE_VERSION;
+
+  if (!png_image_begin_read_from_memory(&png, data, size)) {
+    return false;
+  }
+
+  *fits = static_cast<int>(png.width) <= max_size && static_cast<int>(png.height) <= max_size;
+  if ((*fits && stop_if_fits) ||
+      static_cast<uint64_t>(png.width) * png.height > kMaxDecodedPixels) {
+    bool ok = *fits && stop_if_fits;
+    png_image_free(&png);
+    return ok;
+  }
+
+  //palette/gray images are expanded, alpha is kept only when present
+  bool has_alpha = (png.format & PNG_FORMAT_FLAG_ALPHA) != 0;
+  png.format = has_alpha ? PNG_FORMAT_RGBA : PNG_FORMAT_RGB;
+
+  image->width = static_cast<int>(png.width);
+  image->height = static_cast<int>(png.height);
+  image->channels = has_alpha ? 4 : 3;
+  image->pixels.resize(PNG_IMAGE_SIZE(png));
+
+  if (!png_image_finish_read(&png, nullptr, image->pixels.data(), 0, nullptr)) {
+    png_image_free(&png);
+    image->pixels.clear();
+    return false;
+  }
+
+  return true;
+}
+
+std::optional<std::vector<uint8_t>> ThumbnailGenerator::EncodeJpeg(const ImageBuffer& image,
+                                                                   int quality) {
+  jpeg_compress_struct cinfo;
+  JpegErrorManager error;
+  unsigned char* buffer = nullptr;
+  unsigned long buffer_size = 0;
+  std::vector<uint8_t> rgb_row;
+  JSAMPROW row = nullptr;
+
+  cinfo.err = jpeg_std_error(&error.base);
+  error.base.error_exit = JpegErrorExit;
+  error.base.output_message = JpegSilentMessage;
+
+  if (setjmp(error.jump)) {
+    jpeg_destroy_compress(&cinfo);
+    free(buffer);
+    return std::nullopt;
+  }
+
+  jpeg_create_compress(&cinfo);
+  jpeg_mem_dest(&cinfo, &buffer, &buffer_size);
+
+  bool gray = image.channels == 1;
+  cinfo.image_width = static_cast<JDIMENSION>(image.width);
+  cinfo.image_height = static_cast<JDIMENSION>(image.height);
+  cinfo.input_components = gray ? 1 : 3;
+  cinfo.in_color_space = gray ? JCS_GRAYSCALE : JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, std::clamp(quality, 1, 100), TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+
+  //JPEG has no alpha => RGBA rows are stripped to RGB
+  size_t stride = static_cast<size_t>(image.width) * image.channels;
+  if (image.channels == 4) {
+    rgb_row.resize(static_cast<size_t>(image.width) * 3);
+  }
+  while (cinfo.next_scanline < cinfo.image_height) {
+    const uint8_t* src = image.pixels.data() + cinfo.next_scanline * stride;
+    if (image.channels == 4) {
+      for (int x = 0; x < image.width; ++x) {
+        memcpy(&rgb_row[x * 3], src + x * 4, 3);
+      }
+      row = rgb_row.data();
+    } else {
+      row = const_cast<uint8_t*>(src);
+    }
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+
+  jpeg_finish_compress(&cinfo);
+  std::vector<uint8_t> result(buffer, buffer + buffer_size);
+  jpeg_destroy_compress(&cinfo);
+  free(buffer);
+  return result;
+}
+
+std::optional<std::vector<uint8_t>> ThumbnailGenerator::EncodePng(const ImageBuffer& image) {
+  png_image png;
+  memset(&png, 0, sizeof(png));
+  png.version = PNG_IMAGE_VERSION;
+  png.width = static_cast<png_uint_32>(image.width);
+  png.height = static_cast<png_uint_32>(image.height);
+  png.format = image.channels == 4 ? PNG_FORMAT_RGBA
+             : image.channels == 1 ? PNG_FORMAT_GRAY
+             : PNG_FORMAT_RGB;
+
+  //first call only computes the size
+  png_alloc_size_t size = 0;
+  if (!png_image_write_to_memory(&png, nullptr, &size, 0, image.pixels.data(), 0, nullptr)) {
+    return std::nullopt;
+  }
+
+  std::vector<uint8_t> result(size);
+  if (!png_image_write_to_memory(&png, result.data(), &size, 0, image.pixels.data(), 0, nullptr)) {
+    return std::nullopt;
+  }
+  result.resize(size);
+  return result;
+}
+
+}  // namespace on_audio_query_linux
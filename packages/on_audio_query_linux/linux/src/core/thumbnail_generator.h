@@ -0,0 +1,51 @@
+#ifndef THUMBNAIL_GENERATOR_H_
+#define THUMBNAIL_GENERATOR_H_
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include "../utils/image_resampler.h"
+
+namespace on_audio_query_linux {
+
+/// Decodes artwork (JPEG/PNG), shrinks it to the requested size and
+/// re-encodes it, so a list tile gets a few KB instead of the full cover.
+///
+/// Large JPEGs are decoded with DCT scaling (1/2, 1/4, 1/8) to the smallest
+/// size still at least as big as the target, the rest is area averaged.
+class ThumbnailGenerator {
+ public:
+  /// Thumbnail fitting max_size x max_size in `format` ("jpeg" or "png").
+  /// Returns nullopt when the original should be sent as is: it's already
+  /// small enough and in the requested format, or it can't be decoded.
+  static std::optional<std::vector<uint8_t>> Generate(const uint8_t* data, size_t size,
+                                                      int max_size,
+                                                      const std::string& format,
+                                                      int quality);
+
+  /// Decoded pixels fitting max_size x max_size (gray, RGB or RGBA),
+  /// false when the image can't be decoded
+  static bool Decode(const uint8_t* data, size_t size, int max_size, ImageBuffer* image);
+
+  static bool IsJpeg(const uint8_t* data, size_t size);
+  static bool IsPng(const uint8_t* data, size_t size);
+
+ private:
+  /// Larger images are rejected (after JPEG DCT scaling)
+  static constexpr uint64_t kMaxDecodedPixels = 40000000;
+
+  /// Decoders set `fits` when the source is within max_size and stop there
+  /// (without pixels) if `stop_if_fits` is set
+  static bool DecodeJpeg(const uint8_t* data, size_t size, int max_size,
+                         bool stop_if_fits, ImageBuffer* image, bool* fits);
+  static bool DecodePng(const uint8_t* data, size_t size, int max_size,
+                        bool stop_if_fits, ImageBuffer* image, bool* fits);
+
+  static std::optional<std::vector<uint8_t>> EncodeJpeg(const ImageBuffer& image, int quality);
+  static std::optional<std::vector<uint8_t>> EncodePng(const ImageBuffer& image);
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // THUMBNAIL_GENERATOR_H_
@@ -27,6 +27,16 @@ struct SongMetadata {
   int64_t genre_id;
   std::string file_extension;
   bool is_music;
+  int disc;
+  std::string album_artist;
+  std::string composer;
+
+  /// Audio stream properties (0/"" = unknown)
+  int bitrate;      //bits per second
+  int sample_rate;  //Hz
+  int bit_depth;    //lossless/PCM only
+  int channels;
+  std::string codec;
 };
 
 }  // namespace on_audio_query_linux
@@ -8,10 +8,16 @@
 #include <thread>
 #include <iostream>
 #include <filesystem>
+#include <map>
+#include <memory>
 
 #include "core/database_manager.h"
 #include "core/ffprobe_extractor.h"
+#include "core/cover_resolver.h"
+#include "core/artwork_store.h"
+#include "core/freedesktop_thumbnails.h"
 #include "core/thread_pool.h"
+#include "core/search_session.h"
 #include "scanner/file_scanner.h"
 #include "scanner/scan_coordinator.h"
 #include "queries/audio_query.h"
@@ -20,9 +26,13 @@
 #include "queries/genre_query.h"
 #include "queries/playlist_query.h"
 #include "queries/artwork_query.h"
+#include "queries/artwork_batch_query.h"
 #include "queries/audios_from_query.h"
 #include "queries/with_filters_query.h"
 #include "queries/folder_query.h"
+#include "queries/scan_stats_query.h"
+#include "queries/quarantine_query.h"
+#include "queries/search_query.h"
 
 using namespace on_audio_query_linux;
 
@@ -36,12 +46,102 @@ struct _OnAudioQueryLinuxPlugin {
   // Core components
   DatabaseManager* db_manager;
   FFprobeExtractor* ffprobe;
+  CoverResolver* cover_resolver;
+  ArtworkStore* artwork_store;
+  FreedesktopThumbnails* thumbnails;
   ThreadPool* thread_pool;
   ScanCoordinator* scan_coordinator;
+
+  // Search-as-you-type sessions by id (main loop only), searched on their
+  // own thread so a keystroke never queues behind artwork extraction
+  std::map<int64_t, std::shared_ptr<SearchSession>>* search_sessions;
+  ThreadPool* search_pool;
+
+  // Batch artwork misses, extracted on their own threads so a grid of
+  // covers never waits behind queued scan batches on thread_pool
+  ThreadPool* artwork_pool;
+
+  // Channel used to push events to Dart (set on registration)
+  FlMethodChannel* channel;
 };
 
 G_DEFINE_TYPE(OnAudioQueryLinuxPlugin, on_audio_query_linux_plugin, g_object_get_type())
 
+// Song ids forwarded from the scan thread to the main loop
+struct SongsChangedEvent {
+  OnAudioQueryLinuxPlugin* plugin;
+  std::vector<int64_t> song_ids;
+};
+
+// Send "onSongsChanged" to Dart (runs on the main loop)
+static gboolean songs_changed_idle_cb(gpointer user_data) {
+  SongsChangedEvent* event = static_cast<SongsChangedEvent*>(user_data);
+
+  if (event->plugin->channel) {
+    g_autoptr(FlValue) ids = fl_value_new_list();
+    for (int64_t id : event->song_ids) {
+      fl_value_append_take(ids, fl_value_new_int(id));
+    }
+    fl_method_channel_invoke_method(event->plugin->channel, "onSongsChanged", ids,
+                                    nullptr, nullptr, nullptr);
+  }
+
+  g_object_unref(event->plugin);
+  delete event;
+  return G_SOURCE_REMOVE;
+}
+
+// Artwork extracted on the pool for a queryArtworks batch
+struct ArtworkReadyEvent {
+  OnAudioQueryLinuxPlugin* plugin;
+  int64_t request_id;
+  int64_t id;
+  FlValue* artwork;  //owned, nullptr => no artwork
+};
+
+// Send "onArtwork" to Dart (runs on the main loop)
+static gboolean artwork_ready_idle_cb(gpointer user_data) {
+  ArtworkReadyEvent* event = static_cast<ArtworkReadyEvent*>(user_data);
+
+  if (event->plugin->channel) {
+    g_autoptr(FlValue) args = fl_value_new_map();
+    fl_value_set_string_take(args, "requestId", fl_value_new_int(event->request_id));
+    fl_value_set_string_take(args, "id", fl_value_new_int(event->id));
+    fl_value_set_string_take(args, "artwork",
+                             event->artwork ? event->artwork : fl_value_new_null());
+    event->artwork = nullptr;
+    fl_method_channel_invoke_method(event->plugin->channel, "onArtwork", args,
+                                    nullptr, nullptr, nullptr);
+  }
+
+  if (event->artwork) {
+    fl_value_unref(event->artwork);
+  }
+  g_object_unref(event->plugin);
+  delete event;
+  return G_SOURCE_REMOVE;
+}
+
+// Reply to a searchSession call, computed on the search thread
+struct SearchDoneEvent {
+  FlMethodCall* method_call;
+  FlValue* result;  //owned, nullptr => superseded
+};
+
+// Respond to the call (runs on the main loop)
+static gboolean search_done_idle_cb(gpointer user_data) {
+  SearchDoneEvent* event = static_cast<SearchDoneEvent*>(user_data);
+
+  g_autoptr(FlValue) result = event->result ? event->result : fl_value_new_null();
+  g_autoptr(FlMethodResponse) response =
+      FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  fl_method_call_respond(event->method_call, response, nullptr);
+
+  g_object_unref(event->method_call);
+  delete event;
+  return G_SOURCE_REMOVE;
+}
+
 // Handle method calls from Dart
 static void on_audio_query_linux_plugin_handle_method_call(
     OnAudioQueryLinuxPlugin* self,
@@ -162,6 +262,58 @@ static void on_audio_query_linux_plugin_handle_method_call(
     WithFiltersQuery query(self->db_manager, search);
     FlValue* result = query.Execute();
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "searchSession") == 0) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    int64_t session_id = 0;
+    std::string search = "";
+
+    if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      FlValue* session_val = fl_value_lookup_string(args, "sessionId");
+      FlValue* search_val = fl_value_lookup_string(args, "argsVal");
+      if (session_val && fl_value_get_type(session_val) == FL_VALUE_TYPE_INT) {
+        session_id = fl_value_get_int(session_val);
+      }
+      if (search_val && fl_value_get_type(search_val) == FL_VALUE_TYPE_STRING) {
+        search = fl_value_get_string(search_val);
+      }
+    }
+
+    auto& session = (*self->search_sessions)[session_id];
+    if (!session) {
+      session = std::make_shared<SearchSession>(self->db_manager);
+    }
+
+    //the previous keystroke's search stops and answers null, this one is
+    //answered from the search thread
+    uint64_t generation = session->Supersede();
+    SearchQuery* query = new SearchQuery(self->db_manager, session, search, generation);
+    FlMethodCall* call = FL_METHOD_CALL(g_object_ref(method_call));
+    self->search_pool->Submit([query, call]() {
+      SearchDoneEvent* event = new SearchDoneEvent{call, query->Execute()};
+      delete query;
+      g_idle_add(search_done_idle_cb, event);
+    });
+    return;
+  } else if (strcmp(method, "closeSearchSession") == 0) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    int64_t session_id = 0;
+
+    if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      FlValue* session_val = fl_value_lookup_string(args, "sessionId");
+      if (session_val && fl_value_get_type(session_val) == FL_VALUE_TYPE_INT) {
+        session_id = fl_value_get_int(session_val);
+      }
+    }
+
+    auto it = self->search_sessions->find(session_id);
+    bool closed = it != self->search_sessions->end();
+    if (closed) {
+      it->second->Supersede();
+      self->search_sessions->erase(it);
+    }
+
+    g_autoptr(FlValue) result = fl_value_new_bool(closed);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
   } else if (strcmp(method, "queryFromFolder") == 0) {
     FlValue* args = fl_method_call_get_args(method_call);
     std::string path = "";
@@ -190,22 +342,89 @@ static void on_audio_query_linux_plugin_handle_method_call(
     int64_t id = 0;
     int type = 0;
     std::string format = "jpeg";
+    int size = 200;
+    int quality = 50;
 
     if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
       FlValue* id_val = fl_value_lookup_string(args, "id");
       FlValue* type_val = fl_value_lookup_string(args, "type");
       FlValue* format_val = fl_value_lookup_string(args, "format");
+      FlValue* size_val = fl_value_lookup_string(args, "size");
+      FlValue* quality_val = fl_value_lookup_string(args, "quality");
 
       if (id_val) id = fl_value_get_int(id_val);
       if (type_val) type = fl_value_get_int(type_val);
-      if (format_val && fl_value_get_type(format_val) == FL_VALUE_TYPE_STRING) {
+      //Dart sends the ArtworkFormat index (0 = JPEG, 1 = PNG)
+      if (format_val && fl_value_get_type(format_val) == FL_VALUE_TYPE_INT) {
+        format = fl_value_get_int(format_val) == 1 ? "png" : "jpeg";
+      } else if (format_val && fl_value_get_type(format_val) == FL_VALUE_TYPE_STRING) {
         format = fl_value_get_string(format_val);
       }
+      if (size_val && fl_value_get_type(size_val) == FL_VALUE_TYPE_INT) {
+        size = static_cast<int>(fl_value_get_int(size_val));
+      }
+      if (quality_val && fl_value_get_type(quality_val) == FL_VALUE_TYPE_INT) {
+        quality = static_cast<int>(fl_value_get_int(quality_val));
+      }
     }
 
-    ArtworkQuery query(self->db_manager, self->ffprobe, id, type, format);
+    ArtworkQuery query(self->db_manager, self->ffprobe, self->cover_resolver,
+                       self->artwork_store, self->thumbnails, id, type, format, size, quality);
     FlValue* result = query.Execute();
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "queryArtworks") == 0) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    int64_t request_id = 0;
+    std::vector<int64_t> ids;
+    int type = 0;
+    std::string format = "jpeg";
+    int size = 200;
+    int quality = 50;
+
+    if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      FlValue* request_id_val = fl_value_lookup_string(args, "requestId");
+      FlValue* ids_val = fl_value_lookup_string(args, "ids");
+      FlValue* type_val = fl_value_lookup_string(args, "type");
+      FlValue* format_val = fl_value_lookup_string(args, "format");
+      FlValue* size_val = fl_value_lookup_string(args, "size");
+      FlValue* quality_val = fl_value_lookup_string(args, "quality");
+
+      if (request_id_val) request_id = fl_value_get_int(request_id_val);
+      if (ids_val && fl_value_get_type(ids_val) == FL_VALUE_TYPE_LIST) {
+        for (size_t i = 0; i < fl_value_get_length(ids_val); i++) {
+          FlValue* item = fl_value_get_list_value(ids_val, i);
+          if (fl_value_get_type(item) == FL_VALUE_TYPE_INT) {
+            ids.push_back(fl_value_get_int(item));
+          }
+        }
+      } else if (ids_val && fl_value_get_type(ids_val) == FL_VALUE_TYPE_INT64_LIST) {
+        const int64_t* values = fl_value_get_int64_list(ids_val);
+        ids.assign(values, values + fl_value_get_length(ids_val));
+      }
+      if (type_val) type = fl_value_get_int(type_val);
+      if (format_val && fl_value_get_type(format_val) == FL_VALUE_TYPE_INT) {
+        format = fl_value_get_int(format_val) == 1 ? "png" : "jpeg";
+      } else if (format_val && fl_value_get_type(format_val) == FL_VALUE_TYPE_STRING) {
+        format = fl_value_get_string(format_val);
+      }
+      if (size_val && fl_value_get_type(size_val) == FL_VALUE_TYPE_INT) {
+        size = static_cast<int>(fl_value_get_int(size_val));
+      }
+      if (quality_val && fl_value_get_type(quality_val) == FL_VALUE_TYPE_INT) {
+        quality = static_cast<int>(fl_value_get_int(quality_val));
+      }
+    }
+
+    //cache hits come back in the reply, extracted artworks as "onArtwork" events
+    ArtworkBatchQuery query(self->db_manager, self->ffprobe, self->cover_resolver,
+                            self->artwork_store, self->thumbnails, self->artwork_pool, ids, type,
+                            format, size, quality, [self, request_id](int64_t id, FlValue* artwork) {
+      ArtworkReadyEvent* event = new ArtworkReadyEvent{
+        ON_AUDIO_QUERY_LINUX_PLUGIN(g_object_ref(self)), request_id, id, artwork};
+      g_idle_add(artwork_ready_idle_cb, event);
+    });
+    g_autoptr(FlValue) result = query.Execute();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
   } else if (strcmp(method, "scanMedia") == 0) {
     // Trigger incremental scan in background
     FileScanner scanner;
@@ -214,6 +433,97 @@ static void on_audio_query_linux_plugin_handle_method_call(
 
     g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "setScanOptions") == 0) {
+    FlValue* args = fl_method_call_get_args(method_call);
+
+    if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      FlValue* fast_first_val = fl_value_lookup_string(args, "fastFirstScan");
+      if (fast_first_val && fl_value_get_type(fast_first_val) == FL_VALUE_TYPE_BOOL) {
+        self->scan_coordinator->SetFastFirstScan(fl_value_get_bool(fast_first_val));
+      }
+      FlValue* timeout_val = fl_value_lookup_string(args, "extractorTimeoutMs");
+      if (timeout_val && fl_value_get_type(timeout_val) == FL_VALUE_TYPE_INT) {
+        self->ffprobe->SetProcessTimeout(fl_value_get_int(timeout_val));
+      }
+
+      //scan-time artwork indexing (thumbnails use queryArtwork's JPEG/50 defaults)
+      ScanCoordinator::ArtworkScanOptions artwork_options = self->scan_coordinator->GetArtworkScan();
+      FlValue* index_artwork_val = fl_value_lookup_string(args, "indexArtwork");
+      if (index_artwork_val && fl_value_get_type(index_artwork_val) == FL_VALUE_TYPE_BOOL) {
+        artwork_options.enabled = fl_value_get_bool(index_artwork_val);
+      }
+      FlValue* thumbnail_size_val = fl_value_lookup_string(args, "artworkThumbnailSize");
+      if (thumbnail_size_val && fl_value_get_type(thumbnail_size_val) == FL_VALUE_TYPE_INT) {
+        artwork_options.thumbnail_size = static_cast<int>(fl_value_get_int(thumbnail_size_val));
+      }
+      self->scan_coordinator->SetArtworkScan(artwork_options);
+    }
+
+    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "setArtworkOptions") == 0) {
+    FlValue* args = fl_method_call_get_args(method_call);
+
+    if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      //ordered sidecar names, an empty list disables folder covers
+      FlValue* names_val = fl_value_lookup_string(args, "coverFileNames");
+      if (names_val && fl_value_get_type(names_val) == FL_VALUE_TYPE_LIST) {
+        std::vector<std::string> names;
+        for (size_t i = 0; i < fl_value_get_length(names_val); ++i) {
+          FlValue* name_val = fl_value_get_list_value(names_val, i);
+          if (fl_value_get_type(name_val) == FL_VALUE_TYPE_STRING) {
+            names.push_back(fl_value_get_string(name_val));
+          }
+        }
+        self->cover_resolver->SetFileNames(names);
+      }
+      FlValue* budget_val = fl_value_lookup_string(args, "cacheMaxBytes");
+      if (budget_val && fl_value_get_type(budget_val) == FL_VALUE_TYPE_INT) {
+        self->artwork_store->SetBudget(fl_value_get_int(budget_val));
+      }
+      FlValue* shared_val = fl_value_lookup_string(args, "systemThumbnails");
+      if (shared_val && fl_value_get_type(shared_val) == FL_VALUE_TYPE_BOOL) {
+        self->thumbnails->SetEnabled(fl_value_get_bool(shared_val));
+      }
+    }
+
+    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "queryScanStats") == 0) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    bool as_json = false;
+
+    if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      FlValue* as_json_val = fl_value_lookup_string(args, "asJson");
+      if (as_json_val && fl_value_get_type(as_json_val) == FL_VALUE_TYPE_BOOL) {
+        as_json = fl_value_get_bool(as_json_val);
+      }
+    }
+
+    ScanStatsQuery query(self->db_manager, self->scan_coordinator, as_json);
+    FlValue* result = query.Execute();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "queryQuarantinedFiles") == 0) {
+    QuarantineQuery query(self->db_manager);
+    FlValue* result = query.Execute();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "clearQuarantine") == 0) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    bool success = false;
+
+    //with a path => only that file, without => everything
+    FlValue* path_val = nullptr;
+    if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      path_val = fl_value_lookup_string(args, "path");
+    }
+    if (path_val && fl_value_get_type(path_val) == FL_VALUE_TYPE_STRING) {
+      success = self->db_manager->RemoveFromQuarantine(fl_value_get_string(path_val));
+    } else {
+      success = self->db_manager->ClearQuarantine();
+    }
+
+    g_autoptr(FlValue) result = fl_value_new_bool(success);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
   }
   // Playlist methods
   else if (strcmp(method, "createPlaylist") == 0) {
@@ -327,7 +637,25 @@ static void on_audio_query_linux_plugin_dispose(GObject* object) {
 
   // Cleanup
   delete self->scan_coordinator;
+  self->scan_coordinator = nullptr;
+  //queued searches return at once once superseded
+  if (self->search_sessions) {
+    for (auto& entry : *self->search_sessions) {
+      entry.second->Supersede();
+    }
+  }
+  delete self->search_pool;
+  self->search_pool = nullptr;
+  delete self->search_sessions;
+  self->search_sessions = nullptr;
+  g_clear_object(&self->channel);
+  //pending extractions finish before the stores they write to go away
+  delete self->artwork_pool;
+  self->artwork_pool = nullptr;
   delete self->thread_pool;
+  delete self->artwork_store;
+  delete self->thumbnails;
+  delete self->cover_resolver;
   delete self->ffprobe;
   delete self->db_manager;
 
@@ -343,13 +671,18 @@ static void on_audio_query_linux_plugin_init(OnAudioQueryLinuxPlugin* self) {
 
   // Setup database path
   const char* home = getenv("HOME");
-  std::string db_path = std::string(home ? home : "/tmp") + "/.local/share/on_audio_query/metadata.db";
+  std::string data_dir = std::string(home ? home : "/tmp") + "/.local/share/on_audio_query";
+  std::string db_path = data_dir + "/metadata.db";
 
   // Initialize core components
   self->db_manager = new DatabaseManager(db_path);
   self->db_manager->Initialize();
 
   self->ffprobe = new FFprobeExtractor();
+  self->cover_resolver = new CoverResolver();
+  self->artwork_store = new ArtworkStore(self->db_manager, data_dir + "/artwork");
+  self->artwork_store->Initialize();
+  self->thumbnails = new FreedesktopThumbnails();
   self->thread_pool = new ThreadPool(std::thread::hardware_concurrency());
   self->scan_coordinator = new ScanCoordinator(
     self->db_manager,
@@ -357,6 +690,21 @@ static void on_audio_query_linux_plugin_init(OnAudioQueryLinuxPlugin* self) {
     self->thread_pool
   );
 
+  self->scan_coordinator->SetArtworkStore(self->artwork_store, self->cover_resolver);
+
+  self->search_sessions = new std::map<int64_t, std::shared_ptr<SearchSession>>();
+  self->search_pool = new ThreadPool(1);
+  //a visible grid is a few dozen covers, two threads keep decoding off the scan cores
+  self->artwork_pool = new ThreadPool(2);
+
+  // Forward song row changes (e.g. fast-first enrichment) to Dart
+  self->channel = nullptr;
+  self->scan_coordinator->SetSongsChangedCallback([self](const std::vector<int64_t>& song_ids) {
+    SongsChangedEvent* event = new SongsChangedEvent{
+      ON_AUDIO_QUERY_LINUX_PLUGIN(g_object_ref(self)), song_ids};
+    g_idle_add(songs_changed_idle_cb, event);
+  });
+
   // Check if initial scan is needed (database empty)
   if (self->db_manager->IsDatabaseEmpty()) {
     std::cout << "[Plugin] Database empty - starting initial scan in background..." << std::endl;
@@ -387,6 +735,7 @@ void on_audio_query_linux_plugin_register_with_registrar(FlPluginRegistrar* regi
   fl_method_channel_set_method_call_handler(channel, method_call_cb,
                                            g_object_ref(plugin),
                                            g_object_unref);
+  plugin->channel = FL_METHOD_CHANNEL(g_object_ref(channel));
 
   g_object_unref(plugin);
 }
@@ -20,6 +20,8 @@ FlValue* AlbumQuery::Execute() {
     fl_value_append_take(result_list, album_map);
   }
 
+  AddArtworkPlaceholders(result_list, 1);
+
   std::cout << "[AlbumQuery] Returning " << albums.size() << " albums" << std::endl;
 
   return result_list;
@@ -0,0 +1,73 @@
+#include "artwork_batch_query.h"
+#include <iostream>
+#include <unordered_set>
+
+namespace on_audio_query_linux {
+
+ArtworkBatchQuery::ArtworkBatchQuery(DatabaseManager* db_manager, FFprobeExtractor* ffprobe,
+                                     CoverResolver* cover_resolver, ArtworkStore* artwork_store,
+                                     FreedesktopThumbnails* thumbnails, ThreadPool* thread_pool,
+                                     const std::vector<int64_t>& ids, int type,
+                                     const std::string& format, int size, int quality,
+                                     ArtworkCallback on_artwork)
+    : BaseQuery(db_manager), ffprobe_(ffprobe), cover_resolver_(cover_resolver),
+      artwork_store_(artwork_store), thumbnails_(thumbnails), thread_pool_(thread_pool),
+      ids_(ids), type_(type), format_(format), size_(size), quality_(quality), on_artwork_(std::move(on_artwork)) {}
+
+ArtworkBatchQuery::~ArtworkBatchQuery() {}
+
+FlValue* ArtworkBatchQuery::Execute() {
+  std::cout << "[ArtworkBatchQuery] Query started - " << ids_.size() << " IDs, Type: " << type_
+            << ", Format: " << format_ << ", Size: " << size_ << std::endl;
+
+  FlValue* artworks = fl_value_new_map();
+  auto sources = db_manager_->GetArtworkSources(type_, ids_);
+
+  //ids keep their order => the pool works through the first tiles first
+  std::unordered_set<int64_t> seen;
+  std::vector<std::pair<int64_t, ArtworkSource>> misses;
+  for (int64_t id : ids_) {
+    if (!seen.insert(id).second) {
+      continue;
+    }
+
+    auto source = sources.find(id);
+    if (source == sources.end()) {
+      fl_value_set_take(artworks, fl_value_new_int(id), fl_value_new_null());
+      continue;
+    }
+
+    bool needs_extraction = false;
+    ArtworkQuery query(db_manager_, ffprobe_, cover_resolver_, artwork_store_, thumbnails_, id,
+                       type_, format_, size_, quality_);
+    FlValue* cached = query.Resolve(source->second, true, &needs_extraction);
+    if (needs_extraction) {
+      misses.emplace_back(id, source->second);
+    } else {
+      fl_value_set_take(artworks, fl_value_new_int(id),
+                        cached ? cached : fl_value_new_null());
+    }
+  }
+
+  for (const auto& miss : misses) {
+    thread_pool_->Submit([db_manager = db_manager_, ffprobe = ffprobe_,
+                          cover_resolver = cover_resolver_, artwork_store = artwork_store_,
+                          thumbnails = thumbnails_, type = type_, format = format_,
+                          size = size_, quality = quality_, on_artwork = on_artwork_, id = miss.first, source = miss.second]() {
+      ArtworkQuery query(db_manager, ffprobe, cover_resolver, artwork_store, thumbnails, id, type,
+                         format, size, quality);
+      on_artwork(id, query.Resolve(source));
+    });
+  }
+  int64_t pending = static_cast<int64_t>(misses.size());
+
+  std::cout << "[ArtworkBatchQuery] " << fl_value_get_length(artworks) << " resolved, "
+            << pending << " extracting" << std::endl;
+
+  FlValue* result = fl_value_new_map();
+  fl_value_set_string_take(result, "artworks", artworks);
+  fl_value_set_string_take(result, "pending", fl_value_new_int(pending));
+  return result;
+}
+
+}  // namespace on_audio_query_linux
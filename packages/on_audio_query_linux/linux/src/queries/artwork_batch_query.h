@@ -0,0 +1,50 @@
+#ifndef ARTWORK_BATCH_QUERY_H_
+#define ARTWORK_BATCH_QUERY_H_
+
+#include <functional>
+#include <vector>
+#include "artwork_query.h"
+#include "../core/thread_pool.h"
+
+namespace on_audio_query_linux {
+
+/// Artworks of many songs/albums (e.g. a grid) in one call.
+///
+/// Sources are looked up with a single query and cached renditions are
+/// returned together by Execute(). Misses are extracted in parallel on
+/// `thread_pool` and handed to the callback one by one as they complete.
+/// The plugin passes a pool reserved for artwork: on the shared scan pool a
+/// miss would wait for every scan batch queued ahead of it.
+class ArtworkBatchQuery : public BaseQuery {
+ public:
+  /// Called from a pool thread, takes ownership of `artwork` (nullptr => none)
+  using ArtworkCallback = std::function<void(int64_t id, FlValue* artwork)>;
+
+  ArtworkBatchQuery(DatabaseManager* db_manager, FFprobeExtractor* ffprobe,
+                    CoverResolver* cover_resolver, ArtworkStore* artwork_store,
+                    FreedesktopThumbnails* thumbnails, ThreadPool* thread_pool,
+                    const std::vector<int64_t>& ids, int type,
+                    const std::string& format, int size, int quality,
+                    ArtworkCallback on_artwork);
+  ~ArtworkBatchQuery();
+
+  /// {"artworks": {id: bytes or null}, "pending": number of ids sent to the callback}
+  FlValue* Execute() override;
+
+ private:
+  FFprobeExtractor* ffprobe_;
+  CoverResolver* cover_resolver_;
+  ArtworkStore* artwork_store_;
+  FreedesktopThumbnails* thumbnails_;
+  ThreadPool* thread_pool_;
+  std::vector<int64_t> ids_;
+  int type_;
+  std::string format_;
+  int size_;
+  int quality_;
+  ArtworkCallback on_artwork_;
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // ARTWORK_BATCH_QUERY_H_
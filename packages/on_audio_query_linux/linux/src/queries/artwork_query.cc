@@ -4,61 +4,177 @@
 namespace on_audio_query_linux {
 
 ArtworkQuery::ArtworkQuery(DatabaseManager* db_manager, FFprobeExtractor* ffprobe,
-                           int64_t id, int type, const std::string& format)
-    : BaseQuery(db_manager), ffprobe_(ffprobe), id_(id), type_(type), format_(format) {}
+                           CoverResolver* cover_resolver, ArtworkStore* artwork_store,
+                           FreedesktopThumbnails* thumbnails,
+                           int64_t id, int type, const std::string& format,
+                           int size, int quality)
+    : BaseQuery(db_manager), ffprobe_(ffprobe), cover_resolver_(cover_resolver),
+      artwork_store_(artwork_store), thumbnails_(thumbnails),
+      id_(id), type_(type), format_(format), size_(size), quality_(quality) {}
 
 ArtworkQuery::~ArtworkQuery() {}
 
 FlValue* ArtworkQuery::Execute() {
-  std::cout << "[ArtworkQuery] Query started - ID: " << id_ << ", Type: " << type_ << ", Format: " << format_ << std::endl;
+  std::cout << "[ArtworkQuery] Query started - ID: " << id_ << ", Type: " << type_ << ", Format: " << format_
+            << ", Size: " << size_ << std::endl;
 
-  /// Check database cache first
-  auto cached = db_manager_->GetCachedArtwork(id_, type_, format_);
+  //AUDIO, ALBUM, ARTIST, GENRE (playlists have no artwork source)
+  if (type_ != 0 && type_ != 1 && type_ != 3 && type_ != 4) {
+    std::cerr << "[ArtworkQuery] Unknown type: " << type_ << std::endl;
+    return nullptr;
+  }
+
+  /// Find the file path from database (album/artist/genre => its representative song)
+  auto sources = db_manager_->GetArtworkSources(type_, {id_});
+  auto source = sources.find(id_);
+  if (source == sources.end()) {
+    std::cerr << "[ArtworkQuery] No song found for type " << type_ << " ID: " << id_ << std::endl;
+    return nullptr;
+  }
+
+  return Resolve(source->second);
+}
+
+FlValue* ArtworkQuery::Resolve(const ArtworkSource& source, bool cached_only,
+                               bool* needs_extraction) {
+  const std::string& file_path = source.file_path;
+  int64_t file_mtime = source.file_mtime;
+
+  /// Folder cover (cover.jpg, folder.png, ...) wins over embedded art
+  std::optional<CoverFile> cover;
+  if (cover_resolver_) {
+    cover = cover_resolver_->Resolve(file_path);
+  }
+
+  ArtworkCacheKey key;
+  key.id = id_;
+  key.type = type_;
+  key.format = format_;
+  key.size = size_;
+  key.quality = quality_;
+  key.source = cover.has_value() ? cover->path : file_path;
+  key.source_mtime = cover.has_value() ? cover->mtime : file_mtime;
+
+  /// Check artwork store (thumbnail of an unchanged source, mapped without copying)
+  auto cached = artwork_store_->Lookup(key);
   if (cached.has_value()) {
     std::cout << "[ArtworkQuery] Using cached artwork (" << cached->size() << " bytes)" << std::endl;
     return fl_value_new_uint8_list(cached->data(), cached->size());
   }
 
-  /// Find the file path from database
-  std::string file_path;
-  if (type_ == 0) {  // AUDIO type => query by song ID
-    auto song = db_manager_->GetSongById(id_);
-    if (!song.has_value()) {
-      std::cerr << "[ArtworkQuery] Song not found for ID: " << id_ << std::endl;
-      return nullptr;
+  if (cached_only) {
+    if (needs_extraction) {
+      *needs_extraction = true;
     }
-    file_path = song->data;  //data field contains file path
-  } else if (type_ == 1) {  //ALBUM type => query by album ID
-    //get first song from album
-    QueryParams params;
-    params.album_filter = id_;
-    auto songs = db_manager_->QuerySongs(params);
-    if (songs.empty()) {
-      std::cerr << "[ArtworkQuery] No songs found for album ID: " << id_ << std::endl;
+    return nullptr;
+  }
+
+  std::string source_hash;
+  bool rendition_checked = false;
+
+  /// Picture located and hashed by a scan => a lookup, not an extraction
+  std::optional<SongArtwork> indexed;
+  if (!cover.has_value()) {
+    indexed = db_manager_->GetSongArtwork(file_path, file_mtime);
+    if (indexed.has_value() && !indexed->has_picture) {
+      std::cout << "[ArtworkQuery] No artwork found (indexed)" << std::endl;
       return nullptr;
     }
-    file_path = songs[0].data;  //data field contains file path
-  } else {
-    std::cerr << "[ArtworkQuery] Unknown type: " << type_ << std::endl;
-    return nullptr;
+    if (indexed.has_value()) {
+      source_hash = indexed->hash;
+      rendition_checked = true;
+      auto stored = artwork_store_->LookupRendition(key, source_hash);
+      if (stored.has_value()) {
+        std::cout << "[ArtworkQuery] Reusing stored artwork (" << stored->size() << " bytes)" << std::endl;
+        return fl_value_new_uint8_list(stored->data(), stored->size());
+      }
+    }
+  }
+
+  /// Thumbnail another desktop app already made (freedesktop.org cache)
+  std::optional<ArtworkBytes> artwork;
+  bool shared_thumbnail = false;
+  if (thumbnails_ && size_ > 0) {
+    auto shared = thumbnails_->Lookup(key.source, key.source_mtime, size_);
+    if (shared.has_value()) {
+      std::cout << "[ArtworkQuery] Using shared thumbnail of: " << key.source << std::endl;
+      artwork.emplace(std::move(*shared));
+      shared_thumbnail = true;
+      source_hash.clear();
+      rendition_checked = false;
+    }
+  }
+
+  if (!artwork.has_value() && cover.has_value()) {
+    auto region = MappedRegion::Map(cover->path, 0, static_cast<size_t>(cover->size));
+    if (region.has_value() && region->size() > 0) {
+      std::cout << "[ArtworkQuery] Using folder cover: " << cover->path << std::endl;
+      artwork.emplace(std::move(*region));
+    }
   }
 
-  std::cout << "[ArtworkQuery] Extracting artwork from: " << file_path << std::endl;
+  if (!artwork.has_value() && indexed.has_value() && indexed->raw) {
+    auto region = MappedRegion::Map(file_path, static_cast<uint64_t>(indexed->offset),
+                                    static_cast<size_t>(indexed->length));
+    if (region.has_value() && region->size() == static_cast<size_t>(indexed->length)) {
+      artwork.emplace(std::move(*region));
+    }
+  }
 
-  /// Extract artwork using FFprobe
-  auto artwork = ffprobe_->ExtractArtwork(file_path, format_);
+  if (!artwork.has_value()) {
+    /// Extract embedded artwork (mapped from the file when stored as is)
+    std::cout << "[ArtworkQuery] Extracting artwork from: " << file_path << std::endl;
+    artwork = ffprobe_->ExtractArtwork(file_path, format_);
+    key.source = file_path;
+    key.source_mtime = file_mtime;
+    source_hash.clear();
+    rendition_checked = false;
+  }
 
   if (!artwork.has_value() || artwork->empty()) {
     std::cout << "[ArtworkQuery] No artwork found" << std::endl;
     return nullptr;
   }
 
-  /// Cache extracted artwork in database
-  db_manager_->CacheArtwork(id_, type_, format_, artwork.value());
+  /// Same image already rendered for another track/album (shared album art)
+  if (source_hash.empty()) {
+    source_hash = Md5::HexDigest(artwork->data(), artwork->size());
+  }
+
+  /// Colours/blurhash returned with song and album results, once per image
+  if (!db_manager_->HasArtworkPlaceholder(source_hash)) {
+    auto placeholder = PlaceholderGenerator::Generate(artwork->data(), artwork->size());
+    if (placeholder.has_value()) {
+      db_manager_->SetArtworkPlaceholder(source_hash, placeholder.value());
+    }
+  }
+  if (!rendition_checked) {
+    auto stored = artwork_store_->LookupRendition(key, source_hash);
+    if (stored.has_value()) {
+      std::cout << "[ArtworkQuery] Reusing stored artwork (" << stored->size() << " bytes)" << std::endl;
+      return fl_value_new_uint8_list(stored->data(), stored->size());
+    }
+  }
+
+  /// Shrink to the requested size (nullopt => original is already fine)
+  auto thumbnail = size_ > 0
+      ? ThumbnailGenerator::Generate(artwork->data(), artwork->size(), size_, format_, quality_)
+      : std::nullopt;
+  const uint8_t* data = thumbnail.has_value() ? thumbnail->data() : artwork->data();
+  size_t length = thumbnail.has_value() ? thumbnail->size() : artwork->size();
+
+  /// Store the rendition once per content hash and map this song/album to it
+  artwork_store_->Store(key, source_hash, data, length);
+
+  /// Share what we extracted with file managers and other apps
+  if (thumbnails_ && !shared_thumbnail && size_ > 0) {
+    thumbnails_->Save(key.source, key.source_mtime, size_, artwork->data(), artwork->size());
+  }
 
-  std::cout << "[ArtworkQuery] Found artwork: " << artwork->size() << " bytes (cached)" << std::endl;
+  std::cout << "[ArtworkQuery] Found artwork: " << artwork->size() << " bytes, sending "
+            << length << " bytes (cached)" << std::endl;
 
-  return fl_value_new_uint8_list(artwork->data(), artwork->size());
+  return fl_value_new_uint8_list(data, length);
 }
 
 }  // namespace on_audio_query_linux
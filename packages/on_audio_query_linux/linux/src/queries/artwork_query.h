@@ -3,22 +3,40 @@
 
 #include "base_query.h"
 #include "../core/ffprobe_extractor.h"
+#include "../core/cover_resolver.h"
+#include "../core/thumbnail_generator.h"
+#include "../core/placeholder_generator.h"
+#include "../core/artwork_store.h"
+#include "../core/freedesktop_thumbnails.h"
+#include "../utils/md5.h"
 
 namespace on_audio_query_linux {
 
 class ArtworkQuery : public BaseQuery {
  public:
   ArtworkQuery(DatabaseManager* db_manager, FFprobeExtractor* ffprobe,
-               int64_t id, int type, const std::string& format);
+               CoverResolver* cover_resolver, ArtworkStore* artwork_store,
+               FreedesktopThumbnails* thumbnails, int64_t id, int type, const std::string& format,
+               int size, int quality);
   ~ArtworkQuery();
 
   FlValue* Execute() override;
 
+  /// Artwork of an already known source file. With `cached_only` nothing is
+  /// extracted: a miss returns nullptr and sets `*needs_extraction`.
+  FlValue* Resolve(const ArtworkSource& source, bool cached_only = false,
+                   bool* needs_extraction = nullptr);
+
  private:
   FFprobeExtractor* ffprobe_;
+  CoverResolver* cover_resolver_;  //nullptr => embedded art only
+  ArtworkStore* artwork_store_;
+  FreedesktopThumbnails* thumbnails_;  //nullptr => no shared thumbnails
   int64_t id_;
   int type_;  //0 = AUDIO, 1 = ALBUM
-  std::string format_;
+  std::string format_;  //"jpeg" or "png"
+  int size_;            //max width/height, 0 = original image
+  int quality_;         //JPEG quality (1-100)
 };
 
 }  // namespace on_audio_query_linux
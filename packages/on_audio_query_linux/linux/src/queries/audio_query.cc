@@ -22,6 +22,8 @@ FlValue* AudioQuery::Execute() {
     fl_value_append_take(result_list, song_map);
   }
 
+  AddArtworkPlaceholders(result_list, 0);
+
   std::cout << "[AudioQuery] Returning " << songs.size() << " songs" << std::endl;
 
   return result_list;
@@ -41,6 +41,8 @@ FlValue* AudiosFromQuery::Execute() {
     fl_value_append_take(result_list, song_map);
   }
 
+  AddArtworkPlaceholders(result_list, 0);
+
   std::cout << "[AudiosFromQuery] Returning " << songs.size() << " songs" << std::endl;
 
   return result_list;
@@ -91,6 +93,8 @@ FlValue* AudiosFromQuery::ExecuteSplitArtistQuery() {
     }
   }
 
+  AddArtworkPlaceholders(result_list, 0);
+
   std::cout << "[AudiosFromQuery] Found " << seen_song_ids.size()
             << " songs for split artist: " << artist_name << std::endl;
 
@@ -48,6 +48,29 @@ FlValue* BaseQuery::SongToFlValue(const SongMetadata& song) {
                           fl_value_new_string(song.file_extension.c_str()));
   fl_value_set_string_take(song_map, "is_music",
                           fl_value_new_bool(song.is_music));
+  fl_value_set_string_take(song_map, "disc_number",
+                          fl_value_new_int(song.disc));
+
+  //same as Android: missing tags are null rather than ""
+  fl_value_set_string_take(song_map, "album_artist",
+                          song.album_artist.empty() ? fl_value_new_null()
+                                                    : fl_value_new_string(song.album_artist.c_str()));
+  fl_value_set_string_take(song_map, "composer",
+                          song.composer.empty() ? fl_value_new_null()
+                                                : fl_value_new_string(song.composer.c_str()));
+
+  /// Stream properties (0/null = unknown)
+  fl_value_set_string_take(song_map, "bitrate",
+                          fl_value_new_int(song.bitrate));
+  fl_value_set_string_take(song_map, "sample_rate",
+                          fl_value_new_int(song.sample_rate));
+  fl_value_set_string_take(song_map, "bit_depth",
+                          fl_value_new_int(song.bit_depth));
+  fl_value_set_string_take(song_map, "channels",
+                          fl_value_new_int(song.channels));
+  fl_value_set_string_take(song_map, "codec",
+                          song.codec.empty() ? fl_value_new_null()
+                                             : fl_value_new_string(song.codec.c_str()));
 
   return song_map;
 }
@@ -120,4 +143,51 @@ FlValue* BaseQuery::PlaylistToFlValue(const PlaylistData& playlist) {
   return playlist_map;
 }
 
+void BaseQuery::AddArtworkPlaceholders(FlValue* result_list, int type) {
+  size_t length = fl_value_get_length(result_list);
+  if (length == 0) {
+    return;
+  }
+
+  auto id_of = [](FlValue* item) -> std::optional<int64_t> {
+    FlValue* id = fl_value_lookup_string(item, "_id");
+    if (!id || fl_value_get_type(id) != FL_VALUE_TYPE_INT) {
+      return std::nullopt;
+    }
+    return fl_value_get_int(id);
+  };
+
+  std::vector<int64_t> ids;
+  ids.reserve(length);
+  for (size_t i = 0; i < length; ++i) {
+    auto id = id_of(fl_value_get_list_value(result_list, i));
+    if (id.has_value()) {
+      ids.push_back(id.value());
+    }
+  }
+
+  /// One batched lookup for the whole list
+  auto placeholders = db_manager_->GetArtworkPlaceholders(type, ids);
+
+  for (size_t i = 0; i < length; ++i) {
+    FlValue* item = fl_value_get_list_value(result_list, i);
+    auto id = id_of(item);
+    auto placeholder = id.has_value() ? placeholders.find(id.value()) : placeholders.end();
+    if (placeholder == placeholders.end()) {
+      fl_value_set_string_take(item, "artwork_colors", fl_value_new_null());
+      fl_value_set_string_take(item, "artwork_blurhash", fl_value_new_null());
+      continue;
+    }
+
+    //opaque ARGB => usable as a Flutter Color value directly
+    FlValue* colors = fl_value_new_list();
+    for (uint32_t color : placeholder->second.colors) {
+      fl_value_append_take(colors, fl_value_new_int(static_cast<int64_t>(0xFF000000u | color)));
+    }
+    fl_value_set_string_take(item, "artwork_colors", colors);
+    fl_value_set_string_take(item, "artwork_blurhash",
+                            fl_value_new_string(placeholder->second.blurhash.c_str()));
+  }
+}
+
 }  // namespace on_audio_query_linux
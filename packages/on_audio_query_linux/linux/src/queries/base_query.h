@@ -22,6 +22,10 @@ class BaseQuery {
   FlValue* ArtistToFlValue(const ArtistData& artist);
   FlValue* GenreToFlValue(const GenreData& genre);
   FlValue* PlaylistToFlValue(const PlaylistData& playlist);
+
+  /// Add "artwork_colors" (ARGB ints) and "artwork_blurhash" to the song
+  /// (type 0) or album (type 1) maps of a result list, null when unknown
+  void AddArtworkPlaceholders(FlValue* result_list, int type);
 };
 
 }  // namespace on_audio_query_linux
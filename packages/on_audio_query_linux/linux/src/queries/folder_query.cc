@@ -23,6 +23,8 @@ FlValue* FolderQuery::Execute() {
     fl_value_append_take(result_list, song_map);
   }
 
+  AddArtworkPlaceholders(result_list, 0);
+
   std::cout << "[FolderQuery] Found " << songs.size() << " songs in folder" << std::endl;
 
   return result_list;
@@ -0,0 +1,32 @@
+#include "quarantine_query.h"
+#include <iostream>
+
+namespace on_audio_query_linux {
+
+QuarantineQuery::QuarantineQuery(DatabaseManager* db_manager)
+    : BaseQuery(db_manager) {}
+
+QuarantineQuery::~QuarantineQuery() {}
+
+FlValue* QuarantineQuery::Execute() {
+  std::cout << "[QuarantineQuery] Starting query..." << std::endl;
+
+  auto entries = db_manager_->GetQuarantinedFiles();
+
+  FlValue* result_list = fl_value_new_list();
+
+  for (const auto& entry : entries) {
+    FlValue* entry_map = fl_value_new_map();
+    fl_value_set_string_take(entry_map, "_data", fl_value_new_string(entry.file_path.c_str()));
+    fl_value_set_string_take(entry_map, "reason", fl_value_new_string(entry.reason.c_str()));
+    fl_value_set_string_take(entry_map, "file_mtime", fl_value_new_int(entry.file_mtime));
+    fl_value_set_string_take(entry_map, "quarantined_at", fl_value_new_int(entry.quarantined_at));
+    fl_value_append_take(result_list, entry_map);
+  }
+
+  std::cout << "[QuarantineQuery] Query complete, returning " << entries.size() << " files" << std::endl;
+
+  return result_list;
+}
+
+}  // namespace on_audio_query_linux
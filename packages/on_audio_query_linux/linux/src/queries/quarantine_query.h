@@ -0,0 +1,19 @@
+#ifndef QUARANTINE_QUERY_H_
+#define QUARANTINE_QUERY_H_
+
+#include "base_query.h"
+
+namespace on_audio_query_linux {
+
+/// Lists files skipped by scans because the extractor hung or crashed
+class QuarantineQuery : public BaseQuery {
+ public:
+  explicit QuarantineQuery(DatabaseManager* db_manager);
+  ~QuarantineQuery();
+
+  FlValue* Execute() override;
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // QUARANTINE_QUERY_H_
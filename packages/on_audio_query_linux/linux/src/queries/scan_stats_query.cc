@@ -0,0 +1,55 @@
+#include "scan_stats_query.h"
+#include <iostream>
+
+namespace on_audio_query_linux {
+
+ScanStatsQuery::ScanStatsQuery(DatabaseManager* db_manager, ScanCoordinator* scan_coordinator,
+                               bool as_json)
+    : BaseQuery(db_manager), scan_coordinator_(scan_coordinator), as_json_(as_json) {}
+
+ScanStatsQuery::~ScanStatsQuery() {}
+
+FlValue* ScanStatsQuery::Execute() {
+  std::cout << "[ScanStatsQuery] Querying scan stats..." << std::endl;
+
+  auto stats = scan_coordinator_->GetScanStats();
+  stats["song_count"] = db_manager_->GetSongCount();
+
+  if (as_json_) {
+    return fl_value_new_string(stats.dump().c_str());
+  }
+
+  return JsonToFlValue(stats);
+}
+
+FlValue* ScanStatsQuery::JsonToFlValue(const nlohmann::json& value) {
+  switch (value.type()) {
+    case nlohmann::json::value_t::object: {
+      FlValue* map = fl_value_new_map();
+      for (auto it = value.begin(); it != value.end(); ++it) {
+        fl_value_set_string_take(map, it.key().c_str(), JsonToFlValue(it.value()));
+      }
+      return map;
+    }
+    case nlohmann::json::value_t::array: {
+      FlValue* list = fl_value_new_list();
+      for (const auto& item : value) {
+        fl_value_append_take(list, JsonToFlValue(item));
+      }
+      return list;
+    }
+    case nlohmann::json::value_t::string:
+      return fl_value_new_string(value.get<std::string>().c_str());
+    case nlohmann::json::value_t::boolean:
+      return fl_value_new_bool(value.get<bool>());
+    case nlohmann::json::value_t::number_integer:
+    case nlohmann::json::value_t::number_unsigned:
+      return fl_value_new_int(value.get<int64_t>());
+    case nlohmann::json::value_t::number_float:
+      return fl_value_new_float(value.get<double>());
+    default:
+      return fl_value_new_null();
+  }
+}
+
+}  // namespace on_audio_query_linux
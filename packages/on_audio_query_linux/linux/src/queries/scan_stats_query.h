@@ -0,0 +1,27 @@
+#ifndef SCAN_STATS_QUERY_H_
+#define SCAN_STATS_QUERY_H_
+
+#include "base_query.h"
+#include "../scanner/scan_coordinator.h"
+
+namespace on_audio_query_linux {
+
+class ScanStatsQuery : public BaseQuery {
+ public:
+  ScanStatsQuery(DatabaseManager* db_manager, ScanCoordinator* scan_coordinator,
+                 bool as_json);
+  ~ScanStatsQuery();
+
+  FlValue* Execute() override;
+
+ private:
+  ScanCoordinator* scan_coordinator_;
+  bool as_json_;  //true = JSON string, false = map
+
+  /// Convert a JSON value into the equivalent FlValue
+  FlValue* JsonToFlValue(const nlohmann::json& value);
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // SCAN_STATS_QUERY_H_
@@ -0,0 +1,37 @@
+#include "search_query.h"
+#include <iostream>
+
+namespace on_audio_query_linux {
+
+SearchQuery::SearchQuery(DatabaseManager* db_manager, std::shared_ptr<SearchSession> session,
+                         const std::string& search_term, uint64_t generation)
+    : BaseQuery(db_manager), session_(std::move(session)), search_term_(search_term),
+      generation_(generation) {}
+
+SearchQuery::~SearchQuery() {}
+
+FlValue* SearchQuery::Execute() {
+  auto songs = session_->Search(search_term_, generation_);
+  if (!songs) {
+    return nullptr;
+  }
+
+  FlValue* result_list = fl_value_new_list();
+
+  for (const auto& song : *songs) {
+    fl_value_append_take(result_list, SongToFlValue(song));
+    if (!session_->IsCurrent(generation_)) {
+      fl_value_unref(result_list);  //superseded while converting a large result
+      return nullptr;
+    }
+  }
+
+  AddArtworkPlaceholders(result_list, 0);
+
+  std::cout << "[SearchQuery] Found " << songs->size() << " results for: " << search_term_
+            << std::endl;
+
+  return result_list;
+}
+
+}  // namespace on_audio_query_linux
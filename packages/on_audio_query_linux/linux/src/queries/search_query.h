@@ -0,0 +1,28 @@
+#ifndef SEARCH_QUERY_H_
+#define SEARCH_QUERY_H_
+
+#include <memory>
+#include "base_query.h"
+#include "../core/search_session.h"
+
+namespace on_audio_query_linux {
+
+/// One keystroke of a search session (runs off the main thread)
+class SearchQuery : public BaseQuery {
+ public:
+  SearchQuery(DatabaseManager* db_manager, std::shared_ptr<SearchSession> session,
+              const std::string& search_term, uint64_t generation);
+  ~SearchQuery();
+
+  /// Song list, nullptr when a newer keystroke superseded this one
+  FlValue* Execute() override;
+
+ private:
+  std::shared_ptr<SearchSession> session_;
+  std::string search_term_;
+  uint64_t generation_;
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // SEARCH_QUERY_H_
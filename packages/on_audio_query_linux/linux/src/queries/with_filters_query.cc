@@ -23,6 +23,8 @@ FlValue* WithFiltersQuery::Execute() {
     fl_value_append_take(result_list, song_map);
   }
 
+  AddArtworkPlaceholders(result_list, 0);
+
   std::cout << "[WithFiltersQuery] Found " << songs.size() << " results" << std::endl;
 
   return result_list;
@@ -59,6 +59,7 @@ IncrementalScanner::ScanDelta IncrementalScanner::DetectChanges(
       //file no longer exists
       delta.deleted_file_ids.push_back(song.id);
       delta.deleted_file_paths.push_back(db_path);
+      delta.deleted_songs.push_back(song);
     }
   }
 
@@ -18,6 +18,7 @@ class IncrementalScanner {
     std::vector<std::string> modified_files;
     std::vector<int64_t> deleted_file_ids;
     std::vector<std::string> deleted_file_paths;
+    std::vector<SongMetadata> deleted_songs;  //rows as stored, for aggregate updates
   };
 
   /// Detect changes since last scan
@@ -1,6 +1,13 @@
 #include "scan_coordinator.h"
+#include "../core/thumbnail_generator.h"
+#include "../core/placeholder_generator.h"
+#include "../utils/md5.h"
 #include <iostream>
 #include <thread>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
+#include <sys/stat.h>
 
 namespace on_audio_query_linux {
 
@@ -12,10 +19,16 @@ ScanCoordinator::ScanCoordinator(DatabaseManager* db_manager,
       thread_pool_(thread_pool),
       incremental_scanner_(db_manager),
       cancel_requested_(false),
-      scan_in_progress_(false) {}
+      scan_in_progress_(false),
+      fast_first_scan_(true),
+      artwork_store_(nullptr),
+      cover_resolver_(nullptr) {
+  ffprobe_->SetStats(&scan_stats_);
+}
 
 ScanCoordinator::~ScanCoordinator() {
   CancelScan();
+  ffprobe_->SetStats(nullptr);
 }
 
 void ScanCoordinator::FullScan(const std::string& directory,
@@ -31,9 +44,16 @@ void ScanCoordinator::FullScan(const std::string& directory,
   cancel_requested_ = false;
 
   std::cout << "[ScanCoordinator] Starting full scan of: " << directory << std::endl;
+  scan_stats_.Begin("full", directory);
 
   /// Scan filesystem for all audio files
-  auto files = file_scanner_.ScanDirectory(directory);
+  std::vector<std::string> files;
+  {
+    ScanStats::ScopedTimer timer(&scan_stats_, ScanStats::Phase::WALK);
+    files = file_scanner_.ScanDirectory(directory);
+  }
+  scan_stats_.Increment(ScanStats::Counter::FILES_WALKED, files.size());
+  SkipQuarantined(files);
 
   ScanProgress progress;
   progress.total_files = files.size();
@@ -42,17 +62,58 @@ void ScanCoordinator::FullScan(const std::string& directory,
   progress.updated_files = 0;
   progress.deleted_files = 0;
   progress.failed_files = 0;
+  progress.quarantined_files = 0;
+
+  /// Split into new and known files (only needed for fast-first)
+  std::vector<std::string> new_files;
+  std::vector<std::string> known_files;
+  if (fast_first_scan_ && files.size() >= kFastFirstMinFiles) {
+    auto db_paths = db_manager_->GetAllSongPaths();
+    std::set<std::string> known_paths(db_paths.begin(), db_paths.end());
+    for (const auto& file_path : files) {
+      if (known_paths.count(file_path)) {
+        known_files.push_back(file_path);
+      } else {
+        new_files.push_back(file_path);
+      }
+    }
+  }
 
-  /// Process all files
-  ProcessFiles(files, progress, callback);
+  if (new_files.size() >= kFastFirstMinFiles) {
+    /// Phase 1: make new files visible right away
+    AggregateDelta placeholder_delta;
+    auto placeholders = InsertPlaceholders(new_files, progress, placeholder_delta);
+    {
+      ScanStats::ScopedTimer timer(&scan_stats_, ScanStats::Phase::AGGREGATE);
+      UpdateAggregatedTables(placeholder_delta);
+    }
+    if (callback) {
+      callback(progress);
+    }
 
-  /// Update aggregated tables
-  UpdateAggregatedTables();
+    /// Phase 2: enrich placeholders, then refresh already known files
+    EnrichPlaceholders(placeholders, progress, callback);
+
+    AggregateDelta aggregate_delta;
+    ProcessFiles(known_files, progress, callback, aggregate_delta);
+  } else {
+    /// Process all files
+    AggregateDelta aggregate_delta;
+    ProcessFiles(files, progress, callback, aggregate_delta);
+  }
+
+  /// Rebuild aggregated tables (every key is touched anyway)
+  {
+    ScanStats::ScopedTimer timer(&scan_stats_, ScanStats::Phase::AGGREGATE);
+    UpdateAggregatedTables();
+  }
+  scan_stats_.End();
 
   std::cout << "[ScanCoordinator] Full scan complete!" << std::endl;
   std::cout << "  New: " << progress.new_files << std::endl;
   std::cout << "  Updated: " << progress.updated_files << std::endl;
   std::cout << "  Failed: " << progress.failed_files << std::endl;
+  std::cout << "  Quarantined: " << progress.quarantined_files << std::endl;
 
   scan_in_progress_ = false;
 }
@@ -70,12 +131,24 @@ void ScanCoordinator::IncrementalScan(const std::string& directory,
   cancel_requested_ = false;
 
   std::cout << "[ScanCoordinator] Starting incremental scan of: " << directory << std::endl;
+  scan_stats_.Begin("incremental", directory);
 
   /// Scan filesystem
-  auto current_files = file_scanner_.ScanDirectory(directory);
+  std::vector<std::string> current_files;
+  {
+    ScanStats::ScopedTimer timer(&scan_stats_, ScanStats::Phase::WALK);
+    current_files = file_scanner_.ScanDirectory(directory);
+  }
+  scan_stats_.Increment(ScanStats::Counter::FILES_WALKED, current_files.size());
 
   /// Detect changes
-  auto delta = incremental_scanner_.DetectChanges(directory, current_files);
+  IncrementalScanner::ScanDelta delta;
+  {
+    ScanStats::ScopedTimer timer(&scan_stats_, ScanStats::Phase::DIFF);
+    delta = incremental_scanner_.DetectChanges(directory, current_files);
+  }
+  SkipQuarantined(delta.new_files);
+  SkipQuarantined(delta.modified_files);
 
   ScanProgress progress;
   progress.total_files = delta.new_files.size() + delta.modified_files.size() +
@@ -85,36 +158,62 @@ void ScanCoordinator::IncrementalScan(const std::string& directory,
   progress.updated_files = 0;
   progress.deleted_files = delta.deleted_file_ids.size();
   progress.failed_files = 0;
+  progress.quarantined_files = 0;
+
+  AggregateDelta aggregate_delta;
+
+  /// Many new files => insert placeholders now, enrich after the rest
+  std::vector<SongMetadata> placeholders;
+  bool fast_first = fast_first_scan_ && delta.new_files.size() >= kFastFirstMinFiles;
 
   /// Process new files
-  if (!delta.new_files.empty()) {
-    ProcessFiles(delta.new_files, progress, callback);
+  if (fast_first) {
+    placeholders = InsertPlaceholders(delta.new_files, progress, aggregate_delta);
+  } else if (!delta.new_files.empty()) {
+    ProcessFiles(delta.new_files, progress, callback, aggregate_delta);
   }
 
   /// Process modified files
   if (!delta.modified_files.empty()) {
-    ProcessFiles(delta.modified_files, progress, callback);
+    ProcessFiles(delta.modified_files, progress, callback, aggregate_delta);
   }
 
   /// Delete removed files
-  if (!delta.deleted_file_ids.empty()) {
+  if (!delta.deleted_songs.empty()) {
+    ScanStats::ScopedTimer timer(&scan_stats_, ScanStats::Phase::DB_WRITE);
     db_manager_->BeginTransaction();
-    for (int64_t song_id : delta.deleted_file_ids) {
-      db_manager_->DeleteSong(song_id);
+    for (const auto& song : delta.deleted_songs) {
+      if (db_manager_->DeleteSong(song.id)) {
+        aggregate_delta.RemoveSong(song);
+      }
     }
     db_manager_->CommitTransaction();
 
-    progress.processed_files += delta.deleted_file_ids.size();
+    progress.processed_files += delta.deleted_songs.size();
+    scan_stats_.Increment(ScanStats::Counter::FILES_DELETED, delta.deleted_songs.size());
   }
 
-  /// Update aggregated tables
-  UpdateAggregatedTables();
+  /// Update aggregated tables (only keys touched by this scan)
+  {
+    ScanStats::ScopedTimer timer(&scan_stats_, ScanStats::Phase::AGGREGATE);
+    UpdateAggregatedTables(aggregate_delta);
+  }
+
+  /// Enrich placeholders (publishes every chunk)
+  if (fast_first) {
+    if (callback) {
+      callback(progress);
+    }
+    EnrichPlaceholders(placeholders, progress, callback);
+  }
+  scan_stats_.End();
 
   std::cout << "[ScanCoordinator] Incremental scan complete!" << std::endl;
   std::cout << "  New: " << progress.new_files << std::endl;
   std::cout << "  Modified: " << progress.updated_files << std::endl;
   std::cout << "  Deleted: " << progress.deleted_files << std::endl;
   std::cout << "  Failed: " << progress.failed_files << std::endl;
+  std::cout << "  Quarantined: " << progress.quarantined_files << std::endl;
 
   /// Final callback
   if (callback) {
@@ -141,9 +240,229 @@ void ScanCoordinator::CancelScan() {
   cancel_requested_ = true;
 }
 
+void ScanCoordinator::SetSongsChangedCallback(SongsChangedCallback callback) {
+  std::lock_guard<std::mutex> lock(songs_changed_mutex_);
+  songs_changed_callback_ = std::move(callback);
+}
+
+void ScanCoordinator::SetArtworkScan(const ArtworkScanOptions& options) {
+  std::lock_guard<std::mutex> lock(artwork_mutex_);
+  artwork_options_ = options;
+}
+
+ScanCoordinator::ArtworkScanOptions ScanCoordinator::GetArtworkScan() const {
+  std::lock_guard<std::mutex> lock(artwork_mutex_);
+  return artwork_options_;
+}
+
+void ScanCoordinator::SetArtworkStore(ArtworkStore* artwork_store, CoverResolver* cover_resolver) {
+  std::lock_guard<std::mutex> lock(artwork_mutex_);
+  artwork_store_ = artwork_store;
+  cover_resolver_ = cover_resolver;
+}
+
+SongArtwork ScanCoordinator::IndexArtwork(const SongMetadata& song, const ScannedArtwork& artwork,
+                                          const ArtworkScanOptions& options) {
+  ScanStats::ScopedTimer timer(&scan_stats_, ScanStats::Phase::ARTWORK);
+
+  SongArtwork indexed{song.data, song.file_mtime, artwork.found, artwork.raw,
+                      static_cast<int64_t>(artwork.offset),
+                      static_cast<int64_t>(artwork.bytes.size()), ""};
+  if (!artwork.found) {
+    return indexed;
+  }
+
+  //same hash ArtworkQuery computes => renditions are shared with the query path
+  indexed.hash = Md5::HexDigest(artwork.bytes.data(), artwork.bytes.size());
+  scan_stats_.Increment(ScanStats::Counter::ARTWORKS_INDEXED);
+
+  ArtworkStore* artwork_store;
+  CoverResolver* cover_resolver;
+  {
+    std::lock_guard<std::mutex> lock(artwork_mutex_);
+    artwork_store = artwork_store_;
+    cover_resolver = cover_resolver_;
+  }
+  //a folder cover is what gets shown => its placeholder comes with its first rendition
+  if (cover_resolver && cover_resolver->Resolve(song.data).has_value()) {
+    return indexed;
+  }
+
+  //tracks of an album usually embed the same picture => computed once
+  if (!db_manager_->HasArtworkPlaceholder(indexed.hash)) {
+    auto placeholder = PlaceholderGenerator::Generate(artwork.bytes.data(), artwork.bytes.size());
+    if (placeholder.has_value() && db_manager_->SetArtworkPlaceholder(indexed.hash, placeholder.value())) {
+      scan_stats_.Increment(ScanStats::Counter::ARTWORK_PLACEHOLDERS);
+    }
+  }
+
+  if (options.thumbnail_size <= 0 || !artwork_store) {
+    return indexed;
+  }
+
+  ArtworkCacheKey key{song.id, 0, options.format, options.thumbnail_size, options.quality,
+                      song.data, song.file_mtime};
+
+  //same picture rendered for another track => mapped, not rendered again
+  if (artwork_store->LookupRendition(key, indexed.hash).has_value()) {
+    return indexed;
+  }
+
+  auto thumbnail = ThumbnailGenerator::Generate(artwork.bytes.data(), artwork.bytes.size(),
+                                                options.thumbnail_size, options.format,
+                                                options.quality);
+  const uint8_t* data = thumbnail.has_value() ? thumbnail->data() : artwork.bytes.data();
+  size_t length = thumbnail.has_value() ? thumbnail->size() : artwork.bytes.size();
+  if (artwork_store->Store(key, indexed.hash, data, length).has_value()) {
+    scan_stats_.Increment(ScanStats::Counter::ARTWORK_THUMBNAILS);
+  }
+
+  return indexed;
+}
+
+void ScanCoordinator::NotifySongsChanged(const std::vector<int64_t>& song_ids) {
+  if (song_ids.empty()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(songs_changed_mutex_);
+  if (songs_changed_callback_) {
+    songs_changed_callback_(song_ids);
+  }
+}
+
+std::vector<SongMetadata> ScanCoordinator::InsertPlaceholders(
+    const std::vector<std::string>& files,
+    ScanProgress& progress,
+    AggregateDelta& aggregate_delta) {
+  std::vector<SongMetadata> placeholders;
+  placeholders.reserve(files.size());
+
+  {
+    ScanStats::ScopedTimer timer(&scan_stats_, ScanStats::Phase::PLACEHOLDER);
+
+    db_manager_->BeginTransaction();
+    for (const auto& file_path : files) {
+      if (cancel_requested_) {
+        break;
+      }
+
+      //path + stat only, no ffprobe
+      SongMetadata placeholder = ffprobe_->CreatePlaceholder(file_path);
+      if (db_manager_->InsertSong(placeholder)) {
+        aggregate_delta.AddSong(placeholder);
+        placeholders.push_back(std::move(placeholder));
+        progress.new_files++;
+        scan_stats_.Increment(ScanStats::Counter::FILES_NEW);
+      } else {
+        progress.failed_files++;
+        progress.processed_files++;
+        scan_stats_.Increment(ScanStats::Counter::FILES_FAILED);
+      }
+    }
+    db_manager_->CommitTransaction();
+  }
+
+  std::cout << "[ScanCoordinator] Inserted " << placeholders.size()
+            << " placeholder rows" << std::endl;
+
+  std::vector<int64_t> song_ids;
+  song_ids.reserve(placeholders.size());
+  for (const auto& placeholder : placeholders) {
+    song_ids.push_back(placeholder.id);
+  }
+  NotifySongsChanged(song_ids);
+
+  return placeholders;
+}
+
+void ScanCoordinator::EnrichPlaceholders(const std::vector<SongMetadata>& placeholders,
+                                         ScanProgress& progress,
+                                         ProgressCallback callback) {
+  for (size_t start = 0; start < placeholders.size(); start += kEnrichChunkSize) {
+    if (cancel_requested_) {
+      //remaining rows keep file_mtime = 0 => next incremental scan picks them up
+      break;
+    }
+
+    size_t end = std::min(start + kEnrichChunkSize, placeholders.size());
+
+    std::vector<std::string> chunk_files;
+    std::vector<int64_t> chunk_ids;
+    chunk_files.reserve(end - start);
+    chunk_ids.reserve(end - start);
+    for (size_t i = start; i < end; ++i) {
+      chunk_files.push_back(placeholders[i].data);
+      chunk_ids.push_back(placeholders[i].id);
+    }
+
+    //rows already exist => ProcessFiles rewrites them in place
+    ScanProgress chunk_progress = {};
+    AggregateDelta chunk_delta;
+    ProcessFiles(chunk_files, chunk_progress, nullptr, chunk_delta);
+
+    {
+      ScanStats::ScopedTimer timer(&scan_stats_, ScanStats::Phase::AGGREGATE);
+      UpdateAggregatedTables(chunk_delta);
+    }
+
+    progress.processed_files += chunk_progress.processed_files;
+    progress.failed_files += chunk_progress.failed_files;
+    progress.quarantined_files += chunk_progress.quarantined_files;
+    scan_stats_.Increment(ScanStats::Counter::FILES_ENRICHED, chunk_progress.updated_files);
+
+    NotifySongsChanged(chunk_ids);
+
+    if (callback) {
+      callback(progress);
+    }
+  }
+}
+
+void ScanCoordinator::SkipQuarantined(std::vector<std::string>& files) {
+  if (files.empty()) {
+    return;
+  }
+
+  auto entries = db_manager_->GetQuarantinedFiles();
+  if (entries.empty()) {
+    return;
+  }
+
+  std::unordered_map<std::string, int64_t> quarantined;
+  for (const auto& entry : entries) {
+    quarantined[entry.file_path] = entry.file_mtime;
+  }
+
+  size_t skipped = 0;
+  auto it = std::remove_if(files.begin(), files.end(), [&](const std::string& file_path) {
+    auto entry = quarantined.find(file_path);
+    if (entry == quarantined.end()) {
+      return false;
+    }
+
+    //file replaced/rewritten since => give it another chance
+    struct stat st;
+    if (stat(file_path.c_str(), &st) == 0 && st.st_mtime != entry->second) {
+      db_manager_->RemoveFromQuarantine(file_path);
+      return false;
+    }
+
+    skipped++;
+    return true;
+  });
+  files.erase(it, files.end());
+
+  if (skipped > 0) {
+    std::cout << "[ScanCoordinator] Skipping " << skipped << " quarantined files" << std::endl;
+    scan_stats_.Increment(ScanStats::Counter::QUARANTINE_SKIPPED, skipped);
+  }
+}
+
 void ScanCoordinator::ProcessFiles(const std::vector<std::string>& files,
                                    ScanProgress& progress,
-                                   ProgressCallback callback) {
+                                   ProgressCallback callback,
+                                   AggregateDelta& aggregate_delta) {
   if (files.empty()) {
     return;
   }
@@ -152,6 +471,7 @@ void ScanCoordinator::ProcessFiles(const std::vector<std::string>& files,
   const size_t num_batches = (files.size() + batch_size - 1) / batch_size;
 
   std::mutex progress_mutex;
+  ArtworkScanOptions artwork_options = GetArtworkScan();
 
   /// Start transaction for batch inserts
   db_manager_->BeginTransaction();
@@ -173,16 +493,32 @@ void ScanCoordinator::ProcessFiles(const std::vector<std::string>& files,
     );
 
     //submit batch to thread pool
-    auto future = thread_pool_->Submit([this, batch, &progress, &progress_mutex, callback]() {
+    auto future = thread_pool_->Submit([this, batch, &progress, &progress_mutex, &aggregate_delta,
+                                        &artwork_options, callback]() {
       for (const auto& file_path : batch) {
         if (cancel_requested_) {
           return;
         }
 
         //extract metadata using FFprobe
-        auto metadata_opt = ffprobe_->Extract(file_path);
+        std::optional<SongMetadata> metadata_opt;
+        FFprobeExtractor::ExtractFailure failure = FFprobeExtractor::ExtractFailure::NONE;
+        ScannedArtwork artwork;
+        {
+          ScanStats::ScopedTimer timer(&scan_stats_, ScanStats::Phase::EXTRACT);
+          metadata_opt = ffprobe_->Extract(file_path, &failure,
+                                           artwork_options.enabled ? &artwork : nullptr);
+          scan_stats_.RecordExtraction(timer.Elapsed());
+        }
+
+        //picture was read with the tags => hash/thumbnail it outside the write lock
+        std::optional<SongArtwork> song_artwork;
+        if (metadata_opt.has_value() && artwork.located) {
+          song_artwork = IndexArtwork(metadata_opt.value(), artwork, artwork_options);
+        }
 
         std::lock_guard<std::mutex> lock(progress_mutex);
+        ScanStats::ScopedTimer write_timer(&scan_stats_, ScanStats::Phase::DB_WRITE);
 
         if (metadata_opt.has_value()) {
           //check if song exists in DB
@@ -190,15 +526,43 @@ void ScanCoordinator::ProcessFiles(const std::vector<std::string>& files,
 
           if (existing.has_value()) {
             //update existing song
-            db_manager_->UpdateSong(metadata_opt.value());
+            if (db_manager_->UpdateSong(metadata_opt.value())) {
+              aggregate_delta.RemoveSong(existing.value());
+              aggregate_delta.AddSong(metadata_opt.value());
+            }
             progress.updated_files++;
+            scan_stats_.Increment(ScanStats::Counter::FILES_UPDATED);
           } else {
             //insert new song
-            db_manager_->InsertSong(metadata_opt.value());
+            if (db_manager_->InsertSong(metadata_opt.value())) {
+              aggregate_delta.AddSong(metadata_opt.value());
+            }
             progress.new_files++;
+            scan_stats_.Increment(ScanStats::Counter::FILES_NEW);
+          }
+
+          if (song_artwork.has_value()) {
+            db_manager_->SetSongArtwork(song_artwork.value());
+          }
+        } else if (failure != FFprobeExtractor::ExtractFailure::NONE) {
+          //known-bad file => skipped by later scans until it changes
+          struct stat st;
+          int64_t mtime = stat(file_path.c_str(), &st) == 0 ? st.st_mtime : 0;
+          const char* reason = failure == FFprobeExtractor::ExtractFailure::TIMEOUT ? "timeout" : "crash";
+          db_manager_->QuarantineFile(file_path, mtime, reason);
+
+          //a fast-first placeholder would never be enriched (later scans skip
+          //the path) => the file leaves the library until it changes
+          auto existing = db_manager_->GetSongByPath(file_path);
+          if (existing.has_value() && existing->file_mtime == 0 &&
+              db_manager_->DeleteSong(existing->id)) {
+            aggregate_delta.RemoveSong(existing.value());
           }
+          progress.quarantined_files++;
+          scan_stats_.Increment(ScanStats::Counter::FILES_QUARANTINED);
         } else {
           progress.failed_files++;
+          scan_stats_.Increment(ScanStats::Counter::FILES_FAILED);
         }
 
         progress.processed_files++;
@@ -219,7 +583,10 @@ void ScanCoordinator::ProcessFiles(const std::vector<std::string>& files,
   }
 
   /// Commit transaction
-  db_manager_->CommitTransaction();
+  {
+    ScanStats::ScopedTimer timer(&scan_stats_, ScanStats::Phase::DB_WRITE);
+    db_manager_->CommitTransaction();
+  }
 
   /// Final callback
   if (callback) {
@@ -232,4 +599,14 @@ void ScanCoordinator::UpdateAggregatedTables() {
   db_manager_->UpdateAggregatedTables();
 }
 
+void ScanCoordinator::UpdateAggregatedTables(const AggregateDelta& aggregate_delta) {
+  if (aggregate_delta.IsEmpty()) {
+    std::cout << "[ScanCoordinator] No changes => aggregated tables untouched" << std::endl;
+    return;
+  }
+
+  std::cout << "[ScanCoordinator] Updating aggregated tables incrementally..." << std::endl;
+  db_manager_->UpdateAggregatedTables(aggregate_delta);
+}
+
 }  // namespace on_audio_query_linux
@@ -9,6 +9,9 @@
 #include "../core/database_manager.h"
 #include "../core/ffprobe_extractor.h"
 #include "../core/thread_pool.h"
+#include "../core/scan_stats.h"
+#include "../core/artwork_store.h"
+#include "../core/cover_resolver.h"
 #include "file_scanner.h"
 #include "incremental_scanner.h"
 
@@ -28,10 +31,15 @@ class ScanCoordinator {
     int updated_files;
     int deleted_files;
     int failed_files;
+    int quarantined_files;  //extractor hung/crashed on them during this scan
   };
 
   using ProgressCallback = std::function<void(const ScanProgress&)>;
 
+  /// Receives the ids of songs whose rows were inserted or rewritten
+  /// (called from the scan thread)
+  using SongsChangedCallback = std::function<void(const std::vector<int64_t>&)>;
+
   /// Full scan (initial or forced rescan)
   void FullScan(const std::string& directory,
                 ProgressCallback callback = nullptr);
@@ -51,6 +59,33 @@ class ScanCoordinator {
   /// Check if scan is in progress
   bool IsScanInProgress() const { return scan_in_progress_.load(); }
 
+  /// Fast-first mode: when a scan finds many new files, insert path/stat
+  /// placeholder rows right away and enrich them with tags afterwards
+  void SetFastFirstScan(bool enabled) { fast_first_scan_ = enabled; }
+  bool IsFastFirstScan() const { return fast_first_scan_.load(); }
+
+  /// Artwork stage: embedded pictures are located and hashed while tags are
+  /// read (artwork queries then map them instead of extracting), optionally
+  /// rendering a thumbnail of one size into the artwork store
+  struct ArtworkScanOptions {
+    bool enabled = false;
+    int thumbnail_size = 0;  //0 => index only
+    std::string format = "jpeg";
+    int quality = 50;
+  };
+  void SetArtworkScan(const ArtworkScanOptions& options);
+  ArtworkScanOptions GetArtworkScan() const;
+
+  /// Where scan-time thumbnails go (songs whose folder has a cover image are
+  /// left to the query path, the cover wins there)
+  void SetArtworkStore(ArtworkStore* artwork_store, CoverResolver* cover_resolver);
+
+  /// Set the listener for song row changes (nullptr disables)
+  void SetSongsChangedCallback(SongsChangedCallback callback);
+
+  /// Phase timings and counters of the current (or last) scan
+  nlohmann::json GetScanStats() const { return scan_stats_.ToJson(); }
+
  private:
   DatabaseManager* db_manager_;
   FFprobeExtractor* ffprobe_;
@@ -62,13 +97,54 @@ class ScanCoordinator {
   std::atomic<bool> scan_in_progress_;
   std::mutex scan_mutex_;
 
+  std::atomic<bool> fast_first_scan_;
+  std::mutex songs_changed_mutex_;
+  SongsChangedCallback songs_changed_callback_;
+
+  mutable std::mutex artwork_mutex_;
+  ArtworkScanOptions artwork_options_;
+  ArtworkStore* artwork_store_;
+  CoverResolver* cover_resolver_;
+
+  /// Minimum number of new files before a scan goes fast-first
+  static constexpr size_t kFastFirstMinFiles = 500;
+
+  /// Files enriched (and published) per chunk in the second phase
+  static constexpr size_t kEnrichChunkSize = 1000;
+
+  /// Instrumentation of the current (or last) scan
+  ScanStats scan_stats_;
+
+  /// Drop quarantined files from a scan (files changed since are retried)
+  void SkipQuarantined(std::vector<std::string>& files);
+
   /// Process a list of files in parallel
   void ProcessFiles(const std::vector<std::string>& files,
                     ScanProgress& progress,
-                    ProgressCallback callback);
+                    ProgressCallback callback,
+                    AggregateDelta& aggregate_delta);
+
+  /// Fast-first phase 1: insert placeholder rows (returns inserted rows)
+  std::vector<SongMetadata> InsertPlaceholders(const std::vector<std::string>& files,
+                                               ScanProgress& progress,
+                                               AggregateDelta& aggregate_delta);
+
+  /// Fast-first phase 2: extract tags for placeholder rows chunk by chunk,
+  /// updating aggregates and notifying listeners after every chunk
+  void EnrichPlaceholders(const std::vector<SongMetadata>& placeholders,
+                          ScanProgress& progress,
+                          ProgressCallback callback);
+
+  /// Hash a picture read during extraction and render its thumbnail
+  SongArtwork IndexArtwork(const SongMetadata& song, const ScannedArtwork& artwork,
+                           const ArtworkScanOptions& options);
+
+  /// Notify the songs changed listener (if any)
+  void NotifySongsChanged(const std::vector<int64_t>& song_ids);
 
   /// Update aggregated tables after scan
   void UpdateAggregatedTables();
+  void UpdateAggregatedTables(const AggregateDelta& aggregate_delta);
 };
 
 }  // namespace on_audio_query_linux
@@ -185,11 +185,28 @@ int64_t ArtistSeparator::GenerateSplitArtistId(const std::string& artist_name) {
 void ArtistSeparator::AddToIndex(const std::string& split_artist_name,
                                   const std::string& combined_artist_string) {
   std::string key = ToLower(split_artist_name);
+  std::unique_lock<std::shared_mutex> lock(index_mutex_);
   split_artist_index_[key].insert(combined_artist_string);
 }
 
+void ArtistSeparator::RemoveFromIndex(const std::string& split_artist_name,
+                                      const std::string& combined_artist_string) {
+  std::string key = ToLower(split_artist_name);
+  std::unique_lock<std::shared_mutex> lock(index_mutex_);
+  auto it = split_artist_index_.find(key);
+  if (it == split_artist_index_.end()) {
+    return;
+  }
+
+  it->second.erase(combined_artist_string);
+  if (it->second.empty()) {
+    split_artist_index_.erase(it);
+  }
+}
+
 std::set<std::string> ArtistSeparator::GetCombinedArtistsFor(const std::string& artist_name) {
   std::string key = ToLower(artist_name);
+  std::shared_lock<std::shared_mutex> lock(index_mutex_);
   auto it = split_artist_index_.find(key);
   if (it != split_artist_index_.end()) {
     return it->second;
@@ -198,10 +215,12 @@ std::set<std::string> ArtistSeparator::GetCombinedArtistsFor(const std::string&
 }
 
 void ArtistSeparator::AddIdMapping(int64_t artist_id, const std::string& artist_name) {
+  std::unique_lock<std::shared_mutex> lock(index_mutex_);
   id_to_name_map_[artist_id] = artist_name;
 }
 
 std::string ArtistSeparator::GetArtistNameById(int64_t artist_id) {
+  std::shared_lock<std::shared_mutex> lock(index_mutex_);
   std::cout << "[ArtistSeparator] Looking up ID: " << artist_id
             << " (map size: " << id_to_name_map_.size() << ")" << std::endl;
   auto it = id_to_name_map_.find(artist_id);
@@ -214,6 +233,7 @@ std::string ArtistSeparator::GetArtistNameById(int64_t artist_id) {
 }
 
 void ArtistSeparator::ClearIndex() {
+  std::unique_lock<std::shared_mutex> lock(index_mutex_);
   split_artist_index_.clear();
   //Note: id_to_name_map_ is NOT cleared here because:
   //1. The mappings are deterministic (same name always generates same ID)
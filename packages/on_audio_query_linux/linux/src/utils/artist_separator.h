@@ -6,9 +6,15 @@
 #include <set>
 #include <map>
 #include <regex>
+#include <mutex>
+#include <shared_mutex>
 
 namespace on_audio_query_linux {
 
+/// Splits combined artist strings and indexes the split artists.
+///
+/// The index is written by the database writer (under its lock) and read by
+/// queries on pooled read connections => it has its own reader/writer lock.
 class ArtistSeparator {
  public:
   static ArtistSeparator& Instance();
@@ -22,6 +28,9 @@ class ArtistSeparator {
   /// Add artist to index (tracks which split artists appear in which combined strings)
   void AddToIndex(const std::string& split_artist_name, const std::string& combined_artist_string);
 
+  /// Remove artist from index (combined string no longer present in the library)
+  void RemoveFromIndex(const std::string& split_artist_name, const std::string& combined_artist_string);
+
   /// Get all combined artist strings that contain a given artist
   std::set<std::string> GetCombinedArtistsFor(const std::string& artist_name);
 
@@ -49,6 +58,9 @@ class ArtistSeparator {
   /// Exact-match exceptions (band names that shouldn't be split)
   static const std::set<std::string> EXACT_EXCEPTIONS;
 
+  /// Guards split_artist_index_ and id_to_name_map_ (shared for lookups)
+  mutable std::shared_mutex index_mutex_;
+
   /// Index mapping split artist names to combined strings they appear in
   std::map<std::string, std::set<std::string>> split_artist_index_;
 
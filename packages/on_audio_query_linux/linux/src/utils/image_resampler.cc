@@ -0,0 +1,209 @@
+#include "image_resampler.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define IMAGE_RESAMPLER_X86 1
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define IMAGE_RESAMPLER_NEON 1
+#endif
+
+namespace on_audio_query_linux {
+
+namespace {
+
+/// Source pixels covering each destination pixel (one axis)
+struct Contributions {
+  std::vector<int> first;      //first source index per destination index
+  std::vector<int> count;      //number of source indices
+  std::vector<int> offset;     //start of the weights in `weights`
+  std::vector<float> weights;  //coverage / scale, sums to 1 per destination index
+};
+
+Contributions ComputeContributions(int src_size, int dst_size) {
+  Contributions result;
+  result.first.resize(dst_size);
+  result.count.resize(dst_size);
+  result.offset.resize(dst_size);
+
+  double scale = static_cast<double>(src_size) / dst_size;
+  for (int i = 0; i < dst_size; ++i) {
+    double begin = i * scale;
+    double end = std::min((i + 1) * scale, static_cast<double>(src_size));
+    int first = static_cast<int>(std::floor(begin));
+    int last = std::min(static_cast<int>(std::ceil(end)), src_size) - 1;
+
+    result.first[i] = first;
+    result.offset[i] = static_cast<int>(result.weights.size());
+    for (int j = first; j <= last; ++j) {
+      double coverage = std::min<double>(j + 1, end) - std::max<double>(j, begin);
+      result.weights.push_back(static_cast<float>(coverage / scale));
+    }
+    result.count[i] = last - first + 1;
+  }
+
+  return result;
+}
+
+/// acc[i] += row[i] * weight
+void AccumulateRowScalar(float* acc, const uint8_t* row, size_t length, float weight) {
+  for (size_t i = 0; i < length; ++i) {
+    acc[i] += row[i] * weight;
+  }
+}
+
+#if defined(IMAGE_RESAMPLER_X86)
+
+#if defined(__SSE2__)
+void AccumulateRowSse2(float* acc, const uint8_t* row, size_t length, float weight) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 w = _mm_set1_ps(weight);
+
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+    __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+    __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+
+    __m128 p0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+    __m128 p1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+    __m128 p2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+    __m128 p3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+
+    _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(p0, w)));
+    _mm_storeu_ps(acc + i + 4, _mm_add_ps(_mm_loadu_ps(acc + i + 4), _mm_mul_ps(p1, w)));
+    _mm_storeu_ps(acc + i + 8, _mm_add_ps(_mm_loadu_ps(acc + i + 8), _mm_mul_ps(p2, w)));
+    _mm_storeu_ps(acc + i + 12, _mm_add_ps(_mm_loadu_ps(acc + i + 12), _mm_mul_ps(p3, w)));
+  }
+
+  AccumulateRowScalar(acc + i, row + i, length - i, weight);
+}
+#endif
+
+__attribute__((target("avx2")))
+void AccumulateRowAvx2(float* acc, const uint8_t* row, size_t length, float weight) {
+  const __m256 w = _mm256_set1_ps(weight);
+
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m256i p0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + i)));
+    __m256i p1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + i + 8)));
+
+    _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i),
+                                            _mm256_mul_ps(_mm256_cvtepi32_ps(p0), w)));
+    _mm256_storeu_ps(acc + i + 8, _mm256_add_ps(_mm256_loadu_ps(acc + i + 8),
+                                                _mm256_mul_ps(_mm256_cvtepi32_ps(p1), w)));
+  }
+
+  AccumulateRowScalar(acc + i, row + i, length - i, weight);
+}
+
+#elif defined(IMAGE_RESAMPLER_NEON)
+
+void AccumulateRowNeon(float* acc, const uint8_t* row, size_t length, float weight) {
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    uint8x16_t bytes = vld1q_u8(row + i);
+    uint16x8_t lo = vmovl_u8(vget_low_u8(bytes));
+    uint16x8_t hi = vmovl_u8(vget_high_u8(bytes));
+
+    vst1q_f32(acc + i, vmlaq_n_f32(vld1q_f32(acc + i), vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))), weight));
+    vst1q_f32(acc + i + 4, vmlaq_n_f32(vld1q_f32(acc + i + 4), vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))), weight));
+    vst1q_f32(acc + i + 8, vmlaq_n_f32(vld1q_f32(acc + i + 8), vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))), weight));
+    vst1q_f32(acc + i + 12, vmlaq_n_f32(vld1q_f32(acc + i + 12), vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))), weight));
+  }
+
+  AccumulateRowScalar(acc + i, row + i, length - i, weight);
+}
+
+#endif
+
+using AccumulateRowFn = void (*)(float*, const uint8_t*, size_t, float);
+
+/// Widest kernel the CPU supports (picked once)
+AccumulateRowFn SelectAccumulateRow() {
+#if defined(IMAGE_RESAMPLER_X86)
+  if (__builtin_cpu_supports("avx2")) {
+    return AccumulateRowAvx2;
+  }
+#if defined(__SSE2__)
+  return AccumulateRowSse2;
+#else
+  return AccumulateRowScalar;
+#endif
+#elif defined(IMAGE_RESAMPLER_NEON)
+  return AccumulateRowNeon;
+#else
+  return AccumulateRowScalar;
+#endif
+}
+
+}  // namespace
+
+ImageBuffer ImageResampler::Downscale(const ImageBuffer& source, int dst_width, int dst_height) {
+  static const AccumulateRowFn accumulate_row = SelectAccumulateRow();
+
+  ImageBuffer result;
+  if (source.width <= 0 || source.height <= 0 || source.channels <= 0 ||
+      dst_width <= 0 || dst_height <= 0 ||
+      dst_width > source.width || dst_height > source.height) {
+    return result;
+  }
+
+  const int channels = source.channels;
+  const size_t src_stride = static_cast<size_t>(source.width) * channels;
+
+  Contributions rows = ComputeContributions(source.height, dst_height);
+  Contributions columns = ComputeContributions(source.width, dst_width);
+
+  result.width = dst_width;
+  result.height = dst_height;
+  result.channels = channels;
+  result.pixels.resize(static_cast<size_t>(dst_width) * dst_height * channels);
+
+  std::vector<float> acc(src_stride);
+  for (int y = 0; y < dst_height; ++y) {
+    //vertical pass => one full-width row of weighted sums
+    std::fill(acc.begin(), acc.end(), 0.0f);
+    for (int k = 0; k < rows.count[y]; ++k) {
+      const uint8_t* src_row = source.pixels.data() + (rows.first[y] + k) * src_stride;
+      accumulate_row(acc.data(), src_row, src_stride, rows.weights[rows.offset[y] + k]);
+    }
+
+    //horizontal pass on the reduced row
+    uint8_t* dst_row = result.pixels.data() + static_cast<size_t>(y) * dst_width * channels;
+    for (int x = 0; x < dst_width; ++x) {
+      const float* weights = columns.weights.data() + columns.offset[x];
+      const float* src_px = acc.data() + static_cast<size_t>(columns.first[x]) * channels;
+      for (int c = 0; c < channels; ++c) {
+        float sum = 0.0f;
+        for (int k = 0; k < columns.count[x]; ++k) {
+          sum += src_px[k * channels + c] * weights[k];
+        }
+        dst_row[x * channels + c] = static_cast<uint8_t>(std::clamp(sum + 0.5f, 0.0f, 255.0f));
+      }
+    }
+  }
+
+  return result;
+}
+
+void ImageResampler::FitInside(int width, int height, int max_size, int* out_width, int* out_height) {
+  if (width <= max_size && height <= max_size) {
+    *out_width = width;
+    *out_height = height;
+    return;
+  }
+
+  if (width >= height) {
+    *out_width = max_size;
+    *out_height = std::max(1, static_cast<int>(std::lround(static_cast<double>(height) * max_size / width)));
+  } else {
+    *out_height = max_size;
+    *out_width = std::max(1, static_cast<int>(std::lround(static_cast<double>(width) * max_size / height)));
+  }
+}
+
+}  // namespace on_audio_query_linux
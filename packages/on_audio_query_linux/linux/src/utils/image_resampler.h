@@ -0,0 +1,35 @@
+#ifndef IMAGE_RESAMPLER_H_
+#define IMAGE_RESAMPLER_H_
+
+#include <vector>
+#include <cstdint>
+
+namespace on_audio_query_linux {
+
+/// Interleaved 8-bit pixels (1 = gray, 3 = RGB, 4 = RGBA), rows tightly packed
+struct ImageBuffer {
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  std::vector<uint8_t> pixels;
+};
+
+/// Area-averaging (box filter) downscaler.
+///
+/// Every destination pixel is the coverage weighted mean of the source pixels
+/// under it, which doesn't alias on large reductions the way bilinear does.
+/// The vertical pass (the bulk of the work, it touches every source byte)
+/// runs on SSE2/AVX2 or NEON, the horizontal pass works on the already
+/// reduced rows.
+class ImageResampler {
+ public:
+  /// Shrink to dst_width x dst_height (must not be larger than the source)
+  static ImageBuffer Downscale(const ImageBuffer& source, int dst_width, int dst_height);
+
+  /// Size fitting inside max_size x max_size with the source aspect ratio
+  static void FitInside(int width, int height, int max_size, int* out_width, int* out_height);
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // IMAGE_RESAMPLER_H_
@@ -0,0 +1,111 @@
+#include "mapped_region.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace on_audio_query_linux {
+
+MappedRegion::MappedRegion()
+    : base_(nullptr), mapped_size_(0), data_(nullptr), size_(0) {}
+
+MappedRegion::~MappedRegion() {
+  Release();
+}
+
+MappedRegion::MappedRegion(MappedRegion&& other) noexcept
+    : base_(other.base_), mapped_size_(other.mapped_size_),
+      data_(other.data_), size_(other.size_) {
+  other.base_ = nullptr;
+  other.mapped_size_ = 0;
+  other.data_ = nullptr;
+  other.size_ = 0;
+}
+
+MappedRegion& MappedRegion::operator=(MappedRegion&& other) noexcept {
+  if (this != &other) {
+    Release();
+    base_ = other.base_;
+    mapped_size_ = other.mapped_size_;
+    data_ = other.data_;
+    size_ = other.size_;
+    other.base_ = nullptr;
+    other.mapped_size_ = 0;
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+  return *this;
+}
+
+std::optional<MappedRegion> MappedRegion::Map(const std::string& file_path,
+                                              uint64_t offset, size_t length) {
+  if (length == 0) {
+    return std::nullopt;
+  }
+
+  int fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+
+  return MapDescriptor(fd, offset, length);
+}
+
+std::optional<MappedRegion> MappedRegion::MapFile(const std::string& file_path) {
+  int fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return std::nullopt;
+  }
+
+  return MapDescriptor(fd, 0, static_cast<size_t>(st.st_size));
+}
+
+std::optional<MappedRegion> MappedRegion::MapDescriptor(int fd, uint64_t offset, size_t length) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || offset > static_cast<uint64_t>(st.st_size) ||
+      length > static_cast<uint64_t>(st.st_size) - offset) {
+    close(fd);
+    return std::nullopt;
+  }
+
+  //mmap offsets must be page aligned
+  uint64_t page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  uint64_t aligned_offset = offset - offset % page_size;
+  size_t delta = static_cast<size_t>(offset - aligned_offset);
+
+  void* base = mmap(nullptr, length + delta, PROT_READ, MAP_PRIVATE, fd,
+                    static_cast<off_t>(aligned_offset));
+  close(fd);  //the mapping keeps its own reference
+  if (base == MAP_FAILED) {
+    return std::nullopt;
+  }
+
+  //the slice is copied front to back right away
+  madvise(base, length + delta, MADV_SEQUENTIAL);
+
+  MappedRegion region;
+  region.base_ = base;
+  region.mapped_size_ = length + delta;
+  region.data_ = static_cast<const uint8_t*>(base) + delta;
+  region.size_ = length;
+  return region;
+}
+
+void MappedRegion::Release() {
+  if (base_) {
+    munmap(base_, mapped_size_);
+  }
+  base_ = nullptr;
+  mapped_size_ = 0;
+  data_ = nullptr;
+  size_ = 0;
+}
+
+}  // namespace on_audio_query_linux
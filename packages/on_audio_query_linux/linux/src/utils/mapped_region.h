@@ -0,0 +1,52 @@
+#ifndef MAPPED_REGION_H_
+#define MAPPED_REGION_H_
+
+#include <string>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+
+namespace on_audio_query_linux {
+
+/// Read-only mmap of a byte range of a file.
+///
+/// The mapping itself starts at a page boundary, data() points at the
+/// requested offset. Pages are only faulted in when read, so handing out a
+/// slice costs nothing until the bytes are copied to their destination.
+class MappedRegion {
+ public:
+  MappedRegion();
+  ~MappedRegion();
+
+  MappedRegion(MappedRegion&& other) noexcept;
+  MappedRegion& operator=(MappedRegion&& other) noexcept;
+
+  MappedRegion(const MappedRegion&) = delete;
+  MappedRegion& operator=(const MappedRegion&) = delete;
+
+  /// Map [offset, offset + length) of a file (nullopt when out of range or unmappable)
+  static std::optional<MappedRegion> Map(const std::string& file_path,
+                                         uint64_t offset, size_t length);
+
+  /// Map a whole file (nullopt when empty or unmappable)
+  static std::optional<MappedRegion> MapFile(const std::string& file_path);
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool IsMapped() const { return base_ != nullptr; }
+
+ private:
+  void* base_;
+  size_t mapped_size_;
+  const uint8_t* data_;
+  size_t size_;
+
+  void Release();
+
+  /// Map from an open descriptor (closes it)
+  static std::optional<MappedRegion> MapDescriptor(int fd, uint64_t offset, size_t length);
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // MAPPED_REGION_H_
@@ -0,0 +1,35 @@
+#ifndef MD5_H_
+#define MD5_H_
+
+#include <string>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace on_audio_query_linux {
+
+/// MD5 (RFC 1321) used to address cached artwork by content.
+/// Not for anything security related.
+class Md5 {
+ public:
+  Md5();
+
+  void Update(const uint8_t* data, size_t size);
+  std::array<uint8_t, 16> Final();
+
+  /// Lowercase hex digest of a buffer
+  static std::string HexDigest(const uint8_t* data, size_t size);
+  static std::string HexDigest(const std::string& text);
+
+ private:
+  uint32_t state_[4];
+  uint64_t length_;  //bytes processed
+  uint8_t buffer_[64];
+  size_t buffered_;
+
+  void Transform(const uint8_t* block);
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // MD5_H_
@@ -0,0 +1,156 @@
+#include "process_runner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cerrno>
+#include <fcntl.h>
+#include <csignal>
+#include <poll.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+namespace on_audio_query_linux {
+
+ProcessResult ProcessRunner::Run(const std::vector<std::string>& argv,
+                                 size_t expected_output,
+                                 const ProcessLimits& limits) {
+  ProcessResult result = {"", -1, false, false, 0, 0};
+  if (argv.empty()) {
+    return result;
+  }
+
+  int out_pipe[2];
+  if (pipe2(out_pipe, O_CLOEXEC) != 0) {
+    return result;
+  }
+
+  //child: stdin/stderr => /dev/null, stdout => pipe (dup2 clears CLOEXEC)
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+  posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+  posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+#ifdef POSIX_SPAWN_USEVFORK
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_USEVFORK);
+#endif
+
+  std::vector<char*> args;
+  args.reserve(argv.size() + 1);
+  for (const auto& arg : argv) {
+    args.push_back(const_cast<char*>(arg.c_str()));
+  }
+  args.push_back(nullptr);
+
+  pid_t pid = 0;
+  auto spawn_start = std::chrono::steady_clock::now();
+  int spawn_error = posix_spawnp(&pid, args[0], &actions, &attr, args.data(), environ);
+  result.spawn_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - spawn_start).count();
+
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+  close(out_pipe[1]);
+
+  if (spawn_error != 0) {
+    close(out_pipe[0]);
+    return result;
+  }
+  result.started = true;
+
+  //posix_spawn has no rlimit attribute => apply them to the running child
+  //(a decoder stuck in a loop or allocating without bound hits these)
+  if (limits.cpu_seconds > 0) {
+    struct rlimit cpu_limit = {limits.cpu_seconds, limits.cpu_seconds + 1};
+    prlimit(pid, RLIMIT_CPU, &cpu_limit, nullptr);
+  }
+  if (limits.memory_bytes > 0) {
+    struct rlimit memory_limit = {limits.memory_bytes, limits.memory_bytes};
+    prlimit(pid, RLIMIT_AS, &memory_limit, nullptr);
+  }
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(limits.timeout_ms);
+
+  //read straight into a pre-sized buffer, doubling when full
+  std::string& output = result.output;
+  output.resize(expected_output > 0 ? expected_output : 4096);
+  size_t used = 0;
+  while (true) {
+    if (used == output.size()) {
+      output.resize(output.size() * 2);
+    }
+
+    //watchdog: wait for output at most until the deadline
+    if (limits.timeout_ms > 0) {
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now()).count();
+      struct pollfd pfd = {out_pipe[0], POLLIN, 0};
+      int ready = remaining > 0 ? poll(&pfd, 1, static_cast<int>(remaining)) : 0;
+      if (ready < 0 && errno == EINTR) {
+        continue;
+      }
+      if (ready == 0) {
+        result.timed_out = true;
+        kill(pid, SIGKILL);
+        break;
+      }
+    }
+
+    ssize_t n = read(out_pipe[0], &output[used], output.size() - used);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    used += static_cast<size_t>(n);
+  }
+  output.resize(used);
+  close(out_pipe[0]);
+
+  //stdout closed doesn't mean exited (a child can close it and keep running,
+  //or hang in exit) => the reap is bounded by the same deadline
+  int status = 0;
+  bool reaped = false;
+  auto poll_interval = std::chrono::microseconds(200);
+  while (limits.timeout_ms > 0 && !result.timed_out) {
+    pid_t waited = waitpid(pid, &status, WNOHANG);
+    if (waited < 0 && errno == EINTR) {
+      continue;
+    }
+    if (waited != 0) {
+      reaped = true;  //exited (or nothing left to wait for)
+      break;
+    }
+    if (std::chrono::steady_clock::now() >= deadline) {
+      result.timed_out = true;
+      kill(pid, SIGKILL);
+      break;
+    }
+    //short at first: the child usually exits right after its last write
+    std::this_thread::sleep_for(poll_interval);
+    poll_interval = std::min(poll_interval * 2, std::chrono::microseconds(10000));
+  }
+
+  while (!reaped && waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  result.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+  result.term_signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+
+  return result;
+}
+
+bool ProcessRunner::IsExecutableAvailable(const std::string& name) {
+  ProcessResult result = Run({name, "-version"}, 4096);
+  return result.started && result.exit_code == 0;
+}
+
+}  // namespace on_audio_query_linux
@@ -0,0 +1,46 @@
+#ifndef PROCESS_RUNNER_H_
+#define PROCESS_RUNNER_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace on_audio_query_linux {
+
+/// Limits applied to a child process (0 = unlimited)
+struct ProcessLimits {
+  int timeout_ms = 0;         //wall clock, the child is killed when exceeded
+  uint64_t cpu_seconds = 0;   //RLIMIT_CPU
+  uint64_t memory_bytes = 0;  //RLIMIT_AS
+};
+
+/// Result of a finished child process
+struct ProcessResult {
+  std::string output;  //stdout (binary safe)
+  int exit_code;       //-1 when the process could not be started or was killed
+  bool started;
+  bool timed_out;      //killed by the watchdog
+  int term_signal;     //signal that terminated the child (0 = exited normally)
+  int64_t spawn_us;    //time spent in posix_spawn
+};
+
+/// Runs external tools (ffprobe/ffmpeg) without a shell.
+///
+/// Uses posix_spawnp (vfork semantics => no copy of our address space),
+/// an argv vector instead of an escaped command line and a direct pipe
+/// for stdout. stdin and stderr are redirected to /dev/null.
+class ProcessRunner {
+ public:
+  /// Run argv[0] (looked up in PATH) and capture its stdout.
+  /// `expected_output` pre-sizes the read buffer.
+  static ProcessResult Run(const std::vector<std::string>& argv,
+                           size_t expected_output = 16 * 1024,
+                           const ProcessLimits& limits = ProcessLimits());
+
+  /// Check if an executable can be spawned (runs it with `-version`)
+  static bool IsExecutableAvailable(const std::string& name);
+};
+
+}  // namespace on_audio_query_linux
+
+#endif  // PROCESS_RUNNER_H_
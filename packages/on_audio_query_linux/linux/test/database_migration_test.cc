@@ -0,0 +1,244 @@
+#include "core/database_manager.h"
+#include "test_util.h"
+#include <sqlite3.h>
+#include <string>
+#include <set>
+
+using namespace on_audio_query_linux;
+using namespace on_audio_query_linux::test;
+
+namespace {
+
+/// Schema of the first release (user_version 0, or 1 once versioned):
+/// no stream columns, no aggregates bookkeeping, artwork blobs in the database
+const char* kVersion1Schema = R"(
+  CREATE TABLE songs (
+    id INTEGER PRIMARY KEY,
+    file_path TEXT NOT NULL UNIQUE,
+    file_mtime INTEGER NOT NULL,
+    file_size INTEGER NOT NULL,
+    display_name TEXT NOT NULL,
+    display_name_wo_ext TEXT NOT NULL,
+    file_extension TEXT NOT NULL,
+    uri TEXT NOT NULL,
+    title TEXT,
+    artist TEXT,
+    album TEXT,
+    genre TEXT,
+    year INTEGER,
+    track INTEGER,
+    duration INTEGER,
+    album_id INTEGER,
+    artist_id INTEGER,
+    genre_id INTEGER,
+    date_added INTEGER,
+    date_modified INTEGER,
+    is_music INTEGER DEFAULT 1
+  );
+  CREATE TABLE albums (
+    id INTEGER PRIMARY KEY,
+    album TEXT NOT NULL UNIQUE,
+    artist TEXT,
+    artist_id INTEGER,
+    num_of_songs INTEGER DEFAULT 0,
+    first_year INTEGER,
+    last_year INTEGER
+  );
+  CREATE TABLE artists (
+    id INTEGER PRIMARY KEY,
+    artist TEXT NOT NULL UNIQUE,
+    number_of_albums INTEGER DEFAULT 0,
+    number_of_tracks INTEGER DEFAULT 0
+  );
+  CREATE TABLE genres (
+    id INTEGER PRIMARY KEY,
+    name TEXT NOT NULL UNIQUE,
+    num_of_songs INTEGER DEFAULT 0
+  );
+  CREATE TABLE playlists (
+    id INTEGER PRIMARY KEY AUTOINCREMENT,
+    name TEXT NOT NULL UNIQUE,
+    data TEXT,
+    date_added INTEGER,
+    date_modified INTEGER,
+    num_of_songs INTEGER DEFAULT 0
+  );
+  CREATE TABLE playlist_items (
+    id INTEGER PRIMARY KEY AUTOINCREMENT,
+    playlist_id INTEGER NOT NULL,
+    song_id INTEGER NOT NULL,
+    position INTEGER NOT NULL,
+    date_added INTEGER,
+    FOREIGN KEY (playlist_id) REFERENCES playlists(id) ON DELETE CASCADE,
+    FOREIGN KEY (song_id) REFERENCES songs(id) ON DELETE CASCADE,
+    UNIQUE (playlist_id, song_id)
+  );
+  CREATE TABLE artwork_cache (
+    id INTEGER NOT NULL,
+    type INTEGER NOT NULL,
+    format TEXT NOT NULL,
+    data BLOB,
+    cached_at INTEGER,
+    PRIMARY KEY (id, type, format)
+  );
+  CREATE INDEX idx_songs_artist ON songs(artist_id);
+  CREATE INDEX idx_songs_album ON songs(album_id);
+  CREATE INDEX idx_songs_file_path ON songs(file_path);
+
+  INSERT INTO songs (id, file_path, file_mtime, file_size, display_name, display_name_wo_ext,
+                     file_extension, uri, title, artist, album, genre, year, track, duration,
+                     album_id, artist_id, genre_id, date_added, date_modified)
+  VALUES
+    (1, '/music/a/01.mp3', 1700000000, 4000000, '01.mp3', '01', 'mp3', 'file:///music/a/01.mp3',
+     'Blue Monday', 'New Order', 'Power, Corruption & Lies', 'Synthpop', 1983, 1, 447000,
+     101, 201, 301, 1700000000, 1700000000),
+    (2, '/music/a/02.mp3', 1700000000, 3000000, '02.mp3', '02', 'mp3', 'file:///music/a/02.mp3',
+     'Age of Consent', 'New Order', 'Power, Corruption & Lies', 'Synthpop', 1983, 2, 315000,
+     101, 201, 301, 1700000000, 1700000000),
+    (3, '/music/b/01.flac', 1700000000, 30000000, '01.flac', '01', 'flac', 'file:///music/b/01.flac',
+     'Get Lucky', 'Daft Punk feat. Pharrell Williams', 'Random Access Memories', 'Disco', 2013, 8,
+     369000, 102, 202, 302, 1700000000, 1700000000);
+
+  INSERT INTO albums VALUES (101, 'Power, Corruption & Lies', 'New Order', 201, 7, 1983, 1983);
+  INSERT INTO genres VALUES (301, 'Synthpop', 9);
+  INSERT INTO playlists (id, name, num_of_songs) VALUES (1, 'Favourites', 1);
+  INSERT INTO playlist_items (playlist_id, song_id, position) VALUES (1, 3, 0);
+  INSERT INTO artwork_cache VALUES (1, 0, 'jpeg', x'FFD8FFD9', 1700000000);
+)";
+
+bool CreateVersion1Database(const std::string& path, int user_version) {
+  sqlite3* db = nullptr;
+  if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+    sqlite3_close(db);
+    return false;
+  }
+  std::string sql = std::string(kVersion1Schema) + "PRAGMA user_version = " +
+                    std::to_string(user_version) + ";";
+  bool ok = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK;
+  sqlite3_close(db);
+  return ok;
+}
+
+/// Single integer result of `sql` on a separate connection (-1 on error)
+int64_t QueryInt(const std::string& path, const std::string& sql) {
+  sqlite3* db = nullptr;
+  int64_t value = -1;
+  if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+      value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+  }
+  sqlite3_close(db);
+  return value;
+}
+
+std::set<std::string> SearchTitles(DatabaseManager& db, const std::string& term) {
+  QueryParams params;
+  params.search_filter = term;
+  std::set<std::string> titles;
+  for (const auto& song : db.QuerySongs(params)) {
+    titles.insert(song.title);
+  }
+  return titles;
+}
+
+void TestMigration(int from_version) {
+  std::cout << "[DatabaseMigrationTest] from version " << from_version << std::endl;
+  TempDir dir("database_migration_test");
+  std::string path = dir.File("music.db");
+  CHECK(CreateVersion1Database(path, from_version));
+
+  {
+    DatabaseManager db(path);
+    CHECK(db.Initialize());
+
+    //rows kept, stream columns added (0 = unknown), songs re-read by the next scan
+    CHECK_EQ(db.GetSongCount(), int64_t{3});
+    auto song = db.GetSongByPath("/music/a/01.mp3");
+    CHECK(song.has_value());
+    if (song) {
+      CHECK_EQ(song->title, std::string("Blue Monday"));
+      CHECK_EQ(song->duration, int64_t{447000});
+      CHECK_EQ(song->bitrate, 0);
+      CHECK_EQ(song->codec, std::string(""));
+      CHECK_EQ(song->file_mtime, int64_t{0});
+    }
+
+    //aggregates rebuilt from the songs (the stale counts are gone)
+    auto album = db.GetAlbumById(101);
+    CHECK(album.has_value());
+    if (album) {
+      CHECK_EQ(album->num_of_songs, 2);
+    }
+    auto genre = db.GetGenreById(301);
+    CHECK(genre.has_value());
+    if (genre) {
+      CHECK_EQ(genre->num_of_songs, 2);
+    }
+    CHECK_EQ(db.QueryAlbums().size(), size_t{2});
+
+    //split artists credited on their own
+    std::set<std::string> artists;
+    for (const auto& artist : db.QueryArtists()) {
+      artists.insert(artist.artist);
+    }
+    CHECK(artists.count("New Order") == 1);
+    CHECK(artists.count("Daft Punk") == 1);
+    CHECK(artists.count("Pharrell Williams") == 1);
+
+    //search index built for the existing rows: word prefixes and infixes
+    CHECK(SearchTitles(db, "blue") == std::set<std::string>{"Blue Monday"});
+    CHECK(SearchTitles(db, "new ord") == (std::set<std::string>{"Blue Monday", "Age of Consent"}));
+    CHECK(SearchTitles(db, "harrell") == std::set<std::string>{"Get Lucky"});
+    CHECK(SearchTitles(db, "corruption").size() == 2);
+
+    //playlists survive
+    auto playlists = db.QueryPlaylists();
+    CHECK_EQ(playlists.size(), size_t{1});
+    if (!playlists.empty()) {
+      auto songs = db.GetPlaylistSongs(playlists[0].id);
+      CHECK_EQ(songs.size(), size_t{1});
+    }
+
+    CHECK(db.CheckIntegrity());
+  }
+
+  CHECK_EQ(QueryInt(path, "PRAGMA user_version"), int64_t{12});
+  CHECK_EQ(QueryInt(path, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'artwork_cache' "
+                          "AND sql LIKE '%data BLOB%'"), int64_t{0});
+  CHECK_EQ(QueryInt(path, "SELECT COUNT(*) FROM songs_fts"), int64_t{3});
+  CHECK_EQ(QueryInt(path, "SELECT COUNT(*) FROM songs_trigram"), int64_t{3});
+
+  //opening the migrated database again is a no-op
+  {
+    DatabaseManager db(path);
+    CHECK(db.Initialize());
+    CHECK_EQ(db.GetSongCount(), int64_t{3});
+    CHECK(SearchTitles(db, "lucky") == std::set<std::string>{"Get Lucky"});
+  }
+  CHECK_EQ(QueryInt(path, "PRAGMA user_version"), int64_t{12});
+}
+
+void TestFreshDatabase() {
+  TempDir dir("database_migration_test");
+  std::string path = dir.File("music.db");
+  {
+    DatabaseManager db(path);
+    CHECK(db.Initialize());
+    CHECK(db.IsDatabaseEmpty());
+  }
+  CHECK_EQ(QueryInt(path, "PRAGMA user_version"), int64_t{12});
+}
+
+}  // namespace
+
+int main() {
+  //0: databases written before the schema was versioned
+  TestMigration(0);
+  TestMigration(1);
+  TestFreshDatabase();
+  return Finish("DatabaseMigrationTest");
+}
@@ -0,0 +1,141 @@
+#include "core/tag_reader.h"
+#include "core/ffprobe_json_parser.h"
+#include "utils/process_runner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace on_audio_query_linux;
+
+/// Native tag reader vs the ffprobe path over the audio files of a directory.
+///
+///   extraction_benchmark <music dir> [rounds]
+///
+/// Both paths get one untimed warm-up pass (page cache), then every file is
+/// read `rounds` times. The ffprobe path spawns ffprobe from PATH with the
+/// argv of FFprobeExtractor::RunFFprobe and parses its output, as a fallback
+/// extraction does. Not a test: numbers depend on the machine and the files.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+//same extensions as FileScanner::IsAudioFile
+bool IsAudioFile(const std::filesystem::path& path) {
+  static const std::vector<std::string> kExtensions = {
+    ".mp3", ".flac", ".ogg", ".m4a", ".wav", ".aac",
+    ".wma", ".opus", ".ape", ".wv", ".oga", ".mpc"
+  };
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+  return std::find(kExtensions.begin(), kExtensions.end(), extension) != kExtensions.end();
+}
+
+std::vector<std::string> CollectFiles(const std::string& root) {
+  std::vector<std::string> files;
+  std::error_code error;
+  for (std::filesystem::recursive_directory_iterator it(root, error), end; it != end;
+       it.increment(error)) {
+    if (!error && it->is_regular_file(error) && IsAudioFile(it->path())) {
+      files.push_back(it->path().string());
+    }
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+bool ReadNative(TagReader& reader, const std::string& file) {
+  return reader.Read(file).has_value();
+}
+
+//keep in sync with FFprobeExtractor::RunFFprobe
+bool ReadFFprobe(const std::string& file) {
+  std::vector<std::string> argv = {
+    "ffprobe", "-v", "quiet", "-print_format", "json",
+    "-select_streams", "a:0",
+    "-show_entries",
+    "stream=codec_type,codec_name,sample_rate,channels,bits_per_sample,bits_per_raw_sample,bit_rate"
+    ":format=duration,size,bit_rate"
+    ":format_tags=artist,album,title,genre,date,track,disc,composer,album_artist,albumartist",
+    file
+  };
+  ProcessResult result = ProcessRunner::Run(argv);
+  if (!result.started || result.exit_code != 0) {
+    return false;
+  }
+  TagInfo info;
+  return FFprobeJsonParser::Parse(result.output, info);
+}
+
+struct Timing {
+  double seconds = 0;
+  size_t reads = 0;
+  size_t succeeded = 0;
+};
+
+template <typename Read>
+Timing Measure(const std::vector<std::string>& files, int rounds, Read read) {
+  for (const auto& file : files) {
+    read(file);  //warm-up
+  }
+
+  Timing timing;
+  auto start = Clock::now();
+  for (int round = 0; round < rounds; ++round) {
+    for (const auto& file : files) {
+      ++timing.reads;
+      if (read(file)) ++timing.succeeded;
+    }
+  }
+  timing.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return timing;
+}
+
+void Report(const char* name, const Timing& timing) {
+  double per_second = timing.seconds > 0 ? timing.reads / timing.seconds : 0;
+  std::cout << std::left << std::setw(8) << name << std::right
+            << std::setw(12) << std::fixed << std::setprecision(1) << per_second << " files/s"
+            << std::setw(10) << std::setprecision(1) << timing.seconds * 1e6 / std::max<size_t>(timing.reads, 1)
+            << " us/file  (" << timing.succeeded << "/" << timing.reads << " read)" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " <music dir> [rounds]" << std::endl;
+    return 2;
+  }
+  int rounds = argc > 2 ? std::max(1, std::atoi(argv[2])) : 3;
+
+  auto files = CollectFiles(argv[1]);
+  if (files.empty()) {
+    std::cerr << "[ExtractionBenchmark] no audio files under " << argv[1] << std::endl;
+    return 1;
+  }
+  std::cout << "[ExtractionBenchmark] " << files.size() << " files, " << rounds << " round(s)" << std::endl;
+
+  TagReader reader;
+  Timing native = Measure(files, rounds, [&reader](const std::string& file) {
+    return ReadNative(reader, file);
+  });
+  Report("native", native);
+
+  if (!ProcessRunner::IsExecutableAvailable("ffprobe")) {
+    std::cout << "ffprobe  not found in PATH, skipped" << std::endl;
+    return 0;
+  }
+  Timing ffprobe = Measure(files, rounds, ReadFFprobe);
+  Report("ffprobe", ffprobe);
+
+  if (native.seconds > 0 && ffprobe.seconds > 0) {
+    double ratio = (native.reads / native.seconds) / (ffprobe.reads / ffprobe.seconds);
+    std::cout << "native/ffprobe " << std::setprecision(1) << ratio << "x" << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,164 @@
+#include "core/ffprobe_json_parser.h"
+#include "test_util.h"
+#include <string>
+
+using namespace on_audio_query_linux;
+using namespace on_audio_query_linux::test;
+
+namespace {
+
+/// Hand-written samples in the layout of `ffprobe -v quiet -print_format json
+/// -show_entries ...` output (the arguments FFprobeExtractor runs it with)
+std::string Fixture(const std::string& name) {
+  std::string json = ReadTextFile(std::string(TEST_DATA_DIR) + "/ffprobe/" + name);
+  CHECK(!json.empty());
+  return json;
+}
+
+void TestMp3() {
+  TagInfo info;
+  CHECK(FFprobeJsonParser::Parse(Fixture("mp3_id3v2.json"), info));
+  CHECK_EQ(info.duration_ms, int64_t{215640});
+  CHECK_EQ(info.bitrate, 320000);  //stream bitrate wins over the container average
+  CHECK_EQ(info.sample_rate, 44100);
+  CHECK_EQ(info.channels, 2);
+  CHECK_EQ(info.bit_depth, 0);
+  CHECK_EQ(info.codec, std::string("mp3"));
+  CHECK_EQ(info.GetTag("title", ""), std::string("Harder, Better, Faster, Stronger"));
+  CHECK_EQ(info.GetTag("artist", ""), std::string("Daft Punk"));
+  CHECK_EQ(info.GetTag("album", ""), std::string("Discovery"));
+  CHECK_EQ(info.GetTag("genre", ""), std::string("Electronic"));
+  CHECK_EQ(info.GetTag("date", ""), std::string("2001"));
+  CHECK_EQ(info.GetTag("track", ""), std::string("4/14"));
+  CHECK_EQ(info.GetTag("disc", ""), std::string("1/1"));
+  CHECK_EQ(info.GetTag("album_artist", ""), std::string("Daft Punk"));
+}
+
+void TestFlac() {
+  TagInfo info;
+  CHECK(FFprobeJsonParser::Parse(Fixture("flac_vorbis.json"), info));
+  CHECK_EQ(info.duration_ms, int64_t{412253});
+  CHECK_EQ(info.bitrate, 2296643);  //no stream bitrate => container average
+  CHECK_EQ(info.sample_rate, 96000);
+  CHECK_EQ(info.bit_depth, 24);
+  CHECK_EQ(info.codec, std::string("flac"));
+
+  //upper case Vorbis keys, escapes and UTF-8 passed through
+  CHECK_EQ(info.GetTag("title", ""), std::string("Caf\xC3\xA9 \"Noir\" \\ Live"));
+  CHECK_EQ(info.GetTag("artist", ""), std::string("Bj\xC3\xB6rk"));
+  CHECK_EQ(info.GetTag("album", ""),
+           std::string("\xE6\x9D\xB1\xE4\xBA\xAC \xF0\x9F\x8E\xB5 Sessions"));
+  CHECK_EQ(info.GetTag("track", ""), std::string("7"));
+  CHECK_EQ(info.GetTag("disc", ""), std::string("2"));
+  CHECK_EQ(info.GetTag("composer", ""), std::string("Bj\xC3\xB6rk Gu\xC3\xB0mundsd\xC3\xB3ttir"));
+  CHECK_EQ(info.GetTag("album_artist", ""), std::string("Various Artists"));
+}
+
+void TestM4a() {
+  TagInfo info;
+  CHECK(FFprobeJsonParser::Parse(Fixture("m4a_aac.json"), info));
+  CHECK_EQ(info.duration_ms, int64_t{187008});
+  CHECK_EQ(info.bitrate, 256006);
+  CHECK_EQ(info.sample_rate, 48000);
+  CHECK_EQ(info.codec, std::string("aac"));
+  CHECK_EQ(info.GetTag("album", ""), std::string("Hurry Up, We're Dreaming"));
+  CHECK_EQ(info.GetTag("date", ""), std::string("2011-10-18T07:00:00Z"));
+  CHECK_EQ(info.GetTag("composer", ""), std::string("Anthony Gonzalez"));
+}
+
+void TestUntagged() {
+  TagInfo info;
+  CHECK(FFprobeJsonParser::Parse(Fixture("wav_untagged.json"), info));
+  CHECK_EQ(info.duration_ms, int64_t{3000});
+  CHECK_EQ(info.bit_depth, 16);
+  CHECK_EQ(info.channels, 1);
+  CHECK_EQ(info.codec, std::string("pcm_s16le"));
+  CHECK(info.tags.empty());
+
+  //"N/A" leaves the fields unknown
+  TagInfo unknown;
+  CHECK(FFprobeJsonParser::Parse(Fixture("ogg_unknown_duration.json"), unknown));
+  CHECK_EQ(unknown.duration_ms, int64_t{0});
+  CHECK_EQ(unknown.bitrate, 0);
+  CHECK_EQ(unknown.sample_rate, 44100);
+  CHECK_EQ(unknown.codec, std::string("vorbis"));
+}
+
+void TestStreamsAndTags() {
+  //codec_type after the other keys, first audio stream wins
+  TagInfo info;
+  CHECK(FFprobeJsonParser::Parse(
+      R"({"streams":[{"codec_name":"mjpeg","channels":0,"codec_type":"video"},)"
+      R"({"sample_rate":22050,"codec_name":"opus","codec_type":"audio"},)"
+      R"({"codec_type":"audio","codec_name":"aac"}],)"
+      R"("format":{"duration":12.5,"tags":{"TITLE":"First","title":"Second","Title":""}}})",
+      info));
+  CHECK_EQ(info.codec, std::string("opus"));
+  CHECK_EQ(info.sample_rate, 22050);
+  CHECK_EQ(info.duration_ms, int64_t{12500});
+  CHECK_EQ(info.GetTag("title", ""), std::string("First"));
+
+  //\u escapes including a surrogate pair, unknown and overlong keys skipped
+  TagInfo escaped;
+  CHECK(FFprobeJsonParser::Parse(
+      R"({"format":{"tags":{"artist":"A\u00e9\ud83c\udfb5\n\/",)"
+      R"("a_key_much_longer_than_any_tag_we_map_at_all":"x","encoder":{"nested":[1,2,{}]}}}})",
+      escaped));
+  CHECK_EQ(escaped.GetTag("artist", ""), std::string("A\xC3\xA9\xF0\x9F\x8E\xB5\n/"));
+  CHECK_EQ(escaped.tags.size(), size_t{1});
+
+  TagInfo empty;
+  CHECK(FFprobeJsonParser::Parse("{}", empty));
+  CHECK(FFprobeJsonParser::Parse(R"({"streams":[],"format":{}})", empty));
+}
+
+void TestMalformed() {
+  const char* malformed[] = {
+    "",
+    "[]",
+    "{",
+    R"({"format")",
+    R"({"format":{"duration":"1.0"})",
+    R"({"format":{"tags":{"title":"unterminated}}})",
+    R"({"format":{"tags":{"title":"bad escape \x"}}})",
+    R"({"format":{"tags":{"title":"cut escape \u12"}}})",
+    R"({"streams":[{"codec_name":"mp3"},]})",
+    R"({"format":{"tags":{"title" "missing colon"}}})",
+    R"({"unknown":[1,2,)",
+  };
+  for (const char* json : malformed) {
+    TagInfo info;
+    bool parsed = FFprobeJsonParser::Parse(json, info);
+    if (parsed) {
+      std::cerr << "parsed malformed input: " << json << std::endl;
+    }
+    CHECK(!parsed);
+  }
+
+  //skipped values nest deeper than the parser recurses
+  std::string deep = R"({"unknown":)" + std::string(100000, '[') + std::string(100000, ']') + "}";
+  TagInfo info;
+  CHECK(!FFprobeJsonParser::Parse(deep, info));
+
+  //output cut off by a crashing or killed ffprobe
+  for (const char* name : {"mp3_id3v2.json", "flac_vorbis.json", "m4a_aac.json"}) {
+    std::string json = Fixture(name);
+    size_t complete = json.rfind('}');
+    for (size_t length = 0; length < complete; ++length) {
+      TagInfo partial;
+      CHECK(!FFprobeJsonParser::Parse(json.substr(0, length), partial));
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestMp3();
+  TestFlac();
+  TestM4a();
+  TestUntagged();
+  TestStreamsAndTags();
+  TestMalformed();
+  return Finish("FFprobeJsonParserTest");
+}
@@ -0,0 +1,131 @@
+#include "core/ffprobe_json_parser.h"
+#include "utils/string_utils.h"
+#include "test_util.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using namespace on_audio_query_linux;
+using json = nlohmann::json;
+
+/// FFprobeJsonParser vs a nlohmann::json DOM parse of the same ffprobe output.
+///
+///   ffprobe_parser_benchmark [iterations] [sample.json ...]
+///
+/// Without files the samples under data/ffprobe are used. Every sample is
+/// parsed `iterations` times by each parser. Not a test: numbers depend on
+/// the machine.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const kDefaultSamples[] = {
+  "mp3_id3v2.json", "flac_vorbis.json", "m4a_aac.json",
+  "wav_untagged.json", "ogg_unknown_duration.json"
+};
+
+int ToInt(const json& value) {
+  if (value.is_number_integer()) return value.get<int>();
+  if (value.is_string()) return std::atoi(value.get<std::string>().c_str());
+  return 0;
+}
+
+/// What the extractor did before FFprobeJsonParser: full DOM, then every tag
+/// key lowercased into the map and the first audio stream looked up by key
+bool ParseDom(const std::string& output, TagInfo& info) {
+  json j = json::parse(output, nullptr, false);
+  if (j.is_discarded() || !j.is_object()) {
+    return false;
+  }
+
+  if (j.contains("streams") && j["streams"].is_array()) {
+    for (const auto& stream : j["streams"]) {
+      if (stream.value("codec_type", "") != "audio") continue;
+      info.codec = stream.value("codec_name", "");
+      if (stream.contains("sample_rate")) info.sample_rate = ToInt(stream["sample_rate"]);
+      if (stream.contains("channels")) info.channels = ToInt(stream["channels"]);
+      if (stream.contains("bits_per_sample")) info.bit_depth = ToInt(stream["bits_per_sample"]);
+      if (stream.contains("bit_rate")) info.bitrate = ToInt(stream["bit_rate"]);
+      break;
+    }
+  }
+
+  if (j.contains("format") && j["format"].is_object()) {
+    const auto& format = j["format"];
+    if (format.contains("duration") && format["duration"].is_string()) {
+      info.duration_ms = static_cast<int64_t>(std::atof(format["duration"].get<std::string>().c_str()) * 1000);
+    }
+    if (format.contains("tags") && format["tags"].is_object()) {
+      for (auto it = format["tags"].begin(); it != format["tags"].end(); ++it) {
+        if (it.value().is_string()) {
+          info.tags.emplace(StringUtils::ToLower(it.key()), it.value().get<std::string>());
+        }
+      }
+    }
+  }
+  return true;
+}
+
+template <typename Parse>
+double Measure(const std::vector<std::string>& samples, int iterations, Parse parse) {
+  size_t parsed = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    for (const auto& sample : samples) {
+      TagInfo info;
+      if (parse(sample, info)) ++parsed;
+    }
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  if (parsed != samples.size() * static_cast<size_t>(iterations)) {
+    std::cerr << "[FFprobeParserBenchmark] some samples failed to parse" << std::endl;
+  }
+  return seconds;
+}
+
+void Report(const char* name, double seconds, size_t parses, size_t bytes) {
+  std::cout << std::left << std::setw(8) << name << std::right << std::fixed
+            << std::setw(10) << std::setprecision(2) << seconds * 1e6 / parses << " us/parse"
+            << std::setw(10) << std::setprecision(1) << bytes / seconds / (1024 * 1024) << " MB/s" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 20000;
+
+  std::vector<std::string> samples;
+  if (argc > 2) {
+    for (int i = 2; i < argc; ++i) samples.push_back(test::ReadTextFile(argv[i]));
+  } else {
+    for (const char* name : kDefaultSamples) {
+      samples.push_back(test::ReadTextFile(std::string(TEST_DATA_DIR) + "/ffprobe/" + name));
+    }
+  }
+  size_t sample_bytes = 0;
+  for (const auto& sample : samples) {
+    if (sample.empty()) {
+      std::cerr << "[FFprobeParserBenchmark] empty or missing sample" << std::endl;
+      return 1;
+    }
+    sample_bytes += sample.size();
+  }
+
+  size_t parses = samples.size() * static_cast<size_t>(iterations);
+  size_t bytes = sample_bytes * static_cast<size_t>(iterations);
+  std::cout << "[FFprobeParserBenchmark] " << samples.size() << " samples (" << sample_bytes
+            << " bytes), " << iterations << " iterations" << std::endl;
+
+  double streaming = Measure(samples, iterations, FFprobeJsonParser::Parse);
+  double dom = Measure(samples, iterations, ParseDom);
+  Report("single", streaming, parses, bytes);
+  Report("dom", dom, parses, bytes);
+  std::cout << "dom/single " << std::setprecision(1) << dom / streaming << "x" << std::endl;
+  return 0;
+}
@@ -0,0 +1,228 @@
+#include "core/database_manager.h"
+#include "core/ffprobe_extractor.h"
+#include "core/search_session.h"
+#include "core/thread_pool.h"
+#include "scanner/scan_coordinator.h"
+#include "utils/artist_separator.h"
+#include "test_util.h"
+#include <sqlite3.h>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace on_audio_query_linux;
+using namespace on_audio_query_linux::test;
+
+namespace {
+
+/// Over ScanCoordinator::kFastFirstMinFiles => placeholders first, then enrichment
+constexpr int kFileCount = 640;
+constexpr int kGuestCount = 5;
+
+/// PCM WAV with RIFF INFO tags (read in-process, no ffprobe needed)
+std::vector<uint8_t> MakeWav(const std::string& title, const std::string& artist,
+                             const std::string& album) {
+  std::vector<uint8_t> info;
+  AppendBytes(info, "INFO");
+  for (const auto& [id, value] : {std::make_pair("INAM", title), std::make_pair("IART", artist),
+                                  std::make_pair("IPRD", album)}) {
+    std::string padded = value + std::string(value.size() % 2, '\0');
+    AppendBytes(info, id);
+    AppendLE32(info, static_cast<uint32_t>(padded.size()));
+    AppendBytes(info, padded);
+  }
+
+  std::vector<uint8_t> body;
+  AppendBytes(body, "WAVE");
+  AppendBytes(body, "fmt ");
+  AppendLE32(body, 16);
+  AppendLE16(body, 1);     //PCM
+  AppendLE16(body, 1);     //mono
+  AppendLE32(body, 8000);  //Hz
+  AppendLE32(body, 8000);  //bytes per second
+  AppendLE16(body, 1);
+  AppendLE16(body, 8);
+  AppendBytes(body, "LIST");
+  AppendLE32(body, static_cast<uint32_t>(info.size()));
+  body.insert(body.end(), info.begin(), info.end());
+  AppendBytes(body, "data");
+  AppendLE32(body, 8000);
+  body.resize(body.size() + 8000, 0x80);
+
+  std::vector<uint8_t> out;
+  AppendBytes(out, "RIFF");
+  AppendLE32(out, static_cast<uint32_t>(body.size()));
+  out.insert(out.end(), body.begin(), body.end());
+  return out;
+}
+
+std::string Artist(int i) {
+  return "Band " + std::to_string(i % 40) + " feat. Guest " + std::to_string(i % kGuestCount);
+}
+
+std::string Album(int i) {
+  return "Record " + std::to_string(i % 40);
+}
+
+std::string FilePath(const TempDir& dir, int i) {
+  return dir.Path() + "/music/" + std::to_string(i / 100) + "/track_" + std::to_string(i) + ".wav";
+}
+
+bool WriteLibrary(const TempDir& dir) {
+  bool ok = true;
+  for (int i = 0; i < kFileCount; ++i) {
+    std::string path = FilePath(dir, i);
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+    ok = WriteFile(path, MakeWav("Track " + std::to_string(i), Artist(i), Album(i))) && ok;
+  }
+  return ok;
+}
+
+int64_t CountSongsFromOtherConnection(const std::string& db_path) {
+  sqlite3* db = nullptr;
+  int64_t count = -1;
+  if (sqlite3_open_v2(db_path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM songs", -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+      count = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+  }
+  sqlite3_close(db);
+  return count;
+}
+
+/// Everything the UI does while a scan runs, from one thread
+struct QueryLoad {
+  int rounds = 0;
+  int compactions_deferred = 0;
+  std::set<size_t> song_counts_seen;
+  bool failed = false;
+
+  void Run(DatabaseManager& db, const std::atomic<bool>& done) {
+    SearchSession session(&db);
+    int64_t guest_id = ArtistSeparator::Instance().GenerateSplitArtistId("Guest 1");
+
+    while (!done) {
+      song_counts_seen.insert(db.QuerySongs().size());
+
+      db.QueryArtists();
+      QueryParams guest_albums;
+      guest_albums.artist_filter = guest_id;
+      db.QueryAlbums(guest_albums);
+      db.QueryGenres();
+
+      if (!session.Search("track 1", session.Supersede())) {
+        failed = true;
+      }
+
+      //what ArtworkStore's maintenance pass writes on the shared connection
+      if (!db.RecordArtworkAccess({{"0123456789abcdef0123456789abcdef", std::time(nullptr), 1}})) {
+        failed = true;
+      }
+      bool deferred = false;
+      db.CompactDatabase(0.0, &deferred);
+      compactions_deferred += deferred ? 1 : 0;
+
+      ++rounds;
+    }
+  }
+};
+
+void CheckLibrary(DatabaseManager& db, const std::string& db_path, int expected_songs) {
+  CHECK_EQ(db.GetSongCount(), int64_t{expected_songs});
+  //committed for everyone: no transaction left open on the writer
+  CHECK_EQ(CountSongsFromOtherConnection(db_path), int64_t{expected_songs});
+
+  int placeholders = 0;
+  for (const auto& song : db.QuerySongs()) {
+    if (song.file_mtime == 0 || song.title.rfind("Track ", 0) != 0) {
+      ++placeholders;
+    }
+  }
+  CHECK_EQ(placeholders, 0);
+
+  //split artists: every guest is credited on the albums of their songs
+  std::set<std::string> artists;
+  for (const auto& artist : db.QueryArtists()) {
+    artists.insert(artist.artist);
+  }
+  for (int guest = 0; guest < kGuestCount; ++guest) {
+    std::string name = "Guest " + std::to_string(guest);
+    CHECK(artists.count(name) == 1);
+
+    QueryParams params;
+    params.artist_filter = ArtistSeparator::Instance().GenerateSplitArtistId(name);
+    CHECK(!db.QueryAlbums(params).empty());
+  }
+}
+
+}  // namespace
+
+int main() {
+  TempDir dir("scan_query_test");
+  CHECK(WriteLibrary(dir));
+
+  std::string db_path = dir.File("music.db");
+  DatabaseManager db(db_path);
+  CHECK(db.Initialize());
+
+  FFprobeExtractor extractor;
+  ThreadPool thread_pool(4);
+  ScanCoordinator scanner(&db, &extractor, &thread_pool);
+  scanner.SetFastFirstScan(true);
+
+  //full scan with queries running against it
+  std::atomic<bool> done{false};
+  QueryLoad load;
+  std::thread queries([&] { load.Run(db, done); });
+  scanner.FullScan(dir.Path() + "/music");
+  done = true;
+  queries.join();
+
+  std::cout << "[ScanQueryTest] " << load.rounds << " query rounds during the scan, "
+            << load.compactions_deferred << " compactions deferred" << std::endl;
+  CHECK(!load.failed);
+  //readers only ever see whole scan transactions: nothing, then every placeholder
+  for (size_t count : load.song_counts_seen) {
+    CHECK(count == 0 || count == static_cast<size_t>(kFileCount));
+  }
+  CHECK(load.rounds > 0);
+  CheckLibrary(db, db_path, kFileCount);
+
+  //incremental scan after edits and deletions, queries still running
+  for (int i = 0; i < kFileCount; i += 10) {
+    std::string path = FilePath(dir, i);
+    if (i % 20 == 0) {
+      std::filesystem::remove(path);
+    } else {
+      WriteFile(path, MakeWav("Track " + std::to_string(i) + " (Remastered)", Artist(i), Album(i)));
+      std::filesystem::last_write_time(
+          path, std::filesystem::last_write_time(path) + std::chrono::seconds(5));
+    }
+  }
+  int remaining = kFileCount - (kFileCount + 19) / 20;
+
+  done = false;
+  QueryLoad incremental_load;
+  queries = std::thread([&] { incremental_load.Run(db, done); });
+  scanner.IncrementalScan(dir.Path() + "/music");
+  done = true;
+  queries.join();
+
+  CHECK(!incremental_load.failed);
+  for (size_t count : incremental_load.song_counts_seen) {
+    CHECK(count == static_cast<size_t>(kFileCount) || count == static_cast<size_t>(remaining));
+  }
+  CheckLibrary(db, db_path, remaining);
+  QueryParams remastered;
+  remastered.search_filter = "remastered";
+  CHECK_EQ(db.QuerySongs(remastered).size(), static_cast<size_t>(kFileCount / 20));
+
+  return Finish("ScanQueryTest");
+}
@@ -0,0 +1,218 @@
+#include "core/database_manager.h"
+#include "core/search_session.h"
+#include "test_util.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace on_audio_query_linux;
+using namespace on_audio_query_linux::test;
+
+namespace {
+
+constexpr int kSongCount = 60000;
+
+const char* const kWords[] = {
+  "beat", "beach", "bear", "bee", "abbey", "alphabet", "heartbeat", "night",
+  "river", "Beyoncé", "Åsa", "ocean", "neon", "electric", "dream", "summer", "echo",
+};
+constexpr int kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+SongMetadata MakeSong(int i) {
+  SongMetadata song{};
+  song.id = i + 1;
+  song.title = std::string(kWords[i % kWordCount]) + " " + kWords[(i / kWordCount) % kWordCount] +
+               " " + std::to_string(i);
+  song.artist = std::string("Artist ") + kWords[(i / 7) % kWordCount];
+  song.album = "Album " + std::to_string(i / 12);
+  song.genre = i % 2 ? "Rock" : "Electronic";
+  song.data = "/music/" + std::to_string(i / 100) + "/" + std::to_string(i) + ".mp3";
+  song.uri = "file://" + song.data;
+  song.display_name = std::to_string(i) + ".mp3";
+  song.display_name_wo_ext = std::to_string(i);
+  song.file_extension = "mp3";
+  song.file_mtime = 1700000000;
+  song.size = 4000000;
+  song.duration = 180000;
+  song.album_id = 1000 + i / 12;
+  song.artist_id = 2000 + (i / 7) % kWordCount;
+  song.genre_id = 3000 + i % 2;
+  song.is_music = true;
+  return song;
+}
+
+bool Populate(DatabaseManager& db) {
+  bool ok = true;
+  db.BeginTransaction();
+  for (int i = 0; i < kSongCount; ++i) {
+    ok = db.InsertSong(MakeSong(i)) && ok;
+  }
+  db.CommitTransaction();
+  db.UpdateAggregatedTables();
+  return ok;
+}
+
+std::vector<int64_t> Ids(const std::vector<SongMetadata>& songs) {
+  std::vector<int64_t> ids;
+  for (const auto& song : songs) {
+    ids.push_back(song.id);
+  }
+  return ids;
+}
+
+std::vector<int64_t> SortedIds(const std::vector<SongMetadata>& songs) {
+  auto ids = Ids(songs);
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+std::vector<SongMetadata> FreshQuery(DatabaseManager& db, const std::string& term) {
+  QueryParams params;
+  params.search_filter = term;
+  return db.QuerySongs(params);
+}
+
+/// Typing a term one character at a time answers every prefix like a fresh
+/// query (refined in memory when possible)
+void TestTypingMatchesFreshQueries(DatabaseManager& db) {
+  const char* const typed[] = {"b", "be", "bea", "beat", "beat ", "beat h", "beat he",
+                               "beat hea", "beyon", "beyonc", "a", "al", "alp", "alph"};
+  SearchSession session(&db);
+  for (const char* term : typed) {
+    auto results = session.Search(term, session.Supersede());
+    CHECK(results != nullptr);
+    if (!results) {
+      continue;
+    }
+    auto expected = FreshQuery(db, term);
+    if (SortedIds(*results) != SortedIds(expected)) {
+      std::cerr << "term \"" << term << "\": " << results->size() << " results, fresh query "
+                << expected.size() << std::endl;
+      CHECK(false);
+    }
+  }
+}
+
+/// A write landing between two keystrokes is seen by the next one
+void TestWritesInvalidateRefinement(DatabaseManager& db) {
+  SearchSession session(&db);
+  auto before = session.Search("zeph", session.Supersede());
+  CHECK(before != nullptr && before->empty());
+
+  SongMetadata song = MakeSong(kSongCount);
+  song.title = "Zephyr Song";
+  song.data = "/music/new/zephyr.mp3";
+  db.BeginTransaction();
+  CHECK(db.InsertSong(song));
+  db.CommitTransaction();
+
+  auto after = session.Search("zephy", session.Supersede());
+  CHECK(after != nullptr && after->size() == 1);
+
+  auto inserted = db.GetSongByPath(song.data);
+  CHECK(inserted.has_value() && db.DeleteSong(inserted->id));
+  after = session.Search("zephyr", session.Supersede());
+  CHECK(after != nullptr && after->empty());
+}
+
+void TestCancellation(DatabaseManager& db) {
+  SearchSession session(&db);
+
+  //already superseded before it starts
+  uint64_t stale = session.Supersede();
+  session.Supersede();
+  CHECK(session.Search("beat", stale) == nullptr);
+
+  //QuerySongs polls its callback while the statement runs
+  QueryParams params;
+  params.search_filter = "e";
+  int polls = 0;
+  auto cancelled = db.QuerySongs(params, [&polls] { return ++polls > 2; });
+  CHECK(!cancelled.has_value());
+  CHECK(polls > 2);
+  auto uncancelled = db.QuerySongs(params, [] { return false; });
+  CHECK(uncancelled.has_value() && !uncancelled->empty());
+
+  //a keystroke arriving while a search runs: the running search stops and
+  //returns nothing (a search already done by then returns its full results)
+  auto start = std::chrono::steady_clock::now();
+  size_t full_size = FreshQuery(db, "e").size();
+  auto full_duration = std::chrono::steady_clock::now() - start;
+  std::cout << "[SearchSessionTest] full search: " << full_size << " songs in "
+            << std::chrono::duration_cast<std::chrono::microseconds>(full_duration).count()
+            << " us" << std::endl;
+
+  int stopped = 0;
+  for (int attempt = 0; attempt < 10; ++attempt) {
+    SearchSession racing(&db);
+    uint64_t generation = racing.Supersede();
+    std::atomic<bool> started{false};
+    SearchSession::Results results;
+    std::chrono::steady_clock::time_point returned_at;
+    std::thread search([&] {
+      started = true;
+      results = racing.Search("e", generation);
+      returned_at = std::chrono::steady_clock::now();
+    });
+    while (!started) {
+      std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(500 * attempt));
+    auto superseded_at = std::chrono::steady_clock::now();
+    racing.Supersede();
+    search.join();
+
+    if (results) {
+      CHECK_EQ(results->size(), full_size);  //complete, never partial
+    } else {
+      ++stopped;
+      auto latency = returned_at - superseded_at;
+      CHECK(latency < full_duration + std::chrono::milliseconds(20));
+    }
+  }
+  CHECK(stopped > 0);
+}
+
+/// Keystrokes searched on several threads: the newest one is always answered,
+/// older ones either in full or not at all
+void TestConcurrentKeystrokes(DatabaseManager& db) {
+  SearchSession session(&db);
+  const std::vector<std::string> terms = {"n", "ne", "neo", "neon", "neon ", "neon d",
+                                          "neon dr", "neon dre", "neon drea", "neon dream"};
+  std::vector<SearchSession::Results> results(terms.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < terms.size(); ++i) {
+    uint64_t generation = session.Supersede();
+    threads.emplace_back([&, i, generation] { results[i] = session.Search(terms[i], generation); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  CHECK(results.back() != nullptr);
+  for (size_t i = 0; i < terms.size(); ++i) {
+    if (results[i]) {
+      CHECK(SortedIds(*results[i]) == SortedIds(FreshQuery(db, terms[i])));
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  TempDir dir("search_session_test");
+  DatabaseManager db(dir.File("music.db"));
+  CHECK(db.Initialize());
+  CHECK(Populate(db));
+  CHECK_EQ(db.GetSongCount(), int64_t{kSongCount});
+
+  TestTypingMatchesFreshQueries(db);
+  TestWritesInvalidateRefinement(db);
+  TestCancellation(db);
+  TestConcurrentKeystrokes(db);
+
+  return Finish("SearchSessionTest");
+}
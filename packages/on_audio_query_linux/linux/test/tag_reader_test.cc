@@ -0,0 +1,456 @@
+#include "core/tag_reader.h"
+#include "test_util.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace on_audio_query_linux;
+using namespace on_audio_query_linux::test;
+
+namespace {
+
+/// ID3v2.3 text frame (encoding 0 = Latin-1)
+void AppendId3Frame(std::vector<uint8_t>& out, const std::string& id, const std::string& text) {
+  AppendBytes(out, id);
+  AppendBE32(out, static_cast<uint32_t>(text.size() + 1));
+  out.push_back(0);
+  out.push_back(0);
+  out.push_back(0);
+  AppendBytes(out, text);
+}
+
+std::vector<uint8_t> Id3Header(uint32_t tag_size) {
+  std::vector<uint8_t> out;
+  AppendBytes(out, "ID3");
+  out.push_back(3);
+  out.push_back(0);
+  out.push_back(0);
+  for (int shift = 21; shift >= 0; shift -= 7) {
+    out.push_back(static_cast<uint8_t>((tag_size >> shift) & 0x7F));  //syncsafe
+  }
+  return out;
+}
+
+std::vector<uint8_t> MakeId3() {
+  std::vector<uint8_t> frames;
+  AppendId3Frame(frames, "TIT2", "Id3 Title");
+  AppendId3Frame(frames, "TPE1", "Id3 Artist");
+  AppendId3Frame(frames, "TALB", "Id3 Album");
+  frames.resize(frames.size() + 16, 0);  //padding
+
+  std::vector<uint8_t> out = Id3Header(static_cast<uint32_t>(frames.size()));
+  out.insert(out.end(), frames.begin(), frames.end());
+  return out;
+}
+
+/// FLAC metadata block header (type, 24 bit length)
+void AppendFlacBlock(std::vector<uint8_t>& out, int type, bool last,
+                     const std::vector<uint8_t>& body) {
+  out.push_back(static_cast<uint8_t>((last ? 0x80 : 0) | type));
+  out.push_back(static_cast<uint8_t>(body.size() >> 16));
+  out.push_back(static_cast<uint8_t>(body.size() >> 8));
+  out.push_back(static_cast<uint8_t>(body.size()));
+  out.insert(out.end(), body.begin(), body.end());
+}
+
+/// 44.1 kHz, 2 channels, 16 bit, 441000 samples => 10 s
+std::vector<uint8_t> FlacStreamInfo() {
+  std::vector<uint8_t> info = {0x10, 0x00, 0x10, 0x00, 0, 0, 0, 0, 0, 0};
+  uint64_t packed = (uint64_t{44100} << 44) | (uint64_t{2 - 1} << 41) |
+                    (uint64_t{16 - 1} << 36) | 441000;
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    info.push_back(static_cast<uint8_t>(packed >> shift));
+  }
+  info.resize(34, 0);  //MD5
+  return info;
+}
+
+std::vector<uint8_t> VorbisComment(const std::vector<std::string>& comments, uint32_t count) {
+  std::vector<uint8_t> body;
+  AppendLE32(body, 6);
+  AppendBytes(body, "vendor");
+  AppendLE32(body, count);
+  for (const auto& comment : comments) {
+    AppendLE32(body, static_cast<uint32_t>(comment.size()));
+    AppendBytes(body, comment);
+  }
+  return body;
+}
+
+std::vector<uint8_t> MakeFlac() {
+  std::vector<uint8_t> out;
+  AppendBytes(out, "fLaC");
+  AppendFlacBlock(out, 0, false, FlacStreamInfo());
+  AppendFlacBlock(out, 4, true, VorbisComment({"TITLE=Flac Title", "ARTIST=Flac Artist"}, 2));
+  out.resize(out.size() + 32, 0xFF);  //stands for the first frame
+  return out;
+}
+
+/// MP4 atom header with a 64 bit size and no body
+std::vector<uint8_t> LargeAtom(const std::string& type, uint64_t large_size) {
+  std::vector<uint8_t> out;
+  AppendBE32(out, 1);
+  AppendBytes(out, type);
+  AppendBE32(out, static_cast<uint32_t>(large_size >> 32));
+  AppendBE32(out, static_cast<uint32_t>(large_size));
+  return out;
+}
+
+/// MP4 atom around `body`
+std::vector<uint8_t> Atom(const std::string& type, const std::vector<uint8_t>& body) {
+  std::vector<uint8_t> out;
+  AppendBE32(out, static_cast<uint32_t>(body.size() + 8));
+  AppendBytes(out, type);
+  out.insert(out.end(), body.begin(), body.end());
+  return out;
+}
+
+std::vector<uint8_t> Mp4Text(const std::string& type, const std::string& text) {
+  std::vector<uint8_t> data;
+  AppendBE32(data, 1);  //UTF-8
+  AppendBE32(data, 0);  //locale
+  AppendBytes(data, text);
+  return Atom(type, Atom("data", data));
+}
+
+std::vector<uint8_t> Concat(std::initializer_list<std::vector<uint8_t>> parts) {
+  std::vector<uint8_t> out;
+  for (const auto& part : parts) {
+    out.insert(out.end(), part.begin(), part.end());
+  }
+  return out;
+}
+
+std::vector<uint8_t> Mp4Ftyp() {
+  std::vector<uint8_t> ftyp;
+  AppendBytes(ftyp, "M4A ");
+  AppendBE32(ftyp, 0);
+  AppendBytes(ftyp, "M4A isom");
+  return Atom("ftyp", ftyp);
+}
+
+std::vector<uint8_t> MakeMp4() {
+  //mvhd version 0: times, timescale 1000, duration 5000 => 5 s
+  std::vector<uint8_t> mvhd(100, 0);
+  mvhd[15] = 0xE8;
+  mvhd[14] = 0x03;
+  mvhd[18] = 0x13;
+  mvhd[19] = 0x88;
+
+  std::vector<uint8_t> meta_body(4, 0);  //full box version/flags
+  auto ilst = Atom("ilst", Concat({Mp4Text("\xA9nam", "Mp4 Title"), Mp4Text("\xA9" "ART", "Mp4 Artist")}));
+  meta_body.insert(meta_body.end(), ilst.begin(), ilst.end());
+
+  auto moov = Atom("moov", Concat({Atom("mvhd", mvhd), Atom("udta", Atom("meta", meta_body))}));
+  return Concat({Mp4Ftyp(), moov, Atom("mdat", std::vector<uint8_t>(32, 0))});
+}
+
+/// PCM WAV with a LIST/INFO chunk: 8 kHz mono 8 bit, 16000 bytes => 2 s
+std::vector<uint8_t> MakeWav() {
+  std::vector<uint8_t> fmt;
+  AppendLE16(fmt, 1);
+  AppendLE16(fmt, 1);
+  AppendLE32(fmt, 8000);
+  AppendLE32(fmt, 8000);
+  AppendLE16(fmt, 1);
+  AppendLE16(fmt, 8);
+
+  std::vector<uint8_t> info;
+  AppendBytes(info, "INFO");
+  AppendBytes(info, "INAM");
+  AppendLE32(info, 10);
+  AppendBytes(info, "Wav Title!");
+
+  std::vector<uint8_t> body;
+  AppendBytes(body, "WAVE");
+  AppendBytes(body, "fmt ");
+  AppendLE32(body, static_cast<uint32_t>(fmt.size()));
+  body.insert(body.end(), fmt.begin(), fmt.end());
+  AppendBytes(body, "LIST");
+  AppendLE32(body, static_cast<uint32_t>(info.size()));
+  body.insert(body.end(), info.begin(), info.end());
+  AppendBytes(body, "data");
+  AppendLE32(body, 16000);
+  body.resize(body.size() + 16000, 0x80);
+
+  std::vector<uint8_t> out;
+  AppendBytes(out, "RIFF");
+  AppendLE32(out, static_cast<uint32_t>(body.size()));
+  out.insert(out.end(), body.begin(), body.end());
+  return out;
+}
+
+std::optional<TagInfo> ReadBytes(TagReader& reader, const TempDir& dir,
+                                 const std::vector<uint8_t>& bytes) {
+  std::string path = dir.File("input");
+  if (!WriteFile(path, bytes)) {
+    CHECK(false);
+    return std::nullopt;
+  }
+  return reader.Read(path);
+}
+
+void TestWellFormed(TagReader& reader, const TempDir& dir) {
+  auto id3 = ReadBytes(reader, dir, MakeId3());
+  CHECK(id3.has_value());
+  if (id3) {
+    CHECK_EQ(id3->GetTag("title", ""), std::string("Id3 Title"));
+    CHECK_EQ(id3->GetTag("artist", ""), std::string("Id3 Artist"));
+    CHECK_EQ(id3->GetTag("album", ""), std::string("Id3 Album"));
+  }
+
+  auto flac = ReadBytes(reader, dir, MakeFlac());
+  CHECK(flac.has_value());
+  if (flac) {
+    CHECK_EQ(flac->GetTag("title", ""), std::string("Flac Title"));
+    CHECK_EQ(flac->GetTag("artist", ""), std::string("Flac Artist"));
+    CHECK_EQ(flac->duration_ms, int64_t{10000});
+    CHECK(flac->duration_accuracy == DurationAccuracy::EXACT);
+    CHECK_EQ(flac->sample_rate, 44100);
+    CHECK_EQ(flac->channels, 2);
+    CHECK_EQ(flac->bit_depth, 16);
+  }
+
+  auto mp4 = ReadBytes(reader, dir, MakeMp4());
+  CHECK(mp4.has_value());
+  if (mp4) {
+    CHECK_EQ(mp4->GetTag("title", ""), std::string("Mp4 Title"));
+    CHECK_EQ(mp4->GetTag("artist", ""), std::string("Mp4 Artist"));
+    CHECK_EQ(mp4->duration_ms, int64_t{5000});
+  }
+
+  auto wav = ReadBytes(reader, dir, MakeWav());
+  CHECK(wav.has_value());
+  if (wav) {
+    CHECK_EQ(wav->GetTag("title", ""), std::string("Wav Title!"));
+    CHECK_EQ(wav->duration_ms, int64_t{2000});
+    CHECK(wav->HasTrustedDuration());
+  }
+}
+
+/// Prefixes of a valid file (every one over the headers) must read without
+/// crashing or hanging
+void TestTruncated(TagReader& reader, const TempDir& dir, const std::vector<uint8_t>& bytes) {
+  for (size_t length = 0; length < bytes.size(); length += length < 1024 ? 1 : 997) {
+    std::vector<uint8_t> prefix(bytes.begin(), bytes.begin() + length);
+    auto info = ReadBytes(reader, dir, prefix);
+    if (length < 12) {
+      CHECK(!info.has_value());
+    }
+  }
+}
+
+/// Tags in front of (or behind) 8 MB of audio: only the tag regions are read
+void TestBoundedIo(TagReader& reader, const TempDir& dir) {
+  const std::vector<uint8_t> audio(8 * 1024 * 1024, 0);
+
+  auto wav = MakeWav();
+  auto wav_data = Concat({std::vector<uint8_t>{'d', 'a', 't', 'a', 0x00, 0x00, 0x80, 0x00}, audio});
+  //large data chunk ahead of the original chunks, RIFF size patched to match
+  wav.insert(wav.begin() + 12, wav_data.begin(), wav_data.end());
+  uint32_t riff_size = static_cast<uint32_t>(wav.size() - 8);
+  for (int i = 0; i < 4; ++i) wav[4 + i] = static_cast<uint8_t>(riff_size >> (8 * i));
+
+  auto mp4 = MakeMp4();
+  auto moov_at = mp4.size() - 40;  //mdat(32 zero bytes) is last
+  std::vector<uint8_t> mdat_first = Concat({Mp4Ftyp(), Atom("mdat", audio)});
+  mdat_first.insert(mdat_first.end(), mp4.begin() + Mp4Ftyp().size(), mp4.begin() + moov_at);
+
+  const std::vector<std::pair<const char*, std::vector<uint8_t>>> files = {
+    {"id3", Concat({MakeId3(), audio})},
+    {"flac", Concat({MakeFlac(), audio})},
+    {"wav", wav},
+    {"mp4", mdat_first},
+  };
+  for (const auto& file : files) {
+    std::string path = dir.File(file.first);
+    CHECK(WriteFile(path, file.second));
+    TagReadIo io;
+    auto info = reader.Read(path, &io);
+    CHECK(info.has_value());
+    if (info) {
+      CHECK(!info->GetTag("title", "").empty());  //tags behind the audio were still found
+    }
+    CHECK_EQ(io.file_size, uint64_t{file.second.size()});
+    if (io.bytes_read * 100 >= io.file_size) {
+      std::cerr << file.first << ": read " << io.bytes_read << " of " << io.file_size << " bytes" << std::endl;
+      CHECK(false);
+    }
+  }
+}
+
+/// Every byte of a valid file set to 0x00 and 0xFF in turn (sizes, counts,
+/// flags and versions all end up zero or huge somewhere)
+void TestCorrupted(TagReader& reader, const TempDir& dir, const std::vector<uint8_t>& bytes) {
+  size_t limit = std::min<size_t>(bytes.size(), 512);
+  for (size_t i = 0; i < limit; ++i) {
+    for (uint8_t value : {uint8_t{0x00}, uint8_t{0xFF}}) {
+      std::vector<uint8_t> corrupted = bytes;
+      corrupted[i] = value;
+      ReadBytes(reader, dir, corrupted);
+    }
+  }
+}
+
+void TestMalformedId3(TagReader& reader, const TempDir& dir) {
+  //tag size far past the end of the file
+  auto oversized = Id3Header(0x0FFFFFFF);
+  AppendId3Frame(oversized, "TIT2", "Kept");
+  auto info = ReadBytes(reader, dir, oversized);
+  CHECK(info.has_value());
+
+  //second frame claims more bytes than the tag holds => dropped, first one kept
+  std::vector<uint8_t> frames;
+  AppendId3Frame(frames, "TIT2", "First");
+  AppendBytes(frames, "TPE1");
+  AppendBE32(frames, 0x7FFFFFF0);
+  frames.insert(frames.end(), {0, 0, 0});
+  AppendBytes(frames, "Overflow");
+  auto overflowing = Id3Header(static_cast<uint32_t>(frames.size()));
+  overflowing.insert(overflowing.end(), frames.begin(), frames.end());
+  info = ReadBytes(reader, dir, overflowing);
+  CHECK(info.has_value());
+  if (info) {
+    CHECK_EQ(info->GetTag("title", ""), std::string("First"));
+    CHECK_EQ(info->GetTag("artist", ""), std::string(""));
+  }
+
+  //unsupported version => not an ID3 tag, nothing else to read either
+  auto future = MakeId3();
+  future[3] = 9;
+  CHECK(!ReadBytes(reader, dir, future).has_value());
+}
+
+void TestMalformedFlac(TagReader& reader, const TempDir& dir) {
+  //comment count far above what the block holds
+  std::vector<uint8_t> counted;
+  AppendBytes(counted, "fLaC");
+  AppendFlacBlock(counted, 0, false, FlacStreamInfo());
+  AppendFlacBlock(counted, 4, true, VorbisComment({"TITLE=Only"}, 0xFFFFFFFF));
+  auto info = ReadBytes(reader, dir, counted);
+  CHECK(info.has_value());
+  if (info) {
+    CHECK_EQ(info->GetTag("title", ""), std::string("Only"));
+  }
+
+  //comment length past the end of its block
+  std::vector<uint8_t> comment_body;
+  AppendLE32(comment_body, 6);
+  AppendBytes(comment_body, "vendor");
+  AppendLE32(comment_body, 1);
+  AppendLE32(comment_body, 0xFFFFFFF0);
+  AppendBytes(comment_body, "TITLE=Cut");
+  std::vector<uint8_t> long_comment;
+  AppendBytes(long_comment, "fLaC");
+  AppendFlacBlock(long_comment, 0, false, FlacStreamInfo());
+  AppendFlacBlock(long_comment, 4, true, comment_body);
+  info = ReadBytes(reader, dir, long_comment);
+  if (info) {
+    CHECK_EQ(info->GetTag("title", ""), std::string(""));
+  }
+
+  //block length past the end of the file
+  std::vector<uint8_t> long_block;
+  AppendBytes(long_block, "fLaC");
+  AppendFlacBlock(long_block, 0, false, FlacStreamInfo());
+  long_block.insert(long_block.end(), {0x84, 0xFF, 0xFF, 0xFF});
+  AppendBytes(long_block, "short");
+  ReadBytes(reader, dir, long_block);
+
+  //first block isn't STREAMINFO and is never marked last
+  std::vector<uint8_t> no_streaminfo;
+  AppendBytes(no_streaminfo, "fLaC");
+  for (int i = 0; i < 64; ++i) {
+    AppendFlacBlock(no_streaminfo, 1, false, {});
+  }
+  ReadBytes(reader, dir, no_streaminfo);
+}
+
+void TestMalformedMp4(TagReader& reader, const TempDir& dir) {
+  auto title = Mp4Text("\xA9nam", "Mp4 Title");
+
+  //64 bit sizes that wrap the file offset around
+  for (uint64_t large_size : {uint64_t{0xFFFFFFFFFFFFFFF0}, ~uint64_t{0} - 19, uint64_t{16}}) {
+    auto large = LargeAtom("free", large_size);
+    ReadBytes(reader, dir, Concat({Mp4Ftyp(), large, Atom("moov", {})}));
+
+    //same inside moov and ilst
+    auto inner = Concat({large, Atom("udta", Atom("meta", Concat({std::vector<uint8_t>(4, 0),
+                                                                   Atom("ilst", Concat({large, title}))})))});
+    ReadBytes(reader, dir, Concat({Mp4Ftyp(), Atom("moov", inner)}));
+  }
+
+  //sizes of exactly 2^64 - offset: the next atom would start back at offset 0
+  //(getting here at all means Read() returned instead of looping or recursing)
+  auto ftyp = Mp4Ftyp();
+  const uint64_t top_offset = ftyp.size();
+  auto top_wrap = Concat({ftyp, LargeAtom("free", 0 - top_offset)});
+  CHECK(!ReadBytes(reader, dir, top_wrap).has_value());
+
+  //nested: a top level udta and moov both holding an atom that wraps to 0
+  const uint64_t udta_child = top_offset + 8;
+  auto udta = Atom("udta", LargeAtom("free", 0 - udta_child));
+  const uint64_t moov_child = top_offset + udta.size() + 8;
+  auto moov = Atom("moov", LargeAtom("free", 0 - moov_child));
+  auto nested_wrap = Concat({ftyp, udta, moov});
+  CHECK_EQ(nested_wrap.size(), size_t{72});
+  CHECK(ReadBytes(reader, dir, nested_wrap).has_value());
+
+  //wrapping to 0 from inside ilst, with a title after it that must not be read
+  std::vector<uint8_t> meta_body(4, 0);
+  const uint64_t ilst_child = top_offset + 8 + 8 + 8 + meta_body.size() + 8;  //moov, udta, meta, ilst
+  meta_body = Concat({meta_body, Atom("ilst", Concat({LargeAtom("free", 0 - ilst_child), title}))});
+  auto ilst_wrap = Concat({ftyp, Atom("moov", Atom("udta", Atom("meta", meta_body)))});
+  auto wrapped = ReadBytes(reader, dir, ilst_wrap);
+  CHECK(wrapped.has_value());
+  if (wrapped) {
+    CHECK_EQ(wrapped->GetTag("title", ""), std::string(""));
+  }
+
+  //atom sizes under the header size and zero (= up to the end)
+  for (uint32_t size : {0u, 4u, 7u}) {
+    std::vector<uint8_t> small;
+    AppendBE32(small, size);
+    AppendBytes(small, "udta");
+    auto info = ReadBytes(reader, dir, Concat({Mp4Ftyp(), Atom("moov", small)}));
+    CHECK(info.has_value());
+  }
+
+  //child bigger than its parent
+  std::vector<uint8_t> oversized_child;
+  AppendBE32(oversized_child, 0x00FFFFFF);
+  AppendBytes(oversized_child, "ilst");
+  ReadBytes(reader, dir, Concat({Mp4Ftyp(), Atom("moov", Atom("udta", oversized_child))}));
+
+  //deeply nested udta atoms
+  std::vector<uint8_t> nested = title;
+  for (int i = 0; i < 2000; ++i) {
+    nested = Atom("udta", nested);
+  }
+  ReadBytes(reader, dir, Concat({Mp4Ftyp(), Atom("moov", nested)}));
+
+  //no moov at all
+  CHECK(!ReadBytes(reader, dir, Concat({Mp4Ftyp(), Atom("mdat", std::vector<uint8_t>(64, 0))}))
+             .has_value());
+}
+
+}  // namespace
+
+int main() {
+  TempDir dir("tag_reader_test");
+  TagReader reader;
+
+  TestWellFormed(reader, dir);
+
+  for (const auto& bytes : {MakeId3(), MakeFlac(), MakeMp4(), MakeWav()}) {
+    TestTruncated(reader, dir, bytes);
+    TestCorrupted(reader, dir, bytes);
+  }
+
+  TestBoundedIo(reader, dir);
+  TestMalformedId3(reader, dir);
+  TestMalformedFlac(reader, dir);
+  TestMalformedMp4(reader, dir);
+
+  return Finish("TagReaderTest");
+}
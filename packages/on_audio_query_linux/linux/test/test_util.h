@@ -0,0 +1,114 @@
+#ifndef TEST_UTIL_H_
+#define TEST_UTIL_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <unistd.h>
+
+namespace on_audio_query_linux {
+namespace test {
+
+/// Failed checks of the running test binary
+inline int& FailureCount() {
+  static int failures = 0;
+  return failures;
+}
+
+/// Report a failed check without stopping (main returns the failure count)
+#define CHECK(condition)                                                           \
+  do {                                                                             \
+    if (!(condition)) {                                                            \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #condition    \
+                << std::endl;                                                      \
+      ++::on_audio_query_linux::test::FailureCount();                              \
+    }                                                                              \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                                 \
+  do {                                                                             \
+    const auto& actual_value = (actual);                                           \
+    const auto& expected_value = (expected);                                       \
+    if (!(actual_value == expected_value)) {                                       \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_EQ failed: " #actual    \
+                << " = " << actual_value << ", expected " << expected_value        \
+                << std::endl;                                                      \
+      ++::on_audio_query_linux::test::FailureCount();                              \
+    }                                                                              \
+  } while (0)
+
+/// Exit code of a test binary: 0 when every check passed
+inline int Finish(const char* name) {
+  int failures = FailureCount();
+  if (failures == 0) {
+    std::cout << "[" << name << "] all checks passed" << std::endl;
+  } else {
+    std::cerr << "[" << name << "] " << failures << " check(s) failed" << std::endl;
+  }
+  return failures == 0 ? 0 : 1;
+}
+
+/// Scratch directory removed with everything in it on destruction
+class TempDir {
+ public:
+  explicit TempDir(const std::string& name)
+      : path_(std::filesystem::temp_directory_path() /
+              (name + "_" + std::to_string(getpid()))) {
+    std::filesystem::remove_all(path_);
+    std::filesystem::create_directories(path_);
+  }
+  ~TempDir() {
+    std::error_code error;
+    std::filesystem::remove_all(path_, error);
+  }
+
+  TempDir(const TempDir&) = delete;
+  TempDir& operator=(const TempDir&) = delete;
+
+  std::string File(const std::string& name) const { return (path_ / name).string(); }
+  std::string Path() const { return path_.string(); }
+
+ private:
+  std::filesystem::path path_;
+};
+
+inline bool WriteFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  return file.good();
+}
+
+inline std::string ReadTextFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/// Little helpers to assemble binary headers
+inline void AppendBytes(std::vector<uint8_t>& out, const std::string& text) {
+  out.insert(out.end(), text.begin(), text.end());
+}
+
+inline void AppendBE32(std::vector<uint8_t>& out, uint32_t value) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    out.push_back(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+inline void AppendLE16(std::vector<uint8_t>& out, uint16_t value) {
+  out.push_back(static_cast<uint8_t>(value));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+inline void AppendLE32(std::vector<uint8_t>& out, uint32_t value) {
+  for (int shift = 0; shift <= 24; shift += 8) {
+    out.push_back(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+}  // namespace test
+}  // namespace on_audio_query_linux
+
+#endif  // TEST_UTIL_H_
@@ -28,6 +28,13 @@ class MethodChannelOnAudioQuery extends OnAudioQueryPlatform {
 
   LogConfig _logConfig = LogConfig();
 
+  // Song changes pushed by the native side (see [onSongsChanged]).
+  StreamController<List<int>>? _songsChangedController;
+
+  // Artwork batches still waiting for native "onArtwork" events (see [queryArtworks]).
+  final Map<int, _ArtworkBatch> _artworkBatches = {};
+  int _nextArtworkRequestId = 0;
+
   @override
   Future<void> setLogConfig(LogConfig? logConfig) async {
     // Override log configuration
@@ -184,6 +191,25 @@ class MethodChannelOnAudioQuery extends OnAudioQueryPlatform {
     return resultFilters;
   }
 
+  @override
+  Future<List<SongModel>?> searchAsYouType(
+    String argsVal, {
+    int sessionId = 0,
+  }) async {
+    final List<dynamic>? resultSearch = await _channel.invokeMethod(
+      "searchSession",
+      {"sessionId": sessionId, "argsVal": argsVal},
+    );
+    return resultSearch?.map((songInfo) => SongModel(songInfo)).toList();
+  }
+
+  @override
+  Future<bool> closeSearchSession({int sessionId = 0}) async {
+    return await _channel.invokeMethod('closeSearchSession', {
+      "sessionId": sessionId,
+    });
+  }
+
   @override
   Future<Uint8List?> queryArtwork(
     int id,
@@ -205,6 +231,42 @@ class MethodChannelOnAudioQuery extends OnAudioQueryPlatform {
     return finalArtworks;
   }
 
+  @override
+  Stream<MapEntry<int, Uint8List?>> queryArtworks(
+    List<int> ids,
+    ArtworkType type, {
+    ArtworkFormat? format,
+    int? size,
+    int? quality,
+  }) {
+    final int requestId = _nextArtworkRequestId++;
+    final _ArtworkBatch batch = _ArtworkBatch();
+    _artworkBatches[requestId] = batch;
+    _setCallHandler();
+
+    _channel.invokeMethod("queryArtworks", {
+      "requestId": requestId,
+      "ids": ids,
+      "type": type.index,
+      "format": format != null ? format.index : ArtworkFormat.JPEG.index,
+      "size": size ?? 200,
+      "quality": (quality != null && quality <= 100) ? quality : 50,
+    }).then((result) {
+      // Cached artworks come with the reply, the others as "onArtwork" events.
+      final Map<dynamic, dynamic> artworks = result["artworks"];
+      artworks.forEach((id, artwork) {
+        batch.controller.add(MapEntry(id as int, artwork as Uint8List?));
+      });
+      batch.pending = result["pending"] as int;
+      if (batch.isDone) _closeArtworkBatch(requestId);
+    }).catchError((Object error) {
+      batch.controller.addError(error);
+      _closeArtworkBatch(requestId);
+    });
+
+    return batch.controller.stream;
+  }
+
   @override
   Future<List<SongModel>> queryFromFolder(
     String path, {
@@ -341,4 +403,99 @@ class MethodChannelOnAudioQuery extends OnAudioQueryPlatform {
       "path": path,
     });
   }
+
+  @override
+  Future<dynamic> queryScanStats({bool asJson = false}) async {
+    return await _channel.invokeMethod('queryScanStats', {
+      "asJson": asJson,
+    });
+  }
+
+  @override
+  Future<bool> setScanOptions({
+    bool? fastFirstScan,
+    int? extractorTimeoutMs,
+    bool? indexArtwork,
+    int? artworkThumbnailSize,
+  }) async {
+    return await _channel.invokeMethod('setScanOptions', {
+      "fastFirstScan": fastFirstScan,
+      "extractorTimeoutMs": extractorTimeoutMs,
+      "indexArtwork": indexArtwork,
+      "artworkThumbnailSize": artworkThumbnailSize,
+    });
+  }
+
+  @override
+  Future<bool> setArtworkOptions({
+    List<String>? coverFileNames,
+    int? cacheMaxBytes,
+    bool? systemThumbnails,
+  }) async {
+    return await _channel.invokeMethod('setArtworkOptions', {
+      "coverFileNames": coverFileNames,
+      "cacheMaxBytes": cacheMaxBytes,
+      "systemThumbnails": systemThumbnails,
+    });
+  }
+
+  @override
+  Future<List<Map<dynamic, dynamic>>> queryQuarantinedFiles() async {
+    final List<dynamic> resultQuarantine =
+        await _channel.invokeMethod('queryQuarantinedFiles');
+    return resultQuarantine.map((e) => Map<dynamic, dynamic>.from(e)).toList();
+  }
+
+  @override
+  Future<bool> clearQuarantine({String? path}) async {
+    return await _channel.invokeMethod('clearQuarantine', {
+      "path": path,
+    });
+  }
+
+  @override
+  Stream<List<int>> get onSongsChanged {
+    if (_songsChangedController == null) {
+      _songsChangedController = StreamController<List<int>>.broadcast();
+      _setCallHandler();
+    }
+    return _songsChangedController!.stream;
+  }
+
+  // Every event pushed by the native side goes through a single handler.
+  void _setCallHandler() {
+    _channel.setMethodCallHandler((call) async {
+      switch (call.method) {
+        case "onSongsChanged":
+          final List<dynamic> ids = call.arguments;
+          _songsChangedController?.add(ids.cast<int>());
+          break;
+        case "onArtwork":
+          final int requestId = call.arguments["requestId"];
+          final _ArtworkBatch? batch = _artworkBatches[requestId];
+          if (batch == null) break;
+          batch.controller.add(MapEntry(
+            call.arguments["id"] as int,
+            call.arguments["artwork"] as Uint8List?,
+          ));
+          batch.received++;
+          if (batch.isDone) _closeArtworkBatch(requestId);
+          break;
+      }
+    });
+  }
+
+  void _closeArtworkBatch(int requestId) {
+    _artworkBatches.remove(requestId)?.controller.close();
+  }
+}
+
+// A [queryArtworks] call: [pending] is only known once the native side replied.
+class _ArtworkBatch {
+  final StreamController<MapEntry<int, Uint8List?>> controller =
+      StreamController<MapEntry<int, Uint8List?>>();
+  int? pending;
+  int received = 0;
+
+  bool get isDone => pending != null && received >= pending!;
 }
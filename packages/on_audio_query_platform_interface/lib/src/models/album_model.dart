@@ -20,6 +20,21 @@ class AlbumModel {
   /// Return album [numOfSongs]
   int get numOfSongs => _info["numsongs"] ?? 0;
 
+  /// Return the dominant colours of the album artwork (ARGB, most common first),
+  /// usable as a placeholder while the artwork loads
+  ///
+  /// Important:
+  ///   * Only Linux
+  ///   * Null until the artwork was cached or indexed by a scan
+  List<int>? get artworkColors => (_info["artwork_colors"] as List?)?.cast<int>();
+
+  /// Return the [BlurHash](https://blurha.sh) of the album artwork
+  ///
+  /// Important:
+  ///   * Only Linux
+  ///   * Null until the artwork was cached or indexed by a scan
+  String? get artworkBlurhash => _info["artwork_blurhash"];
+
   /// Return a map with all [keys] and [values] from specific album.
   Map get getMap => _info;
 
@@ -80,6 +80,54 @@ class SongModel {
     return null;
   }
 
+  /// Return song [albumArtist]
+  String? get albumArtist => _info["album_artist"];
+
+  /// Return song [bitrate] (bits per second, average for VBR)
+  ///
+  /// Important:
+  ///   * Only Linux
+  int? get bitrate => _info["bitrate"];
+
+  /// Return song [sampleRate] (Hz)
+  ///
+  /// Important:
+  ///   * Only Linux
+  int? get sampleRate => _info["sample_rate"];
+
+  /// Return song [bitDepth] (bits per sample, 0 for lossy codecs)
+  ///
+  /// Important:
+  ///   * Only Linux
+  int? get bitDepth => _info["bit_depth"];
+
+  /// Return song [channels]
+  ///
+  /// Important:
+  ///   * Only Linux
+  int? get channels => _info["channels"];
+
+  /// Return song [codec] (ffmpeg codec name, e.g. "flac", "mp3", "aac")
+  ///
+  /// Important:
+  ///   * Only Linux
+  String? get codec => _info["codec"];
+
+  /// Return the dominant colours of the song artwork (ARGB, most common first),
+  /// usable as a placeholder while the artwork loads
+  ///
+  /// Important:
+  ///   * Only Linux
+  ///   * Null until the artwork was cached or indexed by a scan
+  List<int>? get artworkColors => (_info["artwork_colors"] as List?)?.cast<int>();
+
+  /// Return the [BlurHash](https://blurha.sh) of the song artwork
+  ///
+  /// Important:
+  ///   * Only Linux
+  ///   * Null until the artwork was cached or indexed by a scan
+  String? get artworkBlurhash => _info["artwork_blurhash"];
+
   // /// Return song [uri]
   // String get uri;
 
@@ -6,6 +6,8 @@ enum ArtworkType {
   AUDIO,
 
   /// Artwork from Albums.
+  ///
+  /// * On Linux, the artwork most of the album audios embed.
   ALBUM,
 
   /// Artwork from Playlists.
@@ -21,12 +23,14 @@ enum ArtworkType {
   ///
   /// * There's no native support for [Artists] artwork so, we take the artwork from
   /// the first audio.
+  /// * On Linux, the artwork most of the artist audios embed.
   ARTIST,
 
   /// Artwork from Genres.
   ///
   /// * There's no native support for [Genres] artwork so, we take the artwork from
   /// the first audio.
+  /// * On Linux, the artwork most of the genre audios embed.
   GENRE,
 }
 